@@ -0,0 +1,175 @@
+/**
+ * @file benchmark_harness.h
+ * @brief Minimal dependency-free benchmark runner with JSON output
+ *
+ * Each benchmark body receives a BenchmarkState with an iteration count
+ * and runs the measured operation that many times. The runner calibrates
+ * the iteration count to a minimum sample time, collects several samples
+ * and reports per-operation statistics as one JSON document on stdout.
+ */
+
+#pragma once
+
+#include <algorithm>
+#include <chrono>
+#include <cstdio>
+#include <cstring>
+#include <functional>
+#include <string>
+#include <vector>
+
+namespace puuyapu {
+namespace bench {
+
+    /**
+     * @brief Timing state handed to a benchmark body
+     * Timing runs from body start to body end; pause around untimed setup.
+     */
+    class BenchmarkState {
+    public:
+        explicit BenchmarkState(size_t iterations) noexcept : iterations_(iterations) {}
+
+        size_t iterations() const noexcept { return iterations_; }
+
+        void pauseTiming() noexcept {
+            if (running_) {
+                elapsed_ += std::chrono::steady_clock::now() - start_;
+                running_ = false;
+            }
+        }
+
+        void resumeTiming() noexcept {
+            if (!running_) {
+                start_ = std::chrono::steady_clock::now();
+                running_ = true;
+            }
+        }
+
+        std::chrono::nanoseconds elapsed() const noexcept { return elapsed_; }
+
+    private:
+        size_t iterations_;
+        bool running_{false};
+        std::chrono::steady_clock::time_point start_;
+        std::chrono::nanoseconds elapsed_{0};
+    };
+
+    /// Keeps the optimizer from discarding a computed value
+    template <typename T>
+    inline void doNotOptimize(const T& value) noexcept {
+        asm volatile("" : : "r,m"(value) : "memory");
+    }
+
+    struct BenchmarkResult {
+        std::string name;
+        size_t iterations{0};               ///< Per sample
+        size_t samples{0};
+        size_t items_per_op{1};
+        double ns_per_op_min{0};
+        double ns_per_op_median{0};
+        double ns_per_op_mean{0};
+        double ns_per_op_max{0};
+    };
+
+    /**
+     * @brief Registers, runs and reports benchmarks
+     */
+    class BenchmarkRunner {
+    public:
+        using Body = std::function<void(BenchmarkState&)>;
+
+        static constexpr size_t SAMPLE_COUNT = 11;
+
+        BenchmarkRunner(std::string filter, std::chrono::milliseconds min_sample_time)
+                : filter_(std::move(filter)), min_sample_time_(min_sample_time) {}
+
+        /**
+         * @brief Run one benchmark unless filtered out
+         * @param name Stable identifier ("operation/size")
+         * @param items_per_op Items processed per iteration (for throughput)
+         * @param body Measured operation
+         */
+        void run(const std::string& name, size_t items_per_op, const Body& body) {
+            if (!filter_.empty() && name.find(filter_) == std::string::npos) {
+                return;
+            }
+            std::fprintf(stderr, "running %s\n", name.c_str());
+
+            // Calibrate: grow iterations until one sample reaches the minimum time
+            size_t iterations = 1;
+            for (;;) {
+                auto elapsed = measure(body, iterations);
+                if (elapsed >= min_sample_time_ || iterations >= MAX_ITERATIONS) {
+                    break;
+                }
+                double scale = elapsed.count() > 0
+                        ? 1.4 * static_cast<double>(min_sample_time_.count()) / static_cast<double>(elapsed.count())
+                        : 10.0;
+                scale = std::min(std::max(scale, 2.0), 10.0);
+                iterations = std::min(MAX_ITERATIONS, static_cast<size_t>(static_cast<double>(iterations) * scale));
+            }
+
+            std::vector<double> per_op;
+            per_op.reserve(SAMPLE_COUNT);
+            for (size_t i = 0; i < SAMPLE_COUNT; ++i) {
+                auto elapsed = measure(body, iterations);
+                per_op.push_back(static_cast<double>(elapsed.count()) / static_cast<double>(iterations));
+            }
+            std::sort(per_op.begin(), per_op.end());
+
+            BenchmarkResult result;
+            result.name = name;
+            result.iterations = iterations;
+            result.samples = per_op.size();
+            result.items_per_op = items_per_op;
+            result.ns_per_op_min = per_op.front();
+            result.ns_per_op_median = per_op[per_op.size() / 2];
+            result.ns_per_op_max = per_op.back();
+            for (double value : per_op) {
+                result.ns_per_op_mean += value / static_cast<double>(per_op.size());
+            }
+            results_.push_back(result);
+        }
+
+        /**
+         * @brief Write all results as JSON
+         */
+        void writeJson(FILE* out) const {
+            std::fprintf(out, "{\n  \"context\": {\"min_sample_ms\": %lld, \"samples\": %zu},\n",
+                         static_cast<long long>(min_sample_time_.count()), SAMPLE_COUNT);
+            std::fprintf(out, "  \"benchmarks\": [\n");
+            for (size_t i = 0; i < results_.size(); ++i) {
+                const BenchmarkResult& r = results_[i];
+                double items_per_second = r.ns_per_op_median > 0
+                        ? 1e9 * static_cast<double>(r.items_per_op) / r.ns_per_op_median
+                        : 0.0;
+                std::fprintf(out,
+                             "    {\"name\": \"%s\", \"iterations\": %zu, \"samples\": %zu, "
+                             "\"ns_per_op_min\": %.1f, \"ns_per_op_median\": %.1f, "
+                             "\"ns_per_op_mean\": %.1f, \"ns_per_op_max\": %.1f, "
+                             "\"items_per_second\": %.0f}%s\n",
+                             r.name.c_str(), r.iterations, r.samples,
+                             r.ns_per_op_min, r.ns_per_op_median, r.ns_per_op_mean, r.ns_per_op_max,
+                             items_per_second, i + 1 < results_.size() ? "," : "");
+            }
+            std::fprintf(out, "  ]\n}\n");
+        }
+
+    private:
+        static constexpr size_t MAX_ITERATIONS = 100000000;
+
+        static std::chrono::nanoseconds measure(const Body& body, size_t iterations) {
+            BenchmarkState state(iterations);
+            state.resumeTiming();
+            body(state);
+            state.pauseTiming();
+            return state.elapsed();
+        }
+
+        std::string filter_;
+        std::chrono::milliseconds min_sample_time_;
+        std::vector<BenchmarkResult> results_;
+    };
+
+} // namespace bench
+} // namespace puuyapu
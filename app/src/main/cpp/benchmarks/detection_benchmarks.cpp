@@ -0,0 +1,404 @@
+/**
+ * @file detection_benchmarks.cpp
+ * @brief Host microbenchmarks for the detection hot paths
+ *
+ * Covers event ingestion, sleep detection over 1k/10k/100k event
+ * histories, gap detection and the DataProcessor serializers. Results
+ * are written to stdout as JSON so they can be diffed across releases.
+ *
+ * Usage: puuyapu_benchmarks [--filter <substring>] [--min-time-ms <ms>]
+ */
+
+#include "benchmark_harness.h"
+#include "synthetic_events.h"
+#include "sleep_detector.h"
+#include "event_timeline.h"
+#include "data_processor.h"
+#include "session_archive.h"
+#include <cstdlib>
+#include <cstring>
+#include <random>
+#include <fcntl.h>
+#include <unistd.h>
+#include <memory>
+
+using namespace puuyapu;
+using namespace puuyapu::bench;
+
+namespace {
+
+    struct Fixture {
+        SyntheticStream stream;
+        std::unique_ptr<SleepDetector> detector;
+    };
+
+    Fixture makeFixture(size_t event_count, size_t days) {
+        Fixture fixture;
+        fixture.stream = SyntheticEventGenerator().generate(event_count, days);
+        fixture.detector = std::make_unique<SleepDetector>(UserPreferences{});
+        fixture.detector->addInteractionEvents(fixture.stream.events.data(), fixture.stream.events.size());
+        return fixture;
+    }
+
+    void registerIngestion(BenchmarkRunner& runner) {
+        auto stream = SyntheticEventGenerator().generate(10000, 14);
+        auto span = stream.events.back().timestamp - stream.events.front().timestamp + std::chrono::hours(1);
+
+        // Steady state producer path: queue push, drained by a query every 1024 events
+        {
+            SleepDetector detector{UserPreferences{}};
+            size_t next = 0;
+            size_t lap = 0;
+            runner.run("add_interaction_event", 1, [&](BenchmarkState& state) {
+                for (size_t i = 0; i < state.iterations(); ++i) {
+                    InteractionEvent event = stream.events[next];
+                    event.timestamp += span * static_cast<int>(lap);
+                    detector.addInteractionEvent(event);
+
+                    if (++next == stream.events.size()) {
+                        next = 0;
+                        lap++;
+                    }
+                    if ((i & 1023) == 1023) {
+                        state.pauseTiming();
+                        doNotOptimize(detector.isCurrentlyAsleep(event.timestamp));
+                        state.resumeTiming();
+                    }
+                }
+            });
+        }
+
+        {
+            constexpr size_t BATCH = 1000;
+            SleepDetector detector{UserPreferences{}};
+            InteractionEventList batch(BATCH);
+            size_t next = 0;
+            size_t lap = 0;
+            runner.run("add_interaction_events/batch_1000", BATCH, [&](BenchmarkState& state) {
+                for (size_t i = 0; i < state.iterations(); ++i) {
+                    state.pauseTiming();
+                    for (auto& event : batch) {
+                        event = stream.events[next];
+                        event.timestamp += span * static_cast<int>(lap);
+                        if (++next == stream.events.size()) {
+                            next = 0;
+                            lap++;
+                        }
+                    }
+                    state.resumeTiming();
+
+                    doNotOptimize(detector.addInteractionEvents(batch.data(), batch.size()));
+                }
+            });
+        }
+
+        // 10 seconds of 50 Hz accelerometer per batch, timestamps advancing across laps
+        {
+            constexpr size_t BATCH = 500;
+            constexpr int64_t PERIOD_NS = 20000000;
+            SleepDetector detector{UserPreferences{}};
+            std::vector<uint8_t> records(BATCH * AccelerometerRecord::SERIALIZED_SIZE, 0);
+            std::mt19937 rng(42);
+            std::normal_distribution<float> noise(0.0f, 0.3f);
+            for (size_t i = 0; i < BATCH; ++i) {
+                float axes[3] = {noise(rng), noise(rng), 9.80665f + noise(rng)};
+                std::memcpy(records.data() + i * AccelerometerRecord::SERIALIZED_SIZE + 8, axes, sizeof(axes));
+            }
+            int64_t clock_offset_ns = std::chrono::duration_cast<std::chrono::nanoseconds>(
+                    stream.now.time_since_epoch()).count();
+            int64_t next_ns = 0;
+            runner.run("add_accelerometer_samples/batch_500", BATCH, [&](BenchmarkState& state) {
+                for (size_t i = 0; i < state.iterations(); ++i) {
+                    state.pauseTiming();
+                    for (size_t k = 0; k < BATCH; ++k, next_ns += PERIOD_NS) {
+                        std::memcpy(records.data() + k * AccelerometerRecord::SERIALIZED_SIZE, &next_ns, sizeof(int64_t));
+                    }
+                    state.resumeTiming();
+
+                    doNotOptimize(detector.addAccelerometerSamples(records.data(), BATCH, clock_offset_ns));
+                }
+            });
+        }
+    }
+
+    void registerDetection(BenchmarkRunner& runner) {
+        struct Size {
+            const char* label;
+            size_t events;
+            size_t days;
+        };
+        constexpr Size SIZES[] = {{"1k", 1000, 7}, {"10k", 10000, 14}, {"100k", 100000, 30}};
+
+        for (const Size& size : SIZES) {
+            Fixture fixture = makeFixture(size.events, size.days);
+            SleepDetector& detector = *fixture.detector;
+            auto now = fixture.stream.now;
+
+            // Full analysis: invalidate the result cache before every call
+            runner.run(std::string("detect_sleep_period/") + size.label, 1, [&](BenchmarkState& state) {
+                for (size_t i = 0; i < state.iterations(); ++i) {
+                    state.pauseTiming();
+                    detector.clearOldData(std::chrono::system_clock::time_point{});
+                    state.resumeTiming();
+
+                    doNotOptimize(detector.detectSleepPeriod(now));
+                }
+            });
+        }
+
+        {
+            Fixture fixture = makeFixture(10000, 14);
+            SleepDetector& detector = *fixture.detector;
+            auto now = fixture.stream.now;
+            detector.detectSleepPeriod(now);
+
+            runner.run("detect_sleep_period_cached/10k", 1, [&](BenchmarkState& state) {
+                for (size_t i = 0; i < state.iterations(); ++i) {
+                    doNotOptimize(detector.detectSleepPeriod(now));
+                }
+            });
+
+            runner.run("borrow_sleep_period_cached/10k", 1, [&](BenchmarkState& state) {
+                for (size_t i = 0; i < state.iterations(); ++i) {
+                    auto borrowed = detector.borrowSleepPeriod(now);
+                    doNotOptimize(borrowed->duration);
+                }
+            });
+
+            runner.run("rank_sleep_candidates_cached/10k", 1, [&](BenchmarkState& state) {
+                for (size_t i = 0; i < state.iterations(); ++i) {
+                    doNotOptimize(detector.rankSleepCandidates(now).count);
+                }
+            });
+
+            auto from = fixture.stream.events.front().timestamp;
+            runner.run("detect_sleep_periods/14_nights", 14, [&](BenchmarkState& state) {
+                for (size_t i = 0; i < state.iterations(); ++i) {
+                    doNotOptimize(detector.detectSleepPeriods(from, now));
+                }
+            });
+
+            // Scratch-arena results, no per-night copies
+            runner.run("visit_sleep_periods/14_nights", 14, [&](BenchmarkState& state) {
+                for (size_t i = 0; i < state.iterations(); ++i) {
+                    doNotOptimize(detector.visitSleepPeriods(from, now,
+                            [](const SleepDetectionResult* results, size_t count) {
+                                doNotOptimize(count > 0 ? results[0].duration.count() : 0.0);
+                            }));
+                }
+            });
+
+            // The range pass above sealed the nights; statistics read the aggregate index
+            runner.run("get_sleep_statistics/14_nights", 1, [&](BenchmarkState& state) {
+                for (size_t i = 0; i < state.iterations(); ++i) {
+                    doNotOptimize(detector.getSleepStatistics(from, now).range.sessions);
+                }
+            });
+        }
+    }
+
+    void registerCandidateScoring(BenchmarkRunner& runner) {
+        // A full batch of synthetic windows: the scoring loop and ranking alone
+        SleepCandidateBatch batch;
+        auto bedtime = std::chrono::system_clock::time_point(std::chrono::hours(24 * 20000));
+        for (size_t i = 0; i < SleepCandidateBatch::CAPACITY; ++i) {
+            auto start = bedtime + std::chrono::hours(3 * i);
+            batch.add(start, start + std::chrono::minutes(240 + 17 * static_cast<int>(i)),
+                      static_cast<double>(i % 7) / 7.0, 1.0 - static_cast<double>(i % 5) / 10.0,
+                      i % 3 == 0, i == 11);
+        }
+
+        SleepCandidateRanking ranking;
+        runner.run("score_sleep_candidates/32", SleepCandidateBatch::CAPACITY, [&](BenchmarkState& state) {
+            for (size_t i = 0; i < state.iterations(); ++i) {
+                batch.score(7.5, ranking);
+                doNotOptimize(ranking.best().score);
+            }
+        });
+    }
+
+    void registerGaps(BenchmarkRunner& runner) {
+        constexpr auto MINIMUM_GAP = std::chrono::minutes(30);
+
+        for (size_t events : {10000, 100000}) {
+            auto stream = SyntheticEventGenerator().generate(events, events == 10000 ? 14 : 30);
+            std::string label = events == 10000 ? "10k" : "100k";
+
+            runner.run("detect_interaction_gaps/" + label, events, [&](BenchmarkState& state) {
+                for (size_t i = 0; i < state.iterations(); ++i) {
+                    doNotOptimize(InteractionAnalyzer::detectInteractionGaps(stream.events, MINIMUM_GAP));
+                }
+            });
+
+            // Engine path: the timeline's gap index rebuilt from its columns
+            EventTimeline timeline(MINIMUM_GAP);
+            for (const auto& event : stream.events) {
+                timeline.insert(event);
+            }
+            runner.run("timeline_gap_rebuild/" + label, events, [&](BenchmarkState& state) {
+                for (size_t i = 0; i < state.iterations(); ++i) {
+                    timeline.setMinimumGap(MINIMUM_GAP + std::chrono::milliseconds(i & 1));
+                    doNotOptimize(timeline.gaps().size());
+                }
+            });
+
+            // Preference change: bulk reclassification of the flag column
+            const ClassificationPolicy policies[2] = {
+                    ClassificationPolicy{},
+                    ClassificationPolicy::fromPreferences([] {
+                        UserPreferences preferences;
+                        preferences.time_check_threshold = std::chrono::seconds(45);
+                        return preferences;
+                    }())
+            };
+            runner.run("timeline_reclassify/" + label, events, [&](BenchmarkState& state) {
+                for (size_t i = 0; i < state.iterations(); ++i) {
+                    timeline.setClassificationPolicy(policies[(i + 1) & 1]);
+                    doNotOptimize(timeline.events().flagData());
+                }
+            });
+
+            // One night window located by binary search, then aggregated
+            auto night_start = stream.wake_times[stream.wake_times.size() / 2] - std::chrono::hours(19);
+            runner.run("timeline_range_night/" + label, 1, [&](BenchmarkState& state) {
+                for (size_t i = 0; i < state.iterations(); ++i) {
+                    EventRange night = timeline.range(night_start, night_start + std::chrono::hours(24));
+                    doNotOptimize(night.timeCheckCount() + static_cast<size_t>(night.totalDuration().count()));
+                }
+            });
+        }
+    }
+
+    void registerSerializers(BenchmarkRunner& runner) {
+        Fixture fixture = makeFixture(10000, 14);
+        auto sessions = fixture.detector->detectSleepPeriods(
+                fixture.stream.events.front().timestamp, fixture.stream.now);
+        if (sessions.empty()) {
+            std::fprintf(stderr, "no sessions detected, skipping serializer benchmarks\n");
+            return;
+        }
+
+        // Richest session: the one with the most interruptions
+        const SleepDetectionResult& session = *std::max_element(
+                sessions.begin(), sessions.end(),
+                [](const SleepDetectionResult& a, const SleepDetectionResult& b) {
+                    return a.interruptions.size() < b.interruptions.size();
+                });
+
+        runner.run("export_json/" + std::to_string(sessions.size()) + "_sessions", sessions.size(),
+                   [&](BenchmarkState& state) {
+                       for (size_t i = 0; i < state.iterations(); ++i) {
+                           doNotOptimize(DataProcessor::exportToJSON(sessions, true));
+                       }
+                   });
+
+        runner.run("export_csv/" + std::to_string(sessions.size()) + "_sessions", sessions.size(),
+                   [&](BenchmarkState& state) {
+                       for (size_t i = 0; i < state.iterations(); ++i) {
+                           doNotOptimize(DataProcessor::exportToCSV(sessions));
+                       }
+                   });
+
+        // Streaming path: fixed 4KB buffer flushed to a descriptor
+        int null_fd = ::open("/dev/null", O_WRONLY);
+        if (null_fd >= 0) {
+            FdSink sink(null_fd);
+            runner.run("export_json_stream/" + std::to_string(sessions.size()) + "_sessions", sessions.size(),
+                       [&](BenchmarkState& state) {
+                           for (size_t i = 0; i < state.iterations(); ++i) {
+                               doNotOptimize(DataProcessor::exportToJSON(sessions, sink, true));
+                           }
+                       });
+            runner.run("export_csv_stream/" + std::to_string(sessions.size()) + "_sessions", sessions.size(),
+                       [&](BenchmarkState& state) {
+                           for (size_t i = 0; i < state.iterations(); ++i) {
+                               doNotOptimize(DataProcessor::exportToCSV(sessions, sink));
+                           }
+                       });
+            ::close(null_fd);
+        }
+
+        // Archive: a year of nights cloned from the detected sessions
+        {
+            auto lap = *sessions.back().bedtime - *sessions.front().bedtime + std::chrono::hours(24);
+            std::vector<SleepDetectionResult> history;
+            for (size_t night = 0; night < 365; ++night) {
+                SleepDetectionResult copy = sessions[night % sessions.size()];
+                auto shift = lap * static_cast<int>(night / sessions.size());
+                *copy.bedtime += shift;
+                *copy.wake_time += shift;
+                for (auto& interruption : copy.interruptions) {
+                    interruption.timestamp += shift;
+                }
+                history.push_back(std::move(copy));
+            }
+
+            std::string path = "/tmp/puuyapu_bench_" + std::to_string(getpid()) + ".archive";
+            unlink(path.c_str());
+            SessionArchive archive;
+            if (archive.open(path) && archive.append(history) == history.size()) {
+                runner.run("archive_read_last_nights/30", 30, [&](BenchmarkState& state) {
+                    for (size_t i = 0; i < state.iterations(); ++i) {
+                        doNotOptimize(archive.readLastNights(30));
+                    }
+                });
+                runner.run("archive_open", 1, [&](BenchmarkState& state) {
+                    SessionArchive reader;
+                    for (size_t i = 0; i < state.iterations(); ++i) {
+                        doNotOptimize(reader.open(path));
+                    }
+                });
+            }
+            unlink(path.c_str());
+        }
+
+        std::vector<uint8_t> buffer(std::max<size_t>(DataProcessor::packedResultSize(session), 128));
+
+        runner.run("serialize_binary", 1, [&](BenchmarkState& state) {
+            for (size_t i = 0; i < state.iterations(); ++i) {
+                doNotOptimize(DataProcessor::serializeToBinary(session, buffer.data()));
+            }
+        });
+
+        runner.run("serialize_packed", 1, [&](BenchmarkState& state) {
+            for (size_t i = 0; i < state.iterations(); ++i) {
+                doNotOptimize(DataProcessor::serializePacked(session, buffer.data(), buffer.size()));
+            }
+        });
+
+        size_t packed_size = DataProcessor::serializePacked(session, buffer.data(), buffer.size());
+        runner.run("deserialize_packed", 1, [&](BenchmarkState& state) {
+            for (size_t i = 0; i < state.iterations(); ++i) {
+                doNotOptimize(DataProcessor::deserializePacked(buffer.data(), packed_size));
+            }
+        });
+    }
+}
+
+int main(int argc, char** argv) {
+    std::string filter;
+    long min_time_ms = 50;
+
+    for (int i = 1; i < argc; ++i) {
+        std::string arg = argv[i];
+        if (arg == "--filter" && i + 1 < argc) {
+            filter = argv[++i];
+        } else if (arg == "--min-time-ms" && i + 1 < argc) {
+            min_time_ms = std::max(1L, std::strtol(argv[++i], nullptr, 10));
+        } else {
+            std::fprintf(stderr, "Usage: %s [--filter <substring>] [--min-time-ms <ms>]\n", argv[0]);
+            return 2;
+        }
+    }
+
+    BenchmarkRunner runner(filter, std::chrono::milliseconds(min_time_ms));
+
+    registerIngestion(runner);
+    registerDetection(runner);
+    registerCandidateScoring(runner);
+    registerGaps(runner);
+    registerSerializers(runner);
+
+    runner.writeJson(stdout);
+    return 0;
+}
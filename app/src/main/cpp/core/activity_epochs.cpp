@@ -0,0 +1,297 @@
+/**
+ * @file activity_epochs.cpp
+ * @brief Motion kernels, sample decoding and the epoch ring
+ *
+ * The kernel works on four lanes at a time: squared magnitude by fused
+ * multiply-adds, a square root (AArch64 and SSE2 natively, a refined
+ * reciprocal estimate on ARMv7), then the ENMO sum, the movement count
+ * and the peak deviation without branches. The scalar loop is the
+ * reference and handles the tail on every backend.
+ */
+
+#include "activity_epochs.h"
+#include <algorithm>
+#include <cmath>
+
+#if !defined(PUUYAPU_NO_SIMD) && (defined(__ARM_NEON) || defined(__ARM_NEON__))
+#include <arm_neon.h>
+#define PUUYAPU_MOTION_NEON 1
+#elif !defined(PUUYAPU_NO_SIMD) && defined(__SSE2__)
+#include <emmintrin.h>
+#define PUUYAPU_MOTION_SSE2 1
+#endif
+
+namespace puuyapu {
+
+    namespace {
+        constexpr float STANDARD_GRAVITY = 9.80665f;
+        constexpr float INVERSE_GRAVITY = 1.0f / STANDARD_GRAVITY;
+
+        void scalarMotion(const float* x, const float* y, const float* z, size_t count,
+                          float threshold_g, MotionAccumulator& accumulator) noexcept {
+            for (size_t i = 0; i < count; ++i) {
+                float magnitude = std::sqrt(x[i] * x[i] + y[i] * y[i] + z[i] * z[i]);
+                float deviation = std::fabs(magnitude - 1.0f);
+                accumulator.enmo_sum += std::max(0.0f, magnitude - 1.0f);
+                accumulator.active += deviation > threshold_g ? 1u : 0u;
+                accumulator.peak_deviation = std::max(accumulator.peak_deviation, deviation);
+            }
+        }
+
+        uint16_t toMilliG(double g) noexcept {
+            return static_cast<uint16_t>(std::min(65535.0, std::max(0.0, g * 1000.0 + 0.5)));
+        }
+    }
+
+    void accumulateMotion(const float* x, const float* y, const float* z, size_t count,
+                          float threshold_g, MotionAccumulator& accumulator) noexcept {
+        size_t i = 0;
+
+#if defined(PUUYAPU_MOTION_NEON)
+        float32x4_t one = vdupq_n_f32(1.0f);
+        float32x4_t zero = vdupq_n_f32(0.0f);
+        float32x4_t threshold = vdupq_n_f32(threshold_g);
+        float32x4_t enmo = zero;
+        float32x4_t peak = zero;
+        uint32x4_t active = vdupq_n_u32(0);
+        for (; i + 4 <= count; i += 4) {
+            float32x4_t vx = vld1q_f32(x + i);
+            float32x4_t vy = vld1q_f32(y + i);
+            float32x4_t vz = vld1q_f32(z + i);
+            float32x4_t squared = vmlaq_f32(vmlaq_f32(vmulq_f32(vx, vx), vy, vy), vz, vz);
+#if defined(__aarch64__)
+            float32x4_t magnitude = vsqrtq_f32(squared);
+#else
+            // sqrt(s) = s * rsqrt(s), one Newton step; s == 0 stays 0
+            float32x4_t estimate = vrsqrteq_f32(vmaxq_f32(squared, vdupq_n_f32(1e-12f)));
+            estimate = vmulq_f32(estimate, vrsqrtsq_f32(vmulq_f32(squared, estimate), estimate));
+            float32x4_t magnitude = vmulq_f32(squared, estimate);
+#endif
+            float32x4_t excess = vsubq_f32(magnitude, one);
+            float32x4_t deviation = vabsq_f32(excess);
+            enmo = vaddq_f32(enmo, vmaxq_f32(excess, zero));
+            peak = vmaxq_f32(peak, deviation);
+            active = vsubq_u32(active, vcgtq_f32(deviation, threshold));   // true lanes are all ones (-1)
+        }
+        float enmo_lanes[4];
+        float peak_lanes[4];
+        uint32_t active_lanes[4];
+        vst1q_f32(enmo_lanes, enmo);
+        vst1q_f32(peak_lanes, peak);
+        vst1q_u32(active_lanes, active);
+        for (size_t lane = 0; lane < 4; ++lane) {
+            accumulator.enmo_sum += enmo_lanes[lane];
+            accumulator.active += active_lanes[lane];
+            accumulator.peak_deviation = std::max(accumulator.peak_deviation, peak_lanes[lane]);
+        }
+#elif defined(PUUYAPU_MOTION_SSE2)
+        const __m128 one = _mm_set1_ps(1.0f);
+        const __m128 zero = _mm_setzero_ps();
+        const __m128 threshold = _mm_set1_ps(threshold_g);
+        const __m128 sign_mask = _mm_castsi128_ps(_mm_set1_epi32(0x7FFFFFFF));
+        __m128 enmo = zero;
+        __m128 peak = zero;
+        __m128i active = _mm_setzero_si128();
+        for (; i + 4 <= count; i += 4) {
+            __m128 vx = _mm_loadu_ps(x + i);
+            __m128 vy = _mm_loadu_ps(y + i);
+            __m128 vz = _mm_loadu_ps(z + i);
+            __m128 squared = _mm_add_ps(_mm_add_ps(_mm_mul_ps(vx, vx), _mm_mul_ps(vy, vy)), _mm_mul_ps(vz, vz));
+            __m128 excess = _mm_sub_ps(_mm_sqrt_ps(squared), one);
+            __m128 deviation = _mm_and_ps(excess, sign_mask);
+            enmo = _mm_add_ps(enmo, _mm_max_ps(excess, zero));
+            peak = _mm_max_ps(peak, deviation);
+            active = _mm_sub_epi32(active, _mm_castps_si128(_mm_cmpgt_ps(deviation, threshold)));
+        }
+        alignas(16) float enmo_lanes[4];
+        alignas(16) float peak_lanes[4];
+        alignas(16) uint32_t active_lanes[4];
+        _mm_store_ps(enmo_lanes, enmo);
+        _mm_store_ps(peak_lanes, peak);
+        _mm_store_si128(reinterpret_cast<__m128i*>(active_lanes), active);
+        for (size_t lane = 0; lane < 4; ++lane) {
+            accumulator.enmo_sum += enmo_lanes[lane];
+            accumulator.active += active_lanes[lane];
+            accumulator.peak_deviation = std::max(accumulator.peak_deviation, peak_lanes[lane]);
+        }
+#endif
+
+        scalarMotion(x + i, y + i, z + i, count - i, threshold_g, accumulator);
+    }
+
+    const char* motionKernelBackend() noexcept {
+#if defined(PUUYAPU_MOTION_NEON)
+        return "neon";
+#elif defined(PUUYAPU_MOTION_SSE2)
+        return "sse2";
+#else
+        return "scalar";
+#endif
+    }
+
+    size_t decodeAccelerometerRecords(const uint8_t* records, size_t count,
+                                      int64_t clock_offset_ns, AccelerometerBlock& block) noexcept {
+        size_t take = std::min(count, AccelerometerBlock::CAPACITY);
+        for (size_t i = 0; i < take; ++i) {
+            AccelerometerRecord record = AccelerometerRecord::deserialize(records + i * AccelerometerRecord::SERIALIZED_SIZE);
+            block.timestamp_ns[i] = record.timestamp_ns + clock_offset_ns;
+            block.x[i] = record.x * INVERSE_GRAVITY;
+            block.y[i] = record.y * INVERSE_GRAVITY;
+            block.z[i] = record.z * INVERSE_GRAVITY;
+        }
+        block.count = take;
+        return take;
+    }
+
+#if defined(__ANDROID__)
+    size_t decodeSensorEvents(const ASensorEvent* events, size_t count,
+                              int64_t clock_offset_ns, AccelerometerBlock& block) noexcept {
+        size_t consumed = 0;
+        block.count = 0;
+        for (; consumed < count && block.count < AccelerometerBlock::CAPACITY; ++consumed) {
+            const ASensorEvent& event = events[consumed];
+            if (event.type != ASENSOR_TYPE_ACCELEROMETER) {
+                continue;
+            }
+            size_t lane = block.count++;
+            block.timestamp_ns[lane] = event.timestamp + clock_offset_ns;
+            block.x[lane] = event.acceleration.x * INVERSE_GRAVITY;
+            block.y[lane] = event.acceleration.y * INVERSE_GRAVITY;
+            block.z[lane] = event.acceleration.z * INVERSE_GRAVITY;
+        }
+        return consumed;
+    }
+#endif
+
+// ============================================================================
+// ActivityEpochReducer
+// ============================================================================
+
+    void ActivityEpochReducer::open(int64_t timestamp_ns) noexcept {
+        constexpr int64_t EPOCH_NS = ActivityEpoch::DURATION_MS * 1000000;
+        int64_t epoch = timestamp_ns / EPOCH_NS;
+        if (timestamp_ns % EPOCH_NS < 0) {
+            epoch--;
+        }
+
+        open_ = true;
+        open_start_ns_ = epoch * EPOCH_NS;
+        open_end_ns_ = open_start_ns_ + EPOCH_NS;
+        open_samples_ = 0;
+        accumulator_ = MotionAccumulator{};
+    }
+
+    ActivityEpoch ActivityEpochReducer::close() noexcept {
+        open_ = false;
+
+        ActivityEpoch epoch;
+        epoch.start_ms = open_start_ns_ / 1000000;
+        epoch.sample_count = static_cast<uint16_t>(std::min<uint32_t>(open_samples_, UINT16_MAX));
+        epoch.active_samples = static_cast<uint16_t>(std::min<uint32_t>(accumulator_.active, UINT16_MAX));
+        epoch.mean_enmo_mg = open_samples_ > 0 ? toMilliG(accumulator_.enmo_sum / open_samples_) : 0;
+        epoch.peak_deviation_mg = toMilliG(accumulator_.peak_deviation);
+        return epoch;
+    }
+
+// ============================================================================
+// ActivityEpochStore
+// ============================================================================
+
+    bool ActivityEpochStore::append(const ActivityEpoch& epoch) {
+        if (capacity_ == 0 || (size_ > 0 && !(at(size_ - 1).start_ms < epoch.start_ms))) {
+            return false;
+        }
+        if (ring_.empty()) {
+            ring_.resize(capacity_);
+        }
+
+        if (size_ == capacity_) {
+            ring_[first_] = epoch;
+            first_ = (first_ + 1) % capacity_;
+        } else {
+            ring_[(first_ + size_) % capacity_] = epoch;
+            size_++;
+        }
+        return true;
+    }
+
+    size_t ActivityEpochStore::firstEndingAfter(int64_t time_ms) const noexcept {
+        size_t low = 0;
+        size_t high = size_;
+        while (low < high) {
+            size_t middle = low + (high - low) / 2;
+            if (at(middle).endMs() <= time_ms) {
+                low = middle + 1;
+            } else {
+                high = middle;
+            }
+        }
+        return low;
+    }
+
+    MotionCoverage ActivityEpochStore::coverage(int64_t from_ms, int64_t to_ms) const noexcept {
+        MotionCoverage coverage;
+        if (!(from_ms < to_ms)) {
+            return coverage;
+        }
+        coverage.expected_epochs = static_cast<uint32_t>(
+                (to_ms - from_ms + ActivityEpoch::DURATION_MS - 1) / ActivityEpoch::DURATION_MS);
+
+        for (size_t i = firstEndingAfter(from_ms); i < size_; ++i) {
+            const ActivityEpoch& epoch = at(i);
+            if (!(epoch.start_ms < to_ms)) {
+                break;
+            }
+            coverage.epochs++;
+            coverage.active_epochs += epoch.isActive() ? 1u : 0u;
+        }
+        return coverage;
+    }
+
+    void ActivityEpochStore::eraseBefore(int64_t cutoff_ms) noexcept {
+        // start < cutoff  <=>  end <= cutoff - 1 + DURATION_MS
+        size_t keep_from = firstEndingAfter(cutoff_ms - 1 + ActivityEpoch::DURATION_MS);
+        first_ = size_ > 0 ? (first_ + keep_from) % capacity_ : 0;
+        size_ -= keep_from;
+    }
+
+    void ActivityEpochStore::clear() noexcept {
+        first_ = 0;
+        size_ = 0;
+    }
+
+    void ActivityEpochStore::writeTo(SnapshotWriter& writer) const {
+        writer.put(static_cast<uint32_t>(size_));
+        for (size_t i = 0; i < size_; ++i) {
+            const ActivityEpoch& epoch = at(i);
+            writer.put(epoch.start_ms);
+            writer.put(epoch.sample_count);
+            writer.put(epoch.active_samples);
+            writer.put(epoch.mean_enmo_mg);
+            writer.put(epoch.peak_deviation_mg);
+        }
+    }
+
+    bool ActivityEpochStore::readFrom(SnapshotReader& reader) {
+        constexpr size_t EPOCH_BYTES = 16;
+
+        uint32_t count = 0;
+        if (!reader.getCount(count, EPOCH_BYTES)) {
+            return false;
+        }
+        ActivityEpochStore decoded(capacity_);
+        for (uint32_t i = 0; i < count; ++i) {
+            ActivityEpoch epoch;
+            if (!reader.get(epoch.start_ms) || !reader.get(epoch.sample_count) ||
+                !reader.get(epoch.active_samples) || !reader.get(epoch.mean_enmo_mg) ||
+                !reader.get(epoch.peak_deviation_mg)) {
+                return false;
+            }
+            decoded.append(epoch);
+        }
+
+        *this = std::move(decoded);
+        return true;
+    }
+
+} // namespace puuyapu
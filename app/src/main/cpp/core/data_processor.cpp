@@ -7,8 +7,7 @@
 
 #include "data_processor.h"
 #include "time_utils.h"
-#include <iomanip>
-#include <sstream>
+#include <algorithm>
 #include <cstring>
 
 namespace puuyapu {
@@ -17,123 +16,161 @@ namespace puuyapu {
             const std::vector<SleepDetectionResult>& sessions,
             bool include_debug) noexcept {
 
-        std::ostringstream json;
-        json << "{\n";
-        json << "  \"export_timestamp\": \"" << timestampToISO(std::chrono::system_clock::now()) << "\",\n";
-        json << "  \"total_sessions\": " << sessions.size() << ",\n";
-        json << "  \"include_debug\": " << (include_debug ? "true" : "false") << ",\n";
-        json << "  \"sleep_sessions\": [\n";
+        StringSink sink;
+        exportToJSON(sessions, sink, include_debug);
+        return std::move(sink.str());
+    }
+
+    bool DataProcessor::exportToJSON(
+            const std::vector<SleepDetectionResult>& sessions,
+            OutputSink& sink,
+            bool include_debug) noexcept {
+
+        StreamWriter json(sink);
+        json.write("{\n");
+        json.write("  \"export_timestamp\": \"").writeIsoTimestamp(std::chrono::system_clock::now()).write("\",\n");
+        json.write("  \"total_sessions\": ").writeUnsigned(sessions.size()).write(",\n");
+        json.write("  \"include_debug\": ").writeBool(include_debug).write(",\n");
+        json.write("  \"sleep_sessions\": [\n");
 
         for (size_t i = 0; i < sessions.size(); ++i) {
             const auto& session = sessions[i];
 
-            json << "    {\n";
+            json.write("    {\n");
 
             if (session.bedtime.has_value()) {
-                json << "      \"bedtime\": \"" << timestampToISO(session.bedtime.value()) << "\",\n";
+                json.write("      \"bedtime\": \"").writeIsoTimestamp(session.bedtime.value()).write("\",\n");
             }
 
             if (session.wake_time.has_value()) {
-                json << "      \"wake_time\": \"" << timestampToISO(session.wake_time.value()) << "\",\n";
+                json.write("      \"wake_time\": \"").writeIsoTimestamp(session.wake_time.value()).write("\",\n");
             }
 
-            json << "      \"duration_hours\": " << doubleToString(session.duration.count()) << ",\n";
-            json << "      \"confidence\": \"" << session.getConfidenceString() << "\",\n";
-            json << "      \"quality_score\": " << doubleToString(session.quality_score) << ",\n";
-            json << "      \"manually_confirmed\": " << (session.is_manually_confirmed ? "true" : "false") << ",\n";
-            json << "      \"pattern_match_score\": " << doubleToString(session.pattern_match_score) << ",\n";
-            json << "      \"sleep_efficiency\": " << doubleToString(session.calculateSleepEfficiency()) << ",\n";
-            json << "      \"interruptions_count\": " << session.interruptions.size();
+            json.write("      \"duration_hours\": ").writeFixed(session.duration.count()).write(",\n");
+            json.write("      \"confidence\": \"").write(session.getConfidenceString()).write("\",\n");
+            json.write("      \"quality_score\": ").writeFixed(session.quality_score).write(",\n");
+            json.write("      \"manually_confirmed\": ").writeBool(session.is_manually_confirmed).write(",\n");
+            json.write("      \"pattern_match_score\": ").writeFixed(session.pattern_match_score).write(",\n");
+            json.write("      \"sleep_efficiency\": ").writeFixed(session.calculateSleepEfficiency()).write(",\n");
+            json.write("      \"interruptions_count\": ").writeUnsigned(session.interruptions.size());
 
             if (include_debug && !session.interruptions.empty()) {
-                json << ",\n      \"interruptions\": [\n";
+                json.write(",\n      \"interruptions\": [\n");
                 for (size_t j = 0; j < session.interruptions.size(); ++j) {
                     const auto& interruption = session.interruptions[j];
-                    json << "        {\n";
-                    json << "          \"timestamp\": \"" << timestampToISO(interruption.timestamp) << "\",\n";
-                    json << "          \"duration_ms\": " << interruption.duration.count() << ",\n";
-                    json << "          \"is_brief_check\": " << (interruption.is_brief_check ? "true" : "false") << ",\n";
-                    json << "          \"impact_score\": " << doubleToString(interruption.impact_score) << "\n";
-                    json << "        }";
-                    if (j < session.interruptions.size() - 1) json << ",";
-                    json << "\n";
+                    json.write("        {\n");
+                    json.write("          \"timestamp\": \"").writeIsoTimestamp(interruption.timestamp).write("\",\n");
+                    json.write("          \"duration_ms\": ").writeInt(interruption.duration.count()).write(",\n");
+                    json.write("          \"is_brief_check\": ").writeBool(interruption.is_brief_check).write(",\n");
+                    json.write("          \"impact_score\": ").writeFixed(interruption.impact_score).write("\n");
+                    json.write("        }");
+                    if (j < session.interruptions.size() - 1) json.write(',');
+                    json.write('\n');
                 }
-                json << "      ]";
+                json.write("      ]");
             }
 
-            json << "\n    }";
-            if (i < sessions.size() - 1) json << ",";
-            json << "\n";
+            json.write("\n    }");
+            if (i < sessions.size() - 1) json.write(',');
+            json.write('\n');
         }
 
-        json << "  ]\n";
-        json << "}";
+        json.write("  ]\n");
+        json.write("}");
 
-        return json.str();
+        return json.flush();
     }
 
     std::string DataProcessor::exportToCSV(
             const std::vector<SleepDetectionResult>& sessions) noexcept {
 
-        std::ostringstream csv;
+        StringSink sink;
+        exportToCSV(sessions, sink);
+        return std::move(sink.str());
+    }
+
+    bool DataProcessor::exportToCSV(
+            const std::vector<SleepDetectionResult>& sessions,
+            OutputSink& sink) noexcept {
+
+        StreamWriter csv(sink);
 
         // Header
-        csv << "Date,Bedtime,WakeTime,DurationHours,Confidence,QualityScore,";
-        csv << "ManuallyConfirmed,PatternMatch,SleepEfficiency,InterruptionsCount\n";
+        csv.write("Date,Bedtime,WakeTime,DurationHours,Confidence,QualityScore,");
+        csv.write("ManuallyConfirmed,PatternMatch,SleepEfficiency,InterruptionsCount\n");
 
         // Data rows
         for (const auto& session : sessions) {
             if (!session.isValid()) continue;
 
-            // Extract date from bedtime
-            auto time_t = std::chrono::system_clock::to_time_t(session.bedtime.value());
-            auto tm = *std::localtime(&time_t);
-
-            csv << (tm.tm_year + 1900) << "-"
-                << std::setfill('0') << std::setw(2) << (tm.tm_mon + 1) << "-"
-                << std::setfill('0') << std::setw(2) << tm.tm_mday << ",";
-
-            // Bedtime
-            csv << timestampToISO(session.bedtime.value()) << ",";
+            // Local date of bedtime, then bedtime
+            csv.writeLocalDate(session.bedtime.value()).write(',');
+            csv.writeIsoTimestamp(session.bedtime.value()).write(',');
 
             // Wake time
             if (session.wake_time.has_value()) {
-                csv << timestampToISO(session.wake_time.value());
+                csv.writeIsoTimestamp(session.wake_time.value());
             }
-            csv << ",";
+            csv.write(',');
 
             // Duration, confidence, quality
-            csv << doubleToString(session.duration.count()) << ",";
-            csv << session.getConfidenceString() << ",";
-            csv << doubleToString(session.quality_score) << ",";
-            csv << (session.is_manually_confirmed ? "true" : "false") << ",";
-            csv << doubleToString(session.pattern_match_score) << ",";
-            csv << doubleToString(session.calculateSleepEfficiency()) << ",";
-            csv << session.interruptions.size() << "\n";
+            csv.writeFixed(session.duration.count()).write(',');
+            csv.write(session.getConfidenceString()).write(',');
+            csv.writeFixed(session.quality_score).write(',');
+            csv.writeBool(session.is_manually_confirmed).write(',');
+            csv.writeFixed(session.pattern_match_score).write(',');
+            csv.writeFixed(session.calculateSleepEfficiency()).write(',');
+            csv.writeUnsigned(session.interruptions.size()).write('\n');
         }
 
-        return csv.str();
+        return csv.flush();
     }
 
-    std::string DataProcessor::exportPerformanceMetrics(
-            const std::unordered_map<std::string, std::chrono::microseconds>& metrics) noexcept {
+    std::string DataProcessor::exportPerformanceMetrics(const MetricsSnapshot& metrics) noexcept {
+        StringSink sink;
+        exportPerformanceMetrics(metrics, sink);
+        return std::move(sink.str());
+    }
 
-        std::ostringstream json;
-        json << "{\n";
-        json << "  \"timestamp\": \"" << timestampToISO(std::chrono::system_clock::now()) << "\",\n";
-        json << "  \"metrics\": {\n";
+    bool DataProcessor::exportPerformanceMetrics(const MetricsSnapshot& metrics, OutputSink& sink) noexcept {
+        StreamWriter json(sink);
+        auto micros = [&json](std::chrono::nanoseconds value) {
+            json.writeFixed(static_cast<double>(value.count()) / 1000.0, 3);
+        };
+
+        json.write("{\n");
+        json.write("  \"timestamp\": \"").writeIsoTimestamp(std::chrono::system_clock::now()).write("\",\n");
+        json.write("  \"metrics\": {\n");
+
+        // Only metrics with samples; names come from the compile-time registry
+        bool first = true;
+        for (size_t i = 0; i < METRIC_COUNT; ++i) {
+            const LatencySummary& summary = metrics.latencies[i];
+            if (summary.count == 0) {
+                continue;
+            }
 
-        size_t count = 0;
-        for (const auto& [operation, duration] : metrics) {
-            json << "    \"" << operation << "\": " << duration.count();
-            if (++count < metrics.size()) json << ",";
-            json << "\n";
+            if (!first) json.write(",\n");
+            first = false;
+
+            json.write("    \"").write(metricName(static_cast<MetricId>(i))).write("\": {");
+            json.write("\"count\": ").writeUnsigned(summary.count).write(", ");
+            json.write("\"mean_us\": ");
+            micros(summary.mean);
+            json.write(", \"p50_us\": ");
+            micros(summary.p50);
+            json.write(", \"p99_us\": ");
+            micros(summary.p99);
+            json.write(", \"max_us\": ");
+            micros(summary.max);
+            json.write('}');
         }
+        if (!first) json.write('\n');
 
-        json << "  }\n";
-        json << "}";
+        json.write("  }\n");
+        json.write("}");
 
-        return json.str();
+        return json.flush();
     }
 
     size_t DataProcessor::serializeToBinary(
@@ -144,11 +181,150 @@ namespace puuyapu {
             return 0;
         }
 
+        return writeSessionRecord(session, buffer);
+    }
+
+    SleepDetectionResult DataProcessor::deserializeFromBinary(
+            const uint8_t* buffer,
+            size_t size) noexcept {
+
+        SleepDetectionResult session;
+
+        if (!buffer || size < 32) { // Minimum required size
+            return session;
+        }
+
+        readSessionRecord(buffer, session);
+        return session;
+    }
+
+    size_t DataProcessor::packedResultSize(const SleepDetectionResult& result) noexcept {
+        return PACKED_HEADER_SIZE + PACKED_SESSION_SECTION_SIZE +
+               result.interruptions.size() * PACKED_INTERRUPTION_SIZE;
+    }
+
+    size_t DataProcessor::serializePacked(
+            const SleepDetectionResult& result,
+            uint8_t* buffer,
+            size_t capacity) noexcept {
+
+        size_t required = packedResultSize(result);
+        if (!buffer || capacity < required) {
+            return 0;
+        }
+
+        // Header
+        uint16_t version = PACKED_FORMAT_VERSION;
+        uint16_t header_size = PACKED_HEADER_SIZE;
+        uint16_t session_size = PACKED_SESSION_SECTION_SIZE;
+        uint16_t interruption_size = PACKED_INTERRUPTION_SIZE;
+        uint32_t interruption_count = static_cast<uint32_t>(result.interruptions.size());
+
+        std::memcpy(buffer, &PACKED_MAGIC, sizeof(uint32_t));
+        std::memcpy(buffer + 4, &version, sizeof(uint16_t));
+        std::memcpy(buffer + 6, &header_size, sizeof(uint16_t));
+        std::memcpy(buffer + 8, &session_size, sizeof(uint16_t));
+        std::memcpy(buffer + 10, &interruption_size, sizeof(uint16_t));
+        std::memcpy(buffer + 12, &interruption_count, sizeof(uint32_t));
+
+        // Session section
+        uint8_t* section = buffer + PACKED_HEADER_SIZE;
+        size_t written = writeSessionRecord(result, section);
+        std::memset(section + written, 0, PACKED_SESSION_SECTION_SIZE - written);
+
+        // Interruptions
+        uint8_t* record = section + PACKED_SESSION_SECTION_SIZE;
+        for (const auto& interruption : result.interruptions) {
+            int64_t timestamp_ms = std::chrono::duration_cast<std::chrono::milliseconds>(
+                    interruption.timestamp.time_since_epoch()).count();
+            int64_t duration_ms = interruption.duration.count();
+            float impact = static_cast<float>(interruption.impact_score);
+
+            std::memcpy(record, &timestamp_ms, sizeof(int64_t));
+            std::memcpy(record + 8, &duration_ms, sizeof(int64_t));
+            record[16] = static_cast<uint8_t>(interruption.cause);
+            record[17] = static_cast<uint8_t>(interruption.app_category);
+            record[18] = interruption.is_brief_check ? 0x01 : 0x00;
+            record[19] = 0;
+            std::memcpy(record + 20, &impact, sizeof(float));
+
+            record += PACKED_INTERRUPTION_SIZE;
+        }
+
+        return required;
+    }
+
+    SleepDetectionResult DataProcessor::deserializePacked(
+            const uint8_t* buffer,
+            size_t size) noexcept {
+
+        SleepDetectionResult result;
+
+        if (!buffer || size < PACKED_HEADER_SIZE) {
+            return result;
+        }
+
+        uint32_t magic;
+        uint16_t version, header_size, session_size, interruption_size;
+        uint32_t interruption_count;
+        std::memcpy(&magic, buffer, sizeof(uint32_t));
+        std::memcpy(&version, buffer + 4, sizeof(uint16_t));
+        std::memcpy(&header_size, buffer + 6, sizeof(uint16_t));
+        std::memcpy(&session_size, buffer + 8, sizeof(uint16_t));
+        std::memcpy(&interruption_size, buffer + 10, sizeof(uint16_t));
+        std::memcpy(&interruption_count, buffer + 12, sizeof(uint32_t));
+
+        if (magic != PACKED_MAGIC || version == 0 ||
+            header_size < PACKED_HEADER_SIZE ||
+            session_size < SESSION_RECORD_SIZE ||
+            interruption_size < PACKED_INTERRUPTION_SIZE) {
+            return result;
+        }
+
+        size_t interruptions_offset = static_cast<size_t>(header_size) + session_size;
+        if (size < interruptions_offset ||
+            (size - interruptions_offset) / interruption_size < interruption_count) {
+            return result;
+        }
+
+        readSessionRecord(buffer + header_size, result);
+
+        result.interruptions.reserve(interruption_count);
+        const uint8_t* record = buffer + interruptions_offset;
+        for (uint32_t i = 0; i < interruption_count; ++i) {
+            int64_t timestamp_ms, duration_ms;
+            float impact;
+            std::memcpy(&timestamp_ms, record, sizeof(int64_t));
+            std::memcpy(&duration_ms, record + 8, sizeof(int64_t));
+            std::memcpy(&impact, record + 20, sizeof(float));
+
+            SleepInterruption interruption(
+                    std::chrono::system_clock::time_point(std::chrono::milliseconds(timestamp_ms)),
+                    std::chrono::milliseconds(duration_ms),
+                    static_cast<InteractionType>(record[16]),
+                    static_cast<AppCategory>(record[17]));
+            interruption.is_brief_check = (record[18] & 0x01) != 0;
+            interruption.impact_score = static_cast<double>(impact);
+            result.interruptions.push_back(interruption);
+
+            record += interruption_size;
+        }
+
+        return result;
+    }
+
+    size_t DataProcessor::writeSessionRecord(
+            const SleepDetectionResult& session,
+            uint8_t* buffer) noexcept {
+
         size_t offset = 0;
 
         // Bedtime timestamp (8 bytes)
-        auto bedtime_ms = std::chrono::duration_cast<std::chrono::milliseconds>(
-                session.bedtime.value().time_since_epoch()).count();
+        int64_t bedtime_ms = 0;
+        if (session.bedtime.has_value()) {
+            bedtime_ms = std::chrono::duration_cast<std::chrono::milliseconds>(
+                    session.bedtime.value().time_since_epoch()).count();
+        }
         std::memcpy(buffer + offset, &bedtime_ms, sizeof(int64_t));
         offset += sizeof(int64_t);
 
@@ -185,31 +361,28 @@ namespace puuyapu {
         std::memcpy(buffer + offset, &pattern_score, sizeof(float));
         offset += sizeof(float);
 
-        // Interruptions count (2 bytes)
-        uint16_t interruption_count = static_cast<uint16_t>(session.interruptions.size());
+        // Interruptions count (2 bytes, saturated; packed header carries the full count)
+        uint16_t interruption_count = static_cast<uint16_t>(
+                std::min<size_t>(session.interruptions.size(), UINT16_MAX));
         std::memcpy(buffer + offset, &interruption_count, sizeof(uint16_t));
         offset += sizeof(uint16_t);
 
         return offset;
     }
 
-    SleepDetectionResult DataProcessor::deserializeFromBinary(
+    void DataProcessor::readSessionRecord(
             const uint8_t* buffer,
-            size_t size) noexcept {
-
-        SleepDetectionResult session;
-
-        if (!buffer || size < 32) { // Minimum required size
-            return session;
-        }
+            SleepDetectionResult& session) noexcept {
 
         size_t offset = 0;
 
         // Bedtime timestamp
         int64_t bedtime_ms;
         std::memcpy(&bedtime_ms, buffer + offset, sizeof(int64_t));
-        session.bedtime = std::chrono::system_clock::time_point(
-                std::chrono::milliseconds(bedtime_ms));
+        if (bedtime_ms > 0) {
+            session.bedtime = std::chrono::system_clock::time_point(
+                    std::chrono::milliseconds(bedtime_ms));
+        }
         offset += sizeof(int64_t);
 
         // Wake time timestamp
@@ -246,32 +419,6 @@ namespace puuyapu {
         float pattern_score;
         std::memcpy(&pattern_score, buffer + offset, sizeof(float));
         session.pattern_match_score = static_cast<double>(pattern_score);
-        offset += sizeof(float);
-
-        return session;
-    }
-
-    std::string DataProcessor::timestampToISO(
-            std::chrono::system_clock::time_point time_point) noexcept {
-
-        auto time_t = std::chrono::system_clock::to_time_t(time_point);
-        auto tm = *std::gmtime(&time_t);
-
-        std::ostringstream oss;
-        oss << std::put_time(&tm, "%Y-%m-%dT%H:%M:%S");
-
-        // Add milliseconds
-        auto ms = std::chrono::duration_cast<std::chrono::milliseconds>(
-                time_point.time_since_epoch()) % 1000;
-        oss << "." << std::setfill('0') << std::setw(3) << ms.count() << "Z";
-
-        return oss.str();
-    }
-
-    std::string DataProcessor::doubleToString(double value, int precision) noexcept {
-        std::ostringstream oss;
-        oss << std::fixed << std::setprecision(precision) << value;
-        return oss.str();
     }
 
 } // namespace puuyapu
@@ -0,0 +1,164 @@
+/**
+ * @file detection_worker.cpp
+ * @brief Implementation of the coalescing detection thread
+ */
+
+#include "detection_worker.h"
+#include "metrics.h"
+#include "trace.h"
+
+namespace puuyapu {
+
+    namespace {
+        constexpr const char* LOG_TAG = "PuuyApu_Worker";
+    }
+
+    DetectionWorker::DetectionWorker(std::unique_ptr<SleepDetector> detector, DetectionListener* listener)
+            : detector_(std::move(detector)),
+              listener_(listener) {}
+
+    DetectionWorker::~DetectionWorker() noexcept {
+        {
+            std::lock_guard<std::mutex> lock(mutex_);
+            stopping_ = true;
+        }
+        work_available_.notify_one();
+
+        if (thread_.joinable()) {
+            thread_.join();
+        }
+    }
+
+    uint64_t DetectionWorker::post(DetectionRequestKind kind,
+                                   std::chrono::system_clock::time_point at) noexcept {
+        size_t slot = static_cast<size_t>(kind);
+        if (slot >= DETECTION_REQUEST_KINDS) {
+            return 0;
+        }
+
+        uint64_t request_id;
+        bool wake;
+        {
+            std::lock_guard<std::mutex> lock(mutex_);
+            if (stopping_) {
+                return 0;
+            }
+            if (!thread_.joinable()) {
+                thread_ = std::thread([this] { workerLoop(); });
+            }
+
+            request_id = ++next_request_id_;
+            PendingRequest& pending = pending_[slot];
+            wake = pending.count == 0;
+            if (wake) {
+                order_[(order_head_ + order_size_) % DETECTION_REQUEST_KINDS] = kind;
+                order_size_++;
+            } else {
+                requests_coalesced_.fetch_add(1, std::memory_order_relaxed);
+            }
+
+            // The merged pass answers for the newest request
+            pending.request_id = request_id;
+            pending.count++;
+            pending.at = at;
+        }
+        requests_posted_.fetch_add(1, std::memory_order_relaxed);
+
+        // A merged request rides on a wake-up that is already pending
+        if (wake) {
+            work_available_.notify_one();
+        }
+        return request_id;
+    }
+
+    DetectionWorker::Statistics DetectionWorker::getStatistics() const noexcept {
+        Statistics stats;
+        stats.requests_posted = requests_posted_.load(std::memory_order_relaxed);
+        stats.requests_coalesced = requests_coalesced_.load(std::memory_order_relaxed);
+        stats.passes = passes_.load(std::memory_order_relaxed);
+        return stats;
+    }
+
+    bool DetectionWorker::isWorkerThread() const noexcept {
+        std::lock_guard<std::mutex> lock(mutex_);
+        return thread_.joinable() && thread_.get_id() == std::this_thread::get_id();
+    }
+
+// ============================================================================
+// Private Helper Methods
+// ============================================================================
+
+    void DetectionWorker::workerLoop() noexcept {
+        if (listener_) {
+            listener_->onWorkerStarted();
+        }
+        SLEEP_LOG_DEBUG(LOG_TAG, "Detection worker started");
+
+        std::unique_lock<std::mutex> lock(mutex_);
+        while (true) {
+            work_available_.wait(lock, [this] { return stopping_ || order_size_ > 0; });
+            if (stopping_) {
+                break;
+            }
+
+            // Free the slot before running, so requests posted during the
+            // pass queue a fresh one instead of merging into a stale answer
+            DetectionRequestKind kind = order_[order_head_];
+            order_head_ = (order_head_ + 1) % DETECTION_REQUEST_KINDS;
+            order_size_--;
+            PendingRequest request = pending_[static_cast<size_t>(kind)];
+            pending_[static_cast<size_t>(kind)] = PendingRequest{};
+
+            lock.unlock();
+            execute(kind, request);
+            lock.lock();
+        }
+        lock.unlock();
+
+        if (listener_) {
+            listener_->onWorkerStopping();
+        }
+        SLEEP_LOG_DEBUG(LOG_TAG, "Detection worker stopped after %llu passes",
+                        static_cast<unsigned long long>(passes_.load(std::memory_order_relaxed)));
+    }
+
+    void DetectionWorker::execute(DetectionRequestKind kind, const PendingRequest& request) noexcept {
+        ScopedMetricTimer metric(MetricId::DETECTION_WORKER_PASS);
+        trace::ScopedSection section(metricName(MetricId::DETECTION_WORKER_PASS));
+
+        DetectionResponse response;
+        response.kind = kind;
+        response.request_id = request.request_id;
+        response.coalesced = request.count;
+        response.at = request.at;
+
+        // Copied out of the detector's cache: the listener may call back
+        // into the detector without holding its event lock
+        SleepDetectionResult sleep;
+
+        switch (kind) {
+            case DetectionRequestKind::DETECT_SLEEP:
+                sleep = detector_->detectSleepPeriod(request.at);
+                response.sleep = &sleep;
+                break;
+            case DetectionRequestKind::IS_CURRENTLY_ASLEEP:
+                response.asleep = detector_->isCurrentlyAsleep(request.at);
+                break;
+            case DetectionRequestKind::ESTIMATED_SLEEP_START:
+                response.sleep_start = detector_->getEstimatedSleepStart(request.at);
+                break;
+            case DetectionRequestKind::OPTIMIZE_MEMORY:
+                detector_->optimizeMemory();
+                break;
+            case DetectionRequestKind::WRITE_SNAPSHOT:
+                response.snapshot_written = detector_->writeSnapshot();
+                break;
+        }
+        passes_.fetch_add(1, std::memory_order_relaxed);
+
+        if (listener_) {
+            listener_->onDetectionComplete(response);
+        }
+    }
+
+} // namespace puuyapu
@@ -0,0 +1,197 @@
+/**
+ * @file detector_registry.cpp
+ * @brief Implementation of the handle-addressed detector table
+ */
+
+#include "detector_registry.h"
+
+namespace puuyapu {
+
+    namespace {
+        constexpr const char* LOG_TAG = "PuuyApu_Registry";
+
+        constexpr uint32_t generationOf(uint64_t word) noexcept {
+            return static_cast<uint32_t>(word >> 32);
+        }
+    }
+
+    DetectorRegistry::DetectorRegistry() noexcept
+            : shards_(new Shard[SHARD_COUNT]) {
+        for (size_t shard_index = 0; shard_index < SHARD_COUNT; ++shard_index) {
+            Shard& shard = shards_[shard_index];
+            shard.free_slots.reserve(SLOTS_PER_SHARD);
+
+            // Reverse order so the lowest slots are handed out first
+            for (size_t i = SLOTS_PER_SHARD; i-- > 0;) {
+                uint32_t index = static_cast<uint32_t>(shard_index * SLOTS_PER_SHARD + i);
+                shard.slots[i].index = index;
+                shard.free_slots.push_back(index);
+            }
+        }
+    }
+
+    DetectorRegistry::~DetectorRegistry() noexcept {
+        // No lease may outlive the registry; free whatever is still registered
+        for (size_t shard_index = 0; shard_index < SHARD_COUNT; ++shard_index) {
+            Shard& shard = shards_[shard_index];
+            for (Slot& slot : shard.slots) {
+                delete slot.worker;
+                slot.worker = nullptr;
+            }
+            shard.retired.clear();
+        }
+    }
+
+    DetectorRegistry& DetectorRegistry::shared() noexcept {
+        static DetectorRegistry registry;
+        return registry;
+    }
+
+    DetectorHandle DetectorRegistry::create(std::unique_ptr<SleepDetector> detector,
+                                            DetectionListener* listener) {
+        if (!detector) {
+            return INVALID_DETECTOR_HANDLE;
+        }
+
+        // Spread creators over the shards; fall through to the next if full
+        size_t first = next_shard_.fetch_add(1, std::memory_order_relaxed);
+        for (size_t attempt = 0; attempt < SHARD_COUNT; ++attempt) {
+            Shard& shard = shards_[(first + attempt) % SHARD_COUNT];
+            drainRetired(shard);
+
+            uint32_t index;
+            {
+                std::lock_guard<std::mutex> lock(shard.mutex);
+                if (shard.free_slots.empty()) {
+                    continue;
+                }
+                index = shard.free_slots.back();
+                shard.free_slots.pop_back();
+            }
+
+            // A free slot has no leases and is not live; only its generation carries over
+            Slot& slot = shard.slots[index % SLOTS_PER_SHARD];
+            slot.worker = new DetectionWorker(std::move(detector), listener);
+            uint32_t generation = generationOf(slot.state.load(std::memory_order_relaxed));
+            slot.state.store((static_cast<uint64_t>(generation) << 32) | LIVE_BIT, std::memory_order_release);
+
+            live_count_.fetch_add(1, std::memory_order_relaxed);
+            return (static_cast<uint64_t>(generation) << 32) | (static_cast<uint64_t>(index) + 1);
+        }
+
+        SLEEP_LOG_ERROR(LOG_TAG, "Detector table full (%zu detectors)", MAX_DETECTORS);
+        return INVALID_DETECTOR_HANDLE;
+    }
+
+    bool DetectorRegistry::destroy(DetectorHandle handle) noexcept {
+        Slot* slot = slotOf(handle);
+        if (!slot) {
+            return false;
+        }
+
+        uint32_t generation = generationOf(handle);
+        uint64_t state = slot->state.load(std::memory_order_acquire);
+        uint64_t retired;
+        do {
+            if (generationOf(state) != generation || !(state & LIVE_BIT)) {
+                return false;
+            }
+            // Next generation, not live, outstanding leases kept
+            retired = (static_cast<uint64_t>(generation + 1) << 32) | (state & LEASE_MASK);
+        } while (!slot->state.compare_exchange_weak(state, retired, std::memory_order_acq_rel,
+                                                     std::memory_order_acquire));
+
+        live_count_.fetch_sub(1, std::memory_order_relaxed);
+
+        // Otherwise the last lease frees it
+        if ((state & LEASE_MASK) == 0) {
+            reclaim(*slot);
+        }
+        return true;
+    }
+
+    DetectorRegistry::Lease DetectorRegistry::acquire(DetectorHandle handle) noexcept {
+        Slot* slot = slotOf(handle);
+        if (!slot) {
+            return Lease();
+        }
+
+        uint32_t generation = generationOf(handle);
+        uint64_t state = slot->state.load(std::memory_order_acquire);
+        do {
+            if (generationOf(state) != generation || !(state & LIVE_BIT) ||
+                (state & LEASE_MASK) == LEASE_MASK) {
+                return Lease();
+            }
+        } while (!slot->state.compare_exchange_weak(state, state + 1, std::memory_order_acquire,
+                                                     std::memory_order_acquire));
+
+        return Lease(this, slot, slot->worker);
+    }
+
+    void DetectorRegistry::Lease::release() noexcept {
+        if (!slot_) {
+            return;
+        }
+
+        uint64_t previous = slot_->state.fetch_sub(1, std::memory_order_acq_rel);
+        if (!(previous & LIVE_BIT) && (previous & LEASE_MASK) == 1) {
+            registry_->reclaim(*slot_);
+        }
+        slot_ = nullptr;
+        worker_ = nullptr;
+    }
+
+// ============================================================================
+// Private Helper Methods
+// ============================================================================
+
+    DetectorRegistry::Slot* DetectorRegistry::slotOf(DetectorHandle handle) noexcept {
+        uint64_t position = handle & 0xFFFFFFFFu;
+        if (position == 0 || position > MAX_DETECTORS) {
+            return nullptr;
+        }
+        size_t index = static_cast<size_t>(position - 1);
+        return &shards_[index / SLOTS_PER_SHARD].slots[index % SLOTS_PER_SHARD];
+    }
+
+    void DetectorRegistry::reclaim(Slot& slot) noexcept {
+        std::unique_ptr<DetectionWorker> worker(slot.worker);
+        slot.worker = nullptr;
+
+        // A worker cannot join itself: a lease dropped inside its own
+        // listener callback parks it for the next create/destroy
+        bool on_worker_thread = worker->isWorkerThread();
+
+        Shard& shard = shards_[slot.index / SLOTS_PER_SHARD];
+        {
+            std::lock_guard<std::mutex> lock(shard.mutex);
+            if (on_worker_thread) {
+                shard.retired.push_back(std::move(worker));
+            }
+            shard.free_slots.push_back(slot.index);
+        }
+        // Joined outside the shard lock
+        worker.reset();
+    }
+
+    void DetectorRegistry::drainRetired(Shard& shard) noexcept {
+        std::vector<std::unique_ptr<DetectionWorker>> retired;
+        {
+            std::lock_guard<std::mutex> lock(shard.mutex);
+            if (shard.retired.empty()) {
+                return;
+            }
+            retired.swap(shard.retired);
+        }
+
+        for (auto& worker : retired) {
+            if (worker->isWorkerThread()) {
+                std::lock_guard<std::mutex> lock(shard.mutex);
+                shard.retired.push_back(std::move(worker));
+            }
+        }
+        // The rest are joined and freed here, outside the shard lock
+    }
+
+} // namespace puuyapu
@@ -0,0 +1,191 @@
+/**
+ * @file detector_snapshot.cpp
+ * @brief Implementation of the detector snapshot file
+ */
+
+#include "detector_snapshot.h"
+#include "checksum.h"
+#include "platform_log.h"
+#include <cerrno>
+#include <cstdio>
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+namespace puuyapu {
+
+    namespace {
+        constexpr const char* LOG_TAG = "PuuyApu_Snapshot";
+
+        bool writeAll(int fd, const uint8_t* data, size_t size) noexcept {
+            while (size > 0) {
+                ssize_t written = ::write(fd, data, size);
+                if (written < 0) {
+                    if (errno == EINTR) {
+                        continue;
+                    }
+                    return false;
+                }
+                data += written;
+                size -= static_cast<size_t>(written);
+            }
+            return true;
+        }
+    }
+
+// ============================================================================
+// SnapshotWriter
+// ============================================================================
+
+    void SnapshotWriter::beginSection(SnapshotSection tag) {
+        endSection();
+        section_start_ = bytes_.size();
+        put(static_cast<uint32_t>(tag));
+        put<uint32_t>(0);
+    }
+
+    void SnapshotWriter::endSection() noexcept {
+        if (section_start_ == 0) {
+            return;
+        }
+        auto length = static_cast<uint32_t>(bytes_.size() - section_start_ - SECTION_HEADER_BYTES);
+        std::memcpy(bytes_.data() + section_start_ + sizeof(uint32_t), &length, sizeof(uint32_t));
+        section_start_ = 0;
+        section_count_++;
+    }
+
+    bool SnapshotWriter::writeFile(const std::string& path, int64_t written_at_ms) noexcept {
+        endSection();
+
+        uint64_t section_bytes = bytes_.size() - HEADER_BYTES;
+        uint32_t crc = crc32(bytes_.data() + HEADER_BYTES, static_cast<size_t>(section_bytes));
+        uint16_t version = FORMAT_VERSION;
+        uint16_t header_size = HEADER_BYTES;
+
+        uint8_t* header = bytes_.data();
+        std::memset(header, 0, HEADER_BYTES);
+        std::memcpy(header, &MAGIC, sizeof(uint32_t));
+        std::memcpy(header + 4, &version, sizeof(uint16_t));
+        std::memcpy(header + 6, &header_size, sizeof(uint16_t));
+        std::memcpy(header + 8, &section_count_, sizeof(uint32_t));
+        std::memcpy(header + 12, &crc, sizeof(uint32_t));
+        std::memcpy(header + 16, &section_bytes, sizeof(uint64_t));
+        std::memcpy(header + 24, &written_at_ms, sizeof(int64_t));
+
+        std::string temp_path = path + ".tmp";
+        int fd = ::open(temp_path.c_str(), O_WRONLY | O_CREAT | O_TRUNC | O_CLOEXEC, 0600);
+        if (fd < 0) {
+            PUUYAPU_LOG_PRINT(PUUYAPU_LOG_ERROR, LOG_TAG, "Cannot create %s", temp_path.c_str());
+            return false;
+        }
+
+        bool ok = writeAll(fd, bytes_.data(), bytes_.size());
+        ok = ok && fsync(fd) == 0;
+        ok = (::close(fd) == 0) && ok;
+        if (!ok || std::rename(temp_path.c_str(), path.c_str()) != 0) {
+            PUUYAPU_LOG_PRINT(PUUYAPU_LOG_ERROR, LOG_TAG, "Failed to write snapshot %s", path.c_str());
+            unlink(temp_path.c_str());
+            return false;
+        }
+        return true;
+    }
+
+// ============================================================================
+// DetectorSnapshot
+// ============================================================================
+
+    DetectorSnapshot::~DetectorSnapshot() noexcept {
+        close();
+    }
+
+    bool DetectorSnapshot::open(const std::string& path) noexcept {
+        close();
+
+        int fd = ::open(path.c_str(), O_RDONLY | O_CLOEXEC);
+        if (fd < 0) {
+            if (errno != ENOENT) {
+                PUUYAPU_LOG_PRINT(PUUYAPU_LOG_ERROR, LOG_TAG, "Cannot open snapshot %s", path.c_str());
+            }
+            return false;
+        }
+
+        struct stat info{};
+        if (fstat(fd, &info) != 0 || static_cast<size_t>(info.st_size) < SnapshotWriter::HEADER_BYTES) {
+            ::close(fd);
+            PUUYAPU_LOG_PRINT(PUUYAPU_LOG_ERROR, LOG_TAG, "Snapshot %s is truncated", path.c_str());
+            return false;
+        }
+
+        size_t size = static_cast<size_t>(info.st_size);
+        void* address = mmap(nullptr, size, PROT_READ, MAP_PRIVATE, fd, 0);
+        ::close(fd);
+        if (address == MAP_FAILED) {
+            PUUYAPU_LOG_PRINT(PUUYAPU_LOG_ERROR, LOG_TAG, "Cannot map snapshot %s", path.c_str());
+            return false;
+        }
+        data_ = static_cast<uint8_t*>(address);
+        size_ = size;
+
+        uint32_t magic, crc;
+        uint16_t version, header_size;
+        uint64_t section_bytes;
+        std::memcpy(&magic, data_, sizeof(uint32_t));
+        std::memcpy(&version, data_ + 4, sizeof(uint16_t));
+        std::memcpy(&header_size, data_ + 6, sizeof(uint16_t));
+        std::memcpy(&crc, data_ + 12, sizeof(uint32_t));
+        std::memcpy(&section_bytes, data_ + 16, sizeof(uint64_t));
+        std::memcpy(&written_at_ms_, data_ + 24, sizeof(int64_t));
+
+        bool valid = magic == SnapshotWriter::MAGIC &&
+                     version == SnapshotWriter::FORMAT_VERSION &&
+                     header_size == SnapshotWriter::HEADER_BYTES &&
+                     section_bytes == size - SnapshotWriter::HEADER_BYTES &&
+                     crc == crc32(data_ + SnapshotWriter::HEADER_BYTES, static_cast<size_t>(section_bytes));
+        if (!valid) {
+            PUUYAPU_LOG_PRINT(PUUYAPU_LOG_ERROR, LOG_TAG,
+                              "Snapshot %s is damaged or of another version (%u)", path.c_str(), version);
+            close();
+            return false;
+        }
+        return true;
+    }
+
+    bool DetectorSnapshot::section(SnapshotSection tag, SnapshotReader& reader) const noexcept {
+        if (!data_) {
+            return false;
+        }
+
+        // A handful of sections: a linear walk over their headers
+        size_t offset = SnapshotWriter::HEADER_BYTES;
+        while (size_ - offset >= SnapshotWriter::SECTION_HEADER_BYTES) {
+            uint32_t section_tag, length;
+            std::memcpy(&section_tag, data_ + offset, sizeof(uint32_t));
+            std::memcpy(&length, data_ + offset + 4, sizeof(uint32_t));
+            offset += SnapshotWriter::SECTION_HEADER_BYTES;
+            if (length > size_ - offset) {
+                return false;
+            }
+            if (section_tag == static_cast<uint32_t>(tag)) {
+                reader = SnapshotReader(data_ + offset, length);
+                return true;
+            }
+            offset += length;
+        }
+        return false;
+    }
+
+// ============================================================================
+// Private Helper Methods
+// ============================================================================
+
+    void DetectorSnapshot::close() noexcept {
+        if (data_) {
+            munmap(data_, size_);
+        }
+        data_ = nullptr;
+        size_ = 0;
+        written_at_ms_ = 0;
+    }
+
+} // namespace puuyapu
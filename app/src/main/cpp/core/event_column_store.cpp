@@ -0,0 +1,211 @@
+/**
+ * @file event_column_store.cpp
+ * @brief Implementation of the columnar interaction event store
+ */
+
+#include "event_column_store.h"
+#include <algorithm>
+
+namespace puuyapu {
+
+    namespace {
+        // Dead head entries tolerated before the columns are compacted
+        constexpr size_t COMPACT_THRESHOLD = 1024;
+
+        template<typename T>
+        void erasePrefix(std::vector<T>& column, size_t count) {
+            column.erase(column.begin(), column.begin() + static_cast<std::ptrdiff_t>(count));
+        }
+
+        template<typename T>
+        void insertAt(std::vector<T>& column, size_t index, T value) {
+            column.insert(column.begin() + static_cast<std::ptrdiff_t>(index), value);
+        }
+
+        int64_t toMilliseconds(std::chrono::system_clock::time_point time_point) noexcept {
+            return std::chrono::duration_cast<std::chrono::milliseconds>(
+                    time_point.time_since_epoch()).count();
+        }
+
+        uint32_t saturateDuration(std::chrono::milliseconds duration) noexcept {
+            auto count = duration.count();
+            if (count <= 0) return 0;
+            return count >= static_cast<int64_t>(UINT32_MAX) ? UINT32_MAX : static_cast<uint32_t>(count);
+        }
+    }
+
+    bool EventColumnStore::append(const InteractionEvent& event) {
+        if (!prepareTimestamp(toMilliseconds(event.timestamp))) {
+            return false;
+        }
+
+        offsets_.push_back(static_cast<uint32_t>(toMilliseconds(event.timestamp) - base_ms_));
+        durations_.push_back(saturateDuration(event.duration));
+        types_.push_back(static_cast<uint8_t>(event.type));
+        categories_.push_back(static_cast<uint8_t>(event.category));
+        flags_.push_back(policy_.classify(event));
+        app_hashes_.push_back(event.app_hash);
+        return true;
+    }
+
+    bool EventColumnStore::insert(size_t index, const InteractionEvent& event) {
+        if (!prepareTimestamp(toMilliseconds(event.timestamp))) {
+            return false;
+        }
+
+        size_t physical = head_ + index;
+        insertAt(offsets_, physical, static_cast<uint32_t>(toMilliseconds(event.timestamp) - base_ms_));
+        insertAt(durations_, physical, saturateDuration(event.duration));
+        insertAt(types_, physical, static_cast<uint8_t>(event.type));
+        insertAt(categories_, physical, static_cast<uint8_t>(event.category));
+        insertAt(flags_, physical, policy_.classify(event));
+        insertAt(app_hashes_, physical, event.app_hash);
+        return true;
+    }
+
+    void EventColumnStore::popFront() noexcept {
+        if (empty()) {
+            return;
+        }
+
+        head_++;
+        if (head_ == offsets_.size()) {
+            clear();
+        } else if (head_ >= COMPACT_THRESHOLD && head_ >= size()) {
+            compact();
+        }
+    }
+
+    void EventColumnStore::clear() noexcept {
+        offsets_.clear();
+        durations_.clear();
+        types_.clear();
+        categories_.clear();
+        flags_.clear();
+        app_hashes_.clear();
+        head_ = 0;
+        base_ms_ = 0;
+    }
+
+    void EventColumnStore::shrinkToFit() {
+        compact();
+        offsets_.shrink_to_fit();
+        durations_.shrink_to_fit();
+        types_.shrink_to_fit();
+        categories_.shrink_to_fit();
+        flags_.shrink_to_fit();
+        app_hashes_.shrink_to_fit();
+    }
+
+    size_t EventColumnStore::memoryUsageBytes() const noexcept {
+        return offsets_.capacity() * sizeof(uint32_t) +
+               durations_.capacity() * sizeof(uint32_t) +
+               types_.capacity() + categories_.capacity() + flags_.capacity() +
+               app_hashes_.capacity() * sizeof(uint16_t);
+    }
+
+    InteractionEvent EventColumnStore::eventAt(size_t index) const noexcept {
+        InteractionEvent event{timestampAt(index), durationAt(index), typeAt(index), categoryAt(index)};
+        event.app_hash = appHashAt(index);
+        return event;
+    }
+
+    size_t EventColumnStore::lowerBound(std::chrono::system_clock::time_point time_point) const noexcept {
+        // First whole millisecond not before time_point
+        auto floor_ms = std::chrono::floor<std::chrono::milliseconds>(time_point.time_since_epoch());
+        int64_t target = floor_ms.count();
+        if (floor_ms < time_point.time_since_epoch()) {
+            target++;
+        }
+
+        if (empty() || target <= base_ms_) {
+            return 0;
+        }
+        int64_t relative = target - base_ms_;
+        if (relative > static_cast<int64_t>(UINT32_MAX)) {
+            return size();
+        }
+
+        auto begin = offsets_.begin() + static_cast<std::ptrdiff_t>(head_);
+        return static_cast<size_t>(std::lower_bound(begin, offsets_.end(),
+                                                    static_cast<uint32_t>(relative)) - begin);
+    }
+
+    size_t EventColumnStore::upperBound(std::chrono::system_clock::time_point time_point) const noexcept {
+        auto floor_ms = std::chrono::floor<std::chrono::milliseconds>(time_point.time_since_epoch());
+        return lowerBound(std::chrono::system_clock::time_point(floor_ms + std::chrono::milliseconds(1)));
+    }
+
+    bool EventColumnStore::setPolicy(const ClassificationPolicy& policy) noexcept {
+        if (policy == policy_) {
+            return false;
+        }
+        policy_ = policy;
+
+        // Dead head entries are skipped; they are never read again
+        for (size_t i = head_; i < flags_.size(); ++i) {
+            flags_[i] = policy_.classify(static_cast<InteractionType>(types_[i]),
+                                         static_cast<AppCategory>(categories_[i]),
+                                         durations_[i]);
+        }
+        return true;
+    }
+
+// ============================================================================
+// Private Helper Methods
+// ============================================================================
+
+    bool EventColumnStore::prepareTimestamp(int64_t timestamp_ms) {
+        if (empty()) {
+            clear();
+            base_ms_ = timestamp_ms;
+            return true;
+        }
+
+        if (timestamp_ms < base_ms_) {
+            // Late event before the base: shift every offset up
+            uint64_t shift = static_cast<uint64_t>(base_ms_ - timestamp_ms);
+            if (offsets_.back() + shift > UINT32_MAX) {
+                return false;
+            }
+            compact();
+            for (auto& offset : offsets_) {
+                offset += static_cast<uint32_t>(shift);
+            }
+            base_ms_ = timestamp_ms;
+            return true;
+        }
+
+        uint64_t relative = static_cast<uint64_t>(timestamp_ms - base_ms_);
+        if (relative <= UINT32_MAX) {
+            return true;
+        }
+
+        // Offset overflow: move the base up to the current head
+        compact();
+        uint32_t head_offset = offsets_.front();
+        if (relative - head_offset > UINT32_MAX) {
+            return false;
+        }
+        for (auto& offset : offsets_) {
+            offset -= head_offset;
+        }
+        base_ms_ += head_offset;
+        return true;
+    }
+
+    void EventColumnStore::compact() {
+        if (head_ == 0) {
+            return;
+        }
+
+        erasePrefix(offsets_, head_);
+        erasePrefix(durations_, head_);
+        erasePrefix(types_, head_);
+        erasePrefix(categories_, head_);
+        erasePrefix(flags_, head_);
+        erasePrefix(app_hashes_, head_);
+        head_ = 0;
+    }
+
+} // namespace puuyapu
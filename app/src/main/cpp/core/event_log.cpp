@@ -0,0 +1,321 @@
+/**
+ * @file event_log.cpp
+ * @brief Implementation of the memory-mapped persistent event log
+ */
+
+#include "event_log.h"
+#include "checksum.h"
+#include "platform_log.h"
+#include <algorithm>
+#include <cerrno>
+#include <cinttypes>
+#include <cstdio>
+#include <cstring>
+#include <dirent.h>
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <unistd.h>
+
+namespace puuyapu {
+
+    namespace {
+        constexpr const char* LOG_TAG = "PuuyApu_EventLog";
+
+        constexpr uint64_t SEGMENT_MAGIC = 0x31474F4C56455550ULL;  // "PUEVLOG1"
+        constexpr uint32_t SEGMENT_VERSION = 1;
+        constexpr size_t FRAME_INDEX_OFFSET = InteractionEvent::SERIALIZED_SIZE;
+        constexpr size_t FRAME_CRC_OFFSET = FRAME_INDEX_OFFSET + sizeof(uint32_t);
+
+        bool frameIsValid(const uint8_t* frame, uint32_t expected_index) noexcept {
+            uint32_t index, crc;
+            std::memcpy(&index, frame + FRAME_INDEX_OFFSET, sizeof(uint32_t));
+            std::memcpy(&crc, frame + FRAME_CRC_OFFSET, sizeof(uint32_t));
+            return index == expected_index && crc == crc32(frame, FRAME_CRC_OFFSET);
+        }
+
+        int64_t frameTimestampMs(const uint8_t* frame) noexcept {
+            int64_t timestamp_ns;
+            std::memcpy(&timestamp_ns, frame, sizeof(int64_t));
+            return timestamp_ns / 1000000;
+        }
+
+        bool parseSegmentName(const char* name, uint64_t& sequence) noexcept {
+            unsigned long long value = 0;
+            char suffix[8] = {};
+            if (std::sscanf(name, "events-%16llx.%4s", &value, suffix) != 2 ||
+                std::strcmp(suffix, "log") != 0) {
+                return false;
+            }
+            sequence = value;
+            return true;
+        }
+    }
+
+    EventLog::~EventLog() noexcept {
+        close();
+    }
+
+    bool EventLog::open(const std::string& directory,
+                        Durability durability,
+                        size_t max_segments) noexcept {
+        close();
+
+        directory_ = directory;
+        durability_ = durability;
+        max_segments_ = std::max<size_t>(max_segments, 1);
+
+        // Collect existing segments
+        std::vector<uint64_t> sequences;
+        DIR* dir = opendir(directory_.c_str());
+        if (!dir) {
+            PUUYAPU_LOG_PRINT(PUUYAPU_LOG_ERROR, LOG_TAG,
+                              "Cannot open event log directory %s", directory_.c_str());
+            return false;
+        }
+        while (dirent* entry = readdir(dir)) {
+            uint64_t sequence;
+            if (parseSegmentName(entry->d_name, sequence)) {
+                sequences.push_back(sequence);
+            }
+        }
+        closedir(dir);
+
+        std::sort(sequences.begin(), sequences.end());
+
+        // Retention: keep only the newest segments
+        size_t excess = sequences.size() > max_segments_ ? sequences.size() - max_segments_ : 0;
+        for (size_t i = 0; i < excess; ++i) {
+            unlink(segmentPath(sequences[i]).c_str());
+        }
+
+        segments_.reserve(max_segments_ + 1);
+        for (size_t i = excess; i < sequences.size(); ++i) {
+            Segment segment;
+            segment.sequence = sequences[i];
+            segment.path = segmentPath(sequences[i]);
+            MapResult mapped = mapSegment(segment, false);
+            if (mapped == MapResult::MAPPED) {
+                segments_.push_back(std::move(segment));
+            } else if (mapped == MapResult::DAMAGED) {
+                PUUYAPU_LOG_PRINT(PUUYAPU_LOG_ERROR, LOG_TAG,
+                                  "Discarding damaged segment %s", segment.path.c_str());
+                closeSegment(segment, true);
+            } else {
+                // Out of descriptors or memory: keep the history for the next open
+                PUUYAPU_LOG_PRINT(PUUYAPU_LOG_ERROR, LOG_TAG,
+                                  "Cannot map segment %s: %s", segment.path.c_str(), std::strerror(errno));
+                closeSegment(segment, false);
+                close();
+                return false;
+            }
+        }
+
+        if (segments_.empty() || segments_.back().frame_count >= FRAMES_PER_SEGMENT) {
+            if (!rollSegment()) {
+                close();
+                return false;
+            }
+        }
+
+        PUUYAPU_LOG_PRINT(PUUYAPU_LOG_INFO, LOG_TAG,
+                          "Event log opened: %zu segments, %zu events",
+                            segments_.size(), eventCount());
+        return true;
+    }
+
+    bool EventLog::append(const InteractionEvent& event) noexcept {
+        if (segments_.empty()) {
+            return false;
+        }
+
+        if (segments_.back().frame_count >= FRAMES_PER_SEGMENT && !rollSegment()) {
+            return false;
+        }
+
+        Segment& segment = segments_.back();
+        auto index = static_cast<uint32_t>(segment.frame_count);
+        uint8_t* frame = segment.data + HEADER_BYTES + segment.frame_count * FRAME_BYTES;
+
+        event.serialize(frame);
+        std::memcpy(frame + FRAME_INDEX_OFFSET, &index, sizeof(uint32_t));
+        uint32_t crc = crc32(frame, FRAME_CRC_OFFSET);
+        std::memcpy(frame + FRAME_CRC_OFFSET, &crc, sizeof(uint32_t));
+
+        segment.frame_count++;
+        segment.last_timestamp_ms = std::max(segment.last_timestamp_ms, frameTimestampMs(frame));
+
+        if (durability_ == Durability::BATCHED &&
+            segment.frame_count - segment.synced_frames >= DURABILITY_BATCH_FRAMES) {
+            syncSegment(segment, false);
+        }
+
+        return true;
+    }
+
+    void EventLog::sync() noexcept {
+        if (!segments_.empty()) {
+            syncSegment(segments_.back(), true);
+        }
+    }
+
+    size_t EventLog::dropSegmentsBefore(std::chrono::system_clock::time_point cutoff_time) noexcept {
+        int64_t cutoff_ms = std::chrono::duration_cast<std::chrono::milliseconds>(
+                cutoff_time.time_since_epoch()).count();
+
+        size_t dropped = 0;
+        while (segments_.size() > 1 && segments_.front().last_timestamp_ms < cutoff_ms) {
+            closeSegment(segments_.front(), true);
+            segments_.erase(segments_.begin());
+            dropped++;
+        }
+        return dropped;
+    }
+
+    size_t EventLog::eventCount() const noexcept {
+        size_t count = 0;
+        for (const auto& segment : segments_) {
+            count += segment.frame_count;
+        }
+        return count;
+    }
+
+// ============================================================================
+// Private Helper Methods
+// ============================================================================
+
+    EventLog::MapResult EventLog::mapSegment(Segment& segment, bool create) noexcept {
+        int flags = O_RDWR | O_CLOEXEC | (create ? O_CREAT | O_EXCL : 0);
+        segment.fd = ::open(segment.path.c_str(), flags, 0600);
+        if (segment.fd < 0) {
+            return MapResult::FAILED;
+        }
+
+        if (create && ftruncate(segment.fd, static_cast<off_t>(SEGMENT_BYTES)) != 0) {
+            return MapResult::FAILED;
+        }
+        if (!create) {
+            off_t size = lseek(segment.fd, 0, SEEK_END);
+            if (size < 0) {
+                return MapResult::FAILED;
+            }
+            if (size != static_cast<off_t>(SEGMENT_BYTES)) {
+                return MapResult::DAMAGED;
+            }
+        }
+
+        void* address = mmap(nullptr, SEGMENT_BYTES, PROT_READ | PROT_WRITE, MAP_SHARED, segment.fd, 0);
+        if (address == MAP_FAILED) {
+            return MapResult::FAILED;
+        }
+        segment.data = static_cast<uint8_t*>(address);
+
+        if (create) {
+            uint32_t frame_bytes = FRAME_BYTES;
+            std::memcpy(segment.data, &SEGMENT_MAGIC, sizeof(uint64_t));
+            std::memcpy(segment.data + 8, &SEGMENT_VERSION, sizeof(uint32_t));
+            std::memcpy(segment.data + 12, &frame_bytes, sizeof(uint32_t));
+            std::memcpy(segment.data + 16, &segment.sequence, sizeof(uint64_t));
+            return MapResult::MAPPED;
+        }
+
+        // Validate header
+        uint64_t magic, sequence;
+        uint32_t version, frame_bytes;
+        std::memcpy(&magic, segment.data, sizeof(uint64_t));
+        std::memcpy(&version, segment.data + 8, sizeof(uint32_t));
+        std::memcpy(&frame_bytes, segment.data + 12, sizeof(uint32_t));
+        std::memcpy(&sequence, segment.data + 16, sizeof(uint64_t));
+        if (magic != SEGMENT_MAGIC || version != SEGMENT_VERSION ||
+            frame_bytes != FRAME_BYTES || sequence != segment.sequence) {
+            return MapResult::DAMAGED;
+        }
+
+        // Count valid frames; the first invalid frame marks the end
+        while (segment.frame_count < FRAMES_PER_SEGMENT) {
+            const uint8_t* frame = frameAt(segment, segment.frame_count);
+            if (!frameIsValid(frame, static_cast<uint32_t>(segment.frame_count))) {
+                break;
+            }
+            segment.last_timestamp_ms = std::max(segment.last_timestamp_ms, frameTimestampMs(frame));
+            segment.frame_count++;
+        }
+        segment.synced_frames = segment.frame_count;
+
+        return MapResult::MAPPED;
+    }
+
+    bool EventLog::rollSegment() noexcept {
+        if (!segments_.empty() && durability_ == Durability::BATCHED) {
+            syncSegment(segments_.back(), true);
+        }
+
+        Segment segment;
+        segment.sequence = segments_.empty() ? 1 : segments_.back().sequence + 1;
+        segment.path = segmentPath(segment.sequence);
+
+        if (mapSegment(segment, true) != MapResult::MAPPED) {
+            PUUYAPU_LOG_PRINT(PUUYAPU_LOG_ERROR, LOG_TAG,
+                              "Cannot create segment %s", segment.path.c_str());
+            closeSegment(segment, false);
+            return false;
+        }
+
+        segments_.push_back(std::move(segment));
+
+        while (segments_.size() > max_segments_) {
+            closeSegment(segments_.front(), true);
+            segments_.erase(segments_.begin());
+        }
+
+        return true;
+    }
+
+    void EventLog::syncSegment(Segment& segment, bool blocking) noexcept {
+        if (!segment.data || segment.synced_frames == segment.frame_count) {
+            return;
+        }
+
+        // msync needs a page-aligned start
+        static const size_t page_size = static_cast<size_t>(sysconf(_SC_PAGESIZE));
+        size_t begin = HEADER_BYTES + segment.synced_frames * FRAME_BYTES;
+        size_t end = HEADER_BYTES + segment.frame_count * FRAME_BYTES;
+        if (segment.synced_frames == 0) {
+            begin = 0;
+        }
+        begin -= begin % page_size;
+
+        msync(segment.data + begin, end - begin, blocking ? MS_SYNC : MS_ASYNC);
+        segment.synced_frames = segment.frame_count;
+    }
+
+    void EventLog::closeSegment(Segment& segment, bool remove) noexcept {
+        if (segment.data) {
+            if (!remove && durability_ == Durability::BATCHED) {
+                syncSegment(segment, true);
+            }
+            munmap(segment.data, SEGMENT_BYTES);
+            segment.data = nullptr;
+        }
+        if (segment.fd >= 0) {
+            ::close(segment.fd);
+            segment.fd = -1;
+        }
+        if (remove) {
+            unlink(segment.path.c_str());
+        }
+    }
+
+    void EventLog::close() noexcept {
+        for (auto& segment : segments_) {
+            closeSegment(segment, false);
+        }
+        segments_.clear();
+    }
+
+    std::string EventLog::segmentPath(uint64_t sequence) const {
+        char name[32];
+        std::snprintf(name, sizeof(name), "events-%016" PRIx64 ".log", sequence);
+        return directory_ + "/" + name;
+    }
+
+} // namespace puuyapu
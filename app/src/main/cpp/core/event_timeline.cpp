@@ -0,0 +1,223 @@
+/**
+ * @file event_timeline.cpp
+ * @brief Implementation of the ordered interaction timeline
+ *
+ * Incremental replacement for the copy-sort-scan detection pipeline.
+ * Gap bookkeeping is updated per appended event; only evictions and
+ * out-of-order inserts require (lazy) repair work.
+ */
+
+#include "event_timeline.h"
+#include "gap_scan.h"
+#include <algorithm>
+
+namespace puuyapu {
+
+    EventTimeline::EventTimeline(std::chrono::milliseconds minimum_gap,
+                                 std::chrono::milliseconds retention,
+                                 size_t capacity) noexcept
+            : min_gap_(minimum_gap),
+              retention_(std::min(retention, EventColumnStore::MAX_SPAN)),
+              capacity_(std::max<size_t>(capacity, 1)) {}
+
+    bool EventTimeline::insert(const InteractionEvent& event) {
+        if (store_.empty() || !(event.timestamp < store_.timestampAt(store_.size() - 1))) {
+            // Common case: events arrive in chronological order.
+            // Expire history that fell out of the retention window.
+            auto horizon = event.timestamp - retention_;
+            while (!store_.empty() && store_.timestampAt(0) < horizon) {
+                evictFront();
+            }
+            if (store_.size() >= capacity_) {
+                evictFront();
+            }
+
+            if (!store_.append(event)) {
+                return false;
+            }
+            if (!rebuild_required_) {
+                trackAppended(store_.size() - 1);
+            }
+            return true;
+        }
+
+        // Late event - keep order, repair gap index on next query
+        if (event.timestamp < store_.timestampAt(store_.size() - 1) - retention_) {
+            return false;
+        }
+        if (store_.size() >= capacity_) {
+            evictFront();
+        }
+        if (!store_.insert(store_.upperBound(event.timestamp), event)) {
+            return false;
+        }
+        rebuild_required_ = true;
+        return true;
+    }
+
+    size_t EventTimeline::eraseBefore(std::chrono::system_clock::time_point cutoff_time) noexcept {
+        size_t count = lowerBound(cutoff_time);
+        for (size_t i = 0; i < count; ++i) {
+            evictFront();
+        }
+        return count;
+    }
+
+    void EventTimeline::setMinimumGap(std::chrono::milliseconds minimum_gap) noexcept {
+        if (minimum_gap != min_gap_) {
+            min_gap_ = minimum_gap;
+            rebuild_required_ = true;
+        }
+    }
+
+    void EventTimeline::setClassificationPolicy(const ClassificationPolicy& policy) noexcept {
+        if (store_.setPolicy(policy)) {
+            rebuild_required_ = true;
+        }
+    }
+
+    void EventTimeline::shrinkToFit() {
+        store_.shrinkToFit();
+        gaps_.shrink_to_fit();
+    }
+
+    size_t EventTimeline::lowerBound(std::chrono::system_clock::time_point time_point) const noexcept {
+        return store_.lowerBound(time_point);
+    }
+
+    size_t EventTimeline::upperBound(std::chrono::system_clock::time_point time_point) const noexcept {
+        return store_.upperBound(time_point);
+    }
+
+    size_t EventTimeline::lastMeaningful() const noexcept {
+        if (rebuild_required_) {
+            rebuildGaps();
+        }
+        return last_meaningful_index_;
+    }
+
+    size_t EventTimeline::nextMeaningful(size_t index) const noexcept {
+        // Flag column scan only, 16 flags per vector test
+        if (index >= store_.size()) {
+            return NPOS;
+        }
+        size_t count = store_.size() - index;
+        size_t found = findFlagged(store_.flagData() + index, count, EventColumnStore::FLAG_MEANINGFUL);
+        return found < count ? index + found : NPOS;
+    }
+
+    const TimeGapList& EventTimeline::gaps() const noexcept {
+        if (rebuild_required_) {
+            rebuildGaps();
+        } else if (leading_dirty_) {
+            refreshLeadingSegment();
+        }
+        return gaps_;
+    }
+
+// ============================================================================
+// Private Helper Methods
+// ============================================================================
+
+    void EventTimeline::evictFront() noexcept {
+        store_.popFront();
+
+        if (rebuild_required_) {
+            return;
+        }
+
+        if (last_meaningful_index_ != NPOS) {
+            last_meaningful_index_ = (last_meaningful_index_ == 0) ? NPOS : last_meaningful_index_ - 1;
+        }
+
+        if (anchor_index_ == 0) {
+            // The evicted head was the open anchor; the new head takes over.
+            // It cannot be meaningful (it would have become the anchor), so it
+            // was only counted if it is a time check.
+            if (store_.empty()) {
+                anchor_index_ = NPOS;
+                brief_since_anchor_ = 0;
+            } else if (store_.isTimeCheckAt(0)) {
+                brief_since_anchor_--;
+            }
+        } else if (anchor_index_ != NPOS) {
+            anchor_index_--;
+        }
+
+        leading_dirty_ = true;
+    }
+
+    void EventTimeline::trackAppended(size_t index) const noexcept {
+        uint8_t flags = store_.flagsAt(index);
+
+        if (anchor_index_ == NPOS) {
+            anchor_index_ = index;
+            brief_since_anchor_ = 0;
+            if (flags & EventColumnStore::FLAG_MEANINGFUL) {
+                last_meaningful_index_ = index;
+            }
+            return;
+        }
+
+        if (flags & EventColumnStore::FLAG_MEANINGFUL) {
+            auto event_time = store_.timestampAt(index);
+            auto anchor_time = store_.timestampAt(anchor_index_);
+            if (event_time - anchor_time >= min_gap_) {
+                TimeGap gap(anchor_time, event_time);
+                gap.brief_interaction_count = brief_since_anchor_;
+                gap.contains_brief_interactions = brief_since_anchor_ > 0;
+                gaps_.push_back(gap);
+            }
+
+            anchor_index_ = index;
+            last_meaningful_index_ = index;
+            brief_since_anchor_ = 0;
+        } else if (flags & EventColumnStore::FLAG_TIME_CHECK) {
+            brief_since_anchor_++;
+        }
+    }
+
+    void EventTimeline::refreshLeadingSegment() const noexcept {
+        leading_dirty_ = false;
+
+        // Only the segment between the head and the first meaningful event
+        // depends on the head; every later gap is anchored at a meaningful event.
+        size_t first_meaningful = store_.empty() ? NPOS : nextMeaningful(1);
+        if (first_meaningful == NPOS) {
+            gaps_.clear();
+            return;
+        }
+
+        auto segment_end = store_.timestampAt(first_meaningful);
+        auto keep = std::find_if(gaps_.begin(), gaps_.end(),
+                                 [segment_end](const TimeGap& gap) { return gap.end_time > segment_end; });
+        gaps_.erase(gaps_.begin(), keep);
+
+        auto head_time = store_.timestampAt(0);
+        if (segment_end - head_time >= min_gap_) {
+            TimeGap gap(head_time, segment_end);
+            gap.brief_interaction_count = static_cast<int>(
+                    countFlagged(store_.flagData() + 1, first_meaningful - 1, EventColumnStore::FLAG_TIME_CHECK));
+            gap.contains_brief_interactions = gap.brief_interaction_count > 0;
+            gaps_.insert(gaps_.begin(), gap);
+        }
+    }
+
+    void EventTimeline::rebuildGaps() const noexcept {
+        gaps_.clear();
+
+        // Vectorized equivalent of trackAppended over every event
+        GapScanState state;
+        scanInteractionGaps(store_.flagData(), store_.size(), 0,
+                            [this](size_t index) { return store_.timestampAt(index); },
+                            min_gap_, state, gaps_);
+
+        anchor_index_ = state.anchor_index;
+        last_meaningful_index_ = state.last_meaningful_index;
+        brief_since_anchor_ = state.brief_since_anchor;
+
+        rebuild_required_ = false;
+        leading_dirty_ = false;
+    }
+
+} // namespace puuyapu
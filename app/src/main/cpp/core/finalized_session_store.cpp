@@ -0,0 +1,232 @@
+/**
+ * @file finalized_session_store.cpp
+ * @brief Implementation of the sealed night store
+ */
+
+#include "finalized_session_store.h"
+#include "time_utils.h"
+#include <algorithm>
+
+namespace puuyapu {
+
+    bool FinalizedSessionStore::seal(int64_t night_index, const SleepDetectionResult& result) {
+        if (!result.isValid()) {
+            return false;
+        }
+
+        size_t position = lowerBound(night_index);
+        if (position < nights_.size() && nights_[position].night_index == night_index) {
+            return false;
+        }
+
+        Night night{night_index, SleepDetectionResult{}, static_cast<uint32_t>(interruptions_.size()),
+                    static_cast<uint32_t>(result.interruptions.size()), result.calculateSleepEfficiency()};
+        night.result.bedtime = result.bedtime;
+        night.result.wake_time = result.wake_time;
+        night.result.duration = result.duration;
+        night.result.confidence = result.confidence;
+        night.result.quality_score = result.quality_score;
+        night.result.is_manually_confirmed = result.is_manually_confirmed;
+        night.result.pattern_match_score = result.pattern_match_score;
+
+        interruptions_.insert(interruptions_.end(), result.interruptions.begin(), result.interruptions.end());
+        SleepAggregate aggregate = aggregateOf(night);
+        nights_.insert(nights_.begin() + static_cast<std::ptrdiff_t>(position), std::move(night));
+
+        if (nights_.size() > capacity_) {
+            dropOldest(nights_.size() - capacity_);
+        } else if (!aggregates_.add(night_index, aggregate)) {
+            rebuildAggregates();
+        }
+        return true;
+    }
+
+    void FinalizedSessionStore::setCapacity(size_t nights) {
+        capacity_ = std::max<size_t>(nights, 1);
+        if (nights_.size() > capacity_) {
+            dropOldest(nights_.size() - capacity_);
+        }
+    }
+
+    size_t FinalizedSessionStore::find(int64_t night_index) const noexcept {
+        // Live detection mostly asks for the newest night
+        if (!nights_.empty() && nights_.back().night_index == night_index) {
+            return nights_.size() - 1;
+        }
+        size_t position = lowerBound(night_index);
+        return position < nights_.size() && nights_[position].night_index == night_index ? position : NPOS;
+    }
+
+    size_t FinalizedSessionStore::lowerBound(int64_t night_index) const noexcept {
+        auto it = std::lower_bound(nights_.begin(), nights_.end(), night_index,
+                                   [](const Night& night, int64_t key) { return night.night_index < key; });
+        return static_cast<size_t>(it - nights_.begin());
+    }
+
+    void FinalizedSessionStore::load(size_t index, SleepDetectionResult& out) const {
+        const Night& night = nights_[index];
+        out.bedtime = night.result.bedtime;
+        out.wake_time = night.result.wake_time;
+        out.duration = night.result.duration;
+        out.confidence = night.result.confidence;
+        out.quality_score = night.result.quality_score;
+        out.is_manually_confirmed = night.result.is_manually_confirmed;
+        out.pattern_match_score = night.result.pattern_match_score;
+
+        const SleepInterruption* first = interruptions_.data() + night.first_interruption;
+        out.interruptions.assign(first, first + night.interruption_count);
+    }
+
+    void FinalizedSessionStore::rekey() noexcept {
+        auto& time_zone = TimeZoneContext::shared();
+        for (Night& night : nights_) {
+            night.night_index = time_zone.toCivil(*night.result.bedtime).night_index;
+        }
+
+        // Order by night, longer sleep first, then drop collapsed duplicates
+        std::stable_sort(nights_.begin(), nights_.end(), [](const Night& a, const Night& b) {
+            if (a.night_index != b.night_index) {
+                return a.night_index < b.night_index;
+            }
+            return a.result.duration > b.result.duration;
+        });
+        auto last = std::unique(nights_.begin(), nights_.end(), [](const Night& a, const Night& b) {
+            return a.night_index == b.night_index;
+        });
+        if (last != nights_.end()) {
+            nights_.erase(last, nights_.end());
+            compactInterruptions();
+        }
+        rebuildAggregates();
+    }
+
+    void FinalizedSessionStore::clear() noexcept {
+        nights_.clear();
+        interruptions_.clear();
+        aggregates_.clear();
+    }
+
+    size_t FinalizedSessionStore::memoryUsageBytes() const noexcept {
+        return nights_.capacity() * sizeof(Night) + interruptions_.capacity() * sizeof(SleepInterruption) +
+               aggregates_.memoryUsageBytes();
+    }
+
+    void FinalizedSessionStore::writeTo(SnapshotWriter& writer) const {
+        writer.put(static_cast<uint32_t>(nights_.size()));
+        for (const Night& night : nights_) {
+            writer.put(night.night_index);
+            writer.putTime(*night.result.bedtime);
+            writer.putTime(*night.result.wake_time);
+            writer.put(night.result.duration.count());
+            writer.put(night.result.confidence);
+            writer.put(night.result.quality_score);
+            writer.put<uint8_t>(night.result.is_manually_confirmed ? 1 : 0);
+            writer.put(night.result.pattern_match_score);
+            writer.put(night.interruption_count);
+            for (uint32_t i = 0; i < night.interruption_count; ++i) {
+                const SleepInterruption& interruption = interruptions_[night.first_interruption + i];
+                writer.putTime(interruption.timestamp);
+                writer.put<int64_t>(interruption.duration.count());
+                writer.put(interruption.cause);
+                writer.put(interruption.app_category);
+                writer.put<uint8_t>(interruption.is_brief_check ? 1 : 0);
+                writer.put(interruption.impact_score);
+            }
+        }
+    }
+
+    bool FinalizedSessionStore::readFrom(SnapshotReader& reader) {
+        constexpr size_t MIN_NIGHT_BYTES = 54;
+        constexpr size_t INTERRUPTION_BYTES = 27;
+
+        FinalizedSessionStore decoded;
+        decoded.capacity_ = capacity_;
+
+        uint32_t count = 0;
+        if (!reader.getCount(count, MIN_NIGHT_BYTES)) {
+            return false;
+        }
+        for (uint32_t n = 0; n < count; ++n) {
+            int64_t night_index = 0;
+            std::chrono::system_clock::time_point bedtime, wake_time;
+            double duration_hours = 0.0;
+            uint8_t manual = 0;
+            uint32_t interruptions = 0;
+            SleepDetectionResult result;
+            bool ok = reader.get(night_index) && reader.getTime(bedtime) && reader.getTime(wake_time) &&
+                      reader.get(duration_hours) && reader.get(result.confidence) &&
+                      reader.get(result.quality_score) && reader.get(manual) &&
+                      reader.get(result.pattern_match_score) &&
+                      reader.getCount(interruptions, INTERRUPTION_BYTES) &&
+                      result.confidence <= SleepConfidence::VERY_HIGH;
+            if (!ok) {
+                return false;
+            }
+            result.bedtime = bedtime;
+            result.wake_time = wake_time;
+            result.duration = std::chrono::duration<double, std::ratio<3600>>(duration_hours);
+            result.is_manually_confirmed = manual != 0;
+
+            result.interruptions.reserve(interruptions);
+            for (uint32_t i = 0; i < interruptions; ++i) {
+                SleepInterruption interruption;
+                int64_t duration_ms = 0;
+                uint8_t brief = 0;
+                if (!reader.getTime(interruption.timestamp) || !reader.get(duration_ms) ||
+                    !reader.get(interruption.cause) || !reader.get(interruption.app_category) ||
+                    !reader.get(brief) || !reader.get(interruption.impact_score)) {
+                    return false;
+                }
+                interruption.duration = std::chrono::milliseconds(duration_ms);
+                interruption.is_brief_check = brief != 0;
+                result.interruptions.push_back(interruption);
+            }
+
+            // Written oldest first: each seal is an append
+            decoded.seal(night_index, result);
+        }
+
+        *this = std::move(decoded);
+        return true;
+    }
+
+// ============================================================================
+// Private Helper Methods
+// ============================================================================
+
+    void FinalizedSessionStore::dropOldest(size_t count) noexcept {
+        nights_.erase(nights_.begin(), nights_.begin() + static_cast<std::ptrdiff_t>(count));
+        compactInterruptions();
+        rebuildAggregates();
+    }
+
+    void FinalizedSessionStore::compactInterruptions() noexcept {
+        // Rare (once a day at most): rebuild the shared array in night order
+        std::vector<SleepInterruption> compacted;
+        compacted.reserve(interruptions_.size());
+        for (Night& night : nights_) {
+            auto first = interruptions_.begin() + night.first_interruption;
+            night.first_interruption = static_cast<uint32_t>(compacted.size());
+            compacted.insert(compacted.end(), first, first + night.interruption_count);
+        }
+        interruptions_.swap(compacted);
+    }
+
+    SleepAggregate FinalizedSessionStore::aggregateOf(const Night& night) const noexcept {
+        auto into_night = *night.result.bedtime - TimeZoneContext::shared().nightWindowStartOf(night.night_index);
+        SleepAggregate aggregate = SleepAggregate::of(
+                night.result, std::chrono::duration<double, std::ratio<60>>(into_night).count());
+        aggregate.interruptions = night.interruption_count;
+        aggregate.efficiency = night.efficiency;
+        return aggregate;
+    }
+
+    void FinalizedSessionStore::rebuildAggregates() {
+        // Rare (eviction, timezone change, out-of-order seal before the first night)
+        aggregates_.clear();
+        for (const Night& night : nights_) {
+            aggregates_.add(night.night_index, aggregateOf(night));
+        }
+    }
+
+} // namespace puuyapu
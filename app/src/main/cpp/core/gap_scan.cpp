@@ -0,0 +1,137 @@
+/**
+ * @file gap_scan.cpp
+ * @brief SIMD flag mask backends for the gap scan
+ *
+ * One 16-byte load per word: NEON tests the flag bits with vtst and
+ * packs the lane results with pairwise adds; SSE2 compares against zero
+ * and uses movemask. The scalar loop is the reference and handles the
+ * partial tail word on every backend.
+ */
+
+#include "gap_scan.h"
+
+#if !defined(PUUYAPU_NO_SIMD) && (defined(__ARM_NEON) || defined(__ARM_NEON__))
+#include <arm_neon.h>
+#define PUUYAPU_GAP_SCAN_NEON 1
+#elif !defined(PUUYAPU_NO_SIMD) && defined(__SSE2__)
+#include <emmintrin.h>
+#define PUUYAPU_GAP_SCAN_SSE2 1
+#endif
+
+namespace puuyapu {
+
+    namespace {
+        constexpr uint8_t MEANINGFUL = EventColumnStore::FLAG_MEANINGFUL;
+        constexpr uint8_t TIME_CHECK = EventColumnStore::FLAG_TIME_CHECK;
+
+        uint32_t scalarMask(const uint8_t* flags, size_t count, uint8_t flag) noexcept {
+            uint32_t mask = 0;
+            for (size_t i = 0; i < count; ++i) {
+                if (flags[i] & flag) {
+                    mask |= 1u << i;
+                }
+            }
+            return mask;
+        }
+
+#if defined(PUUYAPU_GAP_SCAN_NEON)
+        /// Lanes must be 0x00 or 0xFF
+        inline uint32_t laneMask(uint8x16_t lanes) noexcept {
+            static const uint8_t WEIGHTS[16] = {1, 2, 4, 8, 16, 32, 64, 128,
+                                                1, 2, 4, 8, 16, 32, 64, 128};
+            uint8x16_t bits = vandq_u8(lanes, vld1q_u8(WEIGHTS));
+            uint8x8_t sum = vpadd_u8(vget_low_u8(bits), vget_high_u8(bits));
+            sum = vpadd_u8(sum, sum);
+            sum = vpadd_u8(sum, sum);
+            return static_cast<uint32_t>(vget_lane_u8(sum, 0)) |
+                   (static_cast<uint32_t>(vget_lane_u8(sum, 1)) << 8);
+        }
+
+        inline uint32_t wordMask(const uint8_t* flags, uint8_t flag) noexcept {
+            return laneMask(vtstq_u8(vld1q_u8(flags), vdupq_n_u8(flag)));
+        }
+
+        inline void wordMasks(const uint8_t* flags, uint32_t& meaningful, uint32_t& time_checks) noexcept {
+            uint8x16_t values = vld1q_u8(flags);
+            meaningful = laneMask(vtstq_u8(values, vdupq_n_u8(MEANINGFUL)));
+            time_checks = laneMask(vtstq_u8(values, vdupq_n_u8(TIME_CHECK)));
+        }
+#elif defined(PUUYAPU_GAP_SCAN_SSE2)
+        inline uint32_t testMask(__m128i values, uint8_t flag) noexcept {
+            __m128i zero = _mm_setzero_si128();
+            __m128i clear = _mm_cmpeq_epi8(_mm_and_si128(values, _mm_set1_epi8(static_cast<char>(flag))), zero);
+            return ~static_cast<uint32_t>(_mm_movemask_epi8(clear)) & 0xFFFFu;
+        }
+
+        inline uint32_t wordMask(const uint8_t* flags, uint8_t flag) noexcept {
+            return testMask(_mm_loadu_si128(reinterpret_cast<const __m128i*>(flags)), flag);
+        }
+
+        inline void wordMasks(const uint8_t* flags, uint32_t& meaningful, uint32_t& time_checks) noexcept {
+            __m128i values = _mm_loadu_si128(reinterpret_cast<const __m128i*>(flags));
+            meaningful = testMask(values, MEANINGFUL);
+            time_checks = testMask(values, TIME_CHECK);
+        }
+#else
+        inline uint32_t wordMask(const uint8_t* flags, uint8_t flag) noexcept {
+            return scalarMask(flags, GAP_SCAN_LANES, flag);
+        }
+
+        inline void wordMasks(const uint8_t* flags, uint32_t& meaningful, uint32_t& time_checks) noexcept {
+            meaningful = scalarMask(flags, GAP_SCAN_LANES, MEANINGFUL);
+            time_checks = scalarMask(flags, GAP_SCAN_LANES, TIME_CHECK);
+        }
+#endif
+    }
+
+    void buildFlagMasks(const uint8_t* flags, size_t count,
+                        uint16_t* meaningful, uint16_t* time_checks) noexcept {
+        size_t word = 0;
+        for (; (word + 1) * GAP_SCAN_LANES <= count; ++word) {
+            uint32_t meaningful_bits;
+            uint32_t time_check_bits;
+            wordMasks(flags + word * GAP_SCAN_LANES, meaningful_bits, time_check_bits);
+            meaningful[word] = static_cast<uint16_t>(meaningful_bits);
+            time_checks[word] = static_cast<uint16_t>(time_check_bits);
+        }
+
+        size_t tail = count - word * GAP_SCAN_LANES;
+        if (tail > 0) {
+            const uint8_t* rest = flags + word * GAP_SCAN_LANES;
+            meaningful[word] = static_cast<uint16_t>(scalarMask(rest, tail, MEANINGFUL));
+            time_checks[word] = static_cast<uint16_t>(scalarMask(rest, tail, TIME_CHECK));
+        }
+    }
+
+    size_t countFlagged(const uint8_t* flags, size_t count, uint8_t flag) noexcept {
+        size_t total = 0;
+        size_t i = 0;
+        for (; i + GAP_SCAN_LANES <= count; i += GAP_SCAN_LANES) {
+            total += static_cast<size_t>(__builtin_popcount(wordMask(flags + i, flag)));
+        }
+        return total + static_cast<size_t>(__builtin_popcount(scalarMask(flags + i, count - i, flag)));
+    }
+
+    size_t findFlagged(const uint8_t* flags, size_t count, uint8_t flag) noexcept {
+        size_t i = 0;
+        for (; i + GAP_SCAN_LANES <= count; i += GAP_SCAN_LANES) {
+            uint32_t mask = wordMask(flags + i, flag);
+            if (mask != 0) {
+                return i + static_cast<size_t>(__builtin_ctz(mask));
+            }
+        }
+        uint32_t mask = scalarMask(flags + i, count - i, flag);
+        return mask != 0 ? i + static_cast<size_t>(__builtin_ctz(mask)) : count;
+    }
+
+    const char* gapScanBackend() noexcept {
+#if defined(PUUYAPU_GAP_SCAN_NEON)
+        return "neon";
+#elif defined(PUUYAPU_GAP_SCAN_SSE2)
+        return "sse2";
+#else
+        return "scalar";
+#endif
+    }
+
+} // namespace puuyapu
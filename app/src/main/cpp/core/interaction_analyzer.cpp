@@ -7,6 +7,7 @@
  */
 
 #include "interaction_analyzer.h"
+#include "gap_scan.h"
 #include <algorithm>
 #include <cmath>
 
@@ -30,7 +31,7 @@ namespace puuyapu {
         }
 
         // Short interactions need context analysis
-        if (duration_ms < 30000) { // < 30 seconds
+        if (duration_ms < DEFAULT_CLASSIFICATION.brief_ms) { // < 30 seconds
             // Check if this follows a recent meaningful interaction
             if (!context.empty()) {
                 const auto& last_event = context.back();
@@ -52,7 +53,7 @@ namespace puuyapu {
         }
 
         // Medium duration interactions
-        if (duration_ms < 300000) { // < 5 minutes
+        if (duration_ms < DEFAULT_CLASSIFICATION.extended_ms) { // < 5 minutes
             return InteractionType::MEANINGFUL_USE;
         }
 
@@ -71,32 +72,23 @@ namespace puuyapu {
             return gaps;
         }
 
-        // Process consecutive meaningful interactions only
-        auto prev_meaningful = events.begin();
-
-        for (auto it = events.begin() + 1; it != events.end(); ++it) {
-            if (isMeaningfulUsage(*it)) {
-                auto gap_duration = it->timestamp - prev_meaningful->timestamp;
-
-                if (gap_duration >= min_gap) {
-                    TimeGap gap(prev_meaningful->timestamp, it->timestamp);
-
-                    // Count brief interactions within the gap
-                    int brief_count = 0;
-                    for (auto gap_it = prev_meaningful + 1; gap_it != it; ++gap_it) {
-                        if (isTimeCheck(*gap_it)) {
-                            brief_count++;
-                        }
-                    }
-
-                    gap.brief_interaction_count = brief_count;
-                    gap.contains_brief_interactions = (brief_count > 0);
-
-                    gaps.push_back(gap);
-                }
-
-                prev_meaningful = it;
+        // Classify a block into flag bytes, then let the vector scan find
+        // anchors and count brief interactions per gap with popcounts
+        // Only the bits the scan reads; the masked-off rules compile away
+        constexpr uint8_t GAP_FLAGS = EVENT_FLAG_MEANINGFUL | EVENT_FLAG_TIME_CHECK;
+
+        GapScanState state;
+        uint8_t flags[GAP_SCAN_BLOCK];
+        auto time_at = [&events](size_t index) { return events[index].timestamp; };
+
+        for (size_t begin = 0; begin < events.size(); begin += GAP_SCAN_BLOCK) {
+            size_t count = std::min(GAP_SCAN_BLOCK, events.size() - begin);
+            for (size_t i = 0; i < count; ++i) {
+                const InteractionEvent& event = events[begin + i];
+                flags[i] = DefaultClassification::classify(event.type, event.category, event.duration.count()) &
+                           GAP_FLAGS;
             }
+            scanInteractionGaps(flags, count, begin, time_at, min_gap, state, gaps);
         }
 
         return gaps;
@@ -0,0 +1,208 @@
+/**
+ * @file metrics.cpp
+ * @brief Implementation of the per-thread latency histogram registry
+ */
+
+#include "metrics.h"
+#include <algorithm>
+#include <atomic>
+#include <memory>
+#include <mutex>
+#include <vector>
+
+namespace puuyapu {
+
+    namespace {
+        using Metrics::BUCKET_COUNT;
+        using Metrics::MAX_EXPONENT;
+        using Metrics::SUB_BUCKET_BITS;
+        using Metrics::SUB_BUCKETS;
+
+        /**
+         * @brief One metric's histogram; written by a single thread only
+         */
+        struct Histogram {
+            std::atomic<uint32_t> buckets[BUCKET_COUNT];
+            std::atomic<uint64_t> count;
+            std::atomic<uint64_t> sum_ns;
+            std::atomic<uint64_t> max_ns;
+
+            Histogram() noexcept {
+                clear();
+            }
+
+            void clear() noexcept {
+                for (auto& bucket : buckets) {
+                    bucket.store(0, std::memory_order_relaxed);
+                }
+                count.store(0, std::memory_order_relaxed);
+                sum_ns.store(0, std::memory_order_relaxed);
+                max_ns.store(0, std::memory_order_relaxed);
+            }
+        };
+
+        struct ThreadBlock {
+            Histogram histograms[METRIC_COUNT];
+        };
+
+        /// Plain (non-atomic) accumulator used for merging
+        struct MergedHistogram {
+            uint64_t buckets[BUCKET_COUNT] = {};
+            uint64_t count = 0;
+            uint64_t sum_ns = 0;
+            uint64_t max_ns = 0;
+
+            void add(const Histogram& histogram) noexcept {
+                for (size_t i = 0; i < BUCKET_COUNT; ++i) {
+                    buckets[i] += histogram.buckets[i].load(std::memory_order_relaxed);
+                }
+                count += histogram.count.load(std::memory_order_relaxed);
+                sum_ns += histogram.sum_ns.load(std::memory_order_relaxed);
+                max_ns = std::max(max_ns, histogram.max_ns.load(std::memory_order_relaxed));
+            }
+        };
+
+        struct Registry {
+            std::mutex mutex;
+            std::vector<ThreadBlock*> live;
+            std::unique_ptr<MergedHistogram[]> retired{new MergedHistogram[METRIC_COUNT]};
+        };
+
+        // Intentionally leaked: thread-exit hooks may run during static destruction
+        Registry& registry() noexcept {
+            static Registry* instance = new Registry();
+            return *instance;
+        }
+
+        /**
+         * @brief Owns the calling thread's block; folds it into the retired totals on exit
+         */
+        struct ThreadSlot {
+            ThreadBlock* block = nullptr;
+
+            ThreadBlock& get() noexcept {
+                if (!block) {
+                    block = new ThreadBlock();
+                    Registry& reg = registry();
+                    std::lock_guard<std::mutex> lock(reg.mutex);
+                    reg.live.push_back(block);
+                }
+                return *block;
+            }
+
+            ~ThreadSlot() {
+                if (!block) {
+                    return;
+                }
+                Registry& reg = registry();
+                std::lock_guard<std::mutex> lock(reg.mutex);
+                for (size_t i = 0; i < METRIC_COUNT; ++i) {
+                    reg.retired[i].add(block->histograms[i]);
+                }
+                reg.live.erase(std::find(reg.live.begin(), reg.live.end(), block));
+                delete block;
+            }
+        };
+
+        thread_local ThreadSlot t_slot;
+
+        size_t bucketFor(uint64_t value_ns) noexcept {
+            if (value_ns < SUB_BUCKETS) {
+                return static_cast<size_t>(value_ns);
+            }
+            size_t exponent = 63 - static_cast<size_t>(__builtin_clzll(value_ns));
+            if (exponent >= MAX_EXPONENT) {
+                return BUCKET_COUNT - 1;
+            }
+            size_t sub_bucket = static_cast<size_t>(value_ns >> (exponent - SUB_BUCKET_BITS)) & (SUB_BUCKETS - 1);
+            return (exponent - SUB_BUCKET_BITS + 1) * SUB_BUCKETS + sub_bucket;
+        }
+
+        uint64_t bucketUpperBound(size_t bucket) noexcept {
+            if (bucket < SUB_BUCKETS) {
+                return bucket;
+            }
+            size_t exponent = bucket / SUB_BUCKETS + SUB_BUCKET_BITS - 1;
+            uint64_t sub_bucket = bucket % SUB_BUCKETS;
+            uint64_t width = uint64_t{1} << (exponent - SUB_BUCKET_BITS);
+            return (SUB_BUCKETS + sub_bucket) * width + width - 1;
+        }
+
+        std::chrono::nanoseconds percentile(const MergedHistogram& histogram, double fraction) noexcept {
+            // Rank of the sample at this percentile (1-based, nearest-rank)
+            auto rank = static_cast<uint64_t>(fraction * static_cast<double>(histogram.count) + 0.999999);
+            rank = std::max<uint64_t>(rank, 1);
+
+            uint64_t seen = 0;
+            for (size_t i = 0; i < BUCKET_COUNT; ++i) {
+                seen += histogram.buckets[i];
+                if (seen >= rank) {
+                    // The last bucket is open-ended; only max bounds it
+                    uint64_t bound = i + 1 < BUCKET_COUNT ? bucketUpperBound(i) : histogram.max_ns;
+                    return std::chrono::nanoseconds(std::min(bound, histogram.max_ns));
+                }
+            }
+            return std::chrono::nanoseconds(histogram.max_ns);
+        }
+    }
+
+    void Metrics::record(MetricId id, std::chrono::nanoseconds latency) noexcept {
+        auto value = static_cast<uint64_t>(std::max<int64_t>(latency.count(), 0));
+        Histogram& histogram = t_slot.get().histograms[static_cast<size_t>(id)];
+
+        // Single writer per histogram: plain load/store pairs, no RMW needed
+        auto& bucket = histogram.buckets[bucketFor(value)];
+        bucket.store(bucket.load(std::memory_order_relaxed) + 1, std::memory_order_relaxed);
+        histogram.count.store(histogram.count.load(std::memory_order_relaxed) + 1, std::memory_order_relaxed);
+        histogram.sum_ns.store(histogram.sum_ns.load(std::memory_order_relaxed) + value, std::memory_order_relaxed);
+        if (value > histogram.max_ns.load(std::memory_order_relaxed)) {
+            histogram.max_ns.store(value, std::memory_order_relaxed);
+        }
+    }
+
+    MetricsSnapshot Metrics::snapshot() noexcept {
+        std::unique_ptr<MergedHistogram[]> merged(new MergedHistogram[METRIC_COUNT]);
+
+        {
+            Registry& reg = registry();
+            std::lock_guard<std::mutex> lock(reg.mutex);
+            for (size_t i = 0; i < METRIC_COUNT; ++i) {
+                merged[i] = reg.retired[i];
+                for (const ThreadBlock* block : reg.live) {
+                    merged[i].add(block->histograms[i]);
+                }
+            }
+        }
+
+        MetricsSnapshot snapshot;
+        for (size_t i = 0; i < METRIC_COUNT; ++i) {
+            const MergedHistogram& histogram = merged[i];
+            LatencySummary& summary = snapshot.latencies[i];
+
+            summary.count = histogram.count;
+            if (histogram.count == 0) {
+                continue;
+            }
+            summary.mean = std::chrono::nanoseconds(histogram.sum_ns / histogram.count);
+            summary.p50 = percentile(histogram, 0.50);
+            summary.p99 = percentile(histogram, 0.99);
+            summary.max = std::chrono::nanoseconds(histogram.max_ns);
+        }
+
+        return snapshot;
+    }
+
+    void Metrics::reset() noexcept {
+        Registry& reg = registry();
+        std::lock_guard<std::mutex> lock(reg.mutex);
+        for (size_t i = 0; i < METRIC_COUNT; ++i) {
+            reg.retired[i] = MergedHistogram{};
+        }
+        for (ThreadBlock* block : reg.live) {
+            for (auto& histogram : block->histograms) {
+                histogram.clear();
+            }
+        }
+    }
+
+} // namespace puuyapu
@@ -0,0 +1,190 @@
+/**
+ * @file night_summary_store.cpp
+ * @brief Implementation of the night summary tier
+ */
+
+#include "night_summary_store.h"
+#include <algorithm>
+
+namespace puuyapu {
+
+    void NightSummary::merge(const NightSummary& other) noexcept {
+        first_event_ms = std::min(first_event_ms, other.first_event_ms);
+        last_event_ms = std::max(last_event_ms, other.last_event_ms);
+        event_count += other.event_count;
+        time_checks += other.time_checks;
+        meaningful += other.meaningful;
+        sleep_related += other.sleep_related;
+        brief += other.brief;
+        for (size_t i = 0; i < TYPE_COUNT; ++i) {
+            type_counts[i] += other.type_counts[i];
+        }
+        for (size_t i = 0; i < HISTOGRAM_BUCKETS; ++i) {
+            uint32_t sum = uint32_t{interruption_histogram[i]} + other.interruption_histogram[i];
+            interruption_histogram[i] = static_cast<uint16_t>(std::min<uint32_t>(sum, UINT16_MAX));
+        }
+    }
+
+    void NightSummaryStore::add(const NightSummary& summary, const TimeGap* gaps, size_t gap_count) {
+        if (capacity_ == 0) {
+            return;
+        }
+
+        size_t position = lowerBound(summary.night_index);
+        if (position < nights_.size() && nights_[position].summary.night_index == summary.night_index) {
+            Night& night = nights_[position];
+            night.summary.merge(summary);
+            if (gap_count == 0) {
+                return;
+            }
+
+            // Move the list to the end so it stays contiguous; the old
+            // range is reclaimed by the next compaction
+            if (night.first_gap + night.gap_count != gaps_.size()) {
+                gaps_.reserve(gaps_.size() + night.gap_count + gap_count);
+                size_t first = gaps_.size();
+                for (uint32_t i = 0; i < night.gap_count; ++i) {
+                    gaps_.push_back(gaps_[night.first_gap + i]);
+                }
+                night.first_gap = static_cast<uint32_t>(first);
+            }
+            gaps_.insert(gaps_.end(), gaps, gaps + gap_count);
+            night.gap_count += static_cast<uint32_t>(gap_count);
+            return;
+        }
+
+        Night night{summary, static_cast<uint32_t>(gaps_.size()), static_cast<uint32_t>(gap_count)};
+        gaps_.insert(gaps_.end(), gaps, gaps + gap_count);
+        nights_.insert(nights_.begin() + static_cast<std::ptrdiff_t>(position), night);
+
+        if (nights_.size() > capacity_) {
+            dropOldest(nights_.size() - capacity_);
+        }
+    }
+
+    void NightSummaryStore::setCapacity(size_t nights) {
+        capacity_ = nights;
+        if (nights_.size() > capacity_) {
+            dropOldest(nights_.size() - capacity_);
+        }
+    }
+
+    size_t NightSummaryStore::find(int64_t night_index) const noexcept {
+        size_t position = lowerBound(night_index);
+        return position < nights_.size() && nights_[position].summary.night_index == night_index ? position : NPOS;
+    }
+
+    size_t NightSummaryStore::lowerBound(int64_t night_index) const noexcept {
+        auto it = std::lower_bound(nights_.begin(), nights_.end(), night_index,
+                                   [](const Night& night, int64_t key) { return night.summary.night_index < key; });
+        return static_cast<size_t>(it - nights_.begin());
+    }
+
+    void NightSummaryStore::clear() noexcept {
+        nights_.clear();
+        gaps_.clear();
+    }
+
+    size_t NightSummaryStore::memoryUsageBytes() const noexcept {
+        return nights_.capacity() * sizeof(Night) + gaps_.capacity() * sizeof(TimeGap);
+    }
+
+    void NightSummaryStore::writeTo(SnapshotWriter& writer) const {
+        writer.put(static_cast<uint32_t>(nights_.size()));
+        for (const Night& night : nights_) {
+            const NightSummary& summary = night.summary;
+            writer.put(summary.night_index);
+            writer.put(summary.first_event_ms);
+            writer.put(summary.last_event_ms);
+            writer.put(summary.event_count);
+            writer.put(summary.time_checks);
+            writer.put(summary.meaningful);
+            writer.put(summary.sleep_related);
+            writer.put(summary.brief);
+            writer.putBytes(summary.type_counts.data(), sizeof(summary.type_counts));
+            writer.putBytes(summary.interruption_histogram.data(), sizeof(summary.interruption_histogram));
+
+            writer.put(night.gap_count);
+            for (uint32_t i = 0; i < night.gap_count; ++i) {
+                const TimeGap& gap = gaps_[night.first_gap + i];
+                writer.putTime(gap.start_time);
+                writer.putTime(gap.end_time);
+                writer.put<int64_t>(gap.duration.count());
+                writer.put<uint8_t>(gap.contains_brief_interactions ? 1 : 0);
+                writer.put<int32_t>(gap.brief_interaction_count);
+            }
+        }
+    }
+
+    bool NightSummaryStore::readFrom(SnapshotReader& reader) {
+        constexpr size_t MIN_NIGHT_BYTES = 120;
+        constexpr size_t GAP_BYTES = 29;
+
+        NightSummaryStore decoded;
+        decoded.capacity_ = capacity_;
+
+        uint32_t count = 0;
+        if (!reader.getCount(count, MIN_NIGHT_BYTES)) {
+            return false;
+        }
+        std::vector<TimeGap> gaps;
+        for (uint32_t n = 0; n < count; ++n) {
+            NightSummary summary;
+            uint32_t gap_count = 0;
+            bool ok = reader.get(summary.night_index) && reader.get(summary.first_event_ms) &&
+                      reader.get(summary.last_event_ms) && reader.get(summary.event_count) &&
+                      reader.get(summary.time_checks) && reader.get(summary.meaningful) &&
+                      reader.get(summary.sleep_related) && reader.get(summary.brief) &&
+                      reader.getBytes(summary.type_counts.data(), sizeof(summary.type_counts)) &&
+                      reader.getBytes(summary.interruption_histogram.data(), sizeof(summary.interruption_histogram)) &&
+                      reader.getCount(gap_count, GAP_BYTES);
+            if (!ok) {
+                return false;
+            }
+
+            gaps.resize(gap_count);
+            for (TimeGap& gap : gaps) {
+                int64_t duration_ms = 0;
+                uint8_t brief = 0;
+                int32_t brief_count = 0;
+                if (!reader.getTime(gap.start_time) || !reader.getTime(gap.end_time) ||
+                    !reader.get(duration_ms) || !reader.get(brief) || !reader.get(brief_count)) {
+                    return false;
+                }
+                gap.duration = std::chrono::milliseconds(duration_ms);
+                gap.contains_brief_interactions = brief != 0;
+                gap.brief_interaction_count = brief_count;
+            }
+            decoded.add(summary, gaps.data(), gaps.size());
+        }
+
+        *this = std::move(decoded);
+        return true;
+    }
+
+// ============================================================================
+// Private Helper Methods
+// ============================================================================
+
+    void NightSummaryStore::dropOldest(size_t count) noexcept {
+        nights_.erase(nights_.begin(), nights_.begin() + static_cast<std::ptrdiff_t>(count));
+        compactGaps();
+    }
+
+    void NightSummaryStore::compactGaps() noexcept {
+        // Rare (once a day at most): rebuild the shared array in night order
+        std::vector<TimeGap> compacted;
+        size_t total = 0;
+        for (const Night& night : nights_) {
+            total += night.gap_count;
+        }
+        compacted.reserve(total);
+        for (Night& night : nights_) {
+            auto first = gaps_.begin() + night.first_gap;
+            night.first_gap = static_cast<uint32_t>(compacted.size());
+            compacted.insert(compacted.end(), first, first + night.gap_count);
+        }
+        gaps_.swap(compacted);
+    }
+
+} // namespace puuyapu
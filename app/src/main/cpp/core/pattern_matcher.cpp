@@ -2,129 +2,167 @@
  * @file pattern_matcher.cpp
  * @brief Implementation of sleep pattern recognition
  *
- * Statistical analysis of historical sleep patterns for improved accuracy.
+ * Online statistical analysis of historical sleep patterns for improved accuracy.
  */
 
 #include "pattern_matcher.h"
 #include "time_utils.h"
-#include <ctime>
 #include <algorithm>
-#include <numeric>
+#include <cmath>
 
 namespace puuyapu {
 
-    void PatternMatcher::updatePatterns(const SleepDetectionResult& session) noexcept {
-        if (!session.isValid()) {
-            return;
+    namespace {
+        constexpr double MINUTES_PER_DAY = 1440.0;
+        constexpr double TWO_PI = 6.283185307179586;
+        constexpr double RADIANS_PER_MINUTE = TWO_PI / MINUTES_PER_DAY;
+
+        constexpr double DEFAULT_BEDTIME_MINUTES = 1410.0;  // 23:30
+        constexpr double CONFIDENCE_STEP = 0.05;            // Per MEDIUM+ night
+
+        /// Clock-time tolerance: twice the learned spread, between 1 and 3 hours
+        double toleranceMinutes(const CircularTimeStats& stats) noexcept {
+            return std::min(180.0, std::max(60.0, 2.0 * stats.spreadMinutes()));
         }
 
-        // Get day of week for bedtime
-        auto time_t = std::chrono::system_clock::to_time_t(session.bedtime.value());
-        auto tm = *std::localtime(&time_t);
-        int day_of_week = tm.tm_wday;
+        double weightFor(uint32_t samples, uint32_t horizon) noexcept {
+            return 1.0 / static_cast<double>(std::min(samples, horizon));
+        }
+    }
 
-        // Update typical bedtime for this day of week
-        auto bedtime_minutes = getMinutesSinceMidnight(session.bedtime.value());
+// ============================================================================
+// Online Statistics
+// ============================================================================
 
-        // Use exponential moving average for smooth updates
-        const double alpha = 0.1; // Learning rate
-        auto& typical_bedtime = typical_bedtimes_[day_of_week];
+    void CircularTimeStats::add(double minute_of_day, uint32_t horizon) noexcept {
+        double angle = minute_of_day * RADIANS_PER_MINUTE;
+        samples++;
+        double weight = weightFor(samples, horizon);
+        mean_cos += (std::cos(angle) - mean_cos) * weight;
+        mean_sin += (std::sin(angle) - mean_sin) * weight;
+    }
 
-        if (total_sleep_sessions_ == 0) {
-            typical_bedtime = bedtime_minutes;
-        } else {
-            auto current_minutes = typical_bedtime.count();
-            auto new_minutes = bedtime_minutes.count();
-            auto updated_minutes = current_minutes * (1.0 - alpha) + new_minutes * alpha;
-            typical_bedtime = std::chrono::minutes(static_cast<int>(updated_minutes));
-        }
-
-        // Update wake time similarly
-        if (session.wake_time.has_value()) {
-            auto wake_minutes = getMinutesSinceMidnight(session.wake_time.value());
-            auto& typical_wake = typical_wake_times_[day_of_week];
-
-            if (total_sleep_sessions_ == 0) {
-                typical_wake = wake_minutes;
-            } else {
-                auto current_minutes = typical_wake.count();
-                auto new_minutes = wake_minutes.count();
-                auto updated_minutes = current_minutes * (1.0 - alpha) + new_minutes * alpha;
-                typical_wake = std::chrono::minutes(static_cast<int>(updated_minutes));
-            }
-        }
-
-        // Update average sleep duration
-        double current_duration = session.duration.count();
-        if (total_sleep_sessions_ == 0) {
-            average_sleep_duration_ = std::chrono::duration<double, std::ratio<3600>>(current_duration);
-        } else {
-            double avg = average_sleep_duration_.count();
-            avg = avg * (1.0 - alpha) + current_duration * alpha;
-            average_sleep_duration_ = std::chrono::duration<double, std::ratio<3600>>(avg);
+    double CircularTimeStats::meanMinutes() const noexcept {
+        double minutes = std::atan2(mean_sin, mean_cos) / RADIANS_PER_MINUTE;
+        return minutes < 0.0 ? minutes + MINUTES_PER_DAY : minutes;
+    }
+
+    double CircularTimeStats::spreadMinutes() const noexcept {
+        // sqrt(-2 ln R), the wrapped-normal standard deviation
+        double resultant = std::max(concentration(), 1e-12);
+        return std::sqrt(std::max(0.0, -2.0 * std::log(resultant))) / RADIANS_PER_MINUTE;
+    }
+
+    double CircularTimeStats::concentration() const noexcept {
+        return std::min(1.0, std::hypot(mean_cos, mean_sin));
+    }
+
+    void RunningStats::add(double value, uint32_t horizon) noexcept {
+        samples++;
+        double weight = weightFor(samples, horizon);
+        double delta = value - mean;
+        double increment = delta * weight;
+        mean += increment;
+        variance = (1.0 - weight) * (variance + delta * increment);
+    }
+
+    double RunningStats::standardDeviation() const noexcept {
+        return std::sqrt(variance);
+    }
+
+    double circularDistanceMinutes(double a, double b) noexcept {
+        double difference = std::fmod(std::fabs(a - b), MINUTES_PER_DAY);
+        return std::min(difference, MINUTES_PER_DAY - difference);
+    }
+
+// ============================================================================
+// PatternMatcher Implementation
+// ============================================================================
+
+    bool PatternMatcher::updatePatterns(const SleepDetectionResult& session) noexcept {
+        if (!session.isValid()) {
+            return false;
         }
 
-        // Update pattern confidence for this day
-        if (session.confidence >= SleepConfidence::MEDIUM) {
-            pattern_confidence_[day_of_week] = std::min(1.0, pattern_confidence_[day_of_week] + 0.05);
+        // Day of week, bedtime and night from one civil conversion
+        auto& time_zone = TimeZoneContext::shared();
+        CivilTime bedtime_civil = time_zone.toCivil(session.bedtime.value());
+        if (!markLearned(bedtime_civil.night_index)) {
+            return false;
         }
 
-        // Calculate schedule regularity
-        if (total_sleep_sessions_ > 7) { // Need at least a week of data
-            calculateScheduleRegularity();
+        WeekdayProfile& profile = weekdays_[bedtime_civil.weekday];
+        profile.bedtime.add(bedtime_civil.minute_of_day, WEEKDAY_HORIZON);
+        profile.wake_time.add(time_zone.toCivil(session.wake_time.value()).minute_of_day, WEEKDAY_HORIZON);
+
+        overall_bedtime_.add(bedtime_civil.minute_of_day, OVERALL_HORIZON);
+        sleep_duration_hours_.add(session.duration.count(), OVERALL_HORIZON);
+
+        // Update pattern confidence for this day
+        if (session.confidence >= SleepConfidence::MEDIUM || session.is_manually_confirmed) {
+            profile.confidence = std::min(1.0, profile.confidence + CONFIDENCE_STEP);
         }
 
         total_sleep_sessions_++;
+        updateScheduleRegularity();
+        return true;
     }
 
     double PatternMatcher::calculatePatternMatch(
             std::chrono::system_clock::time_point bedtime,
             std::chrono::system_clock::time_point wake_time) const noexcept {
 
-        // Get day of week
-        auto time_t = std::chrono::system_clock::to_time_t(bedtime);
-        auto tm = *std::localtime(&time_t);
-        int day_of_week = tm.tm_wday;
+        if (total_sleep_sessions_ == 0) {
+            return 0.0;
+        }
+
+        auto& time_zone = TimeZoneContext::shared();
+        CivilTime bedtime_civil = time_zone.toCivil(bedtime);
+        const WeekdayProfile& profile = weekdays_[bedtime_civil.weekday];
+
+        // Weekdays not seen yet fall back to the all-days bedtime
+        const CircularTimeStats& bedtime_stats = profile.bedtime.samples > 0 ? profile.bedtime : overall_bedtime_;
 
         double total_score = 0.0;
         int factors = 0;
 
         // Bedtime consistency score
-        auto actual_bedtime = getMinutesSinceMidnight(bedtime);
-        auto expected_bedtime = typical_bedtimes_[day_of_week];
-        auto bedtime_diff = std::abs((actual_bedtime - expected_bedtime).count());
-
-        // Score based on deviation (within 2 hours = good)
-        double bedtime_score = std::max(0.0, 1.0 - (bedtime_diff / 120.0));
-        total_score += bedtime_score * pattern_confidence_[day_of_week];
+        double bedtime_diff = circularDistanceMinutes(bedtime_civil.minute_of_day, bedtime_stats.meanMinutes());
+        total_score += std::max(0.0, 1.0 - bedtime_diff / toleranceMinutes(bedtime_stats));
         factors++;
 
-        // Wake time consistency score (if available)
-        auto actual_wake = getMinutesSinceMidnight(wake_time);
-        auto expected_wake = typical_wake_times_[day_of_week];
-        auto wake_diff = std::abs((actual_wake - expected_wake).count());
-
-        double wake_score = std::max(0.0, 1.0 - (wake_diff / 120.0));
-        total_score += wake_score * pattern_confidence_[day_of_week];
-        factors++;
+        // Wake time consistency score (if learned for this day)
+        if (profile.wake_time.samples > 0) {
+            double wake_diff = circularDistanceMinutes(time_zone.toCivil(wake_time).minute_of_day,
+                                                       profile.wake_time.meanMinutes());
+            total_score += std::max(0.0, 1.0 - wake_diff / toleranceMinutes(profile.wake_time));
+            factors++;
+        }
 
         // Duration consistency score
         double actual_duration = calculateDurationHours(bedtime, wake_time);
-        double expected_duration = average_sleep_duration_.count();
-        double duration_diff = std::abs(actual_duration - expected_duration);
-
-        double duration_score = std::max(0.0, 1.0 - (duration_diff / expected_duration));
-        total_score += duration_score;
-        factors++;
+        double expected_duration = sleep_duration_hours_.mean;
+        if (expected_duration > 0.0) {
+            double duration_diff = std::abs(actual_duration - expected_duration);
+            total_score += std::max(0.0, 1.0 - duration_diff / expected_duration);
+            factors++;
+        }
 
-        return factors > 0 ? total_score / factors : 0.0;
+        return total_score / factors;
     }
 
     std::chrono::minutes PatternMatcher::getExpectedBedtime(int day_of_week) const noexcept {
+        if (day_of_week < 0 || day_of_week > 6 || weekdays_[day_of_week].bedtime.samples == 0) {
+            return std::chrono::minutes(static_cast<int>(DEFAULT_BEDTIME_MINUTES));
+        }
+        return std::chrono::minutes(static_cast<int>(std::lround(weekdays_[day_of_week].bedtime.meanMinutes())) % 1440);
+    }
+
+    double PatternMatcher::getPatternConfidence(int day_of_week) const noexcept {
         if (day_of_week < 0 || day_of_week > 6) {
-            return std::chrono::minutes(1410); // Default 23:30
+            return 0.0;
         }
-        return typical_bedtimes_[day_of_week];
+        return weekdays_[day_of_week].confidence;
     }
 
     bool PatternMatcher::isLikelySleepTime(
@@ -138,41 +176,96 @@ namespace puuyapu {
         }
 
         // Check if current time is within typical sleep window
-        auto time_t = std::chrono::system_clock::to_time_t(current_time);
-        auto tm = *std::localtime(&time_t);
-        int day_of_week = tm.tm_wday;
-
-        auto current_minutes = getMinutesSinceMidnight(current_time);
-        auto expected_bedtime = typical_bedtimes_[day_of_week];
+        CivilTime current_civil = TimeZoneContext::shared().toCivil(current_time);
+        const WeekdayProfile& profile = weekdays_[current_civil.weekday];
+        if (profile.bedtime.samples == 0) {
+            return false;
+        }
 
         // Consider sleep time if within 3 hours of typical bedtime
-        auto time_diff = std::abs((current_minutes - expected_bedtime).count());
+        double time_diff = circularDistanceMinutes(current_civil.minute_of_day, profile.bedtime.meanMinutes());
+
+        return time_diff <= 180.0 && profile.confidence > 0.3;
+    }
 
-        return time_diff <= 180 && pattern_confidence_[day_of_week] > 0.3;
+    void PatternMatcher::writeTo(SnapshotWriter& writer) const {
+        auto putCircular = [&writer](const CircularTimeStats& stats) {
+            writer.put(stats.mean_cos);
+            writer.put(stats.mean_sin);
+            writer.put(stats.samples);
+        };
+
+        for (const WeekdayProfile& profile : weekdays_) {
+            putCircular(profile.bedtime);
+            putCircular(profile.wake_time);
+            writer.put(profile.confidence);
+        }
+        putCircular(overall_bedtime_);
+        writer.put(sleep_duration_hours_.mean);
+        writer.put(sleep_duration_hours_.variance);
+        writer.put(sleep_duration_hours_.samples);
+        writer.put(schedule_regularity_score_);
+        writer.put(static_cast<uint64_t>(total_sleep_sessions_));
+        writer.put(last_learned_night_);
+        writer.put(learned_nights_);
     }
 
-    void PatternMatcher::calculateScheduleRegularity() noexcept {
-        // Calculate variance in bedtimes across all days
-        std::vector<double> bedtime_minutes;
-        bedtime_minutes.reserve(7);
+    bool PatternMatcher::readFrom(SnapshotReader& reader) noexcept {
+        auto getCircular = [&reader](CircularTimeStats& stats) {
+            return reader.get(stats.mean_cos) && reader.get(stats.mean_sin) && reader.get(stats.samples);
+        };
+
+        PatternMatcher decoded;
+        bool ok = true;
+        for (WeekdayProfile& profile : decoded.weekdays_) {
+            ok = ok && getCircular(profile.bedtime) && getCircular(profile.wake_time) &&
+                 reader.get(profile.confidence);
+        }
+        uint64_t sessions = 0;
+        ok = ok && getCircular(decoded.overall_bedtime_) &&
+             reader.get(decoded.sleep_duration_hours_.mean) &&
+             reader.get(decoded.sleep_duration_hours_.variance) &&
+             reader.get(decoded.sleep_duration_hours_.samples) &&
+             reader.get(decoded.schedule_regularity_score_) &&
+             reader.get(sessions) &&
+             reader.get(decoded.last_learned_night_) &&
+             reader.get(decoded.learned_nights_);
+        if (!ok) {
+            return false;
+        }
+
+        decoded.total_sleep_sessions_ = static_cast<size_t>(sessions);
+        *this = decoded;
+        return true;
+    }
 
-        for (const auto& bedtime : typical_bedtimes_) {
-            bedtime_minutes.push_back(bedtime.count());
+    bool PatternMatcher::markLearned(int64_t night_index) noexcept {
+        if (last_learned_night_ == INT64_MIN || night_index > last_learned_night_) {
+            int64_t shift = last_learned_night_ == INT64_MIN ? LEARNED_NIGHT_WINDOW
+                                                            : night_index - last_learned_night_;
+            learned_nights_ = shift >= LEARNED_NIGHT_WINDOW ? 0 : learned_nights_ << shift;
+            learned_nights_ |= 1;
+            last_learned_night_ = night_index;
+            return true;
         }
 
-        // Calculate mean
-        double mean = std::accumulate(bedtime_minutes.begin(), bedtime_minutes.end(), 0.0) / 7.0;
+        int64_t age = last_learned_night_ - night_index;
+        uint64_t bit = age < LEARNED_NIGHT_WINDOW ? uint64_t{1} << age : 0;
+        if (bit == 0 || (learned_nights_ & bit) != 0) {
+            return false;
+        }
+        learned_nights_ |= bit;
+        return true;
+    }
 
-        // Calculate variance
-        double variance = 0.0;
-        for (double minutes : bedtime_minutes) {
-            variance += (minutes - mean) * (minutes - mean);
+    void PatternMatcher::updateScheduleRegularity() noexcept {
+        if (total_sleep_sessions_ < MIN_SESSIONS_FOR_REGULARITY) {
+            schedule_regularity_score_ = 0.0;
+            return;
         }
-        variance /= 7.0;
 
-        // Convert variance to regularity score (lower variance = higher regularity)
-        double std_dev = std::sqrt(variance);
-        schedule_regularity_score_ = std::max(0.0, 1.0 - (std_dev / 180.0)); // 3 hours max deviation
+        // Lower bedtime spread = higher regularity, 3 hours max deviation
+        schedule_regularity_score_ = std::max(0.0, 1.0 - overall_bedtime_.spreadMinutes() / 180.0);
     }
 
 } // namespace puuyapu
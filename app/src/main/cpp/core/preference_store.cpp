@@ -0,0 +1,63 @@
+/**
+ * @file preference_store.cpp
+ * @brief Implementation of versioned preference snapshots
+ */
+
+#include "preference_store.h"
+#include <thread>
+
+namespace puuyapu {
+
+    namespace {
+        /**
+         * @brief Whether two preference sets can produce different detection results
+         * Only fields read by the detection pipeline participate.
+         */
+        bool detectionInputsEqual(const UserPreferences& a, const UserPreferences& b) noexcept {
+            return a.target_sleep_hours == b.target_sleep_hours &&
+                   a.target_bedtime == b.target_bedtime &&
+                   a.target_wake_time == b.target_wake_time &&
+                   a.weekday_bedtime == b.weekday_bedtime &&
+                   a.weekend_bedtime == b.weekend_bedtime &&
+                   a.minimum_interaction_gap == b.minimum_interaction_gap &&
+                   a.time_check_threshold == b.time_check_threshold;
+        }
+    }
+
+    PreferenceStore::PreferenceStore(const UserPreferences& initial)
+            : current_(new PreferenceSnapshot{initial, 1, 1}) {}
+
+    PreferenceStore::~PreferenceStore() noexcept {
+        delete current_.load();
+    }
+
+    bool PreferenceStore::update(const UserPreferences& preferences) noexcept {
+        std::lock_guard<std::mutex> lock(writer_mutex_);
+
+        // Only writers replace current_, so it can be read without a guard here
+        const PreferenceSnapshot* previous = current_.load(std::memory_order_seq_cst);
+        bool detection_changed = !detectionInputsEqual(previous->preferences, preferences);
+
+        auto* next = new PreferenceSnapshot{
+                preferences,
+                previous->version + 1,
+                previous->detection_generation + (detection_changed ? 1 : 0)
+        };
+
+        current_.store(next, std::memory_order_seq_cst);
+        synchronize();
+        delete previous;
+
+        return detection_changed;
+    }
+
+    void PreferenceStore::synchronize() noexcept {
+        for (int phase = 0; phase < 2; ++phase) {
+            uint32_t old_epoch = epoch_.fetch_add(1, std::memory_order_seq_cst);
+            while (readers_[old_epoch & 1].load(std::memory_order_seq_cst) != 0) {
+                std::this_thread::yield();
+            }
+        }
+    }
+
+} // namespace puuyapu
@@ -0,0 +1,71 @@
+/**
+ * @file scratch_arena.cpp
+ * @brief Chunk management for the reusable scratch arena
+ */
+
+#include "scratch_arena.h"
+#include <algorithm>
+
+namespace puuyapu {
+
+    void ScratchArena::useChunk(size_t index) noexcept {
+        current_chunk_ = index;
+        cursor_ = reinterpret_cast<uintptr_t>(chunks_[index].memory.get());
+        limit_ = cursor_ + chunks_[index].bytes;
+    }
+
+    void* ScratchArena::allocateSlow(size_t bytes, size_t alignment) noexcept {
+        // Later chunks kept from an earlier pass are tried before growing
+        size_t needed = bytes + alignment;
+        size_t index = chunks_.empty() ? 0 : current_chunk_ + 1;
+        while (index < chunks_.size() && chunks_[index].bytes < needed) {
+            index++;
+        }
+
+        if (index >= chunks_.size()) {
+            // Geometric growth keeps the chunk count logarithmic in the working set
+            size_t chunk_bytes = std::max(next_chunk_bytes_, needed);
+            next_chunk_bytes_ = chunk_bytes * 2;
+            chunks_.push_back(Chunk{std::unique_ptr<unsigned char[]>(new unsigned char[chunk_bytes]), chunk_bytes});
+            capacity_bytes_ += chunk_bytes;
+            index = chunks_.size() - 1;
+        }
+
+        useChunk(index);
+        uintptr_t aligned = (cursor_ + alignment - 1) & ~(static_cast<uintptr_t>(alignment) - 1);
+        cursor_ = aligned + bytes;
+        used_bytes_ += bytes;
+        return reinterpret_cast<void*>(aligned);
+    }
+
+    void ScratchArena::reset() noexcept {
+        high_water_bytes_ = std::max(high_water_bytes_, used_bytes_);
+        used_bytes_ = 0;
+
+        if (chunks_.empty()) {
+            return;
+        }
+
+        // A spilled pass is merged into one chunk so the next one fits in place
+        if (chunks_.size() > 1 && current_chunk_ > 0) {
+            size_t merged_bytes = capacity_bytes_;
+            chunks_.clear();
+            chunks_.push_back(Chunk{std::unique_ptr<unsigned char[]>(new unsigned char[merged_bytes]), merged_bytes});
+            next_chunk_bytes_ = merged_bytes * 2;
+        }
+
+        useChunk(0);
+    }
+
+    void ScratchArena::release() noexcept {
+        high_water_bytes_ = std::max(high_water_bytes_, used_bytes_);
+        chunks_.clear();
+        chunks_.shrink_to_fit();
+        current_chunk_ = 0;
+        cursor_ = 0;
+        limit_ = 0;
+        capacity_bytes_ = 0;
+        used_bytes_ = 0;
+    }
+
+} // namespace puuyapu
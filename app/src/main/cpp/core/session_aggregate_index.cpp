@@ -0,0 +1,185 @@
+/**
+ * @file session_aggregate_index.cpp
+ * @brief Implementation of the sealed-night aggregate index
+ */
+
+#include "session_aggregate_index.h"
+#include "pattern_matcher.h"
+#include <algorithm>
+#include <cmath>
+
+namespace puuyapu {
+
+    namespace {
+        constexpr double NOON_MINUTES = 12 * 60;
+        constexpr double DAY_MINUTES = 24 * 60;
+
+        const SleepAggregate EMPTY_AGGREGATE{};
+
+        double varianceOf(double sum, double sum_sq, uint32_t count) noexcept {
+            if (count < 2) {
+                return 0.0;
+            }
+            double mean = sum / count;
+            return std::max(0.0, sum_sq / count - mean * mean);
+        }
+    }
+
+// ============================================================================
+// SleepAggregate
+// ============================================================================
+
+    SleepAggregate SleepAggregate::of(const SleepDetectionResult& result, double bedtime_minutes_since_noon) noexcept {
+        SleepAggregate night;
+        night.sessions = 1;
+        night.manually_confirmed = result.is_manually_confirmed ? 1 : 0;
+        night.interruptions = static_cast<uint32_t>(result.interruptions.size());
+        night.duration_hours = result.duration.count();
+        night.duration_hours_sq = night.duration_hours * night.duration_hours;
+        night.efficiency = result.calculateSleepEfficiency();
+        night.quality = result.quality_score;
+        night.bedtime_minutes = bedtime_minutes_since_noon;
+        night.bedtime_minutes_sq = bedtime_minutes_since_noon * bedtime_minutes_since_noon;
+        return night;
+    }
+
+    SleepAggregate& SleepAggregate::operator+=(const SleepAggregate& other) noexcept {
+        sessions += other.sessions;
+        manually_confirmed += other.manually_confirmed;
+        interruptions += other.interruptions;
+        duration_hours += other.duration_hours;
+        duration_hours_sq += other.duration_hours_sq;
+        efficiency += other.efficiency;
+        quality += other.quality;
+        bedtime_minutes += other.bedtime_minutes;
+        bedtime_minutes_sq += other.bedtime_minutes_sq;
+        return *this;
+    }
+
+    SleepAggregate& SleepAggregate::operator-=(const SleepAggregate& other) noexcept {
+        sessions -= other.sessions;
+        manually_confirmed -= other.manually_confirmed;
+        interruptions -= other.interruptions;
+        duration_hours -= other.duration_hours;
+        duration_hours_sq -= other.duration_hours_sq;
+        efficiency -= other.efficiency;
+        quality -= other.quality;
+        bedtime_minutes -= other.bedtime_minutes;
+        bedtime_minutes_sq -= other.bedtime_minutes_sq;
+        return *this;
+    }
+
+    double SleepAggregate::durationStdDevHours() const noexcept {
+        return std::sqrt(varianceOf(duration_hours, duration_hours_sq, sessions));
+    }
+
+    double SleepAggregate::meanBedtimeMinuteOfDay() const noexcept {
+        if (sessions == 0) {
+            return 0.0;
+        }
+        return std::fmod(bedtime_minutes / sessions + NOON_MINUTES, DAY_MINUTES);
+    }
+
+    double SleepAggregate::bedtimeSpreadMinutes() const noexcept {
+        return std::sqrt(varianceOf(bedtime_minutes, bedtime_minutes_sq, sessions));
+    }
+
+    double SleepAggregate::regularity() const noexcept {
+        if (sessions < PatternMatcher::MIN_SESSIONS_FOR_REGULARITY) {
+            return 0.0;
+        }
+        return std::max(0.0, 1.0 - bedtimeSpreadMinutes() / 180.0);
+    }
+
+// ============================================================================
+// SessionAggregateIndex
+// ============================================================================
+
+    bool SessionAggregateIndex::add(int64_t night_index, const SleepAggregate& night) {
+        if (stride_.empty()) {
+            first_night_ = night_index;
+            prefix_.assign(1, SleepAggregate{});
+        }
+        if (night_index < first_night_) {
+            return false;
+        }
+
+        // Extend the day axis through the night (empty days carry the sums forward)
+        size_t day = static_cast<size_t>(night_index - first_night_);
+        while (stride_.size() <= day) {
+            size_t next = stride_.size();
+            stride_.push_back(next >= WEEKDAYS ? stride_[next - WEEKDAYS] : SleepAggregate{});
+            prefix_.push_back(prefix_.back());
+        }
+
+        // Newest night: two entries; an older one also shifts the sums after it
+        for (size_t k = day + 1; k < prefix_.size(); ++k) {
+            prefix_[k] += night;
+        }
+        for (size_t k = day; k < stride_.size(); k += WEEKDAYS) {
+            stride_[k] += night;
+        }
+        return true;
+    }
+
+    SleepAggregate SessionAggregateIndex::range(int64_t from_night, int64_t to_night) const noexcept {
+        SleepAggregate result;
+        if (stride_.empty()) {
+            return result;
+        }
+
+        int64_t days = static_cast<int64_t>(stride_.size());
+        int64_t begin = std::clamp<int64_t>(from_night - first_night_, 0, days);
+        int64_t end = std::clamp<int64_t>(to_night - first_night_, 0, days);
+        if (begin >= end) {
+            return result;
+        }
+
+        result = prefix_[static_cast<size_t>(end)];
+        result -= prefix_[static_cast<size_t>(begin)];
+        return result;
+    }
+
+    SleepAggregate SessionAggregateIndex::weekday(int64_t from_night, int64_t to_night, int weekday) const noexcept {
+        SleepAggregate result;
+        if (stride_.empty() || weekday < 0 || weekday >= WEEKDAYS) {
+            return result;
+        }
+
+        int64_t days = static_cast<int64_t>(stride_.size());
+        int64_t begin = std::clamp<int64_t>(from_night - first_night_, 0, days);
+        int64_t end = std::clamp<int64_t>(to_night - first_night_, 0, days);
+        if (begin >= end) {
+            return result;
+        }
+
+        // Chain ending at the last matching day in range, minus the chain before the range
+        int64_t last = lastWeekdayAtOrBefore(end - 1, weekday);
+        if (last < begin) {
+            return result;
+        }
+        result = strideAt(last);
+        result -= strideAt(lastWeekdayAtOrBefore(begin - 1, weekday));
+        return result;
+    }
+
+    void SessionAggregateIndex::clear() noexcept {
+        first_night_ = 0;
+        prefix_.clear();
+        stride_.clear();
+    }
+
+// ============================================================================
+// Private Helper Methods
+// ============================================================================
+
+    const SleepAggregate& SessionAggregateIndex::strideAt(int64_t day) const noexcept {
+        return day < 0 ? EMPTY_AGGREGATE : stride_[static_cast<size_t>(day)];
+    }
+
+    int64_t SessionAggregateIndex::lastWeekdayAtOrBefore(int64_t day, int weekday) const noexcept {
+        int behind = weekdayOf(first_night_ + day) - weekday;
+        return day - (behind < 0 ? behind + WEEKDAYS : behind);
+    }
+
+} // namespace puuyapu
@@ -0,0 +1,635 @@
+/**
+ * @file session_archive.cpp
+ * @brief Implementation of the month-indexed session archive
+ */
+
+#include "session_archive.h"
+#include "checksum.h"
+#include "metrics.h"
+#include "platform_log.h"
+#include "stream_writer.h"
+#include "time_utils.h"
+#include <algorithm>
+#include <cerrno>
+#include <climits>
+#include <cmath>
+#include <cstdio>
+#include <cstring>
+#include <fcntl.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+namespace puuyapu {
+
+    namespace {
+        constexpr const char* LOG_TAG = "PuuyApu_Archive";
+
+        constexpr size_t MAX_VARINT_BYTES = 10;
+        constexpr size_t FIXED_RECORD_BYTES = 3 * MAX_VARINT_BYTES + 5 + MAX_VARINT_BYTES;
+        constexpr size_t MAX_INTERRUPTION_BYTES = 2 * MAX_VARINT_BYTES + 5;
+        constexpr size_t COPY_CHUNK_BYTES = 64 * 1024;
+
+        constexpr uint8_t CONFIDENCE_MASK = 0x07;
+        constexpr uint8_t MANUALLY_CONFIRMED_FLAG = 0x08;
+        constexpr uint8_t BRIEF_CHECK_FLAG = 0x01;
+
+        int64_t toMillis(std::chrono::system_clock::time_point time_point) noexcept {
+            return std::chrono::duration_cast<std::chrono::milliseconds>(
+                    time_point.time_since_epoch()).count();
+        }
+
+        std::chrono::system_clock::time_point fromMillis(int64_t millis) noexcept {
+            return std::chrono::system_clock::time_point(std::chrono::milliseconds(millis));
+        }
+
+        uint16_t quantizeUnit(double value) noexcept {
+            double clamped = std::isfinite(value) ? std::min(1.0, std::max(0.0, value)) : 0.0;
+            return static_cast<uint16_t>(std::lround(clamped * UINT16_MAX));
+        }
+
+        double dequantizeUnit(uint16_t value) noexcept {
+            return static_cast<double>(value) / UINT16_MAX;
+        }
+
+        uint8_t* putVarint(uint8_t* out, uint64_t value) noexcept {
+            while (value >= 0x80) {
+                *out++ = static_cast<uint8_t>(value | 0x80);
+                value >>= 7;
+            }
+            *out++ = static_cast<uint8_t>(value);
+            return out;
+        }
+
+        uint8_t* putSigned(uint8_t* out, int64_t value) noexcept {
+            uint64_t zigzag = (static_cast<uint64_t>(value) << 1) ^ static_cast<uint64_t>(value >> 63);
+            return putVarint(out, zigzag);
+        }
+
+        uint8_t* putU16(uint8_t* out, uint16_t value) noexcept {
+            std::memcpy(out, &value, sizeof(uint16_t));
+            return out + sizeof(uint16_t);
+        }
+
+        /// Bounds-checked cursor over an encoded block; failures are sticky
+        struct Cursor {
+            const uint8_t* data;
+            const uint8_t* end;
+            bool ok{true};
+
+            uint64_t varint() noexcept {
+                uint64_t value = 0;
+                for (int shift = 0; shift < 64; shift += 7) {
+                    if (data == end) {
+                        break;
+                    }
+                    uint8_t byte = *data++;
+                    value |= static_cast<uint64_t>(byte & 0x7F) << shift;
+                    if ((byte & 0x80) == 0) {
+                        return value;
+                    }
+                }
+                ok = false;
+                return 0;
+            }
+
+            int64_t signedVarint() noexcept {
+                uint64_t zigzag = varint();
+                return static_cast<int64_t>(zigzag >> 1) ^ -static_cast<int64_t>(zigzag & 1);
+            }
+
+            uint8_t u8() noexcept {
+                if (data == end) {
+                    ok = false;
+                    return 0;
+                }
+                return *data++;
+            }
+
+            uint16_t u16() noexcept {
+                if (end - data < static_cast<ptrdiff_t>(sizeof(uint16_t))) {
+                    ok = false;
+                    data = end;
+                    return 0;
+                }
+                uint16_t value;
+                std::memcpy(&value, data, sizeof(uint16_t));
+                data += sizeof(uint16_t);
+                return value;
+            }
+        };
+
+        bool readAll(int fd, uint64_t offset, uint8_t* buffer, size_t size) noexcept {
+            while (size > 0) {
+                ssize_t count = ::pread(fd, buffer, size, static_cast<off_t>(offset));
+                if (count < 0 && errno == EINTR) {
+                    continue;
+                }
+                if (count <= 0) {
+                    return false;
+                }
+                buffer += count;
+                offset += static_cast<uint64_t>(count);
+                size -= static_cast<size_t>(count);
+            }
+            return true;
+        }
+
+        void storeIndexEntry(const SessionArchive::MonthBlock& block, uint8_t* out) noexcept {
+            std::memcpy(out, &block.month_key, sizeof(int32_t));
+            std::memcpy(out + 4, &block.session_count, sizeof(uint32_t));
+            std::memcpy(out + 8, &block.first_bedtime_ms, sizeof(int64_t));
+            std::memcpy(out + 16, &block.last_bedtime_ms, sizeof(int64_t));
+            std::memcpy(out + 24, &block.offset, sizeof(uint32_t));
+            std::memcpy(out + 28, &block.length, sizeof(uint32_t));
+        }
+
+        SessionArchive::MonthBlock loadIndexEntry(const uint8_t* in) noexcept {
+            SessionArchive::MonthBlock block{};
+            std::memcpy(&block.month_key, in, sizeof(int32_t));
+            std::memcpy(&block.session_count, in + 4, sizeof(uint32_t));
+            std::memcpy(&block.first_bedtime_ms, in + 8, sizeof(int64_t));
+            std::memcpy(&block.last_bedtime_ms, in + 16, sizeof(int64_t));
+            std::memcpy(&block.offset, in + 24, sizeof(uint32_t));
+            std::memcpy(&block.length, in + 28, sizeof(uint32_t));
+            return block;
+        }
+    }
+
+    SessionArchive::~SessionArchive() noexcept {
+        close();
+    }
+
+    bool SessionArchive::open(const std::string& path) noexcept {
+        close();
+
+        int fd = ::open(path.c_str(), O_RDONLY | O_CLOEXEC);
+        if (fd < 0) {
+            if (errno == ENOENT) {
+                path_ = path;
+                return true;
+            }
+            PUUYAPU_LOG_PRINT(PUUYAPU_LOG_ERROR, LOG_TAG, "Cannot open archive %s", path.c_str());
+            return false;
+        }
+
+        struct stat info{};
+        if (fstat(fd, &info) != 0 || !readIndex(fd, static_cast<size_t>(info.st_size))) {
+            PUUYAPU_LOG_PRINT(PUUYAPU_LOG_ERROR, LOG_TAG, "Archive %s is damaged", path.c_str());
+            ::close(fd);
+            index_.clear();
+            total_sessions_ = 0;
+            index_offset_ = HEADER_BYTES;
+            return false;
+        }
+
+        path_ = path;
+        fd_ = fd;
+        return true;
+    }
+
+    size_t SessionArchive::append(const std::vector<SleepDetectionResult>& sessions) noexcept {
+        ScopedMetricTimer timer(MetricId::ARCHIVE_APPEND);
+
+        if (!isOpen()) {
+            return 0;
+        }
+
+        // New, finished sessions in bedtime order
+        int64_t newest_ms = lastBedtimeMs();
+        std::vector<const SleepDetectionResult*> fresh;
+        fresh.reserve(sessions.size());
+        for (const auto& session : sessions) {
+            if (session.bedtime && session.wake_time &&
+                (index_.empty() || toMillis(*session.bedtime) > newest_ms)) {
+                fresh.push_back(&session);
+            }
+        }
+        std::sort(fresh.begin(), fresh.end(), [](const SleepDetectionResult* a, const SleepDetectionResult* b) {
+            return *a->bedtime < *b->bedtime;
+        });
+        fresh.erase(std::unique(fresh.begin(), fresh.end(), [](const SleepDetectionResult* a,
+                                                               const SleepDetectionResult* b) {
+            return toMillis(*a->bedtime) == toMillis(*b->bedtime);
+        }), fresh.end());
+
+        if (fresh.empty()) {
+            return 0;
+        }
+
+        // Month keys never decrease, even if a timezone change moves a night back
+        int32_t floor_key = index_.empty() ? INT32_MIN : index_.back().month_key;
+        std::vector<int32_t> keys;
+        keys.reserve(fresh.size());
+        for (const SleepDetectionResult* session : fresh) {
+            floor_key = std::max(floor_key, monthKeyOf(*session->bedtime));
+            keys.push_back(floor_key);
+        }
+
+        // The newest month is re-encoded when the first new session joins it
+        size_t kept_blocks = index_.size();
+        std::vector<SleepDetectionResult> carried;
+        if (!index_.empty() && keys.front() == index_.back().month_key) {
+            if (!decodeBlock(index_.back(), carried)) {
+                return 0;
+            }
+            kept_blocks--;
+        }
+        uint64_t prefix_end = kept_blocks < index_.size() ? index_[kept_blocks].offset : index_offset_;
+
+        std::string temp_path = path_ + ".tmp";
+        int out_fd = ::open(temp_path.c_str(), O_WRONLY | O_CREAT | O_TRUNC | O_CLOEXEC, 0600);
+        if (out_fd < 0) {
+            PUUYAPU_LOG_PRINT(PUUYAPU_LOG_ERROR, LOG_TAG, "Cannot create %s", temp_path.c_str());
+            return 0;
+        }
+        FdSink sink(out_fd);
+        bool ok = true;
+
+        // Header and untouched months: raw copy, no decoding
+        if (fd_ >= 0) {
+            std::vector<uint8_t> chunk(std::min<uint64_t>(prefix_end, COPY_CHUNK_BYTES));
+            for (uint64_t offset = 0; ok && offset < prefix_end; offset += chunk.size()) {
+                size_t length = static_cast<size_t>(std::min<uint64_t>(chunk.size(), prefix_end - offset));
+                ok = readAll(fd_, offset, chunk.data(), length) &&
+                     sink.write(reinterpret_cast<const char*>(chunk.data()), length);
+            }
+        } else {
+            uint8_t header[HEADER_BYTES] = {};
+            uint16_t version = FORMAT_VERSION;
+            uint16_t header_size = HEADER_BYTES;
+            std::memcpy(header, &MAGIC, sizeof(uint32_t));
+            std::memcpy(header + 4, &version, sizeof(uint16_t));
+            std::memcpy(header + 6, &header_size, sizeof(uint16_t));
+            ok = sink.write(reinterpret_cast<const char*>(header), HEADER_BYTES);
+            prefix_end = HEADER_BYTES;
+        }
+
+        std::vector<MonthBlock> index(index_.begin(), index_.begin() + static_cast<ptrdiff_t>(kept_blocks));
+        size_t total_sessions = total_sessions_ - carried.size();
+        uint64_t write_offset = prefix_end;
+
+        std::vector<uint8_t> block_bytes;
+        MonthBlock block{};
+        int64_t previous_ms = 0;
+
+        auto finishBlock = [&]() {
+            if (block.session_count == 0) {
+                return;
+            }
+            block.offset = static_cast<uint32_t>(write_offset);
+            block.length = static_cast<uint32_t>(block_bytes.size());
+            ok = ok && sink.write(reinterpret_cast<const char*>(block_bytes.data()), block_bytes.size());
+            write_offset += block_bytes.size();
+            total_sessions += block.session_count;
+            index.push_back(block);
+            block_bytes.clear();
+            block.session_count = 0;
+        };
+
+        auto addSession = [&](const SleepDetectionResult& session, int32_t key) {
+            int64_t bedtime_ms = toMillis(*session.bedtime);
+            if (block.session_count > 0 && key != block.month_key) {
+                finishBlock();
+            }
+            if (block.session_count == 0) {
+                block.month_key = key;
+                block.first_bedtime_ms = bedtime_ms;
+                previous_ms = bedtime_ms;
+            }
+            size_t used = block_bytes.size();
+            block_bytes.resize(used + maxRecordSize(session));
+            used += encodeSession(session, previous_ms, block_bytes.data() + used);
+            block_bytes.resize(used);
+            previous_ms = bedtime_ms;
+            block.last_bedtime_ms = bedtime_ms;
+            block.session_count++;
+        };
+
+        for (const auto& session : carried) {
+            addSession(session, keys.front());
+        }
+        for (size_t i = 0; i < fresh.size(); ++i) {
+            addSession(*fresh[i], keys[i]);
+        }
+        finishBlock();
+
+        // Index and footer
+        std::vector<uint8_t> tail(index.size() * INDEX_ENTRY_BYTES + FOOTER_BYTES);
+        for (size_t i = 0; i < index.size(); ++i) {
+            storeIndexEntry(index[i], tail.data() + i * INDEX_ENTRY_BYTES);
+        }
+        uint8_t* footer = tail.data() + index.size() * INDEX_ENTRY_BYTES;
+        uint32_t entries = static_cast<uint32_t>(index.size());
+        uint32_t session_total = static_cast<uint32_t>(total_sessions);
+        uint32_t index_crc = crc32(tail.data(), index.size() * INDEX_ENTRY_BYTES);
+        uint16_t version = FORMAT_VERSION;
+        uint16_t footer_size = FOOTER_BYTES;
+        std::memcpy(footer, &write_offset, sizeof(uint64_t));
+        std::memcpy(footer + 8, &entries, sizeof(uint32_t));
+        std::memcpy(footer + 12, &session_total, sizeof(uint32_t));
+        std::memcpy(footer + 16, &index_crc, sizeof(uint32_t));
+        std::memcpy(footer + 20, &version, sizeof(uint16_t));
+        std::memcpy(footer + 22, &footer_size, sizeof(uint16_t));
+        std::memcpy(footer + 28, &MAGIC, sizeof(uint32_t));
+        ok = ok && sink.write(reinterpret_cast<const char*>(tail.data()), tail.size());
+
+        ok = ok && fsync(out_fd) == 0;
+        ok = (::close(out_fd) == 0) && ok;
+        if (!ok || std::rename(temp_path.c_str(), path_.c_str()) != 0) {
+            PUUYAPU_LOG_PRINT(PUUYAPU_LOG_ERROR, LOG_TAG, "Failed to write archive %s", path_.c_str());
+            unlink(temp_path.c_str());
+            return 0;
+        }
+
+        std::string path = path_;
+        if (!open(path)) {
+            return 0;
+        }
+        return fresh.size();
+    }
+
+    std::vector<SleepDetectionResult> SessionArchive::readLastNights(size_t count) const noexcept {
+        ScopedMetricTimer timer(MetricId::ARCHIVE_READ);
+
+        std::vector<SleepDetectionResult> nights;
+        if (count == 0 || index_.empty()) {
+            return nights;
+        }
+
+        size_t first = index_.size();
+        size_t covered = 0;
+        while (first > 0 && covered < count) {
+            covered += index_[--first].session_count;
+        }
+
+        nights.reserve(covered);
+        for (size_t i = first; i < index_.size(); ++i) {
+            if (!decodeBlock(index_[i], nights)) {
+                return {};
+            }
+        }
+
+        if (nights.size() > count) {
+            nights.erase(nights.begin(), nights.end() - static_cast<ptrdiff_t>(count));
+        }
+        return nights;
+    }
+
+    std::vector<SleepDetectionResult> SessionArchive::readRange(
+            std::chrono::system_clock::time_point from,
+            std::chrono::system_clock::time_point to) const noexcept {
+        ScopedMetricTimer timer(MetricId::ARCHIVE_READ);
+
+        std::vector<SleepDetectionResult> sessions;
+        int64_t from_ms = toMillis(from);
+        int64_t to_ms = toMillis(to);
+
+        auto block = std::lower_bound(index_.begin(), index_.end(), from_ms,
+                                      [](const MonthBlock& entry, int64_t value) {
+                                          return entry.last_bedtime_ms < value;
+                                      });
+
+        for (; block != index_.end() && block->first_bedtime_ms < to_ms; ++block) {
+            size_t start = sessions.size();
+            if (!decodeBlock(*block, sessions)) {
+                return {};
+            }
+            // Trim the partial months at either end of the range
+            auto outside = [from_ms, to_ms](const SleepDetectionResult& session) {
+                int64_t bedtime_ms = toMillis(*session.bedtime);
+                return bedtime_ms < from_ms || bedtime_ms >= to_ms;
+            };
+            sessions.erase(std::remove_if(sessions.begin() + static_cast<ptrdiff_t>(start),
+                                          sessions.end(), outside), sessions.end());
+        }
+        return sessions;
+    }
+
+    std::vector<SleepDetectionResult> SessionArchive::readMonth(int year, unsigned month) const noexcept {
+        ScopedMetricTimer timer(MetricId::ARCHIVE_READ);
+
+        std::vector<SleepDetectionResult> sessions;
+        int32_t key = static_cast<int32_t>(year * 12 + static_cast<int>(month) - 1);
+
+        auto block = std::lower_bound(index_.begin(), index_.end(), key,
+                                      [](const MonthBlock& entry, int32_t value) {
+                                          return entry.month_key < value;
+                                      });
+        if (block != index_.end() && block->month_key == key && !decodeBlock(*block, sessions)) {
+            return {};
+        }
+        return sessions;
+    }
+
+    int32_t SessionArchive::monthKeyOf(std::chrono::system_clock::time_point bedtime) noexcept {
+        CivilDate date = civilFromDays(TimeZoneContext::shared().toCivil(bedtime).night_index);
+        return static_cast<int32_t>(date.year * 12 + static_cast<int64_t>(date.month) - 1);
+    }
+
+    size_t SessionArchive::maxRecordSize(const SleepDetectionResult& session) noexcept {
+        return FIXED_RECORD_BYTES + session.interruptions.size() * MAX_INTERRUPTION_BYTES;
+    }
+
+    size_t SessionArchive::encodeSession(const SleepDetectionResult& session,
+                                         int64_t previous_bedtime_ms,
+                                         uint8_t* out) noexcept {
+        uint8_t* start = out;
+
+        int64_t bedtime_ms = session.bedtime ? toMillis(*session.bedtime) : 0;
+        int64_t wake_ms = session.wake_time ? toMillis(*session.wake_time) : bedtime_ms;
+        int64_t in_bed_ms = std::max<int64_t>(0, wake_ms - bedtime_ms);
+        auto duration_ms = static_cast<int64_t>(std::llround(session.duration.count() * 3600000.0));
+
+        out = putSigned(out, bedtime_ms - previous_bedtime_ms);
+        out = putVarint(out, static_cast<uint64_t>(in_bed_ms));
+        out = putSigned(out, duration_ms - in_bed_ms);     // 0 (one byte) for detected nights
+
+        uint8_t flags = static_cast<uint8_t>(session.confidence) & CONFIDENCE_MASK;
+        if (session.is_manually_confirmed) flags |= MANUALLY_CONFIRMED_FLAG;
+        *out++ = flags;
+        out = putU16(out, quantizeUnit(session.quality_score));
+        out = putU16(out, quantizeUnit(session.pattern_match_score));
+
+        out = putVarint(out, session.interruptions.size());
+        int64_t previous_ms = bedtime_ms;
+        for (const auto& interruption : session.interruptions) {
+            int64_t timestamp_ms = toMillis(interruption.timestamp);
+            out = putSigned(out, timestamp_ms - previous_ms);
+            out = putVarint(out, static_cast<uint64_t>(std::max<int64_t>(0, interruption.duration.count())));
+            *out++ = static_cast<uint8_t>(interruption.cause);
+            *out++ = static_cast<uint8_t>(interruption.app_category);
+            *out++ = interruption.is_brief_check ? BRIEF_CHECK_FLAG : 0;
+            out = putU16(out, quantizeUnit(interruption.impact_score));
+            previous_ms = timestamp_ms;
+        }
+
+        return static_cast<size_t>(out - start);
+    }
+
+    size_t SessionArchive::decodeSession(const uint8_t* data,
+                                         size_t size,
+                                         int64_t& previous_bedtime_ms,
+                                         SleepDetectionResult& session) noexcept {
+        Cursor cursor{data, data + size};
+
+        int64_t bedtime_ms = previous_bedtime_ms + cursor.signedVarint();
+        auto in_bed_ms = static_cast<int64_t>(cursor.varint());
+        int64_t duration_ms = in_bed_ms + cursor.signedVarint();
+        uint8_t flags = cursor.u8();
+        uint16_t quality = cursor.u16();
+        uint16_t pattern = cursor.u16();
+        uint64_t interruption_count = cursor.varint();
+
+        // Every interruption takes at least 7 bytes: reject counts the block cannot hold
+        if (!cursor.ok || interruption_count > static_cast<uint64_t>(cursor.end - cursor.data) / 7) {
+            return 0;
+        }
+
+        session = SleepDetectionResult{};
+        session.bedtime = fromMillis(bedtime_ms);
+        session.wake_time = fromMillis(bedtime_ms + in_bed_ms);
+        session.duration = std::chrono::duration<double, std::ratio<3600>>(duration_ms / 3600000.0);
+        session.confidence = static_cast<SleepConfidence>(flags & CONFIDENCE_MASK);
+        session.is_manually_confirmed = (flags & MANUALLY_CONFIRMED_FLAG) != 0;
+        session.quality_score = dequantizeUnit(quality);
+        session.pattern_match_score = dequantizeUnit(pattern);
+
+        session.interruptions.reserve(static_cast<size_t>(interruption_count));
+        int64_t previous_ms = bedtime_ms;
+        for (uint64_t i = 0; i < interruption_count; ++i) {
+            int64_t timestamp_ms = previous_ms + cursor.signedVarint();
+            auto duration = static_cast<int64_t>(cursor.varint());
+            auto cause = static_cast<InteractionType>(cursor.u8());
+            auto category = static_cast<AppCategory>(cursor.u8());
+            uint8_t interruption_flags = cursor.u8();
+            uint16_t impact = cursor.u16();
+
+            SleepInterruption interruption(fromMillis(timestamp_ms), std::chrono::milliseconds(duration),
+                                           cause, category);
+            interruption.is_brief_check = (interruption_flags & BRIEF_CHECK_FLAG) != 0;
+            interruption.impact_score = dequantizeUnit(impact);
+            session.interruptions.push_back(interruption);
+            previous_ms = timestamp_ms;
+        }
+
+        if (!cursor.ok) {
+            return 0;
+        }
+        previous_bedtime_ms = bedtime_ms;
+        return static_cast<size_t>(cursor.data - data);
+    }
+
+// ============================================================================
+// Private Helper Methods
+// ============================================================================
+
+    bool SessionArchive::readIndex(int fd, size_t file_size) noexcept {
+        if (file_size < HEADER_BYTES + FOOTER_BYTES) {
+            return false;
+        }
+
+        uint8_t header[HEADER_BYTES];
+        uint8_t footer[FOOTER_BYTES];
+        if (!readAll(fd, 0, header, HEADER_BYTES) ||
+            !readAll(fd, file_size - FOOTER_BYTES, footer, FOOTER_BYTES)) {
+            return false;
+        }
+
+        uint32_t header_magic, footer_magic;
+        uint16_t header_version, header_size, footer_version, footer_size;
+        std::memcpy(&header_magic, header, sizeof(uint32_t));
+        std::memcpy(&header_version, header + 4, sizeof(uint16_t));
+        std::memcpy(&header_size, header + 6, sizeof(uint16_t));
+        std::memcpy(&footer_version, footer + 20, sizeof(uint16_t));
+        std::memcpy(&footer_size, footer + 22, sizeof(uint16_t));
+        std::memcpy(&footer_magic, footer + 28, sizeof(uint32_t));
+
+        if (header_magic != MAGIC || footer_magic != MAGIC ||
+            header_version == 0 || footer_version == 0 ||
+            header_size < HEADER_BYTES || footer_size != FOOTER_BYTES) {
+            return false;
+        }
+
+        uint64_t index_offset;
+        uint32_t entries, total_sessions, expected_crc;
+        std::memcpy(&index_offset, footer, sizeof(uint64_t));
+        std::memcpy(&entries, footer + 8, sizeof(uint32_t));
+        std::memcpy(&total_sessions, footer + 12, sizeof(uint32_t));
+        std::memcpy(&expected_crc, footer + 16, sizeof(uint32_t));
+
+        if (index_offset < header_size ||
+            index_offset + static_cast<uint64_t>(entries) * INDEX_ENTRY_BYTES + FOOTER_BYTES != file_size) {
+            return false;
+        }
+
+        std::vector<uint8_t> raw(static_cast<size_t>(entries) * INDEX_ENTRY_BYTES);
+        if (!readAll(fd, index_offset, raw.data(), raw.size()) ||
+            crc32(raw.data(), raw.size()) != expected_crc) {
+            return false;
+        }
+
+        std::vector<MonthBlock> index;
+        index.reserve(entries);
+        uint64_t block_end = header_size;
+        size_t counted = 0;
+        for (uint32_t i = 0; i < entries; ++i) {
+            MonthBlock block = loadIndexEntry(raw.data() + i * INDEX_ENTRY_BYTES);
+            if (block.offset < block_end ||
+                static_cast<uint64_t>(block.offset) + block.length > index_offset ||
+                (!index.empty() && block.month_key <= index.back().month_key)) {
+                return false;
+            }
+            block_end = static_cast<uint64_t>(block.offset) + block.length;
+            counted += block.session_count;
+            index.push_back(block);
+        }
+        if (counted != total_sessions) {
+            return false;
+        }
+
+        index_ = std::move(index);
+        index_offset_ = index_offset;
+        total_sessions_ = total_sessions;
+        return true;
+    }
+
+    bool SessionArchive::decodeBlock(const MonthBlock& block,
+                                     std::vector<SleepDetectionResult>& out) const noexcept {
+        std::vector<uint8_t> bytes(block.length);
+        if (fd_ < 0 || !readAll(fd_, block.offset, bytes.data(), bytes.size())) {
+            PUUYAPU_LOG_PRINT(PUUYAPU_LOG_ERROR, LOG_TAG, "Cannot read month block at %u", block.offset);
+            return false;
+        }
+
+        size_t start = out.size();
+        const uint8_t* data = bytes.data();
+        size_t remaining = bytes.size();
+        int64_t previous_ms = block.first_bedtime_ms;
+
+        for (uint32_t i = 0; i < block.session_count; ++i) {
+            SleepDetectionResult session;
+            size_t consumed = decodeSession(data, remaining, previous_ms, session);
+            if (consumed == 0) {
+                PUUYAPU_LOG_PRINT(PUUYAPU_LOG_ERROR, LOG_TAG, "Malformed month block at %u", block.offset);
+                out.resize(start);
+                return false;
+            }
+            out.push_back(std::move(session));
+            data += consumed;
+            remaining -= consumed;
+        }
+        return true;
+    }
+
+    void SessionArchive::close() noexcept {
+        if (fd_ >= 0) {
+            ::close(fd_);
+            fd_ = -1;
+        }
+        path_.clear();
+        index_.clear();
+        index_offset_ = HEADER_BYTES;
+        total_sessions_ = 0;
+    }
+
+} // namespace puuyapu
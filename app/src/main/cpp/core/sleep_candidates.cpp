@@ -0,0 +1,107 @@
+/**
+ * @file sleep_candidates.cpp
+ * @brief Implementation of batched sleep candidate scoring
+ */
+
+#include "sleep_candidates.h"
+#include "time_utils.h"
+#include <algorithm>
+#include <cmath>
+
+namespace puuyapu {
+
+    namespace {
+        constexpr uint32_t INTERRUPTION_MAX_MS = 120000;        ///< analyzeInterruptions cutoff
+        constexpr double FULL_IMPACT_MS = 10.0 * 60 * 1000;     ///< SleepInterruption: max impact at 10 minutes
+    }
+
+    double InterruptionLoad::quality() const noexcept {
+        double quality = 1.0 - impact * 0.1;
+        if (count > 3) {
+            quality -= (count - 3) * 0.05;
+        }
+        return std::max(0.0, std::min(1.0, quality));
+    }
+
+    InterruptionLoad measureInterruptions(const EventRange& inside) noexcept {
+        const uint8_t* flags = inside.flagData();
+        const uint32_t* durations = inside.durationData();
+
+        InterruptionLoad load;
+        for (size_t i = 0; i < inside.size(); ++i) {
+            bool interruption = (flags[i] & EVENT_FLAG_TIME_CHECK) != 0 || durations[i] < INTERRUPTION_MAX_MS;
+            if (!interruption) {
+                continue;
+            }
+            load.count++;
+            load.impact += (flags[i] & EVENT_FLAG_BRIEF) != 0
+                           ? 0.1
+                           : std::min(1.0, durations[i] / FULL_IMPACT_MS);
+        }
+        return load;
+    }
+
+    bool SleepCandidateBatch::add(std::chrono::system_clock::time_point bedtime,
+                                  std::chrono::system_clock::time_point wake_time,
+                                  double pattern_match_score,
+                                  double quality_score,
+                                  bool is_nighttime,
+                                  bool is_manually_confirmed,
+                                  double motion_factor) noexcept {
+        if (full()) {
+            return false;
+        }
+
+        duration_hours_[size_] = calculateDurationHours(bedtime, wake_time);
+        pattern_[size_] = pattern_match_score;
+        quality_[size_] = quality_score;
+        nighttime_[size_] = is_nighttime ? 1.0 : 0.0;
+        manual_[size_] = is_manually_confirmed ? 1.0 : 0.0;
+        motion_[size_] = motion_factor;
+        bedtime_[size_] = bedtime;
+        wake_time_[size_] = wake_time;
+        size_++;
+        return true;
+    }
+
+    void SleepCandidateBatch::score(double target_sleep_hours, SleepCandidateRanking& ranking) const noexcept {
+        ranking.count = 0;
+        ranking.evaluated = size_;
+
+        // calculateConfidenceScore, term by term in the same order, over every lane,
+        // then the motion factor as buildSleepResult applies it
+        alignas(16) std::array<double, CAPACITY> scores;
+        for (size_t i = 0; i < size_; ++i) {
+            double duration_score = std::max(0.0, 1.0 - std::abs(duration_hours_[i] - target_sleep_hours) / target_sleep_hours);
+            double score = manual_[i] * 0.5;
+            score += duration_score * 0.2;
+            score += pattern_[i] * 0.15;
+            score += quality_[i] * 0.1;
+            score += nighttime_[i] * 0.05;
+            scores[i] = std::min(1.0, score) * motion_[i];
+        }
+
+        // Insertion into the short ranked list
+        auto& ranked = ranking.candidates;
+        for (size_t i = 0; i < size_; ++i) {
+            size_t position = ranking.count;
+            while (position > 0 &&
+                   (ranked[position - 1].score < scores[i] ||
+                    (ranked[position - 1].score == scores[i] && ranked[position - 1].bedtime < bedtime_[i]))) {
+                position--;
+            }
+            if (position == SleepCandidateRanking::CAPACITY) {
+                continue;
+            }
+
+            size_t last = std::min(ranking.count, SleepCandidateRanking::CAPACITY - 1);
+            for (size_t j = last; j > position; --j) {
+                ranked[j] = ranked[j - 1];
+            }
+            ranked[position] = SleepCandidate{bedtime_[i], wake_time_[i], duration_hours_[i], pattern_[i],
+                                              quality_[i], scores[i], nighttime_[i] != 0.0, manual_[i] != 0.0};
+            ranking.count = std::min(ranking.count + 1, SleepCandidateRanking::CAPACITY);
+        }
+    }
+
+} // namespace puuyapu
@@ -10,35 +10,99 @@
  */
 
 #include "sleep_detector.h"
+#include "thread_pool.h"
+#include "detector_snapshot.h"
 #include <algorithm>
 #include <cmath>
-#include <ctime>
 
 namespace puuyapu {
 
     constexpr const char* LOG_TAG = "PuuyApu_Core";
 
+    namespace {
+        UserPreferences validatedPreferences(const UserPreferences& preferences) noexcept {
+            if (!preferences.isValid()) {
+                SLEEP_LOG_ERROR(LOG_TAG, "Invalid user preferences provided, using defaults");
+                return UserPreferences{};
+            }
+            return preferences;
+        }
+
+        std::chrono::milliseconds minimumGapOf(const UserPreferences& prefs) noexcept {
+            return std::chrono::duration_cast<std::chrono::milliseconds>(prefs.minimum_interaction_gap);
+        }
+
+        int64_t toEpochMs(std::chrono::system_clock::time_point time_point) noexcept {
+            return std::chrono::duration_cast<std::chrono::milliseconds>(time_point.time_since_epoch()).count();
+        }
+
+        std::chrono::system_clock::time_point fromEpochMs(int64_t epoch_ms) noexcept {
+            return std::chrono::system_clock::time_point(std::chrono::milliseconds(epoch_ms));
+        }
+
+        /// Finished epochs are handed to the event lock this many at a time
+        constexpr size_t EPOCH_STORE_BATCH = 16;
+
+        void writePreferences(SnapshotWriter& writer, const UserPreferences& prefs) {
+            writer.put(prefs.target_sleep_hours.count());
+            writer.put<int64_t>(prefs.target_bedtime.count());
+            writer.put<int64_t>(prefs.target_wake_time.count());
+            writer.put<int64_t>(prefs.weekday_bedtime.count());
+            writer.put<int64_t>(prefs.weekend_bedtime.count());
+            writer.put<int64_t>(prefs.minimum_interaction_gap.count());
+            writer.put<int64_t>(prefs.time_check_threshold.count());
+            writer.put<uint8_t>(prefs.enable_smart_detection ? 1 : 0);
+            writer.put<uint8_t>(prefs.track_interruptions ? 1 : 0);
+            writer.put(prefs.confidence_threshold);
+        }
+
+        bool readPreferences(SnapshotReader& reader, UserPreferences& prefs) noexcept {
+            double target_hours = 0.0;
+            int64_t bedtime = 0, wake_time = 0, weekday_bedtime = 0, weekend_bedtime = 0;
+            int64_t minimum_gap = 0, time_check = 0;
+            uint8_t smart = 0, interruptions = 0;
+            UserPreferences decoded;
+            if (!reader.get(target_hours) || !reader.get(bedtime) || !reader.get(wake_time) ||
+                !reader.get(weekday_bedtime) || !reader.get(weekend_bedtime) ||
+                !reader.get(minimum_gap) || !reader.get(time_check) ||
+                !reader.get(smart) || !reader.get(interruptions) ||
+                !reader.get(decoded.confidence_threshold)) {
+                return false;
+            }
+            decoded.target_sleep_hours = std::chrono::duration<double, std::ratio<3600>>(target_hours);
+            decoded.target_bedtime = std::chrono::minutes(bedtime);
+            decoded.target_wake_time = std::chrono::minutes(wake_time);
+            decoded.weekday_bedtime = std::chrono::minutes(weekday_bedtime);
+            decoded.weekend_bedtime = std::chrono::minutes(weekend_bedtime);
+            decoded.minimum_interaction_gap = std::chrono::seconds(minimum_gap);
+            decoded.time_check_threshold = std::chrono::seconds(time_check);
+            decoded.enable_smart_detection = smart != 0;
+            decoded.track_interruptions = interruptions != 0;
+            if (!decoded.isValid()) {
+                return false;
+            }
+            prefs = decoded;
+            return true;
+        }
+    }
+
 // ============================================================================
 // SleepDetector Implementation
 // ============================================================================
 
-    SleepDetector::SleepDetector(const UserPreferences& preferences) {
+    SleepDetector::SleepDetector(const UserPreferences& preferences, const Clock& clock)
+            : timeline_(minimumGapOf(UserPreferences{})),
+              preferences_(validatedPreferences(preferences)),
+              clock_(&clock) {
         MEASURE_PERFORMANCE("SleepDetector::constructor");
 
-        // Initialize with validated preferences
-        preferences_storage_ = std::make_unique<UserPreferences>(preferences);
-        if (!preferences_storage_->isValid()) {
-            SLEEP_LOG_ERROR(LOG_TAG, "Invalid user preferences provided, using defaults");
-            preferences_storage_ = std::make_unique<UserPreferences>();
-        }
-
-        preferences_.store(preferences_storage_.get());
+        auto prefs = preferences_.read();
 
-        // Pre-allocate event storage for performance
-        recent_events_.reserve(Performance::MAX_EVENTS_CACHE);
+        // Gap index and event flags follow the detection preferences
+        syncTimeline(*prefs);
 
         SLEEP_LOG_INFO(LOG_TAG, "SleepDetector initialized with %d hours target sleep",
-                       (int)preferences_storage_->target_sleep_hours.count());
+                       (int)prefs->target_sleep_hours.count());
     }
 
     SleepDetector::~SleepDetector() noexcept {
@@ -48,50 +112,262 @@ namespace puuyapu {
 
     void SleepDetector::addInteractionEvent(const InteractionEvent& event) noexcept {
         MEASURE_PERFORMANCE("SleepDetector::addInteractionEvent");
+        ScopedMetricTimer metric(MetricId::ADD_INTERACTION_EVENT);
 
-        std::lock_guard<std::mutex> lock(events_mutex_);
+        // Fast path: publish without touching events_mutex_
+        if (ingress_.tryPush(event)) {
+            total_events_processed_++;
+            return;
+        }
 
-        // Add event to circular buffer
-        if (recent_events_.size() < Performance::MAX_EVENTS_CACHE) {
-            recent_events_.push_back(event);
-        } else {
-            // Circular buffer is full, overwrite oldest
-            recent_events_[event_write_index_] = event;
-            event_write_index_ = (event_write_index_ + 1) % Performance::MAX_EVENTS_CACHE;
-            event_buffer_full_ = true;
+        // Queue full: apply inline only if no query currently holds the lock
+        std::unique_lock<std::mutex> lock(events_mutex_, std::try_to_lock);
+        if (!lock.owns_lock()) {
+            ingress_dropped_events_++;
+            SLEEP_LOG_ERROR(LOG_TAG, "Ingress queue full, dropped interaction event");
+            return;
         }
 
+        drainIngress();
+        applyEvent(event);
+        cached_result_.reset();
+
         total_events_processed_++;
+        ingress_overflow_drains_++;
+
+        SLEEP_LOG_DEBUG(LOG_TAG, "Added interaction event inline: type=%d, duration=%ldms",
+                        static_cast<int>(event.type), event.duration.count());
+    }
+
+    size_t SleepDetector::addInteractionEvents(const InteractionEvent* events, size_t count) noexcept {
+        MEASURE_PERFORMANCE("SleepDetector::addInteractionEvents");
+        ScopedMetricTimer metric(MetricId::ADD_INTERACTION_EVENTS);
+
+        if (events == nullptr || count == 0) {
+            return 0;
+        }
+
+        std::lock_guard<std::mutex> lock(events_mutex_);
+
+        // Apply earlier queued events first to keep arrival order
+        drainIngress();
+
+        size_t accepted = 0;
+        for (size_t i = 0; i < count; ++i) {
+            if (applyEvent(events[i])) {
+                accepted++;
+            }
+        }
+
+        total_events_processed_ += count;
 
-        // Invalidate cache when new events arrive
+        // One invalidation for the whole batch
         cached_result_.reset();
 
-        SLEEP_LOG_DEBUG(LOG_TAG, "Added interaction event: type=%d, duration=%ldms",
-                        static_cast<int>(event.type), event.duration.count());
+        SLEEP_LOG_DEBUG(LOG_TAG, "Added %zu/%zu interaction events in batch", accepted, count);
+
+        return accepted;
+    }
+
+    size_t SleepDetector::addSerializedEvents(const uint8_t* records, size_t count) noexcept {
+        MEASURE_PERFORMANCE("SleepDetector::addSerializedEvents");
+        ScopedMetricTimer metric(MetricId::ADD_INTERACTION_EVENTS);
+
+        if (records == nullptr || count == 0) {
+            return 0;
+        }
+
+        ClassificationPolicy policy = getClassificationPolicy();
+
+        std::lock_guard<std::mutex> lock(events_mutex_);
+        drainIngress();
+
+        size_t accepted = 0;
+        for (size_t i = 0; i < count; ++i) {
+            InteractionEvent event = InteractionEvent::deserialize(records + i * InteractionEvent::SERIALIZED_SIZE);
+            if (event.type == InteractionType::UNKNOWN) {
+                event.type = policy.inferType(event.duration.count());
+            }
+            if (applyEvent(event)) {
+                accepted++;
+            }
+        }
+
+        total_events_processed_ += count;
+        cached_result_.reset();
+
+        SLEEP_LOG_DEBUG(LOG_TAG, "Added %zu/%zu serialized events in batch", accepted, count);
+
+        return accepted;
+    }
+
+    template<typename Decode>
+    size_t SleepDetector::reduceSamples(size_t count, Decode&& decode) noexcept {
+        ActivityEpoch finished[EPOCH_STORE_BATCH];
+        size_t pending = 0;
+        size_t added = 0;
+        auto emit = [&](const ActivityEpoch& epoch) {
+            finished[pending++] = epoch;
+            if (pending == EPOCH_STORE_BATCH) {
+                added += storeEpochs(finished, pending);
+                pending = 0;
+            }
+        };
+
+        AccelerometerBlock block;
+        for (size_t offset = 0; offset < count;) {
+            size_t consumed = decode(offset, block);
+            if (consumed == 0) {
+                break;
+            }
+            reducer_.add(block, emit);
+            offset += consumed;
+        }
+
+        return added + storeEpochs(finished, pending);
+    }
+
+    size_t SleepDetector::addAccelerometerSamples(const uint8_t* records, size_t count,
+                                                  int64_t clock_offset_ns) noexcept {
+        TRACE_SECTION("SleepDetector::addAccelerometerSamples");
+
+        std::lock_guard<std::mutex> sensor_lock(sensor_mutex_);
+        return reduceSamples(count, [&](size_t offset, AccelerometerBlock& block) {
+            return decodeAccelerometerRecords(records + offset * AccelerometerRecord::SERIALIZED_SIZE,
+                                              count - offset, clock_offset_ns, block);
+        });
+    }
+
+#if defined(__ANDROID__)
+    size_t SleepDetector::addSensorEvents(const ASensorEvent* events, size_t count,
+                                          int64_t clock_offset_ns) noexcept {
+        TRACE_SECTION("SleepDetector::addSensorEvents");
+
+        std::lock_guard<std::mutex> sensor_lock(sensor_mutex_);
+        return reduceSamples(count, [&](size_t offset, AccelerometerBlock& block) {
+            return decodeSensorEvents(events + offset, count - offset, clock_offset_ns, block);
+        });
+    }
+
+    size_t SleepDetector::drainSensorQueue(ASensorEventQueue* queue, int64_t clock_offset_ns) noexcept {
+        ASensorEvent events[64];
+        size_t added = 0;
+        ssize_t read;
+        while ((read = ASensorEventQueue_getEvents(queue, events, 64)) > 0) {
+            added += addSensorEvents(events, static_cast<size_t>(read), clock_offset_ns);
+        }
+        return added;
+    }
+#endif
+
+    size_t SleepDetector::flushActivityEpoch() noexcept {
+        std::lock_guard<std::mutex> sensor_lock(sensor_mutex_);
+        size_t added = 0;
+        reducer_.flush([&](const ActivityEpoch& epoch) { added += storeEpochs(&epoch, 1); });
+        return added;
+    }
+
+    size_t SleepDetector::storeEpochs(const ActivityEpoch* epochs, size_t count) noexcept {
+        if (count == 0) {
+            return 0;
+        }
+
+        std::lock_guard<std::mutex> lock(events_mutex_);
+        size_t accepted = 0;
+        for (size_t i = 0; i < count; ++i) {
+            accepted += activity_.append(epochs[i]) ? 1 : 0;
+        }
+        if (accepted > 0) {
+            cached_result_.reset();
+        }
+        TRACE_COUNTER("PuuyApu.activity_epochs", activity_.size());
+        return accepted;
     }
 
     SleepDetectionResult SleepDetector::detectSleepPeriod(
             const std::chrono::system_clock::time_point& current_time) const {
 
+        // The one copy this API promises; borrowSleepPeriod avoids it
+        return *borrowSleepPeriod(current_time);
+    }
+
+    BorrowedSleepResult SleepDetector::borrowSleepPeriod(
+            const std::chrono::system_clock::time_point& current_time) const {
+
         MEASURE_PERFORMANCE("SleepDetector::detectSleepPeriod");
+        ScopedMetricTimer metric(MetricId::DETECT_SLEEP_PERIOD);
+
+        // One preference snapshot for the whole pass
+        auto prefs = preferences_.read();
+        uint64_t generation = prefs.snapshot().detection_generation;
+
+        // The timeline is read in place, so hold the lock for the whole pass
+        std::unique_lock<std::mutex> lock(events_mutex_);
+        const SleepDetectionResult& result = detectSleepPeriodLocked(*prefs, generation, current_time);
+        return BorrowedSleepResult(std::move(lock), result);
+    }
+
+    SleepCandidateRanking SleepDetector::rankSleepCandidates(
+            const std::chrono::system_clock::time_point& current_time) const {
+
+        ScopedMetricTimer metric(MetricId::DETECT_SLEEP_PERIOD);
+
+        auto prefs = preferences_.read();
+        uint64_t generation = prefs.snapshot().detection_generation;
+
+        // Ranked by the same (possibly cached) pass that picked the live result
+        std::lock_guard<std::mutex> lock(events_mutex_);
+        detectSleepPeriodLocked(*prefs, generation, current_time);
+        return cached_candidates_;
+    }
+
+    const SleepDetectionResult& SleepDetector::detectSleepPeriodLocked(
+            const UserPreferences& prefs,
+            uint64_t detection_generation,
+            const std::chrono::system_clock::time_point& current_time) const {
+
+        syncTimeline(prefs);
+        drainIngress();
+
+        TRACE_COUNTER("PuuyApu.events_retained", timeline_.size());
+        TRACE_COUNTER("PuuyApu.gaps_indexed", timeline_.gaps().size());
 
         // Check if we can use cached result
-        if (canUseCachedResult(current_time)) {
-            recordPerformanceMetric("cache_hit", std::chrono::microseconds(10));
+        if (canUseCachedResult(current_time, detection_generation)) {
+            cache_hits_.fetch_add(1, std::memory_order_relaxed);
+            TRACE_COUNTER("PuuyApu.cache_hit", 1);
             return *cached_result_;
         }
-
-        // Get sorted events for analysis
-        auto events = getSortedEvents();
-        if (events.size() < 2) {
-            SLEEP_LOG_DEBUG(LOG_TAG, "Insufficient events for sleep detection: %zu", events.size());
-            return SleepDetectionResult{};
+        cache_misses_.fetch_add(1, std::memory_order_relaxed);
+        TRACE_COUNTER("PuuyApu.cache_hit", 0);
+
+        SleepDetectionResult& result = cached_result_.emplace();
+        cached_generation_ = detection_generation;
+        cached_candidates_ = SleepCandidateRanking{};
+
+        // With the timeline fixed, only crossing the onset instant changes the outcome
+        cached_valid_from_ = std::chrono::system_clock::time_point::min();
+        cached_valid_until_ = std::chrono::system_clock::time_point::max();
+        size_t last_meaningful = timeline_.lastMeaningful();
+        if (last_meaningful != EventTimeline::NPOS) {
+            auto onset = timeline_.events().timestampAt(last_meaningful) + prefs.minimum_interaction_gap;
+            if (current_time < onset) {
+                cached_valid_until_ = onset;
+            } else {
+                cached_valid_from_ = onset;
+            }
         }
 
-        SleepDetectionResult result;
+        if (timeline_.size() < 2) {
+            SLEEP_LOG_DEBUG(LOG_TAG, "Insufficient events for sleep detection: %zu", timeline_.size());
+            return result;
+        }
 
-        // Step 1: Find potential sleep start time
-        auto sleep_start = findSleepStartTime(events, current_time);
+        // Step 1: Best-scoring sleep window of the last day, else an open sleep
+        rankCandidates(timeline_, prefs, cached_candidates_);
+        auto sleep_start = cached_candidates_.empty()
+                           ? findSleepStartTime(timeline_, prefs, current_time)
+                           : std::optional<std::chrono::system_clock::time_point>(cached_candidates_.best().bedtime);
         if (!sleep_start.has_value()) {
             SLEEP_LOG_DEBUG(LOG_TAG, "No sleep start time detected");
             return result;
@@ -100,49 +376,47 @@ namespace puuyapu {
         result.bedtime = sleep_start;
 
         // Step 2: Find sleep end time
-        auto sleep_end = findSleepEndTime(events, *sleep_start, current_time);
+        auto sleep_end = findSleepEndTime(timeline_, *sleep_start, current_time);
         if (!sleep_end.has_value()) {
             // User might still be sleeping
             SLEEP_LOG_DEBUG(LOG_TAG, "Sleep end time not detected - user may still be sleeping");
             return result;
         }
 
-        result.wake_time = sleep_end;
-
-        // Step 3: Calculate duration
-        result.duration = std::chrono::duration<double, std::ratio<3600>>(
-                calculateDurationHours(*sleep_start, *sleep_end)
-        );
+        // Completed sleep of a closed night: served from (or sealed into) the store
+        int64_t night = TimeZoneContext::shared().toCivil(*sleep_start).night_index;
+        size_t sealed = finalized_.find(night);
+        if (sealed == FinalizedSessionStore::NPOS && isNightSealable(night, current_time)) {
+            sealed = sealNight(prefs, night);
+        }
+        if (sealed != FinalizedSessionStore::NPOS) {
+            finalized_.load(sealed, result);
+            return result;
+        }
 
-        // Step 4: Analyze interruptions
-        result.interruptions = analyzeInterruptions(events, *sleep_start, *sleep_end);
+        // The night seals when its window closes, even without new events
+        auto window_end = TimeZoneContext::shared().nightWindowStartOf(night + 1);
+        if (current_time < window_end && window_end < cached_valid_until_) {
+            cached_valid_until_ = window_end;
+        }
 
-        // Step 5: Calculate quality and confidence
-        result.quality_score = calculateSleepQuality(result.interruptions,
-                                                     std::chrono::duration_cast<std::chrono::milliseconds>(*sleep_end - *sleep_start));
-        result.confidence = static_cast<SleepConfidence>(
-                std::min(4, static_cast<int>(calculateConfidenceScore(result) * 5))
-        );
-        result.pattern_match_score = evaluatePatternConsistency(*sleep_start, *sleep_end);
-
-        // Check for manual confirmation
-        for (const auto& event : events) {
-            if (event.type == InteractionType::SLEEP_CONFIRMATION &&
-                event.timestamp >= *sleep_start - std::chrono::minutes(30) &&
-                event.timestamp <= *sleep_start + std::chrono::minutes(30)) {
-                result.is_manually_confirmed = true;
-                result.confidence = SleepConfidence::VERY_HIGH;
-                break;
-            }
+        // Steps 3-5: Duration, interruptions, quality and confidence
+        result = buildSleepResult(timeline_, prefs, *sleep_start, *sleep_end);
+        if (!result.isValid()) {
+            return result;
         }
 
-        // Cache the result
-        if (result.isValid()) {
-            std::lock_guard<std::mutex> lock(events_mutex_);
-            cached_result_ = result;
-            last_cache_update_ = current_time;
+        // The night is still open: patterns learn from it once it is sealed
+
+        // A cache miss recomputes the same period; count each night once
+        if (night != counted_live_night_) {
+            counted_live_night_ = night;
             total_sleep_periods_detected_++;
 
+            double score = calculateConfidenceScore(result, prefs);
+            confidence_sum_micros_.fetch_add(static_cast<uint64_t>(score * 1e6), std::memory_order_relaxed);
+            confidence_samples_.fetch_add(1, std::memory_order_relaxed);
+
             SLEEP_LOG_INFO(LOG_TAG, "Sleep period detected: %.1f hours, confidence=%s",
                            result.duration.count(), result.getConfidenceString());
         }
@@ -150,9 +424,243 @@ namespace puuyapu {
         return result;
     }
 
+    std::vector<SleepDetectionResult> SleepDetector::detectSleepPeriods(
+            const std::chrono::system_clock::time_point& from,
+            const std::chrono::system_clock::time_point& to) const {
+
+        MEASURE_PERFORMANCE("SleepDetector::detectSleepPeriods");
+        ScopedMetricTimer metric(MetricId::DETECT_SLEEP_PERIODS);
+
+        auto prefs = preferences_.read();
+
+        std::lock_guard<std::mutex> lock(events_mutex_);
+        scratch_.reset();
+
+        // Night list in scratch memory; only the returned results hit the heap
+        ArenaVector<NightSlot> nights = collectNights(*prefs, from, to);
+        std::vector<SleepDetectionResult> results(nights.size());
+        evaluateNights(*prefs, nights.data(), nights.size(), results.data());
+
+        SLEEP_LOG_DEBUG(LOG_TAG, "Batch detection: %zu nights", results.size());
+
+        return results;
+    }
+
+    std::vector<SleepDetectionResult> SleepDetector::detectSealedSleepPeriods(
+            const std::chrono::system_clock::time_point& from,
+            const std::chrono::system_clock::time_point& to) const {
+
+        MEASURE_PERFORMANCE("SleepDetector::detectSealedSleepPeriods");
+        ScopedMetricTimer metric(MetricId::DETECT_SLEEP_PERIODS);
+
+        auto prefs = preferences_.read();
+
+        std::lock_guard<std::mutex> lock(events_mutex_);
+        scratch_.reset();
+
+        ArenaVector<NightSlot> nights = collectNights(*prefs, from, to);
+        ArenaVector<SleepDetectionResult> results(nights.size(), ArenaAllocator<SleepDetectionResult>(scratch_));
+        evaluateNights(*prefs, nights.data(), nights.size(), results.data());
+
+        // Nights still open (or not yet sealable) stay out
+        std::vector<SleepDetectionResult> sealed;
+        sealed.reserve(nights.size());
+        for (size_t i = 0; i < nights.size(); ++i) {
+            if (finalized_.contains(nights[i].night_index)) {
+                sealed.push_back(results[i]);
+            }
+        }
+
+        SLEEP_LOG_DEBUG(LOG_TAG, "Sealed batch detection: %zu of %zu nights", sealed.size(), nights.size());
+
+        return sealed;
+    }
+
+    ArenaVector<SleepDetector::NightSlot> SleepDetector::collectNights(
+            const UserPreferences& prefs,
+            const std::chrono::system_clock::time_point& from,
+            const std::chrono::system_clock::time_point& to) const {
+
+        ArenaVector<NightSlot> nights{ArenaAllocator<NightSlot>(scratch_)};
+        if (!(from < to)) {
+            return nights;
+        }
+
+        syncTimeline(prefs);
+        drainIngress();
+
+        // Night windows are resolved arithmetically from the cached UTC offset
+        auto& time_zone = TimeZoneContext::shared();
+        int64_t first_night = time_zone.toCivil(from).night_index;
+
+        // Sealed nights of the range, merged in night order with the gap nights
+        size_t sealed = finalized_.lowerBound(first_night);
+        size_t sealed_end = sealed;
+        while (sealed_end < finalized_.size() && finalized_.bedtimeAt(sealed_end) < to) {
+            sealed_end++;
+        }
+        auto flushSealedBefore = [&](int64_t night_limit) {
+            while (sealed < sealed_end && finalized_.nightAt(sealed) < night_limit) {
+                nights.push_back(NightSlot{finalized_.nightAt(sealed), nullptr, sealed});
+                sealed++;
+            }
+        };
+
+        // Only nights that can contain data
+        bool has_events = timeline_.size() >= 2;
+        auto range_end = to;
+        if (has_events) {
+            const auto& events = timeline_.events();
+            auto range_start = std::max(from, events.timestampAt(0));
+            range_end = std::min(to, events.timestampAt(events.size() - 1) + std::chrono::milliseconds(1));
+            has_events = range_start < range_end;
+        }
+
+        int64_t night_span = has_events ? time_zone.toCivil(range_end).night_index - first_night + 1 : 0;
+        nights.reserve((sealed_end - sealed) +
+                       std::min(timeline_.gaps().size(), static_cast<size_t>(std::max<int64_t>(night_span, 0))));
+
+        if (has_events) {
+            // Single pass over the gap index: longest sleep-like gap per unsealed night
+            auto min_gap = minimumGapOf(prefs);
+            int64_t current_night = first_night;
+            const TimeGap* best = nullptr;
+            auto flushBest = [&]() {
+                if (best) {
+                    flushSealedBefore(current_night);
+                    nights.push_back(NightSlot{current_night, best, FinalizedSessionStore::NPOS});
+                    best = nullptr;
+                }
+            };
+
+            for (const auto& gap : timeline_.gaps()) {
+                if (!(gap.start_time < range_end)) {
+                    break;
+                }
+                if (!gap.isLikelySleep(min_gap)) {
+                    continue;
+                }
+                int64_t night = time_zone.toCivil(gap.start_time).night_index;
+                if (night < first_night || finalized_.contains(night)) {
+                    continue;
+                }
+                if (night != current_night) {
+                    flushBest();
+                    current_night = night;
+                }
+                if (!best || gap.duration > best->duration) {
+                    best = &gap;
+                }
+            }
+            flushBest();
+        }
+        flushSealedBefore(INT64_MAX);
+
+        return nights;
+    }
+
+    void SleepDetector::evaluateNights(const UserPreferences& prefs,
+                                       const NightSlot* nights,
+                                       size_t count,
+                                       SleepDetectionResult* results) const {
+
+        // Sealed nights are loaded; only the others need evaluation
+        ArenaVector<size_t> pending{ArenaAllocator<size_t>(scratch_)};
+        pending.reserve(count);
+        for (size_t i = 0; i < count; ++i) {
+            if (nights[i].sealed != FinalizedSessionStore::NPOS) {
+                finalized_.load(nights[i].sealed, results[i]);
+            } else {
+                pending.push_back(i);
+            }
+        }
+
+        // Nights are independent: evaluate them in parallel. The timeline is
+        // only read (gap index already refreshed) while the lock is held.
+        // One captured pointer keeps the std::function in its inline buffer.
+        struct NightBatch {
+            const SleepDetector* detector;
+            const UserPreferences* prefs;
+            const NightSlot* nights;
+            const size_t* pending;
+            SleepDetectionResult* results;
+        } batch{this, &prefs, nights, pending.data(), results};
+
+        ThreadPool::shared().parallelFor(pending.size(), [&batch](size_t k) {
+            size_t i = batch.pending[k];
+            batch.results[i] = batch.detector->buildSleepResult(
+                    batch.detector->timeline_, *batch.prefs,
+                    batch.nights[i].gap->start_time, batch.nights[i].gap->end_time);
+        });
+
+        // Seal and learn the nights the timeline or the clock has moved
+        // past, oldest first; open nights are learned once they are sealed
+        auto now = clock_->now();
+        for (size_t i : pending) {
+            if (isNightSealable(nights[i].night_index, now) &&
+                finalized_.seal(nights[i].night_index, results[i])) {
+                learnFromDetection(results[i]);
+            }
+        }
+    }
+
+    bool SleepDetector::isNightSealable(int64_t night_index,
+                                        const std::chrono::system_clock::time_point& current_time) const noexcept {
+        if (timeline_.empty()) {
+            return false;
+        }
+        auto window_end = TimeZoneContext::shared().nightWindowStartOf(night_index + 1);
+        auto newest = timeline_.events().timestampAt(timeline_.size() - 1);
+        return !(newest < window_end) || !(current_time < window_end);
+    }
+
+    size_t SleepDetector::sealNight(const UserPreferences& prefs, int64_t night_index) const {
+        // Same choice as the batch path: the night's longest sleep-like gap
+        auto& time_zone = TimeZoneContext::shared();
+        auto min_gap = minimumGapOf(prefs);
+        const auto& gaps = timeline_.gaps();
+        const TimeGap* best = nullptr;
+
+        for (auto it = gaps.rbegin(); it != gaps.rend(); ++it) {
+            int64_t night = time_zone.toCivil(it->start_time).night_index;
+            if (night < night_index) {
+                break;
+            }
+            if (night == night_index && it->isLikelySleep(min_gap) &&
+                (!best || !(it->duration < best->duration))) {
+                best = &*it;
+            }
+        }
+        if (!best) {
+            return FinalizedSessionStore::NPOS;
+        }
+
+        SleepDetectionResult result = buildSleepResult(timeline_, prefs, best->start_time, best->end_time);
+        if (!finalized_.seal(night_index, result)) {
+            return FinalizedSessionStore::NPOS;
+        }
+
+        // Already counted if it was detected live while in progress
+        if (night_index != counted_live_night_) {
+            total_sleep_periods_detected_++;
+        }
+        learnFromDetection(result);
+
+        SLEEP_LOG_INFO(LOG_TAG, "Night sealed: %.1f hours, confidence=%s",
+                       result.duration.count(), result.getConfidenceString());
+
+        return finalized_.find(night_index);
+    }
+
     double SleepDetector::calculateConfidenceScore(const SleepDetectionResult& session) const noexcept {
         MEASURE_PERFORMANCE("SleepDetector::calculateConfidenceScore");
 
+        auto prefs = preferences_.read();
+        return calculateConfidenceScore(session, *prefs);
+    }
+
+    double SleepDetector::calculateConfidenceScore(const SleepDetectionResult& session,
+                                                   const UserPreferences& prefs) const noexcept {
         if (!session.isValid()) {
             return 0.0;
         }
@@ -165,8 +673,7 @@ namespace puuyapu {
         }
 
         // Duration reasonableness (20%)
-        auto prefs = preferences_.load();
-        double target_hours = prefs->target_sleep_hours.count();
+        double target_hours = prefs.target_sleep_hours.count();
         double actual_hours = session.duration.count();
         double duration_diff = std::abs(actual_hours - target_hours);
         double duration_score = std::max(0.0, 1.0 - (duration_diff / target_hours));
@@ -196,37 +703,289 @@ namespace puuyapu {
             return;
         }
 
-        // Update atomic pointer
-        *preferences_storage_ = new_preferences;
-        preferences_.store(preferences_storage_.get());
+        // Publish a new snapshot. The gap index and the cached result pick up
+        // the change lazily: both are checked against the snapshot per query.
+        if (preferences_.update(new_preferences)) {
+            SLEEP_LOG_INFO(LOG_TAG, "User preferences updated: target sleep %.1f hours",
+                           new_preferences.target_sleep_hours.count());
+        } else {
+            SLEEP_LOG_DEBUG(LOG_TAG, "User preferences updated, detection inputs unchanged");
+        }
+    }
+
+    size_t SleepDetector::attachEventLog(std::unique_ptr<EventLog> event_log) noexcept {
+        MEASURE_PERFORMANCE("SleepDetector::attachEventLog");
+        ScopedMetricTimer metric(MetricId::ATTACH_EVENT_LOG);
+
+        if (!event_log || !event_log->isOpen()) {
+            return 0;
+        }
+
+        std::lock_guard<std::mutex> lock(events_mutex_);
 
-        // Invalidate cache since preferences changed
+        // Bulk load straight from the mapped segments (already in time order);
+        // after a snapshot restore only the frames appended since
+        auto restore = [this](const InteractionEvent& event) {
+            if (timeline_.insert(event)) {
+                retainAfterInsert(event);
+            }
+        };
+        size_t restored = snapshot_log_position_ ? event_log->forEachAfter(*snapshot_log_position_, restore)
+                                                 : event_log->forEach(restore);
+        snapshot_log_position_.reset();
+
+        // Events queued before attach are newer than the stored history
+        event_log_ = std::move(event_log);
+        drainIngress();
         cached_result_.reset();
 
-        SLEEP_LOG_INFO(LOG_TAG, "User preferences updated: target sleep %.1f hours",
-                       new_preferences.target_sleep_hours.count());
+        SLEEP_LOG_INFO(LOG_TAG, "Restored %zu events from event log", restored);
+
+        return restored;
+    }
+
+    bool SleepDetector::attachSnapshot(const std::string& path) noexcept {
+        MEASURE_PERFORMANCE("SleepDetector::attachSnapshot");
+        ScopedMetricTimer metric(MetricId::RESTORE_SNAPSHOT);
+
+        {
+            std::lock_guard<std::mutex> lock(events_mutex_);
+            snapshot_path_ = path;
+            if (!timeline_.empty() || !finalized_.empty()) {
+                SLEEP_LOG_ERROR(LOG_TAG, "Detector already has history, snapshot not restored");
+                return false;
+            }
+        }
+
+        DetectorSnapshot snapshot;
+        if (!snapshot.open(path)) {
+            return false;
+        }
+
+        // Decode everything first: a malformed section leaves the detector untouched
+        SnapshotReader reader;
+        UserPreferences prefs;
+        bool has_prefs = snapshot.section(SnapshotSection::PREFERENCES, reader) && readPreferences(reader, prefs);
+
+        RetentionPolicy retention;
+        if (snapshot.section(SnapshotSection::RETENTION, reader)) {
+            uint64_t max_raw_events = 0;
+            if (!reader.get(retention.raw_nights) || !reader.get(retention.summary_nights) ||
+                !reader.get(retention.session_nights) || !reader.get(max_raw_events)) {
+                return false;
+            }
+            retention.max_raw_events = static_cast<size_t>(max_raw_events);
+        }
+        retention = retention.clamped();
+
+        uint64_t counters[4] = {};
+        if (snapshot.section(SnapshotSection::COUNTERS, reader)) {
+            for (uint64_t& counter : counters) {
+                if (!reader.get(counter)) {
+                    return false;
+                }
+            }
+        }
+
+        PatternMatcher patterns;
+        FinalizedSessionStore sessions;
+        sessions.setCapacity(retention.session_nights);
+        NightSummaryStore summaries;
+        summaries.setCapacity(retention.summary_nights);
+        ActivityEpochStore activity;
+        if ((snapshot.section(SnapshotSection::PATTERNS, reader) && !patterns.readFrom(reader)) ||
+            (snapshot.section(SnapshotSection::SESSIONS, reader) && !sessions.readFrom(reader)) ||
+            (snapshot.section(SnapshotSection::SUMMARIES, reader) && !summaries.readFrom(reader)) ||
+            (snapshot.section(SnapshotSection::ACTIVITY, reader) && !activity.readFrom(reader))) {
+            SLEEP_LOG_ERROR(LOG_TAG, "Snapshot %s has a malformed section, not restored", path.c_str());
+            return false;
+        }
+
+        // Events are decoded straight from the mapping into the timeline
+        SnapshotReader events;
+        uint32_t event_count = 0;
+        if (snapshot.section(SnapshotSection::EVENTS, events) &&
+            (!events.getCount(event_count, InteractionEvent::SERIALIZED_SIZE) ||
+             events.remaining() != static_cast<size_t>(event_count) * InteractionEvent::SERIALIZED_SIZE)) {
+            return false;
+        }
+
+        std::optional<EventLog::Position> log_position;
+        if (snapshot.section(SnapshotSection::EVENT_LOG_POSITION, reader)) {
+            EventLog::Position position;
+            if (!reader.get(position.sequence) || !reader.get(position.frames)) {
+                return false;
+            }
+            log_position = position;
+        }
+
+        size_t sealed_nights = 0;
+        size_t learned_sessions = 0;
+        {
+            // The timeline is built with the snapshot's gap and classification
+            auto current = preferences_.read();
+            const UserPreferences& active = has_prefs ? prefs : *current;
+
+            std::lock_guard<std::mutex> lock(events_mutex_);
+            if (!timeline_.empty() || !finalized_.empty()) {
+                SLEEP_LOG_ERROR(LOG_TAG, "Detector gained history during restore, snapshot not restored");
+                return false;
+            }
+
+            retention_ = retention;
+            pattern_matcher_ = patterns;
+            finalized_ = std::move(sessions);
+            summaries_ = std::move(summaries);
+            activity_ = std::move(activity);
+            snapshot_log_position_ = log_position;
+
+            total_events_processed_.store(static_cast<size_t>(counters[0]));
+            total_sleep_periods_detected_.store(static_cast<size_t>(counters[1]));
+            confidence_sum_micros_.store(counters[2], std::memory_order_relaxed);
+            confidence_samples_.store(counters[3], std::memory_order_relaxed);
+
+            syncTimeline(active);
+            for (uint32_t i = 0; i < event_count; ++i) {
+                InteractionEvent event = InteractionEvent::deserialize(events.view(InteractionEvent::SERIALIZED_SIZE));
+                if (timeline_.insert(event)) {
+                    retainAfterInsert(event);
+                }
+            }
+
+            // Night indices follow the current zone, which may have changed while the process was gone
+            finalized_.rekey();
+            next_retention_check_ms_ = INT64_MIN;
+
+            drainIngress();
+            cached_result_.reset();
+
+            sealed_nights = finalized_.size();
+            learned_sessions = pattern_matcher_.getSessionCount();
+        }
+
+        // Published only once the restore is committed (update waits for
+        // readers, so neither under the lock nor with a guard held)
+        if (has_prefs) {
+            preferences_.update(prefs);
+        }
+
+        SLEEP_LOG_INFO(LOG_TAG, "Snapshot restored: %u events, %zu sealed nights, %zu learned sessions",
+                       event_count, sealed_nights, learned_sessions);
+        return true;
+    }
+
+    bool SleepDetector::writeSnapshot() const noexcept {
+        MEASURE_PERFORMANCE("SleepDetector::writeSnapshot");
+        ScopedMetricTimer metric(MetricId::WRITE_SNAPSHOT);
+
+        std::lock_guard<std::mutex> snapshot_lock(snapshot_mutex_);
+
+        SnapshotWriter writer;
+        std::string path;
+        {
+            auto prefs = preferences_.read();
+
+            std::lock_guard<std::mutex> lock(events_mutex_);
+            if (snapshot_path_.empty()) {
+                return false;
+            }
+            path = snapshot_path_;
+            drainIngress();
+
+            writer.beginSection(SnapshotSection::PREFERENCES);
+            writePreferences(writer, *prefs);
+
+            writer.beginSection(SnapshotSection::RETENTION);
+            writer.put(retention_.raw_nights);
+            writer.put(retention_.summary_nights);
+            writer.put(retention_.session_nights);
+            writer.put(static_cast<uint64_t>(retention_.max_raw_events));
+
+            writer.beginSection(SnapshotSection::COUNTERS);
+            writer.put(static_cast<uint64_t>(total_events_processed_.load()));
+            writer.put(static_cast<uint64_t>(total_sleep_periods_detected_.load()));
+            writer.put(confidence_sum_micros_.load(std::memory_order_relaxed));
+            writer.put(confidence_samples_.load(std::memory_order_relaxed));
+
+            writer.beginSection(SnapshotSection::PATTERNS);
+            pattern_matcher_.writeTo(writer);
+
+            writer.beginSection(SnapshotSection::SESSIONS);
+            finalized_.writeTo(writer);
+
+            writer.beginSection(SnapshotSection::SUMMARIES);
+            summaries_.writeTo(writer);
+
+            writer.beginSection(SnapshotSection::ACTIVITY);
+            activity_.writeTo(writer);
+
+            const EventColumnStore& events = timeline_.events();
+            writer.beginSection(SnapshotSection::EVENTS);
+            writer.put(static_cast<uint32_t>(events.size()));
+            uint8_t* records = writer.reserve(events.size() * InteractionEvent::SERIALIZED_SIZE);
+            for (size_t i = 0; i < events.size(); ++i) {
+                events.eventAt(i).serialize(records + i * InteractionEvent::SERIALIZED_SIZE);
+            }
+
+            // Every applied event is logged under this lock, so the timeline covers the log up to here
+            if (event_log_) {
+                EventLog::Position position = event_log_->endPosition();
+                writer.beginSection(SnapshotSection::EVENT_LOG_POSITION);
+                writer.put(position.sequence);
+                writer.put(position.frames);
+            }
+        }
+
+        if (!writer.writeFile(path, toEpochMs(clock_->now()))) {
+            return false;
+        }
+        SLEEP_LOG_DEBUG(LOG_TAG, "Snapshot written: %zu bytes", writer.size());
+        return true;
+    }
+
+    PreferenceSnapshot SleepDetector::getPreferenceSnapshot() const noexcept {
+        auto prefs = preferences_.read();
+        return prefs.snapshot();
+    }
+
+    ClassificationPolicy SleepDetector::getClassificationPolicy() const noexcept {
+        auto prefs = preferences_.read();
+        return ClassificationPolicy::fromPreferences(*prefs);
+    }
+
+    void SleepDetector::onTimeZoneChanged() noexcept {
+        TimeZoneContext::shared().invalidate();
+
+        std::lock_guard<std::mutex> lock(events_mutex_);
+        cached_result_.reset();
+
+        // Sealed results stay; only their night windows move. Summaries keep
+        // the windows they were cut with.
+        finalized_.rekey();
+        next_retention_check_ms_ = INT64_MIN;
+
+        SLEEP_LOG_INFO(LOG_TAG, "Timezone changed, civil time cache refreshed");
     }
 
     bool SleepDetector::isCurrentlyAsleep(
             const std::chrono::system_clock::time_point& current_time) const noexcept {
 
         MEASURE_PERFORMANCE("SleepDetector::isCurrentlyAsleep");
+        ScopedMetricTimer metric(MetricId::IS_CURRENTLY_ASLEEP);
 
-        auto events = getSortedEvents();
-        if (events.empty()) {
-            return false;
-        }
+        auto prefs = preferences_.read();
 
-        // Check time since last meaningful interaction
-        auto last_meaningful = std::find_if(events.rbegin(), events.rend(),
-                                            [](const InteractionEvent& e) { return e.isMeaningfulUse(); });
+        std::lock_guard<std::mutex> lock(events_mutex_);
+        syncTimeline(*prefs);
+        drainIngress();
 
-        if (last_meaningful == events.rend()) {
+        // Check time since last meaningful interaction (tracked per event)
+        size_t last_meaningful = timeline_.lastMeaningful();
+        if (last_meaningful == EventTimeline::NPOS) {
             return false;
         }
 
-        auto time_since_last = current_time - last_meaningful->timestamp;
-        auto prefs = preferences_.load();
+        auto time_since_last = current_time - timeline_.events().timestampAt(last_meaningful);
 
         // Simple heuristic: if no meaningful interaction for minimum gap duration
         return time_since_last >= prefs->minimum_interaction_gap;
@@ -240,46 +999,96 @@ namespace puuyapu {
             return std::nullopt;
         }
 
-        auto events = getSortedEvents();
-        return findSleepStartTime(events, current_time);
+        auto prefs = preferences_.read();
+
+        std::lock_guard<std::mutex> lock(events_mutex_);
+        syncTimeline(*prefs);
+        drainIngress();
+        return findSleepStartTime(timeline_, *prefs, current_time);
+    }
+
+    StateTransition SleepDetector::getNextStateTransition(
+            const std::chrono::system_clock::time_point& current_time) const noexcept {
+
+        ScopedMetricTimer metric(MetricId::NEXT_STATE_TRANSITION);
+
+        auto prefs = preferences_.read();
+
+        std::lock_guard<std::mutex> lock(events_mutex_);
+        syncTimeline(*prefs);
+        drainIngress();
+
+        StateTransition next;
+
+        // Without meaningful use there is no anchor to measure inactivity from
+        size_t last_meaningful = timeline_.lastMeaningful();
+        if (last_meaningful == EventTimeline::NPOS) {
+            return next;
+        }
+
+        // Open sleep: only a meaningful event can end it
+        auto onset = timeline_.events().timestampAt(last_meaningful) + prefs->minimum_interaction_gap;
+        if (!(current_time < onset)) {
+            return next;
+        }
+        next = StateTransition{StateTransitionKind::SLEEP_ONSET, onset};
+
+        // Awake after a completed sleep: its night is final at the window end
+        auto min_gap = minimumGapOf(*prefs);
+        const auto& gaps = timeline_.gaps();
+        for (auto it = gaps.rbegin(); it != gaps.rend(); ++it) {
+            if (it->isLikelySleep(min_gap)) {
+                auto& time_zone = TimeZoneContext::shared();
+                int64_t night = time_zone.toCivil(it->start_time).night_index;
+                auto night_end = time_zone.nightWindowStartOf(night + 1);
+                if (!isNightSealable(night, current_time) && night_end < next.at) {
+                    next = StateTransition{StateTransitionKind::NIGHT_FINALIZED, night_end};
+                }
+                break;
+            }
+        }
+
+        return next;
     }
 
     void SleepDetector::clearOldData(
             const std::chrono::system_clock::time_point& cutoff_time) noexcept {
 
         MEASURE_PERFORMANCE("SleepDetector::clearOldData");
+        ScopedMetricTimer metric(MetricId::CLEAR_OLD_DATA);
 
         std::lock_guard<std::mutex> lock(events_mutex_);
+        drainIngress();
 
-        size_t original_size = recent_events_.size();
+        [[maybe_unused]] size_t original_size = timeline_.size();
 
-        // Remove events older than cutoff
-        recent_events_.erase(
-                std::remove_if(recent_events_.begin(), recent_events_.end(),
-                               [cutoff_time](const InteractionEvent& event) {
-                                   return event.timestamp < cutoff_time;
-                               }),
-                recent_events_.end()
-        );
+        // Whole nights before the cutoff keep their session and summary
+        auto prefs = preferences_.read();
+        auto& time_zone = TimeZoneContext::shared();
+        while (!timeline_.empty()) {
+            int64_t oldest = time_zone.toCivil(timeline_.events().timestampAt(0)).night_index;
+            if (cutoff_time < time_zone.nightWindowStartOf(oldest + 1)) {
+                break;
+            }
+            compactNight(*prefs, oldest);
+        }
 
-        // Reset circular buffer state if needed
-        if (recent_events_.size() < Performance::MAX_EVENTS_CACHE) {
-            event_buffer_full_ = false;
-            event_write_index_ = 0;
+        // Events are ordered, so this only drops a prefix
+        timeline_.eraseBefore(cutoff_time);
+        activity_.eraseBefore(toEpochMs(cutoff_time));
+        if (event_log_) {
+            event_log_->dropSegmentsBefore(cutoff_time);
         }
 
         // Invalidate cache
         cached_result_.reset();
 
         SLEEP_LOG_DEBUG(LOG_TAG, "Cleared old data: %zu -> %zu events",
-                        original_size, recent_events_.size());
+                        original_size, timeline_.size());
     }
 
-    std::unordered_map<std::string, std::chrono::microseconds>
-    SleepDetector::getPerformanceMetrics() const {
-
-        std::lock_guard<std::mutex> lock(metrics_mutex_);
-        return performance_metrics_;
+    MetricsSnapshot SleepDetector::getPerformanceMetrics() const noexcept {
+        return Metrics::snapshot();
     }
 
     void SleepDetector::confirmManualSleep(
@@ -305,44 +1114,123 @@ namespace puuyapu {
         stats.total_events_processed = total_events_processed_.load();
         stats.total_sleep_periods_detected = total_sleep_periods_detected_.load();
 
-        // Calculate average confidence from recent detections
-        // This would require maintaining a history, simplified for now
-        stats.average_confidence_score = 0.75; // Placeholder
+        // Average raw confidence over freshly detected periods
+        uint64_t confidence_samples = confidence_samples_.load(std::memory_order_relaxed);
+        stats.average_confidence_score = confidence_samples > 0
+                ? static_cast<double>(confidence_sum_micros_.load(std::memory_order_relaxed)) /
+                  (1e6 * static_cast<double>(confidence_samples))
+                : 0.0;
 
-        // Get average detection time from performance metrics
+        // Mean detection latency from the metrics registry
         auto metrics = getPerformanceMetrics();
-        auto it = metrics.find("SleepDetector::detectSleepPeriod");
-        stats.average_detection_time = (it != metrics.end()) ? it->second : std::chrono::microseconds(0);
+        stats.average_detection_time = std::chrono::duration_cast<std::chrono::microseconds>(
+                metrics[MetricId::DETECT_SLEEP_PERIOD].mean);
+
+        // Cache effectiveness
+        stats.cache_hits = cache_hits_.load(std::memory_order_relaxed);
+        stats.cache_misses = cache_misses_.load(std::memory_order_relaxed);
+        uint64_t lookups = stats.cache_hits + stats.cache_misses;
+        stats.cache_hit_rate = lookups > 0
+                ? static_cast<double>(stats.cache_hits) / static_cast<double>(lookups)
+                : 0.0;
+
+        // Ingress health
+        stats.ingress_pending_events = ingress_.pendingCount();
+        stats.ingress_dropped_events = ingress_dropped_events_.load();
+        stats.ingress_overflow_drains = ingress_overflow_drains_.load();
 
-        // Calculate cache hit rate (simplified)
-        stats.cache_hit_rate = 0.8; // Placeholder
+        {
+            std::lock_guard<std::mutex> sensor_lock(sensor_mutex_);
+            stats.dropped_motion_samples = reducer_.droppedSamples();
+        }
 
         // Estimate memory usage
         std::lock_guard<std::mutex> lock(events_mutex_);
-        stats.current_memory_usage_bytes = recent_events_.size() * sizeof(InteractionEvent);
+        stats.current_memory_usage_bytes = timeline_.memoryUsageBytes() +
+                                           ingress_.capacity() * sizeof(InteractionEvent) +
+                                           scratch_.capacityBytes() +
+                                           finalized_.memoryUsageBytes() +
+                                           summaries_.memoryUsageBytes() +
+                                           activity_.memoryUsageBytes();
+
+        // Learned schedule
+        stats.learned_sleep_sessions = pattern_matcher_.getSessionCount();
+        stats.schedule_regularity = pattern_matcher_.getScheduleRegularity();
+        stats.finalized_nights = finalized_.size();
+        stats.summarized_nights = summaries_.size();
+        stats.activity_epochs = activity_.size();
 
         return stats;
     }
 
-    void SleepDetector::optimizeMemory() noexcept {
-        MEASURE_PERFORMANCE("SleepDetector::optimizeMemory");
+    SleepDetector::SleepStatistics SleepDetector::getSleepStatistics(
+            const std::chrono::system_clock::time_point& from,
+            const std::chrono::system_clock::time_point& to) const {
 
-        // Clear old performance metrics
-        {
-            std::lock_guard<std::mutex> lock(metrics_mutex_);
-            performance_metrics_.clear();
+        SleepStatistics statistics{};
+        statistics.target_sleep_hours = preferences_.read()->target_sleep_hours.count();
+        if (!(from < to)) {
+            return statistics;
+        }
+
+        // Every night window overlapping [from, to): a range ending on a
+        // window boundary keeps its last night, one ending mid-night keeps that night
+        auto& time_zone = TimeZoneContext::shared();
+        int64_t first_night = time_zone.toCivil(from).night_index;
+        int64_t end_night = time_zone.toCivil(to - std::chrono::milliseconds(1)).night_index + 1;
+
+        std::lock_guard<std::mutex> lock(events_mutex_);
+        const SessionAggregateIndex& index = finalized_.aggregates();
+        statistics.range = index.range(first_night, end_night);
+        for (int weekday = 0; weekday < SessionAggregateIndex::WEEKDAYS; ++weekday) {
+            statistics.by_weekday[static_cast<size_t>(weekday)] = index.weekday(first_night, end_night, weekday);
+        }
+        return statistics;
+    }
+
+    void SleepDetector::setRetentionPolicy(const RetentionPolicy& policy) noexcept {
+        std::lock_guard<std::mutex> lock(events_mutex_);
+        drainIngress();
+
+        retention_ = policy.clamped();
+        summaries_.setCapacity(retention_.summary_nights);
+        finalized_.setCapacity(retention_.session_nights);
+
+        // Re-evaluated against the new raw window on the spot
+        next_retention_check_ms_ = INT64_MIN;
+        if (!timeline_.empty()) {
+            enforceRetention(timeline_.events().timestampAt(timeline_.size() - 1));
         }
 
-        // Clear old events (keep last 7 days)
-        auto cutoff_time = std::chrono::system_clock::now() - std::chrono::hours(24 * 7);
-        clearOldData(cutoff_time);
+        SLEEP_LOG_INFO(LOG_TAG, "Retention: %u raw nights (%zu events), %u summaries, %u sessions",
+                       retention_.raw_nights, retention_.max_raw_events,
+                       retention_.summary_nights, retention_.session_nights);
+    }
+
+    RetentionPolicy SleepDetector::getRetentionPolicy() const noexcept {
+        std::lock_guard<std::mutex> lock(events_mutex_);
+        return retention_;
+    }
+
+    void SleepDetector::optimizeMemory() noexcept {
+        MEASURE_PERFORMANCE("SleepDetector::optimizeMemory");
 
-        // Shrink vectors to fit
+        // Reset performance counters
+        Metrics::reset();
+        cache_hits_.store(0, std::memory_order_relaxed);
+        cache_misses_.store(0, std::memory_order_relaxed);
+
+        // Move nights past the raw tier into summaries, then shrink to fit
         {
             std::lock_guard<std::mutex> lock(events_mutex_);
-            recent_events_.shrink_to_fit();
+            drainIngress();
+            enforceRetention(clock_->now());
+            timeline_.shrinkToFit();
+            scratch_.release();
         }
 
+        writeSnapshot();
+
         SLEEP_LOG_INFO(LOG_TAG, "Memory optimization completed");
     }
 
@@ -350,37 +1238,240 @@ namespace puuyapu {
 // Private Helper Methods
 // ============================================================================
 
+    SleepDetectionResult SleepDetector::buildSleepResult(
+            const EventTimeline& timeline,
+            const UserPreferences& prefs,
+            const std::chrono::system_clock::time_point& sleep_start,
+            const std::chrono::system_clock::time_point& sleep_end) const noexcept {
+
+        SleepDetectionResult result;
+        result.bedtime = sleep_start;
+        result.wake_time = sleep_end;
+
+        // Calculate duration
+        result.duration = std::chrono::duration<double, std::ratio<3600>>(
+                calculateDurationHours(sleep_start, sleep_end)
+        );
+
+        // Analyze interruptions
+        result.interruptions = analyzeInterruptions(timeline, sleep_start, sleep_end);
+
+        // Calculate quality and confidence
+        result.quality_score = calculateSleepQuality(result.interruptions,
+                                                     std::chrono::duration_cast<std::chrono::milliseconds>(sleep_end - sleep_start));
+        // Pattern match first: it is one of the confidence factors
+        result.pattern_match_score = evaluatePatternConsistency(prefs, sleep_start, sleep_end);
+        // Still fraction of the sampled epochs scales it when motion data covers the night
+        double motion_factor = activity_.coverage(toEpochMs(sleep_start), toEpochMs(sleep_end)).confidenceFactor();
+        result.confidence = static_cast<SleepConfidence>(
+                std::min(4, static_cast<int>(calculateConfidenceScore(result, prefs) * motion_factor * 5))
+        );
+
+        // Check for manual confirmation within 30 minutes of bedtime
+        EventRange confirmation_window = timeline.rangeInclusive(sleep_start - std::chrono::minutes(30),
+                                                                 sleep_start + std::chrono::minutes(30));
+        if (confirmation_window.containsType(InteractionType::SLEEP_CONFIRMATION)) {
+            result.is_manually_confirmed = true;
+            result.confidence = SleepConfidence::VERY_HIGH;
+        }
+
+        return result;
+    }
+
+    bool SleepDetector::applyEvent(const InteractionEvent& event) const noexcept {
+        // Ordered insert; updates the gap index incrementally
+        if (!timeline_.insert(event)) {
+            return false;
+        }
+
+        if (event_log_) {
+            event_log_->append(event);
+        }
+        retainAfterInsert(event);
+        return true;
+    }
+
+    size_t SleepDetector::enforceRetention(std::chrono::system_clock::time_point reference) const {
+        if (timeline_.empty()) {
+            return 0;
+        }
+
+        auto& time_zone = TimeZoneContext::shared();
+        auto newest = std::max(reference, timeline_.events().timestampAt(timeline_.size() - 1));
+        int64_t newest_night = time_zone.toCivil(newest).night_index;
+        next_retention_check_ms_ = std::chrono::duration_cast<std::chrono::milliseconds>(
+                time_zone.nightWindowStartOf(newest_night + 1).time_since_epoch()).count();
+
+        int64_t keep_from = newest_night - static_cast<int64_t>(retention_.raw_nights) + 1;
+        size_t compacted = 0;
+        auto prefs = preferences_.read();
+
+        while (!timeline_.empty()) {
+            int64_t oldest = time_zone.toCivil(timeline_.events().timestampAt(0)).night_index;
+            bool over_budget = timeline_.size() > retention_.max_raw_events;
+            if (!(oldest < keep_from || (over_budget && oldest < newest_night))) {
+                break;
+            }
+            compactNight(*prefs, oldest);
+            compacted++;
+        }
+
+        if (compacted > 0) {
+            cached_result_.reset();
+            TRACE_COUNTER("PuuyApu.nights_summarized", summaries_.size());
+            SLEEP_LOG_DEBUG(LOG_TAG, "Retention compacted %zu nights, %zu raw events left",
+                            compacted, timeline_.size());
+        }
+        return compacted;
+    }
+
+    void SleepDetector::compactNight(const UserPreferences& prefs, int64_t night_index) const {
+        auto& time_zone = TimeZoneContext::shared();
+        auto window_start = time_zone.nightWindowStartOf(night_index);
+        auto window_end = time_zone.nightWindowStartOf(night_index + 1);
+
+        // The session tier outlives the summary: seal before the gaps go
+        if (!finalized_.contains(night_index)) {
+            sealNight(prefs, night_index);
+        }
+
+        // Everything before the window end: the oldest event is in this night
+        const auto& events = timeline_.events();
+        EventRange night(events, 0, timeline_.lowerBound(window_end));
+        int64_t window_start_ms = std::chrono::duration_cast<std::chrono::milliseconds>(
+                window_start.time_since_epoch()).count();
+
+        NightSummary summary;
+        summary.night_index = night_index;
+        summary.first_event_ms = events.timestampMsAt(night.begin());
+        summary.last_event_ms = events.timestampMsAt(night.end() - 1);
+        summary.event_count = static_cast<uint32_t>(night.size());
+        summary.time_checks = static_cast<uint32_t>(night.timeCheckCount());
+        summary.meaningful = static_cast<uint32_t>(night.countFlags(EVENT_FLAG_MEANINGFUL));
+        summary.sleep_related = static_cast<uint32_t>(night.countFlags(EVENT_FLAG_SLEEP_RELATED));
+
+        for (size_t i = night.begin(); i < night.end(); ++i) {
+            uint8_t flags = events.flagsAt(i);
+
+            size_t type = static_cast<size_t>(events.typeAt(i));
+            if (type < NightSummary::TYPE_COUNT) {
+                summary.type_counts[type]++;
+            }
+
+            if (flags & EVENT_FLAG_BRIEF) {
+                summary.brief++;
+                int64_t hour = (events.timestampMsAt(i) - window_start_ms) / (60 * 60 * 1000);
+                size_t bucket = static_cast<size_t>(std::min<int64_t>(std::max<int64_t>(hour, 0),
+                                                                      NightSummary::HISTOGRAM_BUCKETS - 1));
+                if (summary.interruption_histogram[bucket] < UINT16_MAX) {
+                    summary.interruption_histogram[bucket]++;
+                }
+            }
+        }
+
+        // Gaps are chronological; the night's are the leading ones
+        const auto& gaps = timeline_.gaps();
+        size_t gap_count = 0;
+        while (gap_count < gaps.size() && gaps[gap_count].start_time < window_end) {
+            gap_count++;
+        }
+        summaries_.add(summary, gaps.data(), gap_count);
+
+        timeline_.eraseBefore(window_end);
+    }
+
+    void SleepDetector::syncTimeline(const UserPreferences& prefs) const noexcept {
+        // Ingested events are classified with the new policy from here on;
+        // retained ones are reclassified once, only if the policy changed
+        timeline_.setClassificationPolicy(ClassificationPolicy::fromPreferences(prefs));
+        timeline_.setMinimumGap(minimumGapOf(prefs));
+    }
+
+    size_t SleepDetector::drainIngress() const noexcept {
+        InteractionEvent event;
+        size_t drained = 0;
+        size_t limit = ingress_.capacity();
+
+        while (drained < limit && ingress_.tryPop(event)) {
+            applyEvent(event);
+            drained++;
+        }
+
+        if (drained > 0) {
+            // Invalidate cache when new events arrive
+            cached_result_.reset();
+            TRACE_COUNTER("PuuyApu.events_buffered", drained);
+        }
+
+        return drained;
+    }
+
+    void SleepDetector::rankCandidates(
+            const EventTimeline& timeline,
+            const UserPreferences& prefs,
+            SleepCandidateRanking& ranking) const noexcept {
+
+        TRACE_SECTION("SleepDetector::rankCandidates");
+
+        auto min_gap = minimumGapOf(prefs);
+        const auto& gaps = timeline.gaps();
+
+        // Gather newest first; the batch scores all lanes at once
+        candidate_batch_.clear();
+        std::optional<std::chrono::system_clock::time_point> window_start;
+        for (auto it = gaps.rbegin(); it != gaps.rend() && !candidate_batch_.full(); ++it) {
+            if (!it->isLikelySleep(min_gap)) {
+                continue;
+            }
+            if (!window_start) {
+                window_start = it->end_time - Performance::SLEEP_CANDIDATE_WINDOW;
+            }
+            if (it->start_time < *window_start) {
+                break;
+            }
+
+            InterruptionLoad load = measureInterruptions(timeline.rangeBetween(it->start_time, it->end_time));
+            EventRange confirmation_window = timeline.rangeInclusive(it->start_time - std::chrono::minutes(30),
+                                                                     it->start_time + std::chrono::minutes(30));
+            candidate_batch_.add(it->start_time, it->end_time,
+                                 evaluatePatternConsistency(prefs, it->start_time, it->end_time),
+                                 load.quality(),
+                                 isNighttime(it->start_time),
+                                 confirmation_window.containsType(InteractionType::SLEEP_CONFIRMATION),
+                                 activity_.coverage(toEpochMs(it->start_time), toEpochMs(it->end_time)).confidenceFactor());
+        }
+
+        candidate_batch_.score(prefs.target_sleep_hours.count(), ranking);
+    }
+
     std::optional<std::chrono::system_clock::time_point>
     SleepDetector::findSleepStartTime(
-            const InteractionEventList& events,
+            const EventTimeline& timeline,
+            const UserPreferences& prefs,
             const std::chrono::system_clock::time_point& current_time) const noexcept {
 
-        if (events.empty()) {
+        if (timeline.empty()) {
             return std::nullopt;
         }
 
-        auto prefs = preferences_.load();
+        auto min_gap = minimumGapOf(prefs);
 
-        // Look for gaps in meaningful interactions
-        auto gaps = detectInteractionGaps(events,
-                                          std::chrono::duration_cast<std::chrono::milliseconds>(prefs->minimum_interaction_gap));
+        // Gaps in meaningful interactions are maintained as events arrive
+        const auto& gaps = timeline.gaps();
 
         // Find the most recent gap that could be sleep
         for (auto it = gaps.rbegin(); it != gaps.rend(); ++it) {
-            if (it->isLikelySleep(std::chrono::duration_cast<std::chrono::milliseconds>(
-                    prefs->minimum_interaction_gap))) {
+            if (it->isLikelySleep(min_gap)) {
                 return it->start_time;
             }
         }
 
         // If no gaps found, check if last meaningful interaction was long enough ago
-        auto last_meaningful = std::find_if(events.rbegin(), events.rend(),
-                                            [](const InteractionEvent& e) { return e.isMeaningfulUse(); });
-
-        if (last_meaningful != events.rend()) {
-            auto time_since = current_time - last_meaningful->timestamp;
-            if (time_since >= prefs->minimum_interaction_gap) {
-                return last_meaningful->timestamp;
+        size_t last_meaningful = timeline.lastMeaningful();
+        if (last_meaningful != EventTimeline::NPOS) {
+            auto last_time = timeline.events().timestampAt(last_meaningful);
+            if (current_time - last_time >= prefs.minimum_interaction_gap) {
+                return last_time;
             }
         }
 
@@ -389,18 +1480,14 @@ namespace puuyapu {
 
     std::optional<std::chrono::system_clock::time_point>
     SleepDetector::findSleepEndTime(
-            const InteractionEventList& events,
+            const EventTimeline& timeline,
             const std::chrono::system_clock::time_point& sleep_start,
             const std::chrono::system_clock::time_point& current_time) const noexcept {
 
         // Find first meaningful interaction after sleep start
-        auto wake_event = std::find_if(events.begin(), events.end(),
-                                       [sleep_start](const InteractionEvent& e) {
-                                           return e.timestamp > sleep_start && e.isMeaningfulUse();
-                                       });
-
-        if (wake_event != events.end()) {
-            return wake_event->timestamp;
+        size_t wake_index = timeline.nextMeaningful(timeline.upperBound(sleep_start));
+        if (wake_index != EventTimeline::NPOS) {
+            return timeline.events().timestampAt(wake_index);
         }
 
         // If no wake event found, user might still be sleeping
@@ -408,55 +1495,75 @@ namespace puuyapu {
     }
 
     SleepInterruptionList SleepDetector::analyzeInterruptions(
-            const InteractionEventList& events,
+            const EventTimeline& timeline,
             const std::chrono::system_clock::time_point& sleep_start,
             const std::chrono::system_clock::time_point& sleep_end) const noexcept {
 
         SleepInterruptionList interruptions;
 
-        // Find all interactions between sleep start and end
-        for (const auto& event : events) {
-            if (event.timestamp > sleep_start && event.timestamp < sleep_end) {
-                // Check if this is a brief interruption vs sleep end
-                if (event.isTimeCheck() || event.duration < std::chrono::seconds(120)) {
-                    SleepInterruption interruption{
-                            event.timestamp,
-                            event.duration,
-                            event.type,
-                            event.category
-                    };
-                    interruptions.push_back(interruption);
-                }
+        // Only visit interactions strictly between sleep start and end
+        const auto& events = timeline.events();
+        EventRange night = timeline.rangeBetween(sleep_start, sleep_end);
+        for (size_t i = night.begin(); i < night.end(); ++i) {
+            // Check if this is a brief interruption vs sleep end
+            if (events.isTimeCheckAt(i) || events.durationAt(i) < std::chrono::seconds(120)) {
+                SleepInterruption interruption{
+                        events.timestampAt(i),
+                        events.durationAt(i),
+                        events.typeAt(i),
+                        events.categoryAt(i),
+                        events.isBriefAt(i)
+                };
+                interruptions.push_back(interruption);
             }
         }
 
+        // Movement no screen event explains (awake with the phone face-down)
+        activity_.forEachActiveRun(toEpochMs(sleep_start), toEpochMs(sleep_end), [&](int64_t run_start, int64_t run_end) {
+            auto start = fromEpochMs(run_start);
+            auto end = fromEpochMs(run_end);
+            if (!timeline.rangeInclusive(start, end).empty()) {
+                return;
+            }
+            SleepInterruption interruption{
+                    start,
+                    std::chrono::milliseconds(run_end - run_start),
+                    InteractionType::UNKNOWN,
+                    AppCategory::UNKNOWN,
+                    run_end - run_start <= ActivityEpoch::DURATION_MS
+            };
+            auto position = std::upper_bound(interruptions.begin(), interruptions.end(), start,
+                                             [](std::chrono::system_clock::time_point at, const SleepInterruption& other) {
+                                                 return at < other.timestamp;
+                                             });
+            interruptions.insert(position, interruption);
+        });
+
         return interruptions;
     }
 
     bool SleepDetector::canUseCachedResult(
-            const std::chrono::system_clock::time_point& current_time) const noexcept {
+            const std::chrono::system_clock::time_point& current_time,
+            uint64_t detection_generation) const noexcept {
 
-        if (!cached_result_.has_value()) {
+        if (!cached_result_.has_value() || cached_generation_ != detection_generation) {
             return false;
         }
 
-        auto time_since_cache = current_time - last_cache_update_;
-        return time_since_cache < CACHE_VALIDITY_DURATION;
+        return !(current_time < cached_valid_from_) && current_time < cached_valid_until_;
     }
 
     double SleepDetector::evaluatePatternConsistency(
+            const UserPreferences& prefs,
             const std::chrono::system_clock::time_point& sleep_start,
             const std::chrono::system_clock::time_point& sleep_end) const noexcept {
 
-        auto prefs = preferences_.load();
-
-        // Get current day of week for bedtime comparison
-        auto time_t = std::chrono::system_clock::to_time_t(sleep_start);
-        auto tm = *std::localtime(&time_t);
-        auto expected_bedtime = prefs->getBedtimeForDay(tm.tm_wday);
+        // Day of week and bedtime from one civil conversion
+        CivilTime civil = TimeZoneContext::shared().toCivil(sleep_start);
+        auto expected_bedtime = prefs.getBedtimeForDay(civil.weekday);
 
         // Calculate actual bedtime in minutes since midnight
-        auto actual_bedtime = getMinutesSinceMidnight(sleep_start);
+        auto actual_bedtime = std::chrono::minutes(civil.minute_of_day);
 
         // Calculate deviation from expected bedtime
         auto bedtime_diff = std::abs((actual_bedtime - expected_bedtime).count());
@@ -464,74 +1571,27 @@ namespace puuyapu {
 
         // Calculate duration consistency
         double actual_duration = calculateDurationHours(sleep_start, sleep_end);
-        double target_duration = prefs->target_sleep_hours.count();
+        double target_duration = prefs.target_sleep_hours.count();
         double duration_diff = std::abs(actual_duration - target_duration);
         double duration_score = std::max(0.0, 1.0 - (duration_diff / target_duration));
 
-        // Combined score
-        return (bedtime_score + duration_score) / 2.0;
-    }
-
-    void SleepDetector::recordPerformanceMetric(
-            const std::string& operation,
-            std::chrono::microseconds duration) const noexcept {
+        double preference_score = (bedtime_score + duration_score) / 2.0;
 
-        std::lock_guard<std::mutex> lock(metrics_mutex_);
-
-        // Update rolling average
-        auto it = performance_metrics_.find(operation);
-        if (it != performance_metrics_.end()) {
-            // Simple rolling average
-            it->second = std::chrono::microseconds((it->second.count() + duration.count()) / 2);
-        } else {
-            performance_metrics_[operation] = duration;
+        // Learned schedule takes over as the weekday's profile gains confidence
+        double learned_weight = pattern_matcher_.getPatternConfidence(civil.weekday);
+        if (learned_weight <= 0.0) {
+            return preference_score;
         }
+        double learned_score = pattern_matcher_.calculatePatternMatch(sleep_start, sleep_end);
+        return preference_score * (1.0 - learned_weight) + learned_score * learned_weight;
     }
 
-    InteractionEventList SleepDetector::getSortedEvents() const {
-        std::lock_guard<std::mutex> lock(events_mutex_);
-
-        InteractionEventList sorted_events = recent_events_;
-        std::sort(sorted_events.begin(), sorted_events.end());
-
-        return sorted_events;
-    }
-
-    TimeGapList SleepDetector::detectInteractionGaps(
-            const InteractionEventList& events,
-            std::chrono::milliseconds min_gap_duration) const noexcept {
-
-        TimeGapList gaps;
-
-        if (events.size() < 2) {
-            return gaps;
-        }
-
-        // Find gaps between consecutive meaningful interactions
-        auto prev_meaningful = events.begin();
-        for (auto it = events.begin() + 1; it != events.end(); ++it) {
-            if (it->isMeaningfulUse()) {
-                auto gap_duration = it->timestamp - prev_meaningful->timestamp;
-
-                if (gap_duration >= min_gap_duration) {
-                    TimeGap gap(prev_meaningful->timestamp, it->timestamp);
-
-                    // Count brief interactions in gap
-                    for (auto gap_it = prev_meaningful + 1; gap_it != it; ++gap_it) {
-                        if (gap_it->isTimeCheck()) {
-                            gap.contains_brief_interactions = true;
-                            gap.brief_interaction_count++;
-                        }
-                    }
-
-                    gaps.push_back(gap);
-                }
-
-                prev_meaningful = it;
-            }
+    bool SleepDetector::learnFromDetection(const SleepDetectionResult& result) const noexcept {
+        if (!result.isValid() ||
+            (!result.is_manually_confirmed && result.confidence < SleepConfidence::MEDIUM)) {
+            return false;
         }
-
-        return gaps;
+        return pattern_matcher_.updatePatterns(result);
     }
 
     double SleepDetector::calculateSleepQuality(
@@ -558,133 +1618,4 @@ namespace puuyapu {
         return std::max(0.0, std::min(1.0, quality));
     }
 
-// ============================================================================
-// Utility Functions
-// ============================================================================
-
-    bool isWithinDailyTimeRange(
-            const std::chrono::system_clock::time_point& time_point,
-            std::chrono::minutes range_start,
-            std::chrono::minutes range_end) noexcept {
-
-        auto minutes = getMinutesSinceMidnight(time_point);
-
-        if (range_start <= range_end) {
-            // Normal range (e.g., 9:00 to 17:00)
-            return minutes >= range_start && minutes <= range_end;
-        } else {
-            // Overnight range (e.g., 22:00 to 06:00)
-            return minutes >= range_start || minutes <= range_end;
-        }
-    }
-
-    std::chrono::minutes getMinutesSinceMidnight(
-            const std::chrono::system_clock::time_point& time_point) noexcept {
-
-        auto time_t = std::chrono::system_clock::to_time_t(time_point);
-        auto tm = *std::localtime(&time_t);
-
-        return std::chrono::minutes(tm.tm_hour * 60 + tm.tm_min);
-    }
-
-    bool isNighttime(const std::chrono::system_clock::time_point& time_point) noexcept {
-        // Define nighttime as 22:00 to 06:00
-        return isWithinDailyTimeRange(time_point,
-                                      std::chrono::minutes(22 * 60), // 22:00
-                                      std::chrono::minutes(6 * 60)   // 06:00
-        );
-    }
-
-// ============================================================================
-// InteractionAnalyzer Implementation
-// ============================================================================
-
-    InteractionType InteractionAnalyzer::classifyInteraction(
-            const InteractionEvent& event,
-            const InteractionEventList& recent_history) noexcept {
-
-        // If already classified, return as-is
-        if (event.type != InteractionType::UNKNOWN) {
-            return event.type;
-        }
-
-        // Classify based on duration
-        if (event.duration < std::chrono::seconds(15)) {
-            return InteractionType::TIME_CHECK;
-        } else if (event.duration < std::chrono::seconds(30)) {
-            // Check context - if user just had long session, this might be continuation
-            if (!recent_history.empty()) {
-                auto last_event = recent_history.back();
-                auto time_gap = event.timestamp - last_event.timestamp;
-
-                if (time_gap < std::chrono::minutes(2) &&
-                    last_event.type == InteractionType::MEANINGFUL_USE) {
-                    return InteractionType::MEANINGFUL_USE;
-                }
-            }
-            return InteractionType::TIME_CHECK;
-        } else if (event.duration < std::chrono::minutes(5)) {
-            return InteractionType::MEANINGFUL_USE;
-        } else {
-            return InteractionType::EXTENDED_USE;
-        }
-    }
-
-    TimeGapList InteractionAnalyzer::detectInteractionGaps(
-            const InteractionEventList& events,
-            std::chrono::milliseconds minimum_gap) noexcept {
-
-        TimeGapList gaps;
-
-        if (events.size() < 2) {
-            return gaps;
-        }
-
-        // Events should already be sorted, but ensure it
-        auto sorted_events = events;
-        std::sort(sorted_events.begin(), sorted_events.end());
-
-        for (size_t i = 1; i < sorted_events.size(); ++i) {
-            auto gap_duration = sorted_events[i].timestamp - sorted_events[i-1].timestamp;
-
-            if (gap_duration >= minimum_gap) {
-                TimeGap gap(sorted_events[i-1].timestamp, sorted_events[i].timestamp);
-                gaps.push_back(gap);
-            }
-        }
-
-        return gaps;
-    }
-
-    bool InteractionAnalyzer::detectSleepPattern(
-            const InteractionEventList& events,
-            const UserPreferences& preferences) noexcept {
-
-        if (events.empty()) {
-            return false;
-        }
-
-        // Find last meaningful interaction
-        auto last_meaningful = std::find_if(events.rbegin(), events.rend(),
-                                            [](const InteractionEvent& e) { return e.isMeaningfulUse(); });
-
-        if (last_meaningful == events.rend()) {
-            return false;
-        }
-
-        // Check if enough time has passed since last meaningful interaction
-        auto now = std::chrono::system_clock::now();
-        auto time_since_last = now - last_meaningful->timestamp;
-
-        return time_since_last >= preferences.minimum_interaction_gap;
-    }
-
-    bool InteractionAnalyzer::isTimeCheck(const InteractionEvent& event) noexcept {
-        return event.isTimeCheck();
-    }
-
-    bool InteractionAnalyzer::isMeaningfulUsage(const InteractionEvent& event) noexcept {
-        return event.isMeaningfulUse();
-    }
-
 } // namespace puuyapu
\ No newline at end of file
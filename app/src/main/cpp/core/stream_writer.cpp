@@ -0,0 +1,148 @@
+/**
+ * @file stream_writer.cpp
+ * @brief Implementation of the buffered export writer
+ */
+
+#include "stream_writer.h"
+#include "time_utils.h"
+#include <algorithm>
+#include <cerrno>
+#include <charconv>
+#include <cmath>
+#include <unistd.h>
+
+namespace puuyapu {
+
+    namespace {
+        constexpr uint64_t POWERS_OF_TEN[] = {
+                1ULL, 10ULL, 100ULL, 1000ULL, 10000ULL, 100000ULL,
+                1000000ULL, 10000000ULL, 100000000ULL, 1000000000ULL,
+        };
+
+        constexpr int64_t MILLIS_PER_SECOND = 1000;
+        constexpr int64_t MILLIS_PER_DAY = 86400 * MILLIS_PER_SECOND;
+
+        int64_t floorDiv(int64_t value, int64_t divisor) noexcept {
+            int64_t quotient = value / divisor;
+            return (value % divisor != 0 && (value < 0) != (divisor < 0)) ? quotient - 1 : quotient;
+        }
+    }
+
+    bool FdSink::write(const char* data, size_t size) noexcept {
+        while (size > 0) {
+            ssize_t written = ::write(fd_, data, size);
+            if (written < 0) {
+                if (errno == EINTR) {
+                    continue;
+                }
+                return false;
+            }
+            data += written;
+            size -= static_cast<size_t>(written);
+        }
+        return true;
+    }
+
+// ============================================================================
+// StreamWriter Implementation
+// ============================================================================
+
+    StreamWriter& StreamWriter::write(const char* data, size_t size) noexcept {
+        while (size > 0) {
+            if (used_ == BUFFER_BYTES) {
+                flush();
+            }
+            size_t chunk = std::min(size, BUFFER_BYTES - used_);
+            std::memcpy(buffer_ + used_, data, chunk);
+            used_ += chunk;
+            data += chunk;
+            size -= chunk;
+        }
+        return *this;
+    }
+
+    StreamWriter& StreamWriter::writeInt(int64_t value) noexcept {
+        char* out = reserve(20);
+        used_ = static_cast<size_t>(std::to_chars(out, buffer_ + BUFFER_BYTES, value).ptr - buffer_);
+        return *this;
+    }
+
+    StreamWriter& StreamWriter::writeUnsigned(uint64_t value) noexcept {
+        char* out = reserve(20);
+        used_ = static_cast<size_t>(std::to_chars(out, buffer_ + BUFFER_BYTES, value).ptr - buffer_);
+        return *this;
+    }
+
+    StreamWriter& StreamWriter::writePadded(uint64_t value, int width) noexcept {
+        char digits[20];
+        auto length = static_cast<int>(std::to_chars(digits, digits + sizeof(digits), value).ptr - digits);
+
+        char* out = reserve(static_cast<size_t>(std::max(width, length)));
+        for (int i = length; i < width; ++i) {
+            *out++ = '0';
+        }
+        std::memcpy(out, digits, static_cast<size_t>(length));
+        used_ = static_cast<size_t>(out + length - buffer_);
+        return *this;
+    }
+
+    StreamWriter& StreamWriter::writeFixed(double value, int precision) noexcept {
+        precision = std::min(std::max(precision, 0), 9);
+
+        // Integer fixed-point: no locale, no printf, exact decimal digits
+        double scaled = std::round(std::fabs(value) * static_cast<double>(POWERS_OF_TEN[precision]));
+        if (!std::isfinite(scaled) || scaled >= 9.0e18) {
+            scaled = 0.0;
+        }
+        auto units = static_cast<uint64_t>(scaled);
+
+        if (value < 0 && units != 0) {
+            write('-');
+        }
+        writeUnsigned(units / POWERS_OF_TEN[precision]);
+        if (precision > 0) {
+            write('.');
+            writePadded(units % POWERS_OF_TEN[precision], precision);
+        }
+        return *this;
+    }
+
+    StreamWriter& StreamWriter::writeIsoTimestamp(std::chrono::system_clock::time_point time_point) noexcept {
+        int64_t millis = std::chrono::duration_cast<std::chrono::milliseconds>(
+                time_point.time_since_epoch()).count();
+        int64_t day = floorDiv(millis, MILLIS_PER_DAY);
+        int64_t millis_of_day = millis - day * MILLIS_PER_DAY;
+        CivilDate date = civilFromDays(day);
+
+        int64_t seconds_of_day = millis_of_day / MILLIS_PER_SECOND;
+
+        writeInt(date.year).write('-');
+        writePadded(date.month, 2).write('-');
+        writePadded(date.day, 2).write('T');
+        writePadded(static_cast<uint64_t>(seconds_of_day / 3600), 2).write(':');
+        writePadded(static_cast<uint64_t>(seconds_of_day / 60 % 60), 2).write(':');
+        writePadded(static_cast<uint64_t>(seconds_of_day % 60), 2).write('.');
+        writePadded(static_cast<uint64_t>(millis_of_day % MILLIS_PER_SECOND), 3).write('Z');
+        return *this;
+    }
+
+    StreamWriter& StreamWriter::writeLocalDate(std::chrono::system_clock::time_point time_point) noexcept {
+        CivilDate date = civilFromDays(TimeZoneContext::shared().toCivil(time_point).local_day);
+
+        writeInt(date.year).write('-');
+        writePadded(date.month, 2).write('-');
+        writePadded(date.day, 2);
+        return *this;
+    }
+
+    bool StreamWriter::flush() noexcept {
+        if (used_ > 0) {
+            if (ok_) {
+                ok_ = sink_.write(buffer_, used_);
+            }
+            used_ = 0;
+        }
+        return ok_;
+    }
+
+} // namespace puuyapu
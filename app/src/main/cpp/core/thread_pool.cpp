@@ -0,0 +1,114 @@
+/**
+ * @file thread_pool.cpp
+ * @brief Implementation of the analysis worker pool
+ */
+
+#include "thread_pool.h"
+#include <algorithm>
+
+namespace puuyapu {
+
+    ThreadPool::ThreadPool(size_t worker_count) {
+        workers_.reserve(worker_count);
+        for (size_t i = 0; i < worker_count; ++i) {
+            workers_.emplace_back([this] { workerLoop(); });
+        }
+    }
+
+    ThreadPool::~ThreadPool() noexcept {
+        {
+            std::lock_guard<std::mutex> lock(mutex_);
+            stopping_ = true;
+        }
+        work_available_.notify_all();
+
+        for (auto& worker : workers_) {
+            worker.join();
+        }
+    }
+
+    ThreadPool& ThreadPool::shared() noexcept {
+        static ThreadPool pool([] {
+            size_t cores = std::thread::hardware_concurrency();
+            return std::min<size_t>(cores > 1 ? cores - 1 : 0, 3);
+        }());
+        return pool;
+    }
+
+    void ThreadPool::parallelFor(size_t count, const std::function<void(size_t)>& body) noexcept {
+        if (count == 0) {
+            return;
+        }
+
+        // Not worth a wake-up round trip
+        if (workers_.empty() || count == 1) {
+            for (size_t i = 0; i < count; ++i) {
+                body(i);
+            }
+            return;
+        }
+
+        // Another detector owns the pool: run on this thread instead of
+        // queueing behind it, so independent detectors never serialize
+        std::unique_lock<std::mutex> submit_lock(submit_mutex_, std::try_to_lock);
+        if (!submit_lock.owns_lock()) {
+            for (size_t i = 0; i < count; ++i) {
+                body(i);
+            }
+            return;
+        }
+
+        {
+            std::lock_guard<std::mutex> lock(mutex_);
+            body_ = &body;
+            count_ = count;
+            next_item_.store(0, std::memory_order_relaxed);
+            pending_workers_ = workers_.size();
+            generation_++;
+        }
+        work_available_.notify_all();
+
+        // The caller works too
+        runItems();
+
+        std::unique_lock<std::mutex> lock(mutex_);
+        work_done_.wait(lock, [this] { return pending_workers_ == 0; });
+        body_ = nullptr;
+    }
+
+// ============================================================================
+// Private Helper Methods
+// ============================================================================
+
+    void ThreadPool::workerLoop() noexcept {
+        uint64_t seen_generation = 0;
+
+        std::unique_lock<std::mutex> lock(mutex_);
+        for (;;) {
+            work_available_.wait(lock, [&] { return stopping_ || generation_ != seen_generation; });
+            if (stopping_) {
+                return;
+            }
+            seen_generation = generation_;
+
+            lock.unlock();
+            runItems();
+            lock.lock();
+
+            if (--pending_workers_ == 0) {
+                work_done_.notify_one();
+            }
+        }
+    }
+
+    void ThreadPool::runItems() noexcept {
+        const auto& body = *body_;
+        size_t count = count_;
+
+        for (size_t i = next_item_.fetch_add(1, std::memory_order_relaxed); i < count;
+             i = next_item_.fetch_add(1, std::memory_order_relaxed)) {
+            body(i);
+        }
+    }
+
+} // namespace puuyapu
@@ -11,6 +11,217 @@
 
 namespace puuyapu {
 
+    namespace {
+        constexpr int64_t SECONDS_PER_DAY = 86400;
+        constexpr int64_t NOON_SECONDS = 12 * 3600;
+        constexpr int64_t SPAN_SEARCH_DAYS = 366;
+
+        int64_t floorDiv(int64_t value, int64_t divisor) noexcept {
+            int64_t quotient = value / divisor;
+            return (value % divisor != 0 && (value < 0) != (divisor < 0)) ? quotient - 1 : quotient;
+        }
+
+        int64_t epochSeconds(std::chrono::system_clock::time_point time_point) noexcept {
+            auto since_epoch = time_point.time_since_epoch();
+            auto seconds = std::chrono::duration_cast<std::chrono::seconds>(since_epoch);
+            if (seconds > since_epoch) {
+                seconds -= std::chrono::seconds(1);
+            }
+            return seconds.count();
+        }
+
+        std::atomic<uint64_t> system_lookups{0};
+
+        /// Slow path: ask libc (thread-safe variant)
+        int32_t systemOffsetAt(int64_t epoch_seconds) noexcept {
+            system_lookups.fetch_add(1, std::memory_order_relaxed);
+            auto time_t = static_cast<std::time_t>(epoch_seconds);
+            std::tm tm{};
+            localtime_r(&time_t, &tm);
+            return static_cast<int32_t>(tm.tm_gmtoff);
+        }
+
+        /**
+         * @brief First second in (from, to] whose offset differs from from's
+         * Requires offsets at from and to to differ.
+         */
+        int64_t bisectTransition(int64_t from, int64_t to, int32_t from_offset) noexcept {
+            while (to - from > 1) {
+                int64_t middle = from + (to - from) / 2;
+                if (systemOffsetAt(middle) == from_offset) {
+                    from = middle;
+                } else {
+                    to = middle;
+                }
+            }
+            return to;
+        }
+    }
+
+// ============================================================================
+// TimeZoneContext Implementation
+// ============================================================================
+
+    TimeZoneContext& TimeZoneContext::shared() noexcept {
+        static TimeZoneContext context;
+        return context;
+    }
+
+    CivilTime TimeZoneContext::toCivil(std::chrono::system_clock::time_point time_point) noexcept {
+        int64_t seconds = epochSeconds(time_point);
+        int32_t offset = utcOffsetAt(time_point);
+
+        int64_t local = seconds + offset;
+        int64_t day = floorDiv(local, SECONDS_PER_DAY);
+        int64_t second_of_day = local - day * SECONDS_PER_DAY;
+
+        CivilTime civil{};
+        civil.minute_of_day = static_cast<int>(second_of_day / 60);
+        civil.weekday = static_cast<int>(((day % 7) + 7 + 4) % 7);    // 1970-01-01 was a Thursday
+        civil.local_day = day;
+        civil.night_index = floorDiv(local - NOON_SECONDS, SECONDS_PER_DAY);
+        civil.utc_offset_seconds = offset;
+        return civil;
+    }
+
+    int32_t TimeZoneContext::utcOffsetAt(std::chrono::system_clock::time_point time_point) noexcept {
+        int64_t seconds = epochSeconds(time_point);
+
+        int32_t offset;
+        if (tryCached(seconds, offset)) {
+            return offset;
+        }
+
+        // Outside every cached span: cache the one containing this instant
+        refresh(seconds);
+        if (tryCached(seconds, offset)) {
+            return offset;
+        }
+
+        // A concurrent invalidate() dropped it again
+        return systemOffsetAt(seconds);
+    }
+
+    std::chrono::system_clock::time_point TimeZoneContext::nightWindowStart(
+            std::chrono::system_clock::time_point time_point) noexcept {
+        return nightWindowStartOf(toCivil(time_point).night_index);
+    }
+
+    std::chrono::system_clock::time_point TimeZoneContext::nightWindowStartOf(int64_t night_index) noexcept {
+        int64_t local_noon = night_index * SECONDS_PER_DAY + NOON_SECONDS;
+
+        // Offset guessed at the local reading, corrected once if a transition lies in between
+        auto resolve = [this](int64_t seconds) {
+            return utcOffsetAt(std::chrono::system_clock::time_point(std::chrono::seconds(seconds)));
+        };
+        int32_t guess = resolve(local_noon);
+        int64_t utc = local_noon - guess;
+        int32_t actual = resolve(utc);
+        if (actual != guess) {
+            utc = local_noon - actual;
+        }
+
+        return std::chrono::system_clock::time_point(std::chrono::seconds(utc));
+    }
+
+    uint64_t TimeZoneContext::systemLookupCount() noexcept {
+        return system_lookups.load(std::memory_order_relaxed);
+    }
+
+    void TimeZoneContext::invalidate() noexcept {
+        std::lock_guard<std::mutex> lock(refresh_mutex_);
+        tzset();
+
+        uint64_t sequence = sequence_.load(std::memory_order_relaxed);
+        sequence_.store(sequence + 1, std::memory_order_relaxed);
+        std::atomic_thread_fence(std::memory_order_release);
+        for (Span& span : spans_) {
+            span.begin.store(0, std::memory_order_relaxed);
+            span.end.store(0, std::memory_order_relaxed);
+        }
+        sequence_.store(sequence + 2, std::memory_order_release);
+        next_slot_ = 0;
+    }
+
+// ============================================================================
+// Private Helper Methods
+// ============================================================================
+
+    bool TimeZoneContext::tryCached(int64_t epoch_seconds, int32_t& offset_seconds) const noexcept {
+        uint64_t before = sequence_.load(std::memory_order_acquire);
+        if (before & 1) {
+            return false;
+        }
+
+        bool found = false;
+        int32_t offset = 0;
+        for (const Span& span : spans_) {
+            if (epoch_seconds >= span.begin.load(std::memory_order_relaxed) &&
+                epoch_seconds < span.end.load(std::memory_order_relaxed)) {
+                offset = span.offset.load(std::memory_order_relaxed);
+                found = true;
+                break;
+            }
+        }
+
+        std::atomic_thread_fence(std::memory_order_acquire);
+        if (!found || sequence_.load(std::memory_order_relaxed) != before) {
+            return false;
+        }
+        offset_seconds = offset;
+        return true;
+    }
+
+    void TimeZoneContext::refresh(int64_t epoch_seconds) noexcept {
+        std::lock_guard<std::mutex> lock(refresh_mutex_);
+
+        // Another thread may have cached it while we waited
+        for (const Span& span : spans_) {
+            if (epoch_seconds >= span.begin.load(std::memory_order_relaxed) &&
+                epoch_seconds < span.end.load(std::memory_order_relaxed)) {
+                return;
+            }
+        }
+
+        int32_t offset = systemOffsetAt(epoch_seconds);
+
+        // Walk day by day to the neighbouring transitions, then bisect to the second
+        int64_t end = epoch_seconds + SPAN_SEARCH_DAYS * SECONDS_PER_DAY;
+        for (int64_t day = 1; day <= SPAN_SEARCH_DAYS; ++day) {
+            int64_t probe = epoch_seconds + day * SECONDS_PER_DAY;
+            if (systemOffsetAt(probe) != offset) {
+                end = bisectTransition(probe - SECONDS_PER_DAY, probe, offset);
+                break;
+            }
+        }
+
+        int64_t begin = epoch_seconds - SPAN_SEARCH_DAYS * SECONDS_PER_DAY;
+        for (int64_t day = 1; day <= SPAN_SEARCH_DAYS; ++day) {
+            int64_t probe = epoch_seconds - day * SECONDS_PER_DAY;
+            int32_t probe_offset = systemOffsetAt(probe);
+            if (probe_offset != offset) {
+                begin = bisectTransition(probe, probe + SECONDS_PER_DAY, probe_offset);
+                break;
+            }
+        }
+
+        uint64_t sequence = sequence_.load(std::memory_order_relaxed);
+        sequence_.store(sequence + 1, std::memory_order_relaxed);
+        std::atomic_thread_fence(std::memory_order_release);
+        Span& slot = spans_[next_slot_];
+        slot.begin.store(begin, std::memory_order_relaxed);
+        slot.end.store(end, std::memory_order_relaxed);
+        slot.offset.store(offset, std::memory_order_relaxed);
+        sequence_.store(sequence + 2, std::memory_order_release);
+        next_slot_ = (next_slot_ + 1) % SPAN_SLOTS;
+
+        refresh_count_.fetch_add(1, std::memory_order_relaxed);
+    }
+
+// ============================================================================
+// Utility Functions
+// ============================================================================
+
     bool isWithinDailyTimeRange(
             const std::chrono::system_clock::time_point& time_point,
             std::chrono::minutes range_start,
@@ -30,10 +241,7 @@ namespace puuyapu {
     std::chrono::minutes getMinutesSinceMidnight(
             const std::chrono::system_clock::time_point& time_point) noexcept {
 
-        auto time_t = std::chrono::system_clock::to_time_t(time_point);
-        auto tm = *std::localtime(&time_t);
-
-        return std::chrono::minutes(tm.tm_hour * 60 + tm.tm_min);
+        return std::chrono::minutes(TimeZoneContext::shared().toCivil(time_point).minute_of_day);
     }
 
     bool isNighttime(const std::chrono::system_clock::time_point& time_point) noexcept {
@@ -44,12 +252,4 @@ namespace puuyapu {
         );
     }
 
-    double calculateDurationHours(
-            const std::chrono::system_clock::time_point& start,
-            const std::chrono::system_clock::time_point& end) noexcept {
-
-        auto duration = end - start;
-        return std::chrono::duration<double, std::ratio<3600>>(duration).count();
-    }
-
-} // namespace puuyapu
\ No newline at end of file
+} // namespace puuyapu
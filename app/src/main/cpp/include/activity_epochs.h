@@ -0,0 +1,327 @@
+/**
+ * @file activity_epochs.h
+ * @brief Streaming reduction of accelerometer samples to 30-second activity epochs
+ *
+ * Screen interactions cannot tell a user lying awake with the phone
+ * face-down from one asleep; movement can. Samples arrive at 25-50 Hz
+ * (millions per night), so they are never stored: each batch is
+ * deinterleaved into a stack block, converted to g, and folded into the
+ * open epoch by a SIMD kernel (NEON, SSE2 or scalar) that computes the
+ * vector magnitude, its excess over gravity (ENMO, the usual actigraphy
+ * measure) and how many samples deviate from 1 g by more than the
+ * movement threshold. Only the finished 16-byte epochs are kept, in a
+ * fixed ring, so the path runs in constant memory.
+ *
+ * Epochs are a second evidence stream for SleepDetector: active epochs
+ * that no screen event explains become interruptions, and the still
+ * fraction of a sleep window scales its confidence.
+ *
+ * Reducer: one producer at a time (SleepDetector serializes it).
+ * Store: not thread-safe, owned by SleepDetector under its event lock.
+ *
+ * @performance Target: < 5 nanoseconds per sample, no allocation per batch
+ */
+
+#pragma once
+
+#include "puuyapu_types.h"
+#include "detector_snapshot.h"
+#include <cstdint>
+#include <cstring>
+#include <vector>
+
+#if defined(__ANDROID__)
+#include <android/sensor.h>
+#endif
+
+namespace puuyapu {
+
+    /**
+     * @brief Packed accelerometer record of the direct ByteBuffer ingest path
+     *
+     * Layout (24 bytes, little-endian): i64 timestamp (ns, sensor clock:
+     * SensorEvent.timestamp / elapsedRealtimeNanos), f32 x, y, z (m/s^2),
+     * u32 reserved (0).
+     */
+    struct AccelerometerRecord {
+        static constexpr size_t SERIALIZED_SIZE = 24;
+
+        int64_t timestamp_ns;
+        float x;
+        float y;
+        float z;
+
+        static AccelerometerRecord deserialize(const uint8_t* data) noexcept {
+            AccelerometerRecord record;
+            std::memcpy(&record.timestamp_ns, data, sizeof(int64_t));
+            std::memcpy(&record.x, data + 8, sizeof(float));
+            std::memcpy(&record.y, data + 12, sizeof(float));
+            std::memcpy(&record.z, data + 16, sizeof(float));
+            return record;
+        }
+    };
+
+    /**
+     * @brief One 30-second activity epoch (16 bytes)
+     */
+    struct ActivityEpoch {
+        static constexpr int64_t DURATION_MS = 30000;
+
+        int64_t start_ms{0};            ///< Wall clock, a multiple of DURATION_MS
+        uint16_t sample_count{0};
+        uint16_t active_samples{0};     ///< Samples deviating from 1 g past the movement threshold
+        uint16_t mean_enmo_mg{0};       ///< Mean max(0, |a| - 1 g), milli-g
+        uint16_t peak_deviation_mg{0};  ///< Largest | |a| - 1 g |, milli-g
+
+        /**
+         * @brief Movement in at least a tenth of the epoch (and two samples)
+         */
+        bool isActive() const noexcept {
+            return active_samples >= 2 && active_samples * 10u >= sample_count;
+        }
+
+        int64_t endMs() const noexcept { return start_ms + DURATION_MS; }
+    };
+
+    /**
+     * @brief Kernel output for a run of samples
+     */
+    struct MotionAccumulator {
+        double enmo_sum{0.0};           ///< g
+        uint32_t active{0};
+        float peak_deviation{0.0f};     ///< g
+    };
+
+    /**
+     * @brief Fold samples (in g) into an accumulator
+     * @param threshold_g Deviation from 1 g that counts as movement
+     * @performance < 1 nanosecond per sample (SIMD)
+     */
+    void accumulateMotion(const float* x, const float* y, const float* z, size_t count,
+                          float threshold_g, MotionAccumulator& accumulator) noexcept;
+
+    /**
+     * @brief Name of the compiled motion kernel ("neon", "sse2" or "scalar")
+     */
+    const char* motionKernelBackend() noexcept;
+
+    /**
+     * @brief Structure-of-arrays sample block, decoded on the stack
+     */
+    struct AccelerometerBlock {
+        static constexpr size_t CAPACITY = 256;
+
+        alignas(16) float x[CAPACITY];
+        alignas(16) float y[CAPACITY];
+        alignas(16) float z[CAPACITY];
+        int64_t timestamp_ns[CAPACITY];     ///< Wall clock
+        size_t count{0};
+    };
+
+    /**
+     * @brief Decode up to one block of packed records (m/s^2 to g)
+     * @param clock_offset_ns Wall clock minus sensor clock, in nanoseconds
+     * @return Records consumed
+     */
+    size_t decodeAccelerometerRecords(const uint8_t* records, size_t count,
+                                      int64_t clock_offset_ns, AccelerometerBlock& block) noexcept;
+
+#if defined(__ANDROID__)
+    /**
+     * @brief Decode up to one block of ASensorEvents, skipping other sensor types
+     * @return Events consumed
+     */
+    size_t decodeSensorEvents(const ASensorEvent* events, size_t count,
+                              int64_t clock_offset_ns, AccelerometerBlock& block) noexcept;
+#endif
+
+    /**
+     * @brief Streaming epoch builder: O(1) state, one open epoch
+     *
+     * Timestamps must not go backwards across the open epoch; older samples
+     * are dropped. An epoch is emitted when the first sample of a later
+     * epoch arrives (or on flush), so epochs with no samples do not exist.
+     */
+    class ActivityEpochReducer {
+    public:
+        static constexpr float MOVEMENT_THRESHOLD_G = 0.04f;
+
+        /**
+         * @brief Fold a decoded block, emitting finished epochs
+         * @param emit Callable as emit(const ActivityEpoch&)
+         */
+        template<typename Emit>
+        void add(const AccelerometerBlock& block, Emit&& emit) {
+            size_t i = 0;
+            while (i < block.count) {
+                int64_t timestamp = block.timestamp_ns[i];
+                if (open_ && timestamp < open_start_ns_) {
+                    dropped_samples_++;
+                    i++;
+                    continue;
+                }
+                if (open_ && !(timestamp < open_end_ns_)) {
+                    emit(close());
+                }
+                if (!open_) {
+                    open(timestamp);
+                }
+
+                // Run of samples inside the open epoch goes through the kernel at once
+                size_t run_end = i + 1;
+                while (run_end < block.count && block.timestamp_ns[run_end] < open_end_ns_ &&
+                       !(block.timestamp_ns[run_end] < open_start_ns_)) {
+                    run_end++;
+                }
+                accumulateMotion(block.x + i, block.y + i, block.z + i, run_end - i,
+                                 MOVEMENT_THRESHOLD_G, accumulator_);
+                open_samples_ += static_cast<uint32_t>(run_end - i);
+                i = run_end;
+            }
+        }
+
+        /**
+         * @brief Emit the open epoch, if any
+         */
+        template<typename Emit>
+        void flush(Emit&& emit) {
+            if (open_) {
+                emit(close());
+            }
+        }
+
+        uint64_t droppedSamples() const noexcept { return dropped_samples_; }
+
+    private:
+        /// Open the epoch containing a wall-clock instant (the only division per epoch)
+        void open(int64_t timestamp_ns) noexcept;
+        ActivityEpoch close() noexcept;
+
+        bool open_{false};
+        int64_t open_start_ns_{0};
+        int64_t open_end_ns_{0};
+        uint32_t open_samples_{0};
+        MotionAccumulator accumulator_;
+        uint64_t dropped_samples_{0};
+    };
+
+    /**
+     * @brief Movement evidence of a time window
+     */
+    struct MotionCoverage {
+        uint32_t epochs{0};             ///< Epochs with samples inside the window
+        uint32_t active_epochs{0};
+        uint32_t expected_epochs{0};    ///< Epochs the window spans
+
+        /// Enough of the window was sampled to trust the still fraction
+        bool isSufficient() const noexcept { return expected_epochs > 0 && epochs * 2 >= expected_epochs; }
+
+        double stillFraction() const noexcept {
+            return epochs > 0 ? 1.0 - static_cast<double>(active_epochs) / epochs : 1.0;
+        }
+
+        /**
+         * @brief Confidence multiplier: 1.0 without (enough) data, down to 0.5 when always moving
+         */
+        double confidenceFactor() const noexcept {
+            return isSufficient() ? 0.5 + 0.5 * stillFraction() : 1.0;
+        }
+    };
+
+    /**
+     * @brief Fixed-capacity ring of epochs, oldest first
+     *
+     * The ring is allocated on the first append, so detectors without a
+     * sensor stream pay nothing; when full the oldest epoch is overwritten.
+     */
+    class ActivityEpochStore {
+    public:
+        static constexpr size_t NPOS = SIZE_MAX;
+
+        explicit ActivityEpochStore(size_t capacity = Performance::MAX_ACTIVITY_EPOCHS) noexcept
+                : capacity_(capacity) {}
+
+        /**
+         * @brief Append an epoch later than the newest one
+         * @return false if out of order (dropped)
+         */
+        bool append(const ActivityEpoch& epoch);
+
+        size_t size() const noexcept { return size_; }
+        bool empty() const noexcept { return size_ == 0; }
+        const ActivityEpoch& at(size_t index) const noexcept { return ring_[(first_ + index) % capacity_]; }
+
+        /**
+         * @brief Index of the first epoch ending after time_ms
+         */
+        size_t firstEndingAfter(int64_t time_ms) const noexcept;
+
+        /**
+         * @brief Movement evidence of [from_ms, to_ms)
+         * @performance O(log n + epochs in window)
+         */
+        MotionCoverage coverage(int64_t from_ms, int64_t to_ms) const noexcept;
+
+        /**
+         * @brief Visit runs of consecutive active epochs fully inside [from_ms, to_ms)
+         * @param visitor Callable as visitor(int64_t start_ms, int64_t end_ms)
+         */
+        template<typename Visitor>
+        void forEachActiveRun(int64_t from_ms, int64_t to_ms, Visitor&& visitor) const {
+            int64_t run_start = 0;
+            int64_t run_end = 0;
+            bool in_run = false;
+            for (size_t i = firstEndingAfter(from_ms); i < size_; ++i) {
+                const ActivityEpoch& epoch = at(i);
+                if (epoch.start_ms < from_ms) {
+                    continue;
+                }
+                if (epoch.endMs() > to_ms) {
+                    break;
+                }
+                bool extends = in_run && epoch.start_ms == run_end;
+                if (in_run && (!epoch.isActive() || !extends)) {
+                    visitor(run_start, run_end);
+                    in_run = false;
+                }
+                if (epoch.isActive()) {
+                    if (!in_run) {
+                        run_start = epoch.start_ms;
+                        in_run = true;
+                    }
+                    run_end = epoch.endMs();
+                }
+            }
+            if (in_run) {
+                visitor(run_start, run_end);
+            }
+        }
+
+        /**
+         * @brief Drop every epoch that starts before cutoff_ms
+         */
+        void eraseBefore(int64_t cutoff_ms) noexcept;
+
+        void clear() noexcept;
+
+        /**
+         * @brief Encode the retained epochs, oldest first (SnapshotSection::ACTIVITY)
+         */
+        void writeTo(SnapshotWriter& writer) const;
+
+        /**
+         * @brief Replace the retained epochs with decoded ones
+         * @return false if the section is malformed (store unchanged)
+         */
+        bool readFrom(SnapshotReader& reader);
+
+        size_t memoryUsageBytes() const noexcept { return ring_.capacity() * sizeof(ActivityEpoch); }
+
+    private:
+        std::vector<ActivityEpoch> ring_;
+        size_t capacity_;
+        size_t first_{0};
+        size_t size_{0};
+    };
+
+} // namespace puuyapu
@@ -0,0 +1,70 @@
+/**
+ * @file checksum.h
+ * @brief CRC-32 (IEEE 802.3) for on-disk record validation
+ *
+ * Shared by the event log frames and the session archive index.
+ *
+ * Slicing-by-8: eight table lookups per 8-byte word instead of one
+ * dependent lookup per byte, so megabyte snapshots verify in well under
+ * a millisecond. The result is the plain table-driven CRC-32.
+ *
+ * @performance Target: ~0.3 nanoseconds per byte (table driven)
+ */
+
+#pragma once
+
+#include <array>
+#include <cstddef>
+#include <cstdint>
+
+namespace puuyapu {
+
+    namespace detail {
+        using CrcTables = std::array<std::array<uint32_t, 256>, 8>;
+
+        /// tables[0] is the byte table; tables[k][i] is tables[0][i] advanced k more zero bytes
+        constexpr CrcTables makeCrcTables() {
+            CrcTables tables{};
+            for (uint32_t i = 0; i < 256; ++i) {
+                uint32_t crc = i;
+                for (int bit = 0; bit < 8; ++bit) {
+                    crc = (crc & 1) ? (crc >> 1) ^ 0xEDB88320u : crc >> 1;
+                }
+                tables[0][i] = crc;
+            }
+            for (size_t k = 1; k < tables.size(); ++k) {
+                for (uint32_t i = 0; i < 256; ++i) {
+                    uint32_t previous = tables[k - 1][i];
+                    tables[k][i] = tables[0][previous & 0xFF] ^ (previous >> 8);
+                }
+            }
+            return tables;
+        }
+
+        inline constexpr CrcTables CRC_TABLES = makeCrcTables();
+    }
+
+    /**
+     * @brief CRC-32 of a byte range
+     */
+    inline uint32_t crc32(const uint8_t* data, size_t length) noexcept {
+        const auto& t = detail::CRC_TABLES;
+        uint32_t crc = 0xFFFFFFFFu;
+        size_t i = 0;
+        for (; i + 8 <= length; i += 8) {
+            uint32_t low = crc ^ (static_cast<uint32_t>(data[i]) |
+                                  static_cast<uint32_t>(data[i + 1]) << 8 |
+                                  static_cast<uint32_t>(data[i + 2]) << 16 |
+                                  static_cast<uint32_t>(data[i + 3]) << 24);
+            crc = t[7][low & 0xFF] ^ t[6][(low >> 8) & 0xFF] ^
+                  t[5][(low >> 16) & 0xFF] ^ t[4][low >> 24] ^
+                  t[3][data[i + 4]] ^ t[2][data[i + 5]] ^
+                  t[1][data[i + 6]] ^ t[0][data[i + 7]];
+        }
+        for (; i < length; ++i) {
+            crc = t[0][(crc ^ data[i]) & 0xFF] ^ (crc >> 8);
+        }
+        return crc ^ 0xFFFFFFFFu;
+    }
+
+} // namespace puuyapu
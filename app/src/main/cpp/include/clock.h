@@ -0,0 +1,91 @@
+/**
+ * @file clock.h
+ * @brief Injectable wall clock for the detection engine
+ *
+ * Every "what time is it" the engine needs (retention cutoffs, the JNI
+ * calls that detect as of now) goes through a Clock, so a recorded night
+ * can be replayed faster than real time with identical results. Devices
+ * use SystemClock; replays and tools drive a ManualClock.
+ *
+ * @performance Target: now() < 50 nanoseconds
+ */
+
+#pragma once
+
+#include <atomic>
+#include <chrono>
+#include <cstdint>
+
+namespace puuyapu {
+
+    /**
+     * @brief Source of the current wall-clock instant
+     * Implementations must be thread-safe and outlive their users.
+     */
+    class Clock {
+    public:
+        virtual ~Clock() = default;
+
+        virtual std::chrono::system_clock::time_point now() const noexcept = 0;
+    };
+
+    /**
+     * @brief std::chrono::system_clock
+     */
+    class SystemClock final : public Clock {
+    public:
+        std::chrono::system_clock::time_point now() const noexcept override {
+            return std::chrono::system_clock::now();
+        }
+
+        /// Process-wide instance, the default of every detector
+        static const SystemClock& instance() noexcept {
+            static const SystemClock clock;
+            return clock;
+        }
+    };
+
+    /**
+     * @brief Simulated time, moved explicitly by its owner
+     *
+     * Millisecond resolution (the resolution of serialized events).
+     * Readers on other threads see each set/advance atomically.
+     */
+    class ManualClock final : public Clock {
+    public:
+        explicit ManualClock(std::chrono::system_clock::time_point start = {}) noexcept
+                : now_ms_(toMs(start)) {}
+
+        std::chrono::system_clock::time_point now() const noexcept override {
+            return std::chrono::system_clock::time_point(
+                    std::chrono::milliseconds(now_ms_.load(std::memory_order_acquire)));
+        }
+
+        void set(std::chrono::system_clock::time_point time_point) noexcept {
+            now_ms_.store(toMs(time_point), std::memory_order_release);
+        }
+
+        void advance(std::chrono::milliseconds delta) noexcept {
+            now_ms_.fetch_add(delta.count(), std::memory_order_acq_rel);
+        }
+
+        /**
+         * @brief Move forward to time_point; never moves backwards
+         */
+        void advanceTo(std::chrono::system_clock::time_point time_point) noexcept {
+            int64_t target = toMs(time_point);
+            int64_t current = now_ms_.load(std::memory_order_relaxed);
+            while (current < target &&
+                   !now_ms_.compare_exchange_weak(current, target, std::memory_order_acq_rel)) {}
+        }
+
+    private:
+        static int64_t toMs(std::chrono::system_clock::time_point time_point) noexcept {
+            return std::chrono::duration_cast<std::chrono::milliseconds>(
+                    time_point.time_since_epoch()).count();
+        }
+
+        std::atomic<int64_t> now_ms_;
+    };
+
+} // namespace puuyapu
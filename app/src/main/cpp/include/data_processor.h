@@ -11,8 +11,10 @@
 #pragma once
 
 #include "puuyapu_types.h"
+#include "metrics.h"
+#include "stream_writer.h"
 #include <string>
-#include <sstream>
+#include <vector>
 
 namespace puuyapu {
 
@@ -21,6 +23,8 @@ namespace puuyapu {
      *
      * Converts native C++ sleep data to JSON/CSV formats optimized for
      * minimal memory allocation and maximum processing speed.
+     * Sink overloads stream through a fixed 4KB buffer (constant peak memory);
+     * the string overloads are thin wrappers over a StringSink.
      */
     class DataProcessor {
     public:
@@ -35,6 +39,19 @@ namespace puuyapu {
                 const std::vector<SleepDetectionResult>& sessions,
                 bool include_debug = false) noexcept;
 
+        /**
+         * @brief Stream sleep sessions as JSON into a sink
+         * @param sessions Vector of sleep detection results
+         * @param sink Destination (file descriptor, JNI stream, string)
+         * @param include_debug Include debug information in export
+         * @return false if the sink reported a write failure
+         * @performance < 1ms per 100 sessions, no per-field allocation
+         */
+        static bool exportToJSON(
+                const std::vector<SleepDetectionResult>& sessions,
+                OutputSink& sink,
+                bool include_debug = false) noexcept;
+
         /**
          * @brief Export sleep sessions to CSV format
          * @param sessions Vector of sleep detection results
@@ -44,17 +61,32 @@ namespace puuyapu {
         static std::string exportToCSV(
                 const std::vector<SleepDetectionResult>& sessions) noexcept;
 
+        /**
+         * @brief Stream sleep sessions as CSV into a sink
+         * @return false if the sink reported a write failure
+         * @performance < 500μs per 100 sessions, no per-field allocation
+         */
+        static bool exportToCSV(
+                const std::vector<SleepDetectionResult>& sessions,
+                OutputSink& sink) noexcept;
+
         /**
          * @brief Export performance metrics to JSON
-         * @param metrics Performance timing data
-         * @return JSON string with performance data
+         * @param metrics Merged latency snapshot
+         * @return JSON with count, mean, p50, p99 and max (microseconds) per recorded metric
          * @performance < 100μs
          */
-        static std::string exportPerformanceMetrics(
-                const std::unordered_map<std::string, std::chrono::microseconds>& metrics) noexcept;
+        static std::string exportPerformanceMetrics(const MetricsSnapshot& metrics) noexcept;
+
+        /**
+         * @brief Stream performance metrics JSON into a sink
+         * @return false if the sink reported a write failure
+         */
+        static bool exportPerformanceMetrics(const MetricsSnapshot& metrics, OutputSink& sink) noexcept;
 
         /**
          * @brief Convert sleep session to compact binary format
+         * Fixed record for JNI transfer; persistent history uses SessionArchive.
          * @param session Sleep session to serialize
          * @param buffer Output buffer (must be at least 128 bytes)
          * @return Number of bytes written
@@ -64,6 +96,65 @@ namespace puuyapu {
                 const SleepDetectionResult& session,
                 uint8_t* buffer) noexcept;
 
+        /// Packed result layout version written by serializePacked
+        static constexpr uint16_t PACKED_FORMAT_VERSION = 1;
+
+        /// Packed result magic, "PSR1" in little-endian byte order
+        static constexpr uint32_t PACKED_MAGIC = 0x31525350;
+
+        static constexpr size_t PACKED_HEADER_SIZE = 16;
+        static constexpr size_t SESSION_RECORD_SIZE = 35;           ///< serializeToBinary record
+        static constexpr size_t PACKED_SESSION_SECTION_SIZE = 40;   ///< Record padded to 8 bytes
+        static constexpr size_t PACKED_INTERRUPTION_SIZE = 24;
+
+        /**
+         * @brief Bytes required to pack a detection result with serializePacked
+         * @param result Detection result to pack
+         * @return Exact packed size in bytes
+         */
+        static size_t packedResultSize(const SleepDetectionResult& result) noexcept;
+
+        /**
+         * @brief Pack a detection result, including interruptions, into a buffer
+         *
+         * Versioned little-endian layout for zero-copy transfer to Java
+         * (direct ByteBuffer), decoded lazily on the Java side:
+         *
+         * Header (16 bytes):
+         *   [0]  u32 magic      [4]  u16 version       [6]  u16 header size
+         *   [8]  u16 session section size              [10] u16 interruption record size
+         *   [12] u32 interruption count
+         * Session section: serializeToBinary record, zero padded, written
+         *   even when no sleep was detected (bedtime 0)
+         * Interruptions, each 24 bytes:
+         *   [0] i64 timestamp ms  [8] i64 duration ms  [16] u8 cause
+         *   [17] u8 app category  [18] u8 flags (0x01 brief check)  [19] u8 reserved
+         *   [20] f32 impact score
+         *
+         * Readers must use the size fields, not the constants, to skip sections
+         * so that later versions can append fields.
+         *
+         * @param result Detection result to pack
+         * @param buffer Output buffer
+         * @param capacity Size of output buffer in bytes
+         * @return Number of bytes written, 0 if buffer is null or too small
+         * @performance < 5μs for a typical night
+         */
+        static size_t serializePacked(
+                const SleepDetectionResult& result,
+                uint8_t* buffer,
+                size_t capacity) noexcept;
+
+        /**
+         * @brief Decode a buffer written by serializePacked
+         * @param buffer Packed result
+         * @param size Number of bytes in buffer
+         * @return Decoded result, empty result if the buffer is not a valid packed result
+         */
+        static SleepDetectionResult deserializePacked(
+                const uint8_t* buffer,
+                size_t size) noexcept;
+
         /**
          * @brief Deserialize sleep session from binary format
          * @param buffer Input buffer containing serialized data
@@ -77,22 +168,19 @@ namespace puuyapu {
 
     private:
         /**
-         * @brief Fast timestamp to ISO string conversion
-         * @param time_point Timestamp to convert
-         * @return ISO 8601 formatted timestamp string
-         * @performance < 20μs
+         * @brief Write the fixed session record shared by the binary formats
+         * @return SESSION_RECORD_SIZE
          */
-        static std::string timestampToISO(
-                std::chrono::system_clock::time_point time_point) noexcept;
+        static size_t writeSessionRecord(
+                const SleepDetectionResult& session,
+                uint8_t* buffer) noexcept;
 
         /**
-         * @brief Optimized double to string conversion
-         * @param value Double value to convert
-         * @param precision Number of decimal places
-         * @return String representation
-         * @performance < 10μs
+         * @brief Read the fixed session record shared by the binary formats
          */
-        static std::string doubleToString(double value, int precision = 2) noexcept;
+        static void readSessionRecord(
+                const uint8_t* buffer,
+                SleepDetectionResult& session) noexcept;
     };
 
 } // namespace puuyapu
\ No newline at end of file
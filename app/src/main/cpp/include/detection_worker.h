@@ -0,0 +1,165 @@
+/**
+ * @file detection_worker.h
+ * @brief Dedicated detection thread with coalesced requests
+ *
+ * DetectionWorker owns a SleepDetector and runs every detection pass on
+ * its own thread, so callers on the UI or accessibility threads only
+ * enqueue a request. Requests of the same kind that are still pending
+ * merge into one pass evaluated at the newest request's instant: ten
+ * lifecycle-triggered detections in a burst cost one detection.
+ *
+ * Results are delivered on the worker thread through DetectionListener.
+ * Event ingestion stays on the producer threads (SleepDetector's ingress
+ * queue is lock-free), only compute moves here. The thread is started by
+ * the first post(), so detectors only used synchronously (off-device
+ * replay) never own one.
+ *
+ * @performance Target: post < 2 microseconds, one pass per pending kind
+ */
+
+#pragma once
+
+#include "sleep_detector.h"
+#include <array>
+#include <atomic>
+#include <condition_variable>
+#include <cstdint>
+#include <memory>
+#include <mutex>
+#include <optional>
+#include <thread>
+
+namespace puuyapu {
+
+    /**
+     * @brief Work a detection request asks for (values are part of the JNI contract)
+     */
+    enum class DetectionRequestKind : uint8_t {
+        DETECT_SLEEP = 0,             ///< SleepDetector::detectSleepPeriod
+        IS_CURRENTLY_ASLEEP = 1,      ///< SleepDetector::isCurrentlyAsleep
+        ESTIMATED_SLEEP_START = 2,    ///< SleepDetector::getEstimatedSleepStart
+        OPTIMIZE_MEMORY = 3,          ///< SleepDetector::optimizeMemory
+        WRITE_SNAPSHOT = 4            ///< SleepDetector::writeSnapshot (periodic persistence)
+    };
+
+    constexpr size_t DETECTION_REQUEST_KINDS = 5;
+
+    /**
+     * @brief Outcome of one worker pass
+     *
+     * Only the field matching kind is meaningful. sleep points into the
+     * worker's stack and is valid for the duration of the callback.
+     */
+    struct DetectionResponse {
+        DetectionRequestKind kind{DetectionRequestKind::DETECT_SLEEP};
+        uint64_t request_id{0};                     ///< Newest request served by this pass
+        uint32_t coalesced{0};                      ///< Requests merged into the pass (>= 1)
+        std::chrono::system_clock::time_point at{}; ///< Instant the pass evaluated
+        const SleepDetectionResult* sleep{nullptr}; ///< DETECT_SLEEP
+        bool asleep{false};                         ///< IS_CURRENTLY_ASLEEP
+        std::optional<std::chrono::system_clock::time_point> sleep_start; ///< ESTIMATED_SLEEP_START
+        bool snapshot_written{false};               ///< WRITE_SNAPSHOT
+    };
+
+    /**
+     * @brief Receiver of worker results, called on the worker thread only
+     *
+     * The started/stopping hooks bracket the thread's lifetime so a
+     * listener can attach per-thread resources (a JNIEnv) exactly once.
+     */
+    class DetectionListener {
+    public:
+        virtual ~DetectionListener() = default;
+
+        virtual void onWorkerStarted() noexcept {}
+        virtual void onWorkerStopping() noexcept {}
+
+        virtual void onDetectionComplete(const DetectionResponse& response) noexcept = 0;
+    };
+
+    /**
+     * @brief Single-thread detection executor owning its SleepDetector
+     *
+     * Thread-safe: post() may be called from any thread. Synchronous
+     * SleepDetector calls through detector() remain valid; they serialize
+     * with worker passes on the detector's own locks.
+     */
+    class DetectionWorker {
+    public:
+        /**
+         * @brief Worker counters since construction
+         */
+        struct Statistics {
+            uint64_t requests_posted{0};
+            uint64_t requests_coalesced{0};     ///< Posted requests merged into a pending one
+            uint64_t passes{0};                 ///< Completed detection passes
+        };
+
+        /**
+         * @brief Take ownership of detector (the thread starts on first post)
+         * @param detector Detector the passes run against (non-null)
+         * @param listener Receiver of results, must outlive the worker (nullable)
+         */
+        DetectionWorker(std::unique_ptr<SleepDetector> detector, DetectionListener* listener);
+
+        /**
+         * @brief Stop the thread; requests still pending are dropped
+         * Must not run on the worker thread itself (see isWorkerThread).
+         */
+        ~DetectionWorker() noexcept;
+
+        DetectionWorker(const DetectionWorker&) = delete;
+        DetectionWorker& operator=(const DetectionWorker&) = delete;
+
+        /**
+         * @brief Queue a request, merging it into a pending one of the same kind
+         * @param kind Work to perform
+         * @param at Evaluation instant (ignored by OPTIMIZE_MEMORY)
+         * @return Request id (> 0), or 0 if the worker is stopping
+         * @performance < 2 microseconds, never waits for a pass
+         */
+        uint64_t post(DetectionRequestKind kind, std::chrono::system_clock::time_point at) noexcept;
+
+        SleepDetector& detector() noexcept { return *detector_; }
+        const SleepDetector& detector() const noexcept { return *detector_; }
+
+        Statistics getStatistics() const noexcept;
+
+        /**
+         * @brief Whether the caller is this worker's thread (e.g. inside a listener callback)
+         */
+        bool isWorkerThread() const noexcept;
+
+    private:
+        /// Coalescing slot: at most one pending request per kind
+        struct PendingRequest {
+            uint64_t request_id{0};
+            uint32_t count{0};
+            std::chrono::system_clock::time_point at{};
+        };
+
+        void workerLoop() noexcept;
+        void execute(DetectionRequestKind kind, const PendingRequest& request) noexcept;
+
+        std::unique_ptr<SleepDetector> detector_;
+        DetectionListener* listener_;
+
+        mutable std::mutex mutex_;
+        std::condition_variable work_available_;
+
+        // Pending kinds in posting order (each kind appears at most once)
+        std::array<PendingRequest, DETECTION_REQUEST_KINDS> pending_{};
+        std::array<DetectionRequestKind, DETECTION_REQUEST_KINDS> order_{};
+        size_t order_head_{0};
+        size_t order_size_{0};
+        uint64_t next_request_id_{0};
+        bool stopping_{false};
+
+        std::atomic<uint64_t> requests_posted_{0};
+        std::atomic<uint64_t> requests_coalesced_{0};
+        std::atomic<uint64_t> passes_{0};
+
+        std::thread thread_;                ///< Started by the first post (under mutex_)
+    };
+
+} // namespace puuyapu
@@ -0,0 +1,167 @@
+/**
+ * @file detector_registry.h
+ * @brief Opaque handles to independent detector instances
+ *
+ * Every detector (a DetectionWorker and the SleepDetector it owns) lives
+ * in a slot of a fixed, sharded table and is addressed by a 64-bit
+ * handle: slot index + 1 in the low half, the slot's generation in the
+ * high half. A destroyed handle never aliases a later detector in the
+ * same slot, and handle 0 is never valid.
+ *
+ * Calls on a handle pin the detector with a Lease: one CAS on the slot's
+ * state word, no lock. destroy() retires the slot immediately (new
+ * leases fail) and the detector is freed when its last lease drops, so a
+ * call racing a destroy never sees freed memory. Only create/destroy and
+ * the final release take a lock, and only their shard's.
+ *
+ * @performance Target: acquire + release < 50 nanoseconds uncontended
+ */
+
+#pragma once
+
+#include "detection_worker.h"
+#include <array>
+#include <atomic>
+#include <cstdint>
+#include <memory>
+#include <mutex>
+#include <vector>
+
+namespace puuyapu {
+
+    using DetectorHandle = uint64_t;
+
+    constexpr DetectorHandle INVALID_DETECTOR_HANDLE = 0;
+
+    /**
+     * @brief Process-wide table of detector instances
+     */
+    class DetectorRegistry {
+        struct Slot;
+        struct Shard;
+
+    public:
+        static constexpr size_t SHARD_COUNT = 16;
+        static constexpr size_t SLOTS_PER_SHARD = 64;
+        static constexpr size_t MAX_DETECTORS = SHARD_COUNT * SLOTS_PER_SHARD;
+
+        /**
+         * @brief Pinned reference to a live detector (move-only)
+         *
+         * Empty if the handle was invalid or destroyed. While a lease is
+         * held the detector stays allocated, even across destroy().
+         */
+        class Lease {
+        public:
+            Lease() noexcept = default;
+            ~Lease() noexcept { release(); }
+
+            Lease(Lease&& other) noexcept
+                    : registry_(other.registry_), slot_(other.slot_), worker_(other.worker_) {
+                other.slot_ = nullptr;
+                other.worker_ = nullptr;
+            }
+
+            Lease& operator=(Lease&& other) noexcept {
+                if (this != &other) {
+                    release();
+                    registry_ = other.registry_;
+                    slot_ = other.slot_;
+                    worker_ = other.worker_;
+                    other.slot_ = nullptr;
+                    other.worker_ = nullptr;
+                }
+                return *this;
+            }
+
+            Lease(const Lease&) = delete;
+            Lease& operator=(const Lease&) = delete;
+
+            explicit operator bool() const noexcept { return worker_ != nullptr; }
+
+            SleepDetector* operator->() const noexcept { return &worker_->detector(); }
+            SleepDetector& operator*() const noexcept { return worker_->detector(); }
+
+            DetectionWorker& worker() const noexcept { return *worker_; }
+
+        private:
+            friend class DetectorRegistry;
+
+            Lease(DetectorRegistry* registry, Slot* slot, DetectionWorker* worker) noexcept
+                    : registry_(registry), slot_(slot), worker_(worker) {}
+
+            void release() noexcept;
+
+            DetectorRegistry* registry_{nullptr};
+            Slot* slot_{nullptr};
+            DetectionWorker* worker_{nullptr};
+        };
+
+        DetectorRegistry() noexcept;
+        ~DetectorRegistry() noexcept;
+
+        DetectorRegistry(const DetectorRegistry&) = delete;
+        DetectorRegistry& operator=(const DetectorRegistry&) = delete;
+
+        /**
+         * @brief Registry shared by the JNI bridge and host tools
+         */
+        static DetectorRegistry& shared() noexcept;
+
+        /**
+         * @brief Register a new detector
+         * @param detector Detector to own (non-null)
+         * @param listener Receiver of the detector's asynchronous results (nullable)
+         * @return Handle, or INVALID_DETECTOR_HANDLE if the table is full
+         * @performance O(1), locks one shard
+         */
+        DetectorHandle create(std::unique_ptr<SleepDetector> detector, DetectionListener* listener = nullptr);
+
+        /**
+         * @brief Retire a handle; the detector is freed once no lease pins it
+         * @return false if the handle is not live
+         */
+        bool destroy(DetectorHandle handle) noexcept;
+
+        /**
+         * @brief Pin the detector behind a handle
+         * @return Empty lease if the handle is invalid or destroyed
+         * @performance Lock-free, one CAS
+         */
+        Lease acquire(DetectorHandle handle) noexcept;
+
+        /**
+         * @brief Number of live (not destroyed) detectors
+         */
+        size_t size() const noexcept { return live_count_.load(std::memory_order_relaxed); }
+
+    private:
+        // Slot state word: [generation:32][live:1][leases:31]
+        static constexpr uint64_t LIVE_BIT = uint64_t{1} << 31;
+        static constexpr uint64_t LEASE_MASK = LIVE_BIT - 1;
+
+        struct alignas(64) Slot {
+            std::atomic<uint64_t> state{0};
+            DetectionWorker* worker{nullptr};       ///< Published by the release store of state
+            uint32_t index{0};                      ///< Position in the whole table
+        };
+
+        struct Shard {
+            std::mutex mutex;                       ///< Free list and retired workers
+            std::vector<uint32_t> free_slots;
+            std::vector<std::unique_ptr<DetectionWorker>> retired;   ///< Released on their own thread, freed later
+            std::array<Slot, SLOTS_PER_SHARD> slots;
+        };
+
+        Slot* slotOf(DetectorHandle handle) noexcept;
+        void reclaim(Slot& slot) noexcept;
+        void drainRetired(Shard& shard) noexcept;
+
+        std::unique_ptr<Shard[]> shards_;
+        std::atomic<size_t> next_shard_{0};
+        std::atomic<size_t> live_count_{0};
+    };
+
+    using DetectorLease = DetectorRegistry::Lease;
+
+} // namespace puuyapu
@@ -0,0 +1,164 @@
+/**
+ * @file event_column_store.h
+ * @brief Compact structure-of-arrays storage for interaction events
+ *
+ * Stores the interaction history column by column so that gap and
+ * classification scans only touch the bytes they need:
+ * - timestamps: 32-bit millisecond offsets from a 64-bit base
+ * - durations: 32-bit milliseconds
+ * - type / category / classification flags: one byte each
+ * - app hash: two bytes
+ *
+ * 13 bytes per event versus 40 for the InteractionEvent record, which is
+ * what allows a full retention window of history to stay resident.
+ *
+ * Not thread-safe: owned and serialized by EventTimeline.
+ *
+ * @performance Append/pop: O(1) amortized, lookup by time: O(log n)
+ */
+
+#pragma once
+
+#include "puuyapu_types.h"
+#include <vector>
+#include <cstdint>
+
+namespace puuyapu {
+
+    /**
+     * @brief Time-ordered columnar event store with a real head and tail
+     *
+     * Events live in [head_, tail) of each column. Popping the head only
+     * advances an index; the dead prefix is compacted in bulk once it
+     * outweighs the live data. Timestamps are frame-of-reference encoded:
+     * the base moves forward on compaction so offsets always fit 32 bits
+     * as long as the live span stays under MAX_SPAN (~49 days).
+     *
+     * Timestamps and durations are kept at millisecond precision (the JNI
+     * resolution). session_id and user_interaction_count are not retained.
+     *
+     * Flags are computed once per event with the store's classification
+     * policy; changing the policy reclassifies the retained events in one
+     * pass over the duration, type and category columns.
+     */
+    class EventColumnStore {
+    public:
+        /// Classification bits precomputed at ingest (see EventFlag)
+        enum Flag : uint8_t {
+            FLAG_TIME_CHECK = EVENT_FLAG_TIME_CHECK,
+            FLAG_MEANINGFUL = EVENT_FLAG_MEANINGFUL,
+            FLAG_SLEEP_RELATED = EVENT_FLAG_SLEEP_RELATED,
+            FLAG_BRIEF = EVENT_FLAG_BRIEF
+        };
+
+        static constexpr size_t BYTES_PER_EVENT =
+                sizeof(uint32_t) * 2 + sizeof(uint8_t) * 3 + sizeof(uint16_t);
+
+        /// Largest representable distance between head and tail timestamps
+        static constexpr std::chrono::milliseconds MAX_SPAN{UINT32_MAX};
+
+        /**
+         * @brief Append event at the tail
+         * @param event Event not older than the current tail
+         * @return false if the event cannot be represented (span too large)
+         */
+        bool append(const InteractionEvent& event);
+
+        /**
+         * @brief Insert event at a position (for late events)
+         * @param index Logical position, must keep time order
+         * @param event Event to insert
+         * @return false if the event cannot be represented (span too large)
+         */
+        bool insert(size_t index, const InteractionEvent& event);
+
+        /**
+         * @brief Drop the oldest event
+         * @performance O(1) amortized
+         */
+        void popFront() noexcept;
+
+        void clear() noexcept;
+        void shrinkToFit();
+
+        size_t size() const noexcept { return offsets_.size() - head_; }
+        bool empty() const noexcept { return size() == 0; }
+
+        /**
+         * @brief Resident bytes held by all columns (including spare capacity)
+         */
+        size_t memoryUsageBytes() const noexcept;
+
+        // Column accessors by logical index (0 = oldest)
+        int64_t timestampMsAt(size_t index) const noexcept {
+            return base_ms_ + offsets_[head_ + index];
+        }
+        std::chrono::system_clock::time_point timestampAt(size_t index) const noexcept {
+            return std::chrono::system_clock::time_point(std::chrono::milliseconds(timestampMsAt(index)));
+        }
+        std::chrono::milliseconds durationAt(size_t index) const noexcept {
+            return std::chrono::milliseconds(durations_[head_ + index]);
+        }
+        InteractionType typeAt(size_t index) const noexcept {
+            return static_cast<InteractionType>(types_[head_ + index]);
+        }
+        AppCategory categoryAt(size_t index) const noexcept {
+            return static_cast<AppCategory>(categories_[head_ + index]);
+        }
+        uint8_t flagsAt(size_t index) const noexcept { return flags_[head_ + index]; }
+        uint16_t appHashAt(size_t index) const noexcept { return app_hashes_[head_ + index]; }
+
+        bool isTimeCheckAt(size_t index) const noexcept { return (flagsAt(index) & FLAG_TIME_CHECK) != 0; }
+        bool isMeaningfulAt(size_t index) const noexcept { return (flagsAt(index) & FLAG_MEANINGFUL) != 0; }
+        bool isBriefAt(size_t index) const noexcept { return (flagsAt(index) & FLAG_BRIEF) != 0; }
+
+        /**
+         * @brief Materialize an InteractionEvent record
+         */
+        InteractionEvent eventAt(size_t index) const noexcept;
+
+        /**
+         * @brief Index of first event with timestamp >= time_point
+         * @performance O(log n), touches only the offset column
+         */
+        size_t lowerBound(std::chrono::system_clock::time_point time_point) const noexcept;
+
+        /**
+         * @brief Index of first event with timestamp > time_point
+         * @performance O(log n), touches only the offset column
+         */
+        size_t upperBound(std::chrono::system_clock::time_point time_point) const noexcept;
+
+        // Raw column access for vectorizable scans (size() elements each)
+        int64_t baseMs() const noexcept { return base_ms_; }
+        const uint32_t* offsetData() const noexcept { return offsets_.data() + head_; }
+        const uint8_t* flagData() const noexcept { return flags_.data() + head_; }
+        const uint32_t* durationData() const noexcept { return durations_.data() + head_; }
+        const uint8_t* typeData() const noexcept { return types_.data() + head_; }
+
+        /**
+         * @brief Switch the classification policy, reclassifying retained events
+         * @return true if the policy changed (flags may differ)
+         * @performance O(n) on change, O(1) otherwise
+         */
+        bool setPolicy(const ClassificationPolicy& policy) noexcept;
+
+        const ClassificationPolicy& policy() const noexcept { return policy_; }
+
+    private:
+        bool prepareTimestamp(int64_t timestamp_ms);
+        void compact();
+
+        ClassificationPolicy policy_;
+        int64_t base_ms_{0};
+        size_t head_{0};
+
+        std::vector<uint32_t> offsets_;     ///< Milliseconds since base_ms_
+        std::vector<uint32_t> durations_;   ///< Milliseconds, saturated
+        std::vector<uint8_t> types_;
+        std::vector<uint8_t> categories_;
+        std::vector<uint8_t> flags_;
+        std::vector<uint16_t> app_hashes_;
+    };
+
+} // namespace puuyapu
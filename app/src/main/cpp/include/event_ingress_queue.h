@@ -0,0 +1,133 @@
+/**
+ * @file event_ingress_queue.h
+ * @brief Bounded lock-free ingress queue for interaction events
+ *
+ * Decouples the event producer (accessibility/usage service thread) from
+ * detection queries. Producers publish into a fixed ring without taking
+ * any lock; the detector drains pending events into its timeline at the
+ * start of each query while it already holds its event lock.
+ *
+ * Multi-producer, single-consumer: push is safe from any thread, pop must
+ * be serialized by the caller (SleepDetector::events_mutex_).
+ *
+ * @performance Push/pop: O(1), wait-free when not contended, no allocation
+ */
+
+#pragma once
+
+#include "puuyapu_types.h"
+#include <atomic>
+#include <memory>
+#include <cstdint>
+
+namespace puuyapu {
+
+    /**
+     * @brief Bounded MPSC ring buffer of InteractionEvent records
+     *
+     * Each cell carries a sequence number that tells producers whether the
+     * slot is free and the consumer whether it has been published, so slots
+     * are claimed with a single CAS on the tail and never shared in flight.
+     *
+     * A producer that claimed a slot but has not yet published it holds
+     * back later events until the next drain; nothing is lost or reordered.
+     */
+    class EventIngressQueue {
+    public:
+        /**
+         * @brief Create queue with fixed capacity
+         * @param capacity Requested slots, rounded up to a power of two
+         */
+        explicit EventIngressQueue(size_t capacity = Performance::INGRESS_QUEUE_CAPACITY)
+                : mask_(roundUpPowerOfTwo(capacity) - 1),
+                  cells_(new Cell[mask_ + 1]) {
+            for (size_t i = 0; i <= mask_; ++i) {
+                cells_[i].sequence.store(i, std::memory_order_relaxed);
+            }
+        }
+
+        EventIngressQueue(const EventIngressQueue&) = delete;
+        EventIngressQueue& operator=(const EventIngressQueue&) = delete;
+
+        /**
+         * @brief Publish an event (any thread, never blocks)
+         * @param event Event to enqueue
+         * @return false if the queue is full
+         * @performance Target: < 1 microsecond
+         */
+        bool tryPush(const InteractionEvent& event) noexcept {
+            size_t position = enqueue_position_.load(std::memory_order_relaxed);
+
+            for (;;) {
+                Cell& cell = cells_[position & mask_];
+                size_t sequence = cell.sequence.load(std::memory_order_acquire);
+                auto difference = static_cast<intptr_t>(sequence) - static_cast<intptr_t>(position);
+
+                if (difference == 0) {
+                    if (enqueue_position_.compare_exchange_weak(position, position + 1,
+                                                                std::memory_order_relaxed)) {
+                        cell.event = event;
+                        cell.sequence.store(position + 1, std::memory_order_release);
+                        return true;
+                    }
+                } else if (difference < 0) {
+                    return false;
+                } else {
+                    position = enqueue_position_.load(std::memory_order_relaxed);
+                }
+            }
+        }
+
+        /**
+         * @brief Take the oldest published event (single consumer only)
+         * @param event Receives the event
+         * @return false if no published event is pending
+         */
+        bool tryPop(InteractionEvent& event) noexcept {
+            size_t position = dequeue_position_.load(std::memory_order_relaxed);
+            Cell& cell = cells_[position & mask_];
+
+            if (cell.sequence.load(std::memory_order_acquire) != position + 1) {
+                return false;
+            }
+
+            event = cell.event;
+            cell.sequence.store(position + mask_ + 1, std::memory_order_release);
+            dequeue_position_.store(position + 1, std::memory_order_relaxed);
+            return true;
+        }
+
+        /**
+         * @brief Approximate number of claimed, undrained slots
+         */
+        size_t pendingCount() const noexcept {
+            size_t tail = enqueue_position_.load(std::memory_order_relaxed);
+            size_t head = dequeue_position_.load(std::memory_order_relaxed);
+            return tail >= head ? tail - head : 0;
+        }
+
+        size_t capacity() const noexcept { return mask_ + 1; }
+
+    private:
+        struct Cell {
+            std::atomic<size_t> sequence{0};
+            InteractionEvent event;
+        };
+
+        static size_t roundUpPowerOfTwo(size_t value) noexcept {
+            size_t result = 2;
+            while (result < value) {
+                result <<= 1;
+            }
+            return result;
+        }
+
+        const size_t mask_;
+        std::unique_ptr<Cell[]> cells_;
+
+        // Producer and consumer cursors on separate cache lines
+        alignas(64) std::atomic<size_t> enqueue_position_{0};
+        alignas(64) std::atomic<size_t> dequeue_position_{0};
+    };
+
+} // namespace puuyapu
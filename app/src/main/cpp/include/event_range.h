@@ -0,0 +1,89 @@
+/**
+ * @file event_range.h
+ * @brief Non-owning view of a contiguous time window of the event timeline
+ *
+ * A range is two indices into the column store found by binary search,
+ * so locating a window is O(log n) and nothing is copied. Aggregates run
+ * straight over the columns they need (one byte per event for counts),
+ * which keeps per-window work at O(k) sequential reads.
+ *
+ * Valid only while the timeline is unchanged (SleepDetector's event lock).
+ *
+ * @performance Lookup O(log n), aggregates O(k) over one column
+ */
+
+#pragma once
+
+#include "event_column_store.h"
+#include <cstring>
+
+namespace puuyapu {
+
+    /**
+     * @brief Events [begin, end) of an EventColumnStore, oldest first
+     */
+    class EventRange {
+    public:
+        EventRange(const EventColumnStore& store, size_t begin, size_t end) noexcept
+                : store_(&store), begin_(begin), end_(end < begin ? begin : end) {}
+
+        size_t begin() const noexcept { return begin_; }
+        size_t end() const noexcept { return end_; }
+        size_t size() const noexcept { return end_ - begin_; }
+        bool empty() const noexcept { return begin_ == end_; }
+
+        /// Column store index of the k-th event of the range
+        size_t indexAt(size_t k) const noexcept { return begin_ + k; }
+
+        std::chrono::system_clock::time_point timestampAt(size_t k) const noexcept { return store_->timestampAt(begin_ + k); }
+        std::chrono::milliseconds durationAt(size_t k) const noexcept { return store_->durationAt(begin_ + k); }
+        InteractionType typeAt(size_t k) const noexcept { return store_->typeAt(begin_ + k); }
+        uint8_t flagsAt(size_t k) const noexcept { return store_->flagsAt(begin_ + k); }
+        InteractionEvent eventAt(size_t k) const noexcept { return store_->eventAt(begin_ + k); }
+
+        /// Raw columns of the range, size() entries each
+        const uint8_t* flagData() const noexcept { return store_->flagData() + begin_; }
+        const uint32_t* durationData() const noexcept { return store_->durationData() + begin_; }
+
+        /**
+         * @brief Events with any of the given EventFlag bits
+         */
+        size_t countFlags(uint8_t mask) const noexcept {
+            const uint8_t* flags = flagData();
+            size_t count = 0;
+            for (size_t i = 0; i < size(); ++i) {
+                count += (flags[i] & mask) != 0;
+            }
+            return count;
+        }
+
+        size_t timeCheckCount() const noexcept { return countFlags(EVENT_FLAG_TIME_CHECK); }
+
+        /**
+         * @brief Sum of event durations (each saturated at ~49 days)
+         */
+        std::chrono::milliseconds totalDuration() const noexcept {
+            const uint32_t* durations = durationData();
+            uint64_t total = 0;
+            for (size_t i = 0; i < size(); ++i) {
+                total += durations[i];
+            }
+            return std::chrono::milliseconds(static_cast<int64_t>(total));
+        }
+
+        /**
+         * @brief Whether any event of the range has the given type
+         * @performance memchr over the type column
+         */
+        bool containsType(InteractionType type) const noexcept {
+            return !empty() &&
+                   std::memchr(store_->typeData() + begin_, static_cast<int>(type), size()) != nullptr;
+        }
+
+    private:
+        const EventColumnStore* store_;
+        size_t begin_;
+        size_t end_;
+    };
+
+} // namespace puuyapu
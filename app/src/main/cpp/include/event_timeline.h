@@ -0,0 +1,176 @@
+/**
+ * @file event_timeline.h
+ * @brief Ordered interaction timeline with incremental gap tracking
+ *
+ * Keeps interaction events in chronological order as they arrive and
+ * maintains the list of sleep-candidate gaps between meaningful
+ * interactions per event, so detection queries never copy or sort.
+ *
+ * Not thread-safe: callers (SleepDetector) serialize access.
+ *
+ * @performance Append: O(1) amortized, gap query: O(new events)
+ */
+
+#pragma once
+
+#include "puuyapu_types.h"
+#include "event_column_store.h"
+#include "event_range.h"
+#include <limits>
+
+namespace puuyapu {
+
+    /**
+     * @brief Chronologically ordered event store with a live gap index
+     *
+     * Gap semantics match the original full-scan algorithm: the first
+     * retained event and every meaningful interaction act as anchors, a gap
+     * is recorded between consecutive anchors when it spans at least the
+     * minimum gap, and time checks strictly inside it are counted as brief
+     * interactions.
+     *
+     * In-order appends update the gap index in O(1). Head evictions only
+     * mark the leading segment for a lazy re-check, and out-of-order inserts
+     * (late replays) fall back to a single linear rebuild on the next query.
+     *
+     * Retention is time based: events older than the retention window
+     * (relative to the newest event) are evicted from the head, with an
+     * event-count cap as a memory safety net.
+     */
+    class EventTimeline {
+    public:
+        static constexpr size_t NPOS = std::numeric_limits<size_t>::max();
+
+        /**
+         * @brief Create an empty timeline
+         * @param minimum_gap Minimum gap between anchors to record
+         * @param retention How much history to keep behind the newest event
+         * @param capacity Maximum number of events retained (oldest evicted)
+         */
+        explicit EventTimeline(std::chrono::milliseconds minimum_gap,
+                               std::chrono::milliseconds retention = Performance::DATA_RETENTION_DAYS,
+                               size_t capacity = Performance::MAX_EVENTS_RETAINED) noexcept;
+
+        /**
+         * @brief Insert event keeping chronological order
+         * @param event Event to insert
+         * @return false if the event was dropped (older than the retention window)
+         * @performance O(1) for in-order events, O(n) for late events
+         */
+        bool insert(const InteractionEvent& event);
+
+        /**
+         * @brief Remove all events older than cutoff
+         * @param cutoff_time Events with timestamp < cutoff are removed
+         * @return Number of events removed
+         */
+        size_t eraseBefore(std::chrono::system_clock::time_point cutoff_time) noexcept;
+
+        /**
+         * @brief Change the minimum gap; rebuilds the gap index if different
+         * @param minimum_gap New minimum gap duration
+         */
+        void setMinimumGap(std::chrono::milliseconds minimum_gap) noexcept;
+
+        /**
+         * @brief Change the classification policy; reclassifies and rebuilds if different
+         * @param policy Policy derived from the current preferences
+         * @performance O(n) on change, O(1) otherwise
+         */
+        void setClassificationPolicy(const ClassificationPolicy& policy) noexcept;
+
+        /**
+         * @brief Release unused storage
+         */
+        void shrinkToFit();
+
+        size_t size() const noexcept { return store_.size(); }
+        bool empty() const noexcept { return store_.empty(); }
+        size_t memoryUsageBytes() const noexcept { return store_.memoryUsageBytes() + gaps_.capacity() * sizeof(TimeGap); }
+        std::chrono::milliseconds minimumGap() const noexcept { return min_gap_; }
+
+        /**
+         * @brief Column view of the ordered events (index 0 = oldest)
+         */
+        const EventColumnStore& events() const noexcept { return store_; }
+
+        /**
+         * @brief Index of first event with timestamp >= time_point
+         * @performance O(log n)
+         */
+        size_t lowerBound(std::chrono::system_clock::time_point time_point) const noexcept;
+
+        /**
+         * @brief Index of first event with timestamp > time_point
+         * @performance O(log n)
+         */
+        size_t upperBound(std::chrono::system_clock::time_point time_point) const noexcept;
+
+        /**
+         * @brief Events with from <= timestamp < to, without copying
+         * @performance O(log n)
+         */
+        EventRange range(std::chrono::system_clock::time_point from,
+                         std::chrono::system_clock::time_point to) const noexcept {
+            return EventRange(store_, lowerBound(from), lowerBound(to));
+        }
+
+        /**
+         * @brief Events strictly between from and to (excludes both endpoints)
+         * @performance O(log n)
+         */
+        EventRange rangeBetween(std::chrono::system_clock::time_point from,
+                                std::chrono::system_clock::time_point to) const noexcept {
+            return EventRange(store_, upperBound(from), lowerBound(to));
+        }
+
+        /**
+         * @brief Events with from <= timestamp <= to
+         * @performance O(log n)
+         */
+        EventRange rangeInclusive(std::chrono::system_clock::time_point from,
+                                  std::chrono::system_clock::time_point to) const noexcept {
+            return EventRange(store_, lowerBound(from), upperBound(to));
+        }
+
+        /**
+         * @brief Most recent meaningful interaction
+         * @return Event index, or NPOS if none retained
+         * @performance O(1)
+         */
+        size_t lastMeaningful() const noexcept;
+
+        /**
+         * @brief Index of first meaningful event at or after index
+         * @return Event index, or NPOS if none
+         */
+        size_t nextMeaningful(size_t index) const noexcept;
+
+        /**
+         * @brief Chronological list of gaps >= minimum gap
+         * @performance O(1) when up to date, O(leading segment) after
+         *              evictions, O(n) after out-of-order inserts
+         */
+        const TimeGapList& gaps() const noexcept;
+
+    private:
+        void evictFront() noexcept;
+        void trackAppended(size_t index) const noexcept;
+        void refreshLeadingSegment() const noexcept;
+        void rebuildGaps() const noexcept;
+
+        EventColumnStore store_;
+        std::chrono::milliseconds min_gap_;
+        std::chrono::milliseconds retention_;
+        size_t capacity_;
+
+        // Gap index state - lazily repaired from const accessors
+        mutable TimeGapList gaps_;
+        mutable size_t anchor_index_{NPOS};          ///< Last anchor (meaningful or first event)
+        mutable size_t last_meaningful_index_{NPOS}; ///< Last meaningful event
+        mutable int brief_since_anchor_{0};          ///< Time checks after anchor
+        mutable bool leading_dirty_{false};          ///< Head changed since last query
+        mutable bool rebuild_required_{false};       ///< Order changed, full rebuild needed
+    };
+
+} // namespace puuyapu
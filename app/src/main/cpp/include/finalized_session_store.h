@@ -0,0 +1,133 @@
+/**
+ * @file finalized_session_store.h
+ * @brief Immutable per-night results for nights that can no longer change
+ *
+ * A night (local noon-to-noon window) is sealed once it has a complete
+ * sleep and the timeline has moved past the end of its window. From then
+ * on its SleepDetectionResult is served from here: it is never
+ * recomputed, survives clearOldData and preference updates, and keeps
+ * history available after the events behind it were evicted.
+ *
+ * Results are stored flat: the per-night record without its interruption
+ * list, plus one shared interruption array, so sealed history does not
+ * hold on to slab blocks meant for live detection.
+ *
+ * A SessionAggregateIndex is kept in step with the sealed nights, so
+ * range and weekday statistics never walk the store.
+ *
+ * Not thread-safe: owned by SleepDetector under its event lock.
+ *
+ * @performance Lookup O(log nights), seal O(1) amortized for the newest night
+ */
+
+#pragma once
+
+#include "puuyapu_types.h"
+#include "session_aggregate_index.h"
+#include "detector_snapshot.h"
+#include <cstdint>
+#include <vector>
+
+namespace puuyapu {
+
+    /**
+     * @brief Night-indexed store of sealed detection results (oldest first)
+     */
+    class FinalizedSessionStore {
+    public:
+        static constexpr size_t NPOS = SIZE_MAX;
+
+        /// Default number of sealed nights kept; the oldest is dropped beyond it (about 13 months)
+        static constexpr size_t MAX_NIGHTS = Performance::SESSION_RETENTION_NIGHTS;
+
+        /**
+         * @brief Seal a night's result
+         * @param night_index Night window of the result (see CivilTime::night_index)
+         * @param result Valid, complete result
+         * @return false if the night is already sealed or the result is invalid
+         */
+        bool seal(int64_t night_index, const SleepDetectionResult& result);
+
+        /**
+         * @brief Position of a sealed night
+         * @return Index into the store, or NPOS if not sealed
+         * @performance O(log nights), O(1) for the newest night
+         */
+        size_t find(int64_t night_index) const noexcept;
+
+        bool contains(int64_t night_index) const noexcept { return find(night_index) != NPOS; }
+
+        /**
+         * @brief Index of the first sealed night >= night_index
+         */
+        size_t lowerBound(int64_t night_index) const noexcept;
+
+        size_t size() const noexcept { return nights_.size(); }
+        bool empty() const noexcept { return nights_.empty(); }
+
+        int64_t nightAt(size_t index) const noexcept { return nights_[index].night_index; }
+        std::chrono::system_clock::time_point bedtimeAt(size_t index) const noexcept {
+            return *nights_[index].result.bedtime;
+        }
+
+        /**
+         * @brief Materialize the full result of a sealed night
+         * @param index Store position
+         * @param out Receives the result, interruption list included
+         */
+        void load(size_t index, SleepDetectionResult& out) const;
+
+        /**
+         * @brief Re-derive night keys after a timezone change
+         * Bedtimes are absolute; only their night windows move. If two
+         * nights collapse into one window the longer sleep is kept.
+         */
+        void rekey() noexcept;
+
+        /**
+         * @brief Change how many nights are kept, dropping the oldest beyond it
+         */
+        void setCapacity(size_t nights);
+        size_t capacity() const noexcept { return capacity_; }
+
+        /**
+         * @brief Prefix-sum statistics over the sealed nights
+         */
+        const SessionAggregateIndex& aggregates() const noexcept { return aggregates_; }
+
+        /**
+         * @brief Encode every sealed night (SnapshotSection::SESSIONS)
+         */
+        void writeTo(SnapshotWriter& writer) const;
+
+        /**
+         * @brief Replace the store with decoded nights, keeping the capacity
+         * @return false if the section is malformed (store unchanged)
+         */
+        bool readFrom(SnapshotReader& reader);
+
+        void clear() noexcept;
+
+        size_t memoryUsageBytes() const noexcept;
+
+    private:
+        struct Night {
+            int64_t night_index;
+            SleepDetectionResult result;        ///< Without interruptions
+            uint32_t first_interruption;
+            uint32_t interruption_count;
+            double efficiency;                  ///< calculateSleepEfficiency, taken before the list is flattened
+        };
+
+        void dropOldest(size_t count) noexcept;
+        void compactInterruptions() noexcept;
+        SleepAggregate aggregateOf(const Night& night) const noexcept;
+        void rebuildAggregates();
+
+        std::vector<Night> nights_;
+        std::vector<SleepInterruption> interruptions_;
+        size_t capacity_{MAX_NIGHTS};
+        SessionAggregateIndex aggregates_;
+    };
+
+} // namespace puuyapu
@@ -0,0 +1,170 @@
+/**
+ * @file gap_scan.h
+ * @brief Vectorized gap scan over classification flag columns
+ *
+ * Gap detection only needs two facts per event: is it meaningful (an
+ * anchor) and is it a time check (a brief interaction). buildFlagMasks
+ * turns 16 flag bytes at a time into one meaningful and one time-check
+ * bitmask with NEON (arm64-v8a, armeabi-v7a), SSE2 (x86, x86_64) or a
+ * scalar loop. The scan then walks only the set meaningful bits: brief
+ * interactions between two anchors are a popcount of the time-check mask,
+ * and a 16-event word whose last timestamp is still within the minimum
+ * gap of the current anchor is skipped with one comparison.
+ *
+ * Results are identical to the per-event scalar walk (same gaps, same
+ * brief counts, same anchors) on every backend.
+ *
+ * @performance Target: < 1 nanosecond per event on typical histories
+ */
+
+#pragma once
+
+#include "puuyapu_types.h"
+#include "event_column_store.h"
+#include <algorithm>
+#include <cstdint>
+
+namespace puuyapu {
+
+    /// Events per bitmask word
+    constexpr size_t GAP_SCAN_LANES = 16;
+
+    /// Events classified per buildFlagMasks call (stack-resident masks)
+    constexpr size_t GAP_SCAN_BLOCK = 1024;
+
+    /**
+     * @brief Anchor bookkeeping carried across scan calls
+     *
+     * Indices are absolute (as passed to the time accessor). A default
+     * state means no anchor yet: the first scanned event becomes one.
+     */
+    struct GapScanState {
+        static constexpr size_t NPOS = SIZE_MAX;
+
+        size_t anchor_index{NPOS};              ///< Last anchor (meaningful or first event)
+        size_t last_meaningful_index{NPOS};     ///< Last meaningful event
+        int brief_since_anchor{0};              ///< Time checks after the anchor
+    };
+
+    /**
+     * @brief Build per-16-event bitmasks of the meaningful and time-check flags
+     *
+     * Bit j of word w describes flags[w * 16 + j]; bits past count are zero.
+     *
+     * @param flags EventColumnStore classification flags
+     * @param count Number of flags
+     * @param meaningful Output, (count + 15) / 16 words
+     * @param time_checks Output, (count + 15) / 16 words
+     * @performance < 0.2 nanoseconds per flag (SIMD)
+     */
+    void buildFlagMasks(const uint8_t* flags, size_t count,
+                        uint16_t* meaningful, uint16_t* time_checks) noexcept;
+
+    /**
+     * @brief Number of flags with any bit of flag set
+     * @performance < 0.2 nanoseconds per flag (SIMD)
+     */
+    size_t countFlagged(const uint8_t* flags, size_t count, uint8_t flag) noexcept;
+
+    /**
+     * @brief Index of the first flag with any bit of flag set
+     * @return count if none
+     * @performance < 0.2 nanoseconds per flag (SIMD)
+     */
+    size_t findFlagged(const uint8_t* flags, size_t count, uint8_t flag) noexcept;
+
+    /**
+     * @brief Name of the compiled mask backend ("neon", "sse2" or "scalar")
+     */
+    const char* gapScanBackend() noexcept;
+
+    /**
+     * @brief Append the gaps closed by a run of chronologically ordered events
+     *
+     * Same semantics as EventTimeline's gap index: the first event and
+     * every meaningful event are anchors, a gap is recorded between
+     * consecutive anchors spanning at least min_gap, and time checks
+     * strictly inside it are counted as brief interactions.
+     *
+     * @param flags Classification flags of events [first_index, first_index + count)
+     * @param count Number of events
+     * @param first_index Absolute index of flags[0]
+     * @param time_at Callable returning the system_clock::time_point of an absolute index
+     * @param min_gap Minimum anchor-to-anchor span to record
+     * @param state Anchor state, updated in place (carry it to scan in pieces)
+     * @param gaps Output, gaps appended in order
+     * @performance O(count / 16 + meaningful events in long words)
+     */
+    template<typename TimeAt>
+    void scanInteractionGaps(const uint8_t* flags, size_t count, size_t first_index,
+                             TimeAt&& time_at, std::chrono::milliseconds min_gap,
+                             GapScanState& state, TimeGapList& gaps) {
+        uint16_t meaningful_masks[GAP_SCAN_BLOCK / GAP_SCAN_LANES];
+        uint16_t time_check_masks[GAP_SCAN_BLOCK / GAP_SCAN_LANES];
+
+        for (size_t done = 0; done < count; done += GAP_SCAN_BLOCK) {
+            size_t block = std::min(GAP_SCAN_BLOCK, count - done);
+            buildFlagMasks(flags + done, block, meaningful_masks, time_check_masks);
+
+            for (size_t word = 0; word * GAP_SCAN_LANES < block; ++word) {
+                size_t base = first_index + done + word * GAP_SCAN_LANES;
+                size_t lanes = std::min(GAP_SCAN_LANES, block - word * GAP_SCAN_LANES);
+                uint32_t meaningful = meaningful_masks[word];
+                uint32_t checks = time_check_masks[word];
+
+                if (state.anchor_index == GapScanState::NPOS) {
+                    // The head event opens the first segment without being counted
+                    state.anchor_index = base;
+                    state.brief_since_anchor = 0;
+                    if (meaningful & 1u) {
+                        state.last_meaningful_index = base;
+                    }
+                    meaningful &= ~1u;
+                    checks &= ~1u;
+                }
+
+                if (meaningful == 0) {
+                    state.brief_since_anchor += __builtin_popcount(checks);
+                    continue;
+                }
+
+                auto anchor_time = time_at(state.anchor_index);
+
+                // Ordered input: if the word's last event is within min_gap of
+                // the anchor, so is every anchor-to-anchor span ending in it
+                if (time_at(base + lanes - 1) - anchor_time < min_gap) {
+                    unsigned last = 31u - static_cast<unsigned>(__builtin_clz(meaningful));
+                    state.anchor_index = base + last;
+                    state.last_meaningful_index = base + last;
+                    state.brief_since_anchor = __builtin_popcount(checks >> (last + 1));
+                    continue;
+                }
+
+                while (meaningful != 0) {
+                    unsigned bit = static_cast<unsigned>(__builtin_ctz(meaningful));
+                    uint32_t below = (1u << bit) - 1u;
+                    state.brief_since_anchor += __builtin_popcount(checks & below);
+                    checks &= ~(below | (1u << bit));
+
+                    size_t index = base + bit;
+                    auto event_time = time_at(index);
+                    if (event_time - anchor_time >= min_gap) {
+                        TimeGap gap(anchor_time, event_time);
+                        gap.brief_interaction_count = state.brief_since_anchor;
+                        gap.contains_brief_interactions = state.brief_since_anchor > 0;
+                        gaps.push_back(gap);
+                    }
+
+                    anchor_time = event_time;
+                    state.anchor_index = index;
+                    state.last_meaningful_index = index;
+                    state.brief_since_anchor = 0;
+                    meaningful &= meaningful - 1u;
+                }
+
+                state.brief_since_anchor += __builtin_popcount(checks);
+            }
+        }
+    }
+
+} // namespace puuyapu
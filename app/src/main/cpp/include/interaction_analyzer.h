@@ -53,10 +53,7 @@ namespace puuyapu {
          * @performance < 10 microseconds
          */
         static inline bool isTimeCheck(const InteractionEvent& event) noexcept {
-            return event.duration.count() < 15000 || // < 15 seconds
-                   event.type == InteractionType::TIME_CHECK ||
-                   (event.category == AppCategory::CLOCK_ALARM &&
-                    event.duration.count() < 30000);
+            return event.isTimeCheck();
         }
 
         /**
@@ -66,10 +63,7 @@ namespace puuyapu {
          * @performance < 10 microseconds
          */
         static inline bool isMeaningfulUsage(const InteractionEvent& event) noexcept {
-            return event.duration.count() >= 30000 || // >= 30 seconds
-                   event.type == InteractionType::MEANINGFUL_USE ||
-                   event.type == InteractionType::EXTENDED_USE ||
-                   event.type == InteractionType::NOTIFICATION_RESPONSE;
+            return event.isMeaningfulUse();
         }
     };
 
@@ -1,34 +1,345 @@
-// memory_pool.h - Custom memory management for high performance
-template<typename T>
-class ObjectPool {
-private:
-    std::vector<std::unique_ptr<T>> available;
-    std::vector<std::unique_ptr<T>> inUse;
-
-public:
-    T* acquire() {
-        if (available.empty()) {
-            available.push_back(std::make_unique<T>());
-        }
-
-        auto obj = std::move(available.back());
-        available.pop_back();
-        T* ptr = obj.get();
-        inUse.push_back(std::move(obj));
-        return ptr;
-    }
-
-    void release(T* obj) {
-        auto it = std::find_if(inUse.begin(), inUse.end(),
-                               [obj](const std::unique_ptr<T>& ptr) { return ptr.get() == obj; });
-
-        if (it != inUse.end()) {
-            available.push_back(std::move(*it));
-            inUse.erase(it);
-        }
-    }
-};
-
-// Global pools for frequently used objects
-extern ObjectPool<InteractionEvent> g_eventPool;
-extern ObjectPool<SleepSession> g_sessionPool;
\ No newline at end of file
+/**
+ * @file memory_pool.h
+ * @brief Fixed-capacity slab allocator with a lock-free intrusive free list
+ *
+ * ObjectPool<T> preallocates every slot up front; acquire and release are
+ * O(1) CAS operations on a tagged free-list head (the tag defeats ABA), so
+ * pooled objects never touch the global heap after construction.
+ * LocalCache adds an optional per-thread front end that moves slots to
+ * and from the shared list in batches. BlockPoolAllocator serves small
+ * std::vector buffers (interruption lists) from a process-wide slab and
+ * falls back to the heap only for oversized requests or exhaustion.
+ *
+ * @performance Target: < 50 nanoseconds per acquire/release
+ */
+
+#pragma once
+
+#include <atomic>
+#include <cstddef>
+#include <cstdint>
+#include <memory>
+#include <new>
+#include <utility>
+
+namespace puuyapu {
+
+    template<typename T>
+    class ObjectPool;
+
+    /**
+     * @brief Owning handle to a pooled object (move-only, like unique_ptr)
+     * Destroys the object and returns its slot on destruction.
+     */
+    template<typename T>
+    class PoolHandle {
+    public:
+        PoolHandle() noexcept = default;
+        PoolHandle(ObjectPool<T>* pool, T* object) noexcept : pool_(pool), object_(object) {}
+
+        PoolHandle(PoolHandle&& other) noexcept
+                : pool_(std::exchange(other.pool_, nullptr)), object_(std::exchange(other.object_, nullptr)) {}
+
+        PoolHandle& operator=(PoolHandle&& other) noexcept {
+            if (this != &other) {
+                reset();
+                pool_ = std::exchange(other.pool_, nullptr);
+                object_ = std::exchange(other.object_, nullptr);
+            }
+            return *this;
+        }
+
+        PoolHandle(const PoolHandle&) = delete;
+        PoolHandle& operator=(const PoolHandle&) = delete;
+
+        ~PoolHandle() noexcept { reset(); }
+
+        T* get() const noexcept { return object_; }
+        T* operator->() const noexcept { return object_; }
+        T& operator*() const noexcept { return *object_; }
+        explicit operator bool() const noexcept { return object_ != nullptr; }
+
+        void reset() noexcept {
+            if (object_) {
+                object_->~T();
+                pool_->deallocate(object_);
+                object_ = nullptr;
+                pool_ = nullptr;
+            }
+        }
+
+    private:
+        ObjectPool<T>* pool_{nullptr};
+        T* object_{nullptr};
+    };
+
+    /**
+     * @brief Fixed-capacity slab of T slots
+     *
+     * Thread-safe and lock-free. Slots hold their own free-list link next
+     * to (not inside) the object storage, so a racing pop never reads
+     * memory a new owner is writing. All handles must be released before
+     * the pool is destroyed.
+     */
+    template<typename T>
+    class ObjectPool {
+    public:
+        /**
+         * @param capacity Number of slots, allocated once here
+         */
+        explicit ObjectPool(size_t capacity)
+                : capacity_(static_cast<uint32_t>(capacity)),
+                  slots_(new Slot[capacity]) {
+            for (uint32_t i = 0; i < capacity_; ++i) {
+                slots_[i].next.store(i + 1 < capacity_ ? i + 1 : NIL, std::memory_order_relaxed);
+            }
+            head_.store(pack(0, capacity_ > 0 ? 0 : NIL), std::memory_order_release);
+            available_.store(capacity_, std::memory_order_relaxed);
+        }
+
+        ObjectPool(const ObjectPool&) = delete;
+        ObjectPool& operator=(const ObjectPool&) = delete;
+
+        /**
+         * @brief Construct an object in a free slot
+         * @return Empty handle if the pool is exhausted
+         * @performance O(1)
+         */
+        template<typename... Args>
+        PoolHandle<T> acquire(Args&&... args) noexcept {
+            void* slot = allocate();
+            if (!slot) {
+                return {};
+            }
+            return PoolHandle<T>(this, new(slot) T(std::forward<Args>(args)...));
+        }
+
+        /**
+         * @brief Take an uninitialized slot (suitably aligned for T)
+         * @return nullptr if the pool is exhausted
+         * @performance O(1), one CAS when uncontended
+         */
+        void* allocate() noexcept {
+            uint64_t head = head_.load(std::memory_order_acquire);
+            while (indexOf(head) != NIL) {
+                uint32_t index = indexOf(head);
+                uint32_t next = slots_[index].next.load(std::memory_order_relaxed);
+                if (head_.compare_exchange_weak(head, pack(tagOf(head) + 1, next),
+                                                std::memory_order_acquire, std::memory_order_acquire)) {
+                    available_.fetch_sub(1, std::memory_order_relaxed);
+                    return slots_[index].storage;
+                }
+            }
+            return nullptr;
+        }
+
+        /**
+         * @brief Return a slot taken with allocate (object already destroyed)
+         * @performance O(1)
+         */
+        void deallocate(void* pointer) noexcept {
+            uint32_t index = indexOfSlot(pointer);
+            uint64_t head = head_.load(std::memory_order_relaxed);
+            do {
+                slots_[index].next.store(indexOf(head), std::memory_order_relaxed);
+            } while (!head_.compare_exchange_weak(head, pack(tagOf(head) + 1, index),
+                                                  std::memory_order_release, std::memory_order_relaxed));
+            available_.fetch_add(1, std::memory_order_relaxed);
+        }
+
+        /// True if pointer lies inside this pool's slab
+        bool owns(const void* pointer) const noexcept {
+            auto address = reinterpret_cast<uintptr_t>(pointer);
+            auto begin = reinterpret_cast<uintptr_t>(slots_.get());
+            return address >= begin && address < begin + capacity_ * sizeof(Slot);
+        }
+
+        size_t capacity() const noexcept { return capacity_; }
+
+        /// Free slots in the shared list (excludes slots parked in LocalCaches)
+        size_t available() const noexcept { return available_.load(std::memory_order_relaxed); }
+
+        /**
+         * @brief Per-thread front end: serves up to CACHE_SLOTS slots without touching the shared list
+         *
+         * Owned by one thread (typically thread_local). Refills and spills
+         * half its capacity at a time; returns everything on destruction.
+         */
+        class LocalCache {
+        public:
+            static constexpr size_t CACHE_SLOTS = 16;
+
+            explicit LocalCache(ObjectPool& pool) noexcept : pool_(pool) {}
+
+            LocalCache(const LocalCache&) = delete;
+            LocalCache& operator=(const LocalCache&) = delete;
+
+            ~LocalCache() noexcept { flush(); }
+
+            void* allocate() noexcept {
+                if (count_ == 0) {
+                    while (count_ < CACHE_SLOTS / 2) {
+                        void* slot = pool_.allocate();
+                        if (!slot) {
+                            break;
+                        }
+                        slots_[count_++] = slot;
+                    }
+                    if (count_ == 0) {
+                        return nullptr;
+                    }
+                }
+                return slots_[--count_];
+            }
+
+            void deallocate(void* pointer) noexcept {
+                if (count_ == CACHE_SLOTS) {
+                    while (count_ > CACHE_SLOTS / 2) {
+                        pool_.deallocate(slots_[--count_]);
+                    }
+                }
+                slots_[count_++] = pointer;
+            }
+
+            /// Return every cached slot to the shared list
+            void flush() noexcept {
+                while (count_ > 0) {
+                    pool_.deallocate(slots_[--count_]);
+                }
+            }
+
+        private:
+            ObjectPool& pool_;
+            void* slots_[CACHE_SLOTS];
+            size_t count_{0};
+        };
+
+    private:
+        static constexpr uint32_t NIL = UINT32_MAX;
+
+        struct Slot {
+            alignas(T) unsigned char storage[sizeof(T)];
+            std::atomic<uint32_t> next{NIL};
+        };
+
+        static uint64_t pack(uint32_t tag, uint32_t index) noexcept {
+            return (static_cast<uint64_t>(tag) << 32) | index;
+        }
+        static uint32_t tagOf(uint64_t head) noexcept { return static_cast<uint32_t>(head >> 32); }
+        static uint32_t indexOf(uint64_t head) noexcept { return static_cast<uint32_t>(head); }
+
+        uint32_t indexOfSlot(const void* pointer) const noexcept {
+            // storage is the first member, so a slot and its storage share an address
+            return static_cast<uint32_t>(reinterpret_cast<const Slot*>(pointer) - slots_.get());
+        }
+
+        const uint32_t capacity_;
+        std::unique_ptr<Slot[]> slots_;
+        std::atomic<uint64_t> head_{0};     ///< Tag (high 32 bits) | first free index
+        std::atomic<size_t> available_{0};
+    };
+
+    /**
+     * @brief std allocator serving buffers of up to BlockElements from a shared slab
+     *
+     * Stateless: every instance for the same parameters uses one process-wide
+     * ObjectPool of PoolBlocks blocks, fronted by a thread_local LocalCache.
+     * The slab is created on first use and intentionally never destroyed, so
+     * containers may be freed during static or thread teardown, and on any
+     * thread: a block freed elsewhere joins that thread's cache. Once a
+     * thread's cache has been destroyed (its thread_local teardown), that
+     * thread goes to the shared list directly; a thread's cached blocks
+     * return to the slab when it exits or calls releaseThreadCache().
+     */
+    template<typename T, size_t BlockElements, size_t PoolBlocks>
+    class BlockPoolAllocator {
+    public:
+        using value_type = T;
+
+        template<typename U>
+        struct rebind {
+            using other = BlockPoolAllocator<U, BlockElements, PoolBlocks>;
+        };
+
+        BlockPoolAllocator() noexcept = default;
+
+        template<typename U>
+        BlockPoolAllocator(const BlockPoolAllocator<U, BlockElements, PoolBlocks>&) noexcept {}
+
+        T* allocate(size_t count) {
+            if (count <= BlockElements) {
+                auto* cache = localCache();
+                if (void* block = cache ? cache->allocate() : sharedPool().allocate()) {
+                    return static_cast<T*>(block);
+                }
+            }
+            return static_cast<T*>(::operator new(count * sizeof(T)));
+        }
+
+        void deallocate(T* pointer, size_t) noexcept {
+            if (sharedPool().owns(pointer)) {
+                if (auto* cache = localCache()) {
+                    cache->deallocate(pointer);
+                } else {
+                    sharedPool().deallocate(pointer);
+                }
+            } else {
+                ::operator delete(pointer);
+            }
+        }
+
+        /**
+         * @brief Return the calling thread's cached blocks to the shared slab
+         * For threads that stop using the allocator long before they exit.
+         */
+        static void releaseThreadCache() noexcept {
+            if (auto* cache = localCache()) {
+                cache->flush();
+            }
+        }
+
+        /// Blocks currently free in the shared slab, excluding thread caches (diagnostics)
+        static size_t availableBlocks() noexcept { return sharedPool().available(); }
+
+        template<typename U>
+        bool operator==(const BlockPoolAllocator<U, BlockElements, PoolBlocks>&) const noexcept { return true; }
+
+        template<typename U>
+        bool operator!=(const BlockPoolAllocator<U, BlockElements, PoolBlocks>&) const noexcept { return false; }
+
+    private:
+        struct Block {
+            alignas(T) unsigned char bytes[sizeof(T) * BlockElements];
+        };
+
+        static ObjectPool<Block>& sharedPool() noexcept {
+            static ObjectPool<Block>* pool = new ObjectPool<Block>(PoolBlocks);
+            return *pool;
+        }
+
+        enum class CacheState : uint8_t { UNUSED, LIVE, DESTROYED };
+
+        /// Trivially destructible, so it stays readable through thread_local teardown
+        static CacheState& cacheState() noexcept {
+            static thread_local CacheState state = CacheState::UNUSED;
+            return state;
+        }
+
+        struct ThreadCache {
+            typename ObjectPool<Block>::LocalCache cache{sharedPool()};
+
+            ThreadCache() noexcept { cacheState() = CacheState::LIVE; }
+            ~ThreadCache() noexcept { cacheState() = CacheState::DESTROYED; }
+        };
+
+        /// This thread's cache, or nullptr once it has been torn down
+        static typename ObjectPool<Block>::LocalCache* localCache() noexcept {
+            if (cacheState() == CacheState::DESTROYED) {
+                return nullptr;
+            }
+            static thread_local ThreadCache thread_cache;
+            return &thread_cache.cache;
+        }
+    };
+
+} // namespace puuyapu
@@ -0,0 +1,208 @@
+/**
+ * @file metrics.h
+ * @brief Lock-free latency metrics with per-thread log-bucketed histograms
+ *
+ * Metric IDs are fixed at compile time, so recording a sample never
+ * allocates or hashes a string. Each recording thread owns a block of
+ * HDR-style histograms (8 sub-buckets per power of two, ~12.5% relative
+ * precision) that only it writes; snapshots merge all blocks and report
+ * count, mean, p50, p99 and max per metric.
+ *
+ * @performance Record: ~20ns (single-writer stores, no RMW, no lock)
+ */
+
+#pragma once
+
+#include <array>
+#include <chrono>
+#include <cstdint>
+#include <cstddef>
+
+namespace puuyapu {
+
+    /**
+     * @brief Compile-time registry of measured operations
+     * Append new IDs before COUNT and add the name to METRIC_NAMES.
+     */
+    enum class MetricId : uint8_t {
+        // Core engine
+        ADD_INTERACTION_EVENT = 0,
+        ADD_INTERACTION_EVENTS,
+        DETECT_SLEEP_PERIOD,
+        DETECT_SLEEP_PERIODS,
+        IS_CURRENTLY_ASLEEP,
+        CLEAR_OLD_DATA,
+        ATTACH_EVENT_LOG,
+        ARCHIVE_APPEND,
+        ARCHIVE_READ,
+        NEXT_STATE_TRANSITION,
+        DETECTION_WORKER_PASS,
+        WRITE_SNAPSHOT,
+        RESTORE_SNAPSHOT,
+
+        // JNI bridge
+        JNI_INITIALIZE,
+        JNI_INITIALIZE_WITH_STORAGE,
+        JNI_ADD_INTERACTION_EVENT,
+        JNI_ADD_INTERACTION_EVENTS,
+        JNI_ADD_INTERACTION_EVENTS_ARRAY,
+        JNI_DETECT_SLEEP,
+        JNI_DETECT_SLEEP_PACKED,
+        JNI_DETECT_SLEEP_PERIODS_PACKED,
+        JNI_EXPORT_SLEEP_HISTORY,
+        JNI_CALCULATE_CONFIDENCE,
+        JNI_UPDATE_PREFERENCES,
+        JNI_IS_CURRENTLY_ASLEEP,
+        JNI_GET_ESTIMATED_SLEEP_START,
+        JNI_CLEAR_OLD_DATA,
+        JNI_OPTIMIZE_MEMORY,
+        JNI_CONFIRM_MANUAL_SLEEP,
+        JNI_GET_PERFORMANCE_METRICS,
+        JNI_OPEN_SESSION_ARCHIVE,
+        JNI_ARCHIVE_SLEEP_HISTORY,
+        JNI_LOAD_RECENT_NIGHTS_PACKED,
+        JNI_GET_NEXT_STATE_TRANSITION,
+        JNI_SET_DETECTION_LISTENER,
+        JNI_POST_DETECTION_REQUEST,
+        JNI_CREATE_DETECTOR,
+        JNI_DESTROY_DETECTOR,
+        JNI_SET_RETENTION_POLICY,
+        JNI_GET_EVENTS_PACKED,
+        JNI_RANK_SLEEP_CANDIDATES,
+        JNI_ADD_ACCELEROMETER_SAMPLES,
+        JNI_GET_SLEEP_STATISTICS,
+        JNI_INITIALIZE_FROM_SNAPSHOT,
+        JNI_SET_USER_PREFERENCES,
+
+        COUNT
+    };
+
+    constexpr size_t METRIC_COUNT = static_cast<size_t>(MetricId::COUNT);
+
+    namespace detail {
+        constexpr const char* METRIC_NAMES[] = {
+                "add_interaction_event",
+                "add_interaction_events",
+                "detect_sleep_period",
+                "detect_sleep_periods",
+                "is_currently_asleep",
+                "clear_old_data",
+                "attach_event_log",
+                "archive_append",
+                "archive_read",
+                "next_state_transition",
+                "detection_worker_pass",
+                "write_snapshot",
+                "restore_snapshot",
+
+                "jni_initialize",
+                "jni_initialize_with_storage",
+                "jni_add_interaction_event",
+                "jni_add_interaction_events",
+                "jni_add_interaction_events_array",
+                "jni_detect_sleep",
+                "jni_detect_sleep_packed",
+                "jni_detect_sleep_periods_packed",
+                "jni_export_sleep_history",
+                "jni_calculate_confidence",
+                "jni_update_preferences",
+                "jni_is_currently_asleep",
+                "jni_get_estimated_sleep_start",
+                "jni_clear_old_data",
+                "jni_optimize_memory",
+                "jni_confirm_manual_sleep",
+                "jni_get_performance_metrics",
+                "jni_open_session_archive",
+                "jni_archive_sleep_history",
+                "jni_load_recent_nights_packed",
+                "jni_get_next_state_transition",
+                "jni_set_detection_listener",
+                "jni_post_detection_request",
+                "jni_create_detector",
+                "jni_destroy_detector",
+                "jni_set_retention_policy",
+                "jni_get_events_packed",
+                "jni_rank_sleep_candidates",
+                "jni_add_accelerometer_samples",
+                "jni_get_sleep_statistics",
+                "jni_initialize_from_snapshot",
+                "jni_set_user_preferences",
+        };
+
+        static_assert(sizeof(METRIC_NAMES) / sizeof(METRIC_NAMES[0]) == METRIC_COUNT,
+                      "Every MetricId needs a name");
+    }
+
+    constexpr const char* metricName(MetricId id) noexcept {
+        return detail::METRIC_NAMES[static_cast<size_t>(id)];
+    }
+
+    /**
+     * @brief Merged latency distribution of one metric
+     * Percentiles are bucket upper bounds (never under-reported), capped at max.
+     */
+    struct LatencySummary {
+        uint64_t count{0};
+        std::chrono::nanoseconds mean{0};
+        std::chrono::nanoseconds p50{0};
+        std::chrono::nanoseconds p99{0};
+        std::chrono::nanoseconds max{0};
+    };
+
+    /**
+     * @brief Point-in-time view of every metric
+     */
+    struct MetricsSnapshot {
+        std::array<LatencySummary, METRIC_COUNT> latencies{};
+
+        const LatencySummary& operator[](MetricId id) const noexcept {
+            return latencies[static_cast<size_t>(id)];
+        }
+    };
+
+    namespace Metrics {
+        /// Histogram layout: values < 8ns exact, then 8 sub-buckets per power of two up to 2^40ns
+        constexpr size_t SUB_BUCKET_BITS = 3;
+        constexpr size_t SUB_BUCKETS = size_t{1} << SUB_BUCKET_BITS;
+        constexpr size_t MAX_EXPONENT = 40;
+        constexpr size_t BUCKET_COUNT = (MAX_EXPONENT - SUB_BUCKET_BITS + 2) * SUB_BUCKETS;
+
+        /**
+         * @brief Record one latency sample for the calling thread
+         * @performance Target: < 50 nanoseconds
+         */
+        void record(MetricId id, std::chrono::nanoseconds latency) noexcept;
+
+        /**
+         * @brief Merge all threads' histograms
+         * @performance Target: < 200 microseconds
+         */
+        MetricsSnapshot snapshot() noexcept;
+
+        /**
+         * @brief Zero all histograms (approximate while samples are being recorded)
+         */
+        void reset() noexcept;
+    }
+
+    /**
+     * @brief RAII latency sample for a registered metric
+     */
+    class ScopedMetricTimer {
+    public:
+        explicit ScopedMetricTimer(MetricId id) noexcept
+                : id_(id), start_(std::chrono::steady_clock::now()) {}
+
+        ~ScopedMetricTimer() {
+            Metrics::record(id_, std::chrono::steady_clock::now() - start_);
+        }
+
+        ScopedMetricTimer(const ScopedMetricTimer&) = delete;
+        ScopedMetricTimer& operator=(const ScopedMetricTimer&) = delete;
+
+    private:
+        MetricId id_;
+        std::chrono::steady_clock::time_point start_;
+    };
+
+} // namespace puuyapu
@@ -0,0 +1,140 @@
+/**
+ * @file night_summary_store.h
+ * @brief Compact per-night summaries, the middle retention tier
+ *
+ * When a night leaves the raw-event window its events are folded into a
+ * NightSummary (classification counts, an hourly histogram of brief
+ * interactions and the night's gap list) and dropped from the timeline.
+ * A summary costs a few hundred bytes instead of the night's thousands
+ * of columnar events, and keeps old nights available for pattern
+ * learning and diagnostics after their raw events are gone.
+ *
+ * Gaps are stored flat in one shared array, like the finalized store's
+ * interruptions.
+ *
+ * Not thread-safe: owned by SleepDetector under its event lock.
+ *
+ * @performance Add O(1) amortized for the newest night, lookup O(log nights)
+ */
+
+#pragma once
+
+#include "puuyapu_types.h"
+#include "detector_snapshot.h"
+#include <array>
+#include <cstdint>
+#include <vector>
+
+namespace puuyapu {
+
+    /**
+     * @brief Downsampled record of one night window (local noon to noon)
+     */
+    struct NightSummary {
+        static constexpr size_t HISTOGRAM_BUCKETS = 24;     ///< One per hour, bucket 0 starts at local noon
+        static constexpr size_t TYPE_COUNT = 6;             ///< InteractionType values
+
+        int64_t night_index{0};
+        int64_t first_event_ms{0};
+        int64_t last_event_ms{0};
+        uint32_t event_count{0};
+
+        // Classification counts (EventFlag bits)
+        uint32_t time_checks{0};
+        uint32_t meaningful{0};
+        uint32_t sleep_related{0};
+        uint32_t brief{0};
+        std::array<uint32_t, TYPE_COUNT> type_counts{};     ///< Indexed by InteractionType
+
+        /// Brief interactions (likely mid-sleep checks) per hour of the window
+        std::array<uint16_t, HISTOGRAM_BUCKETS> interruption_histogram{};
+
+        /**
+         * @brief Fold another summary of the same night into this one
+         * Used when late events arrive for a night already summarized.
+         */
+        void merge(const NightSummary& other) noexcept;
+    };
+
+    /**
+     * @brief Night-indexed store of summaries (oldest first)
+     */
+    class NightSummaryStore {
+    public:
+        static constexpr size_t NPOS = SIZE_MAX;
+
+        /**
+         * @brief Add a night's summary and its gaps
+         *
+         * A night that is already present is merged: counts accumulate
+         * and the gaps are appended to its list.
+         *
+         * @param summary Summary of the night
+         * @param gaps Gaps that started inside the night window
+         * @param gap_count Number of gaps
+         */
+        void add(const NightSummary& summary, const TimeGap* gaps, size_t gap_count);
+
+        /**
+         * @brief Change how many nights are kept, dropping the oldest beyond it
+         */
+        void setCapacity(size_t nights);
+        size_t capacity() const noexcept { return capacity_; }
+
+        /**
+         * @brief Position of a night
+         * @return Index into the store, or NPOS if not summarized
+         */
+        size_t find(int64_t night_index) const noexcept;
+
+        /**
+         * @brief Index of the first night >= night_index
+         */
+        size_t lowerBound(int64_t night_index) const noexcept;
+
+        size_t size() const noexcept { return nights_.size(); }
+        bool empty() const noexcept { return nights_.empty(); }
+
+        const NightSummary& at(size_t index) const noexcept { return nights_[index].summary; }
+
+        /**
+         * @brief Gaps of a night, chronological
+         * @param index Store position
+         * @param count Receives the number of gaps
+         */
+        const TimeGap* gapsAt(size_t index, size_t& count) const noexcept {
+            count = nights_[index].gap_count;
+            return gaps_.data() + nights_[index].first_gap;
+        }
+
+        /**
+         * @brief Encode every summary and its gaps (SnapshotSection::SUMMARIES)
+         */
+        void writeTo(SnapshotWriter& writer) const;
+
+        /**
+         * @brief Replace the store with decoded summaries, keeping the capacity
+         * @return false if the section is malformed (store unchanged)
+         */
+        bool readFrom(SnapshotReader& reader);
+
+        void clear() noexcept;
+
+        size_t memoryUsageBytes() const noexcept;
+
+    private:
+        struct Night {
+            NightSummary summary;
+            uint32_t first_gap;
+            uint32_t gap_count;
+        };
+
+        void dropOldest(size_t count) noexcept;
+        void compactGaps() noexcept;
+
+        std::vector<Night> nights_;
+        std::vector<TimeGap> gaps_;
+        size_t capacity_{Performance::SUMMARY_RETENTION_NIGHTS};
+    };
+
+} // namespace puuyapu
@@ -3,51 +3,128 @@
  * @brief Sleep pattern recognition and historical comparison
  *
  * Analyzes user's historical sleep patterns to improve detection accuracy.
- * Uses statistical analysis to identify typical sleep schedules.
+ * Per-weekday bedtime and wake statistics are kept as online circular
+ * means (clock times wrap at midnight, so 23:50 and 00:10 average to
+ * 00:00), durations as online linear mean/variance. Every update and every
+ * score is O(1) regardless of how much history has been learned.
  *
- * @performance Target: < 1ms pattern matching
+ * @performance Target: < 1 microsecond pattern matching
  */
 
 #pragma once
 
 #include "puuyapu_types.h"
-#include <unordered_map>
+#include "detector_snapshot.h"
 #include <array>
+#include <cstdint>
 
 namespace puuyapu {
 
+    /**
+     * @brief Online mean and spread of a clock time (minutes since midnight)
+     *
+     * Welford-style running mean of the unit vector of each sample's angle
+     * on the 24h clock. The sample weight is 1/n up to a horizon, then
+     * fixed, so the statistic follows schedule changes instead of freezing.
+     */
+    struct CircularTimeStats {
+        double mean_cos{0.0};
+        double mean_sin{0.0};
+        uint32_t samples{0};
+
+        void add(double minute_of_day, uint32_t horizon) noexcept;
+
+        /// Circular mean in minutes since midnight (0-1439.99)
+        double meanMinutes() const noexcept;
+
+        /// Circular standard deviation in minutes
+        double spreadMinutes() const noexcept;
+
+        /// Mean resultant length: 1.0 = identical times, 0.0 = no preferred time
+        double concentration() const noexcept;
+    };
+
+    /**
+     * @brief Online mean and variance (Welford, exponentially weighted past the horizon)
+     */
+    struct RunningStats {
+        double mean{0.0};
+        double variance{0.0};
+        uint32_t samples{0};
+
+        void add(double value, uint32_t horizon) noexcept;
+
+        double standardDeviation() const noexcept;
+    };
+
+    /**
+     * @brief Shortest distance between two clock times, in minutes (0-720)
+     */
+    double circularDistanceMinutes(double a, double b) noexcept;
+
     /**
      * @brief Historical sleep pattern analyzer
      *
      * Maintains statistical models of user's sleep patterns to improve
-     * detection accuracy through personalization.
+     * detection accuracy through personalization. Owned by SleepDetector
+     * and fed from every finished detection; not thread-safe, the owner
+     * serializes updates against reads.
      */
     class PatternMatcher {
+    public:
+        /// Samples after which a weekday's statistics become a moving window (~3 months)
+        static constexpr uint32_t WEEKDAY_HORIZON = 12;
+
+        /// Samples after which the all-days statistics become a moving window
+        static constexpr uint32_t OVERALL_HORIZON = 60;
+
+        /// Sessions required before regularity is reported (a week of data)
+        static constexpr size_t MIN_SESSIONS_FOR_REGULARITY = 7;
+
+        /// Nights before the newest learned one that are still told apart from repeats
+        static constexpr int64_t LEARNED_NIGHT_WINDOW = 64;
+
     private:
-        // Weekly pattern storage (day of week -> typical bedtime/wake time)
-        std::array<std::chrono::minutes, 7> typical_bedtimes_;
-        std::array<std::chrono::minutes, 7> typical_wake_times_;
-        std::array<double, 7> pattern_confidence_;
+        struct WeekdayProfile {
+            CircularTimeStats bedtime;
+            CircularTimeStats wake_time;
+            double confidence{0.0};
+        };
+
+        std::array<WeekdayProfile, 7> weekdays_{};
 
         // Overall statistics
-        std::chrono::duration<double, std::ratio<3600>> average_sleep_duration_{8.0};
+        CircularTimeStats overall_bedtime_;
+        RunningStats sleep_duration_hours_;
         double schedule_regularity_score_{0.0};
         size_t total_sleep_sessions_{0};
+        int64_t last_learned_night_{INT64_MIN};     ///< Newest learned night
+        uint64_t learned_nights_{0};                ///< Bit k: night last_learned_night_ - k was learned
 
     public:
         /**
          * @brief Update patterns with new sleep session
+         *
+         * Each night is learned once, in any order: a night already
+         * learned, or more than LEARNED_NIGHT_WINDOW nights older than the
+         * newest learned one, is ignored.
+         *
          * @param session Completed sleep session to learn from
-         * @performance < 200 microseconds
+         * @return true if the session was learned
+         * @performance < 1 microsecond
          */
-        void updatePatterns(const SleepDetectionResult& session) noexcept;
+        bool updatePatterns(const SleepDetectionResult& session) noexcept;
 
         /**
          * @brief Calculate how well a sleep session matches historical patterns
+         *
+         * Pure similarity to the learned profile, not weighted by how much
+         * has been learned; combine with getPatternConfidence.
+         *
          * @param bedtime Detected bedtime
          * @param wake_time Detected wake time
-         * @return Pattern match score 0.0-1.0
-         * @performance < 300 microseconds
+         * @return Pattern match score 0.0-1.0 (0.0 without history)
+         * @performance < 1 microsecond
          */
         double calculatePatternMatch(
                 std::chrono::system_clock::time_point bedtime,
@@ -56,11 +133,18 @@ namespace puuyapu {
         /**
          * @brief Get expected bedtime for specific day
          * @param day_of_week 0=Sunday, 1=Monday, ..., 6=Saturday
-         * @return Expected bedtime in minutes since midnight
+         * @return Expected bedtime in minutes since midnight (23:30 until learned)
          * @performance < 20 microseconds
          */
         std::chrono::minutes getExpectedBedtime(int day_of_week) const noexcept;
 
+        /**
+         * @brief How much the learned profile of a weekday can be trusted
+         * @param day_of_week 0=Sunday, 1=Monday, ..., 6=Saturday
+         * @return 0.0 (nothing learned) to 1.0
+         */
+        double getPatternConfidence(int day_of_week) const noexcept;
+
         /**
          * @brief Check if current pattern suggests user is likely sleeping
          * @param current_time Current timestamp
@@ -78,6 +162,32 @@ namespace puuyapu {
          * @performance < 10 microseconds
          */
         double getScheduleRegularity() const noexcept { return schedule_regularity_score_; }
+
+        size_t getSessionCount() const noexcept { return total_sleep_sessions_; }
+
+        /**
+         * @brief Encode the learned profile (SnapshotSection::PATTERNS)
+         */
+        void writeTo(SnapshotWriter& writer) const;
+
+        /**
+         * @brief Replace the profile with a decoded one
+         * @return false if the section is malformed (profile unchanged)
+         */
+        bool readFrom(SnapshotReader& reader) noexcept;
+
+    private:
+        /**
+         * @brief Record a night as learned
+         * @return false if it was learned before (or is too old to tell)
+         */
+        bool markLearned(int64_t night_index) noexcept;
+
+        /**
+         * @brief Refresh regularity from the running all-days bedtime spread
+         * @performance O(1)
+         */
+        void updateScheduleRegularity() noexcept;
     };
 
 } // namespace puuyapu
@@ -1,32 +1,29 @@
 // performance_monitor.h - Built-in performance tracking
+#pragma once
+
+#include "metrics.h"
+#include <chrono>
+
+namespace puuyapu {
+
+// Thin start/stop facade over the Metrics registry (one timer per monitor)
 class PerformanceMonitor {
 private:
-    std::unordered_map<std::string, std::chrono::high_resolution_clock::time_point> timers;
-    std::unordered_map<std::string, double> averageTimes;
+    std::chrono::steady_clock::time_point startTime{};
 
 public:
-    void startTimer(const std::string& operation) {
-        timers[operation] = std::chrono::high_resolution_clock::now();
+    void startTimer() noexcept {
+        startTime = std::chrono::steady_clock::now();
     }
 
-    void endTimer(const std::string& operation) {
-        auto endTime = std::chrono::high_resolution_clock::now();
-        auto duration = std::chrono::duration_cast<std::chrono::microseconds>(
-                endTime - timers[operation]
-        ).count();
-
-        // Update running average
-        averageTimes[operation] = (averageTimes[operation] + duration) / 2.0;
-
-#ifdef DEBUG
-        __android_log_print(ANDROID_LOG_DEBUG, "PuuyApu",
-            "Operation %s took %ld microseconds",
-            operation.c_str(), duration);
-#endif
+    void endTimer(MetricId operation) noexcept {
+        Metrics::record(operation, std::chrono::steady_clock::now() - startTime);
     }
 
-    double getAverageTime(const std::string& operation) const {
-        auto it = averageTimes.find(operation);
-        return it != averageTimes.end() ? it->second : 0.0;
+    // Mean over every recorded sample, in microseconds
+    double getAverageTime(MetricId operation) const noexcept {
+        return static_cast<double>(Metrics::snapshot()[operation].mean.count()) / 1000.0;
     }
-};
\ No newline at end of file
+};
+
+} // namespace puuyapu
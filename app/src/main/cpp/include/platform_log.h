@@ -0,0 +1,62 @@
+/**
+ * @file platform_log.h
+ * @brief Logging shim: Android log on device, stderr on host builds
+ *
+ * Lets the core library build and run on a workstation (benchmarks,
+ * replay tools) without the NDK. Host builds print warnings and errors
+ * only, unless PUUYAPU_HOST_LOG_VERBOSE is defined, so benchmark loops
+ * are not dominated by I/O.
+ */
+
+#pragma once
+
+#if defined(__ANDROID__)
+
+#include <android/log.h>
+
+#define PUUYAPU_LOG_DEBUG ANDROID_LOG_DEBUG
+#define PUUYAPU_LOG_INFO ANDROID_LOG_INFO
+#define PUUYAPU_LOG_WARN ANDROID_LOG_WARN
+#define PUUYAPU_LOG_ERROR ANDROID_LOG_ERROR
+
+#define PUUYAPU_LOG_PRINT(priority, tag, ...) __android_log_print(priority, tag, __VA_ARGS__)
+
+#else
+
+#include <cstdarg>
+#include <cstdio>
+
+#define PUUYAPU_LOG_DEBUG 3
+#define PUUYAPU_LOG_INFO 4
+#define PUUYAPU_LOG_WARN 5
+#define PUUYAPU_LOG_ERROR 6
+
+#define PUUYAPU_LOG_PRINT(priority, tag, ...) ::puuyapu::hostLogPrint(priority, tag, __VA_ARGS__)
+
+namespace puuyapu {
+
+    /**
+     * @brief stderr fallback with the same signature as __android_log_print
+     */
+    __attribute__((format(printf, 3, 4)))
+    inline int hostLogPrint(int priority, const char* tag, const char* format, ...) noexcept {
+#ifndef PUUYAPU_HOST_LOG_VERBOSE
+        if (priority < PUUYAPU_LOG_WARN) {
+            return 0;
+        }
+#endif
+        static constexpr char LEVELS[] = "??VDIWEF";
+        char level = (priority >= 0 && priority < 8) ? LEVELS[priority] : '?';
+
+        std::fprintf(stderr, "%c/%s: ", level, tag);
+        va_list args;
+        va_start(args, format);
+        int written = std::vfprintf(stderr, format, args);
+        va_end(args);
+        std::fputc('\n', stderr);
+        return written;
+    }
+
+} // namespace puuyapu
+
+#endif
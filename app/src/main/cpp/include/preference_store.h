@@ -0,0 +1,121 @@
+/**
+ * @file preference_store.h
+ * @brief Immutable, versioned UserPreferences snapshots with lock-free reads
+ *
+ * Readers pin the current snapshot with a single atomic increment and
+ * never take a lock; writers publish a new snapshot and reclaim the old
+ * one only after every reader that could have seen it has left
+ * (two-counter epoch scheme, as in userspace RCU).
+ *
+ * @performance Read: two atomic RMW, Update: O(readers) wait, rare
+ */
+
+#pragma once
+
+#include "puuyapu_types.h"
+#include <atomic>
+#include <mutex>
+#include <cstdint>
+
+namespace puuyapu {
+
+    /**
+     * @brief Published preferences plus version metadata
+     *
+     * Never modified after publication.
+     */
+    struct PreferenceSnapshot {
+        UserPreferences preferences;
+        uint64_t version;               ///< Increments on every update
+        uint64_t detection_generation;  ///< Increments only when detection inputs change
+    };
+
+    /**
+     * @brief RCU-style holder for the current preference snapshot
+     */
+    class PreferenceStore {
+    public:
+        /**
+         * @brief RAII read-side critical section
+         *
+         * The snapshot stays valid for the lifetime of the guard.
+         * Keep guards short-lived: updates wait for them to drop.
+         */
+        class ReadGuard {
+        public:
+            ReadGuard(ReadGuard&& other) noexcept
+                    : snapshot_(other.snapshot_), counter_(other.counter_) {
+                other.counter_ = nullptr;
+            }
+
+            ReadGuard(const ReadGuard&) = delete;
+            ReadGuard& operator=(const ReadGuard&) = delete;
+            ReadGuard& operator=(ReadGuard&&) = delete;
+
+            ~ReadGuard() {
+                if (counter_) {
+                    counter_->fetch_sub(1, std::memory_order_release);
+                }
+            }
+
+            const PreferenceSnapshot& snapshot() const noexcept { return *snapshot_; }
+            const UserPreferences& operator*() const noexcept { return snapshot_->preferences; }
+            const UserPreferences* operator->() const noexcept { return &snapshot_->preferences; }
+
+        private:
+            friend class PreferenceStore;
+
+            ReadGuard(const PreferenceSnapshot* snapshot, std::atomic<uint32_t>* counter) noexcept
+                    : snapshot_(snapshot), counter_(counter) {}
+
+            const PreferenceSnapshot* snapshot_;
+            std::atomic<uint32_t>* counter_;
+        };
+
+        /**
+         * @brief Create store with an initial (already validated) snapshot
+         */
+        explicit PreferenceStore(const UserPreferences& initial);
+        ~PreferenceStore() noexcept;
+
+        PreferenceStore(const PreferenceStore&) = delete;
+        PreferenceStore& operator=(const PreferenceStore&) = delete;
+
+        /**
+         * @brief Pin the current snapshot (never blocks)
+         * @performance Target: < 100 nanoseconds
+         */
+        ReadGuard read() const noexcept {
+            uint32_t epoch = epoch_.load(std::memory_order_seq_cst);
+            std::atomic<uint32_t>* counter = &readers_[epoch & 1];
+            counter->fetch_add(1, std::memory_order_seq_cst);
+            return ReadGuard(current_.load(std::memory_order_seq_cst), counter);
+        }
+
+        /**
+         * @brief Publish new preferences and reclaim the previous snapshot
+         *
+         * Writers are serialized. Returns after no reader can still hold
+         * the previous snapshot, so it must not be called while the calling
+         * thread holds a ReadGuard.
+         *
+         * @param preferences New preferences (caller validates)
+         * @return true if detection inputs changed (detection_generation bumped)
+         * @performance Target: < 200 microseconds without long-lived readers
+         */
+        bool update(const UserPreferences& preferences) noexcept;
+
+    private:
+        /**
+         * @brief Wait until all readers that may see the old snapshot are gone
+         * Flips the epoch twice so readers racing with the first flip are covered.
+         */
+        void synchronize() noexcept;
+
+        std::atomic<const PreferenceSnapshot*> current_;
+        mutable std::atomic<uint32_t> epoch_{0};
+        mutable std::atomic<uint32_t> readers_[2] = {{0}, {0}};
+        std::mutex writer_mutex_;
+    };
+
+} // namespace puuyapu
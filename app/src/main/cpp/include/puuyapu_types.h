@@ -12,6 +12,8 @@
 
 #pragma once
 
+#include "memory_pool.h"
+#include <algorithm>
 #include <chrono>
 #include <vector>
 #include <optional>
@@ -53,6 +55,111 @@ namespace puuyapu {
         SYSTEM = 6           ///< Settings, system apps
     };
 
+/**
+ * @brief Classification bits computed once per event at ingest
+ *
+ * Retained events carry these in EventColumnStore's flag column, so scans
+ * test bits instead of re-evaluating duration and category rules.
+ */
+    enum EventFlag : uint8_t {
+        EVENT_FLAG_TIME_CHECK = 0x01,     ///< Brief time or notification check
+        EVENT_FLAG_MEANINGFUL = 0x02,     ///< Active use, a gap anchor
+        EVENT_FLAG_SLEEP_RELATED = 0x04,  ///< Sleep confirmation or alarm setting
+        EVENT_FLAG_BRIEF = 0x08           ///< Short enough to be a brief interruption
+    };
+
+/**
+ * @brief Duration cutoffs of the event classification policy
+ *
+ * The single definition behind every time check / meaningful / sleep
+ * related / brief decision. The defaults are the historical rules;
+ * ClassificationPolicy derives the user variant from
+ * UserPreferences::time_check_threshold.
+ */
+    struct ClassificationThresholds {
+        int64_t time_check_ms{15000};       ///< Any shorter event is a time check
+        int64_t clock_check_ms{30000};      ///< Shorter clock/alarm events are time checks
+        int64_t meaningful_ms{30000};       ///< Events at least this long are meaningful
+        int64_t brief_ms{30000};            ///< Shorter events are brief interruptions
+        int64_t sleep_related_ms{10000};    ///< Shorter clock/alarm events are sleep related
+        int64_t extended_ms{300000};        ///< Inferred EXTENDED_USE from this duration on
+
+        constexpr bool operator==(const ClassificationThresholds& other) const noexcept {
+            return time_check_ms == other.time_check_ms &&
+                   clock_check_ms == other.clock_check_ms &&
+                   meaningful_ms == other.meaningful_ms &&
+                   brief_ms == other.brief_ms &&
+                   sleep_related_ms == other.sleep_related_ms &&
+                   extended_ms == other.extended_ms;
+        }
+
+        constexpr bool operator!=(const ClassificationThresholds& other) const noexcept {
+            return !(*this == other);
+        }
+    };
+
+    inline constexpr ClassificationThresholds DEFAULT_CLASSIFICATION{};
+
+/**
+ * @brief EventFlag bits of an interaction under the given thresholds
+ *
+ * Branchless: every rule is a comparison folded with bitwise ors, so
+ * block classification loops stay straight-line.
+ *
+ * @performance < 2 nanoseconds
+ */
+    constexpr uint8_t classifyEvent(const ClassificationThresholds& thresholds,
+                                    InteractionType type, AppCategory category,
+                                    int64_t duration_ms) noexcept {
+        const uint8_t clock = static_cast<uint8_t>(category == AppCategory::CLOCK_ALARM);
+
+        const uint8_t time_check = static_cast<uint8_t>(duration_ms < thresholds.time_check_ms) |
+                                   static_cast<uint8_t>(type == InteractionType::TIME_CHECK) |
+                                   (clock & static_cast<uint8_t>(duration_ms < thresholds.clock_check_ms));
+        const uint8_t meaningful = static_cast<uint8_t>(duration_ms >= thresholds.meaningful_ms) |
+                                   static_cast<uint8_t>(type == InteractionType::MEANINGFUL_USE) |
+                                   static_cast<uint8_t>(type == InteractionType::EXTENDED_USE) |
+                                   static_cast<uint8_t>(type == InteractionType::NOTIFICATION_RESPONSE);
+        const uint8_t sleep_related = static_cast<uint8_t>(type == InteractionType::SLEEP_CONFIRMATION) |
+                                      (clock & static_cast<uint8_t>(duration_ms < thresholds.sleep_related_ms));
+        const uint8_t brief = static_cast<uint8_t>(duration_ms < thresholds.brief_ms);
+
+        return static_cast<uint8_t>(time_check * EVENT_FLAG_TIME_CHECK |
+                                    meaningful * EVENT_FLAG_MEANINGFUL |
+                                    sleep_related * EVENT_FLAG_SLEEP_RELATED |
+                                    brief * EVENT_FLAG_BRIEF);
+    }
+
+/**
+ * @brief Interaction type implied by duration alone (producers without a type)
+ */
+    constexpr InteractionType inferEventType(const ClassificationThresholds& thresholds,
+                                             int64_t duration_ms) noexcept {
+        return duration_ms < thresholds.brief_ms ? InteractionType::TIME_CHECK
+             : duration_ms < thresholds.extended_ms ? InteractionType::MEANINGFUL_USE
+             : InteractionType::EXTENDED_USE;
+    }
+
+/**
+ * @brief Classification with thresholds fixed at compile time
+ *
+ * Every cutoff is an immediate, so the default policy costs no loads.
+ * Used where no user preferences apply (records, stateless analysis).
+ */
+    template<const ClassificationThresholds& Thresholds>
+    struct StaticClassification {
+        static constexpr uint8_t classify(InteractionType type, AppCategory category,
+                                          int64_t duration_ms) noexcept {
+            return classifyEvent(Thresholds, type, category, duration_ms);
+        }
+
+        static constexpr InteractionType inferType(int64_t duration_ms) noexcept {
+            return inferEventType(Thresholds, duration_ms);
+        }
+    };
+
+    using DefaultClassification = StaticClassification<DEFAULT_CLASSIFICATION>;
+
 /**
  * @brief Sleep detection confidence levels
  *
@@ -71,7 +178,8 @@ namespace puuyapu {
  * @brief High-performance interaction event structure
  *
  * Represents a single phone interaction event.
- * Memory layout optimized for cache efficiency (32 bytes aligned).
+ * This is the exchange record (40 bytes on 64-bit ABIs); retained history
+ * is stored column-wise by EventColumnStore at 13 bytes per event.
  *
  * @performance All operations < 100 microseconds
  */
@@ -113,15 +221,21 @@ namespace puuyapu {
                    type == other.type;
         }
 
+        /**
+         * @brief EventFlag bits under the default classification policy
+         * @performance < 2 nanoseconds
+         */
+        inline uint8_t classificationFlags() const noexcept {
+            return DefaultClassification::classify(type, category, duration.count());
+        }
+
         /**
          * @brief Check if this represents a brief time check vs meaningful use
          * @return true if likely just checking time/notifications briefly
          * @performance < 10 microseconds
          */
         inline bool isTimeCheck() const noexcept {
-            return type == InteractionType::TIME_CHECK ||
-                   (category == AppCategory::CLOCK_ALARM && duration.count() < 30000) ||
-                   duration.count() < 15000; // Less than 15 seconds is likely time check
+            return (classificationFlags() & EVENT_FLAG_TIME_CHECK) != 0;
         }
 
         /**
@@ -130,10 +244,7 @@ namespace puuyapu {
          * @performance < 10 microseconds
          */
         inline bool isMeaningfulUse() const noexcept {
-            return type == InteractionType::MEANINGFUL_USE ||
-                   type == InteractionType::EXTENDED_USE ||
-                   type == InteractionType::NOTIFICATION_RESPONSE ||
-                   duration.count() >= 30000; // 30+ seconds is meaningful
+            return (classificationFlags() & EVENT_FLAG_MEANINGFUL) != 0;
         }
 
         /**
@@ -142,9 +253,30 @@ namespace puuyapu {
          * @performance < 10 microseconds
          */
         inline bool isSleepRelated() const noexcept {
-            return type == InteractionType::SLEEP_CONFIRMATION ||
-                   (category == AppCategory::CLOCK_ALARM && duration.count() < 10000);
+            return (classificationFlags() & EVENT_FLAG_SLEEP_RELATED) != 0;
         }
+
+        /**
+         * @brief Fixed binary record size used for JNI batches and storage
+         *
+         * Layout (native byte order, little-endian on all Android ABIs):
+         * [0,8) int64 timestamp (ns since epoch), [8,16) int64 duration (ms),
+         * [16] type, [17] category, [18,20) app_hash, [20,24) session_id,
+         * [24,32) user_interaction_count
+         */
+        static constexpr size_t SERIALIZED_SIZE = 32;
+
+        /**
+         * @brief Write record into buffer (at least SERIALIZED_SIZE bytes, any alignment)
+         * @performance < 1 microsecond
+         */
+        void serialize(uint8_t* buffer) const noexcept;
+
+        /**
+         * @brief Read record from buffer (at least SERIALIZED_SIZE bytes, any alignment)
+         * @performance < 1 microsecond
+         */
+        static InteractionEvent deserialize(const uint8_t* buffer) noexcept;
     };
 
 /**
@@ -168,8 +300,19 @@ namespace puuyapu {
                 std::chrono::milliseconds dur,
                 InteractionType c,
                 AppCategory cat = AppCategory::UNKNOWN
+        ) noexcept : SleepInterruption(ts, dur, c, cat, dur.count() < DEFAULT_CLASSIFICATION.brief_ms) {}
+
+        /**
+         * @param brief EVENT_FLAG_BRIEF of the interrupting event
+         */
+        SleepInterruption(
+                std::chrono::system_clock::time_point ts,
+                std::chrono::milliseconds dur,
+                InteractionType c,
+                AppCategory cat,
+                bool brief
         ) noexcept : timestamp(ts), duration(dur), cause(c), app_category(cat),
-                     is_brief_check(dur.count() < 30000), impact_score(0.0) {
+                     is_brief_check(brief), impact_score(0.0) {
 
             // Calculate impact score based on duration and timing
             if (is_brief_check) {
@@ -181,6 +324,15 @@ namespace puuyapu {
         }
     };
 
+/**
+ * @brief Interruption storage for one night
+ *
+ * Lists of up to 32 interruptions (a 1KB block) come from a shared 64-block
+ * slab instead of the global heap, so copying and dropping results in
+ * steady-state detection does not hit malloc; longer lists spill to the heap.
+ */
+    using SleepInterruptionList = std::vector<SleepInterruption, BlockPoolAllocator<SleepInterruption, 32, 64>>;
+
 /**
  * @brief Complete sleep detection result with confidence metrics
  *
@@ -192,7 +344,7 @@ namespace puuyapu {
         std::optional<std::chrono::system_clock::time_point> wake_time;   ///< When sleep ended
         std::chrono::duration<double, std::ratio<3600>> duration{0};      ///< Sleep duration in hours
         SleepConfidence confidence{SleepConfidence::LOW};                 ///< Detection confidence
-        std::vector<SleepInterruption> interruptions;                     ///< Mid-sleep wake-ups
+        SleepInterruptionList interruptions;                              ///< Mid-sleep wake-ups (slab-backed)
         double quality_score{0.0};                                        ///< 0.0-1.0, overall sleep quality
         bool is_manually_confirmed{false};                                ///< User pressed "Going to Sleep" button
         double pattern_match_score{0.0};                                  ///< How well this matches user's typical pattern
@@ -252,6 +404,28 @@ namespace puuyapu {
         }
     };
 
+/**
+ * @brief Kind of time-driven change in the detection state
+ */
+    enum class StateTransitionKind : uint8_t {
+        NONE = 0,            ///< Nothing changes until a new event arrives
+        SLEEP_ONSET = 1,     ///< Inactivity reaches the sleep gap: asleep from the last meaningful use
+        NIGHT_FINALIZED = 2  ///< The detected night's window closes; its session can no longer change
+    };
+
+/**
+ * @brief Earliest future instant at which detection results could change without new input
+ *
+ * Lets the platform schedule one exact alarm instead of polling. Any
+ * new event, preference update or timezone change invalidates it.
+ */
+    struct StateTransition {
+        StateTransitionKind kind{StateTransitionKind::NONE};
+        std::chrono::system_clock::time_point at{};     ///< Meaningful unless kind is NONE
+
+        bool hasTransition() const noexcept { return kind != StateTransitionKind::NONE; }
+    };
+
 /**
  * @brief User preferences for personalized sleep tracking
  *
@@ -310,14 +484,79 @@ namespace puuyapu {
         /**
          * @brief Check if interaction duration suggests time check
          * @param duration How long the interaction lasted
-         * @return true if duration suggests brief time check
+         * @return true if duration suggests brief time check (EVENT_FLAG_BRIEF)
          * @performance < 10 microseconds
          */
         bool isLikelyTimeCheck(std::chrono::milliseconds duration) const noexcept {
-            return duration <= time_check_threshold;
+            return duration < time_check_threshold;
         }
     };
 
+/**
+ * @brief Event classification policy in effect for a detector
+ *
+ * Runtime counterpart of StaticClassification: the cutoffs follow
+ * UserPreferences::time_check_threshold. Brief, clock-check and
+ * meaningful cutoffs equal the threshold and the plain time-check cutoff
+ * is half of it, so the default 30 seconds reproduces
+ * DEFAULT_CLASSIFICATION exactly.
+ */
+    class ClassificationPolicy {
+    public:
+        constexpr ClassificationPolicy() noexcept = default;
+
+        explicit constexpr ClassificationPolicy(const ClassificationThresholds& thresholds) noexcept
+                : thresholds_(thresholds) {}
+
+        /**
+         * @brief Policy for a preference set (threshold clamped to 1 s .. 5 min)
+         */
+        static constexpr ClassificationPolicy fromPreferences(const UserPreferences& preferences) noexcept {
+            int64_t threshold_ms = std::chrono::duration_cast<std::chrono::milliseconds>(
+                    preferences.time_check_threshold).count();
+            threshold_ms = threshold_ms < 1000 ? 1000
+                         : threshold_ms > DEFAULT_CLASSIFICATION.extended_ms ? DEFAULT_CLASSIFICATION.extended_ms
+                         : threshold_ms;
+
+            ClassificationThresholds thresholds;
+            thresholds.time_check_ms = threshold_ms / 2;
+            thresholds.clock_check_ms = threshold_ms;
+            thresholds.meaningful_ms = threshold_ms;
+            thresholds.brief_ms = threshold_ms;
+            return ClassificationPolicy(thresholds);
+        }
+
+        constexpr uint8_t classify(InteractionType type, AppCategory category,
+                                   int64_t duration_ms) const noexcept {
+            return classifyEvent(thresholds_, type, category, duration_ms);
+        }
+
+        constexpr uint8_t classify(const InteractionEvent& event) const noexcept {
+            return classify(event.type, event.category, event.duration.count());
+        }
+
+        constexpr InteractionType inferType(int64_t duration_ms) const noexcept {
+            return inferEventType(thresholds_, duration_ms);
+        }
+
+        constexpr const ClassificationThresholds& thresholds() const noexcept { return thresholds_; }
+        constexpr bool isDefault() const noexcept { return thresholds_ == DEFAULT_CLASSIFICATION; }
+
+        constexpr bool operator==(const ClassificationPolicy& other) const noexcept {
+            return thresholds_ == other.thresholds_;
+        }
+
+        constexpr bool operator!=(const ClassificationPolicy& other) const noexcept {
+            return thresholds_ != other.thresholds_;
+        }
+
+    private:
+        ClassificationThresholds thresholds_{};
+    };
+
+    static_assert(ClassificationPolicy::fromPreferences(UserPreferences{}).isDefault(),
+                  "Default preferences must map to the default classification");
+
 /**
  * @brief Time gap structure for gap analysis
  *
@@ -365,15 +604,64 @@ namespace puuyapu {
 
 // Type aliases for convenience and performance
     using InteractionEventList = std::vector<InteractionEvent>;
-    using SleepInterruptionList = std::vector<SleepInterruption>;
     using TimeGapList = std::vector<TimeGap>;
 
 // Performance constants for optimization
     namespace Performance {
-        constexpr size_t MAX_EVENTS_CACHE = 10000;           ///< Maximum events to keep in memory
+        constexpr size_t MAX_EVENTS_CACHE = 10000;           ///< Typical working set for preallocation
+        constexpr size_t MAX_EVENTS_RETAINED = 262144;       ///< Hard cap on retained events (~3.4MB columnar)
+        constexpr size_t INGRESS_QUEUE_CAPACITY = 4096;      ///< Pending events between producer and detector (~192KB)
+        constexpr size_t MAX_ACTIVITY_EPOCHS = 23040;        ///< 30-second motion epochs retained: 8 days (~360KB)
         constexpr size_t DETECTION_BATCH_SIZE = 1000;        ///< Events to process per batch
-        constexpr std::chrono::hours DATA_RETENTION_DAYS{30}; ///< How long to keep historical data
+        constexpr std::chrono::hours DATA_RETENTION_DAYS{24 * 30}; ///< How long to keep historical data (30 days)
         constexpr std::chrono::milliseconds CACHE_TTL{300000}; ///< Cache validity: 5 minutes
+        constexpr std::chrono::hours SLEEP_CANDIDATE_WINDOW{24}; ///< Gaps ranked against the most recent one
+
+        // Retention tiers (RetentionPolicy defaults), in night windows
+        constexpr uint32_t RAW_RETENTION_NIGHTS = 7;         ///< Raw events, current night included
+        constexpr uint32_t SUMMARY_RETENTION_NIGHTS = 90;    ///< Night summaries (~400 bytes each)
+        constexpr uint32_t SESSION_RETENTION_NIGHTS = 400;   ///< Finalized sessions (about 13 months)
     }
 
+    /**
+     * @brief How much history each retention tier keeps
+     *
+     * Raw events cover the newest raw_nights night windows, within a
+     * max_raw_events budget (~13 bytes each in columnar form). Older
+     * nights are sealed and folded into night summaries, and only their
+     * finalized sessions survive past summary_nights. Memory is therefore
+     * bounded by these four numbers, not by how long the app has run.
+     */
+    struct RetentionPolicy {
+        uint32_t raw_nights{Performance::RAW_RETENTION_NIGHTS};
+        uint32_t summary_nights{Performance::SUMMARY_RETENTION_NIGHTS};
+        uint32_t session_nights{Performance::SESSION_RETENTION_NIGHTS};
+        size_t max_raw_events{Performance::MAX_EVENTS_RETAINED};
+
+        /**
+         * @brief Bring every field into its supported range
+         *
+         * raw_nights stays inside the timeline's own retention window and
+         * max_raw_events under its hard cap, so events only ever leave the
+         * timeline through the summary tier.
+         */
+        constexpr RetentionPolicy clamped() const noexcept {
+            constexpr uint32_t MAX_RAW_NIGHTS =
+                    static_cast<uint32_t>(Performance::DATA_RETENTION_DAYS / std::chrono::hours(24)) - 1;
+            constexpr size_t MIN_RAW_EVENTS = 1024;
+
+            RetentionPolicy policy = *this;
+            policy.raw_nights = std::min(std::max(raw_nights, uint32_t{1}), MAX_RAW_NIGHTS);
+            policy.session_nights = std::max(session_nights, uint32_t{1});
+            policy.max_raw_events = std::min(std::max(max_raw_events, MIN_RAW_EVENTS), Performance::MAX_EVENTS_RETAINED);
+            return policy;
+        }
+
+        constexpr bool operator==(const RetentionPolicy& other) const noexcept {
+            return raw_nights == other.raw_nights && summary_nights == other.summary_nights &&
+                   session_nights == other.session_nights && max_raw_events == other.max_raw_events;
+        }
+        constexpr bool operator!=(const RetentionPolicy& other) const noexcept { return !(*this == other); }
+    };
+
 } // namespace puuyapu
\ No newline at end of file
@@ -0,0 +1,139 @@
+/**
+ * @file scratch_arena.h
+ * @brief Reusable bump arena for per-pass detection intermediates
+ *
+ * ScratchArena hands out memory by bumping a pointer through chunks it
+ * owns and keeps. reset() rewinds it in O(1) without freeing anything, so
+ * a caller that resets once per pass stops touching the global heap as
+ * soon as the arena has grown to its working-set size. ArenaAllocator
+ * adapts it to std containers; deallocation is a no-op.
+ *
+ * @performance Target: < 10 nanoseconds per allocation, O(1) reset
+ */
+
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <memory>
+#include <vector>
+
+namespace puuyapu {
+
+    /**
+     * @brief Monotonic chunked arena, rewound between passes
+     *
+     * Not thread-safe; the owner serializes allocation and reset. Objects
+     * placed in the arena are never destroyed by it: containers using
+     * ArenaAllocator must be destroyed before the next reset().
+     */
+    class ScratchArena {
+    public:
+        static constexpr size_t DEFAULT_CHUNK_BYTES = 16 * 1024;
+
+        /**
+         * @param initial_bytes Size of the first chunk, allocated on first use
+         */
+        explicit ScratchArena(size_t initial_bytes = DEFAULT_CHUNK_BYTES) noexcept
+                : next_chunk_bytes_(initial_bytes > 0 ? initial_bytes : DEFAULT_CHUNK_BYTES) {}
+
+        ScratchArena(const ScratchArena&) = delete;
+        ScratchArena& operator=(const ScratchArena&) = delete;
+
+        ScratchArena(ScratchArena&&) noexcept = default;
+        ScratchArena& operator=(ScratchArena&&) noexcept = default;
+
+        /**
+         * @brief Bump-allocate bytes with the given power-of-two alignment
+         * @performance O(1); a new chunk only when the current one is full
+         */
+        void* allocate(size_t bytes, size_t alignment) noexcept {
+            uintptr_t aligned = (cursor_ + alignment - 1) & ~(static_cast<uintptr_t>(alignment) - 1);
+            if (aligned + bytes <= limit_) {
+                cursor_ = aligned + bytes;
+                used_bytes_ += bytes;
+                return reinterpret_cast<void*>(aligned);
+            }
+            return allocateSlow(bytes, alignment);
+        }
+
+        /**
+         * @brief Rewind to empty, keeping the memory
+         *
+         * If the last pass spilled into several chunks they are merged into
+         * one chunk of their combined size, so the next pass of the same
+         * shape is served from a single chunk without heap traffic.
+         */
+        void reset() noexcept;
+
+        /**
+         * @brief Free every chunk (e.g. from optimizeMemory)
+         */
+        void release() noexcept;
+
+        /// Bytes reserved from the heap
+        size_t capacityBytes() const noexcept { return capacity_bytes_; }
+
+        /// Bytes handed out since the last reset
+        size_t usedBytes() const noexcept { return used_bytes_; }
+
+        /// Largest usedBytes() seen at a reset
+        size_t highWaterBytes() const noexcept { return high_water_bytes_; }
+
+    private:
+        struct Chunk {
+            std::unique_ptr<unsigned char[]> memory;
+            size_t bytes;
+        };
+
+        void* allocateSlow(size_t bytes, size_t alignment) noexcept;
+        void useChunk(size_t index) noexcept;
+
+        std::vector<Chunk> chunks_;
+        size_t current_chunk_{0};
+        uintptr_t cursor_{0};
+        uintptr_t limit_{0};
+        size_t next_chunk_bytes_;
+        size_t capacity_bytes_{0};
+        size_t used_bytes_{0};
+        size_t high_water_bytes_{0};
+    };
+
+    /**
+     * @brief std allocator drawing from a ScratchArena
+     *
+     * Copies share the arena. deallocate does nothing; memory comes back
+     * when the arena is reset.
+     */
+    template<typename T>
+    class ArenaAllocator {
+    public:
+        using value_type = T;
+
+        explicit ArenaAllocator(ScratchArena& arena) noexcept : arena_(&arena) {}
+
+        template<typename U>
+        ArenaAllocator(const ArenaAllocator<U>& other) noexcept : arena_(other.arena()) {}
+
+        T* allocate(size_t count) noexcept {
+            return static_cast<T*>(arena_->allocate(count * sizeof(T), alignof(T)));
+        }
+
+        void deallocate(T*, size_t) noexcept {}
+
+        ScratchArena* arena() const noexcept { return arena_; }
+
+        template<typename U>
+        bool operator==(const ArenaAllocator<U>& other) const noexcept { return arena_ == other.arena(); }
+
+        template<typename U>
+        bool operator!=(const ArenaAllocator<U>& other) const noexcept { return arena_ != other.arena(); }
+
+    private:
+        ScratchArena* arena_;
+    };
+
+    template<typename T>
+    using ArenaVector = std::vector<T, ArenaAllocator<T>>;
+
+} // namespace puuyapu
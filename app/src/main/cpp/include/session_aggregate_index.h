@@ -0,0 +1,137 @@
+/**
+ * @file session_aggregate_index.h
+ * @brief Prefix-sum index over sealed nights for constant-time range statistics
+ *
+ * Dashboards ask for averages, sleep debt, efficiency and regularity over
+ * a week, a month or all of history. Instead of walking the session list
+ * (and every night's interruptions for efficiency) on each query, the
+ * index keeps one additive SleepAggregate per day, as two running sums
+ * over a dense day axis:
+ * - prefix: everything before day k, so [a, b) is prefix[b] - prefix[a]
+ * - stride: day k plus every 7th day before it, so one weekday's nights
+ *   in [a, b) is a difference of two stride entries
+ *
+ * Both are O(1) per query. Appending the newest night is O(1); sealing an
+ * older night updates the sums after it (O(days), once per night at most).
+ *
+ * Not thread-safe: owned by FinalizedSessionStore (SleepDetector's event lock).
+ *
+ * @performance Query O(1), append O(1) amortized
+ */
+
+#pragma once
+
+#include "puuyapu_types.h"
+#include <array>
+#include <cstdint>
+#include <vector>
+
+namespace puuyapu {
+
+    /**
+     * @brief Additive statistics of a set of nights
+     *
+     * Bedtimes are minutes since the night window opened (local noon), so
+     * sums never wrap at midnight.
+     */
+    struct SleepAggregate {
+        uint32_t sessions{0};
+        uint32_t manually_confirmed{0};
+        uint32_t interruptions{0};
+        double duration_hours{0.0};
+        double duration_hours_sq{0.0};
+        double efficiency{0.0};             ///< Sum of calculateSleepEfficiency
+        double quality{0.0};                ///< Sum of quality_score
+        double bedtime_minutes{0.0};
+        double bedtime_minutes_sq{0.0};
+
+        /**
+         * @brief Aggregate of one night
+         * @param result Sealed result
+         * @param bedtime_minutes_since_noon Bedtime within its night window
+         */
+        static SleepAggregate of(const SleepDetectionResult& result, double bedtime_minutes_since_noon) noexcept;
+
+        SleepAggregate& operator+=(const SleepAggregate& other) noexcept;
+        SleepAggregate& operator-=(const SleepAggregate& other) noexcept;
+
+        double averageDurationHours() const noexcept { return sessions > 0 ? duration_hours / sessions : 0.0; }
+        double averageEfficiency() const noexcept { return sessions > 0 ? efficiency / sessions : 0.0; }
+        double averageQuality() const noexcept { return sessions > 0 ? quality / sessions : 0.0; }
+        double interruptionsPerNight() const noexcept {
+            return sessions > 0 ? static_cast<double>(interruptions) / sessions : 0.0;
+        }
+
+        /**
+         * @brief Net sleep debt against a nightly target (negative is surplus)
+         */
+        double sleepDebtHours(double target_hours) const noexcept {
+            return sessions * target_hours - duration_hours;
+        }
+
+        double durationStdDevHours() const noexcept;
+
+        /// Mean bedtime as a local minute of day (0-1439)
+        double meanBedtimeMinuteOfDay() const noexcept;
+
+        double bedtimeSpreadMinutes() const noexcept;
+
+        /**
+         * @brief 0.0-1.0 schedule regularity, PatternMatcher's scale
+         * (3 hours of bedtime spread is 0; needs MIN_SESSIONS_FOR_REGULARITY nights)
+         */
+        double regularity() const noexcept;
+    };
+
+    /**
+     * @brief Day-indexed prefix sums over sealed nights
+     */
+    class SessionAggregateIndex {
+    public:
+        static constexpr int WEEKDAYS = 7;
+
+        /**
+         * @brief Fold in one night
+         * @return false if the night precedes the first indexed day (caller rebuilds)
+         */
+        bool add(int64_t night_index, const SleepAggregate& night);
+
+        /**
+         * @brief Nights with night_index in [from_night, to_night)
+         */
+        SleepAggregate range(int64_t from_night, int64_t to_night) const noexcept;
+
+        /**
+         * @brief Nights of one evening weekday (0=Sunday) with night_index in [from_night, to_night)
+         */
+        SleepAggregate weekday(int64_t from_night, int64_t to_night, int weekday) const noexcept;
+
+        /// Evening weekday of a night window (0=Sunday)
+        static int weekdayOf(int64_t night_index) noexcept {
+            int weekday = static_cast<int>((night_index + 4) % WEEKDAYS);   // 1970-01-01 was a Thursday
+            return weekday < 0 ? weekday + WEEKDAYS : weekday;
+        }
+
+        bool empty() const noexcept { return stride_.empty(); }
+        int64_t firstNight() const noexcept { return first_night_; }
+        size_t days() const noexcept { return stride_.size(); }
+
+        void clear() noexcept;
+
+        size_t memoryUsageBytes() const noexcept {
+            return (prefix_.capacity() + stride_.capacity()) * sizeof(SleepAggregate);
+        }
+
+    private:
+        /// Sum of the stride chain ending at day (0 before the first day)
+        const SleepAggregate& strideAt(int64_t day) const noexcept;
+
+        /// Last day <= day that falls on weekday (may be negative)
+        int64_t lastWeekdayAtOrBefore(int64_t day, int weekday) const noexcept;
+
+        int64_t first_night_{0};
+        std::vector<SleepAggregate> prefix_;    ///< days() + 1 entries, prefix_[0] is empty
+        std::vector<SleepAggregate> stride_;    ///< days() entries
+    };
+
+} // namespace puuyapu
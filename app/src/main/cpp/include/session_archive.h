@@ -0,0 +1,183 @@
+/**
+ * @file session_archive.h
+ * @brief Compressed, month-indexed archive of finished sleep sessions
+ *
+ * The single persistent format for SleepDetectionResult history. Sessions
+ * are delta/varint encoded into one block per local calendar month; a
+ * month index and a fixed footer at the end of the file let a reader find
+ * any month, or the last N nights, with three or four small preads and no
+ * scan of older history. A typical night takes 15-20 bytes plus about 10
+ * bytes per interruption, so years of history fit in a few hundred KB.
+ *
+ * File layout (little-endian):
+ *   Header (16 bytes): [0] u32 magic "PSA1", [4] u16 version,
+ *                      [6] u16 header size, [8] u64 reserved
+ *   Month blocks, oldest first, each a run of session records
+ *   Month index: one 32-byte entry per block
+ *     [0] i32 month key (year * 12 + month - 1), [4] u32 session count,
+ *     [8] i64 first bedtime ms, [16] i64 last bedtime ms,
+ *     [24] u32 block offset, [28] u32 block length
+ *   Footer (32 bytes, at EOF): [0] u64 index offset, [8] u32 index entries,
+ *     [12] u32 total sessions, [16] u32 CRC-32 of the index, [20] u16 version,
+ *     [22] u16 footer size, [24] u32 reserved, [28] u32 magic
+ *
+ * Session record (varints are LEB128, signed values zigzag encoded):
+ *   svarint bedtime delta ms (from the previous record, or the block's
+ *   first bedtime), varint time in bed ms, svarint duration ms minus time
+ *   in bed, u8 confidence | 0x08 manually confirmed, u16 quality,
+ *   u16 pattern match (scores quantized to 1/65535), varint interruption
+ *   count, then per interruption: svarint timestamp delta ms (from the
+ *   previous interruption, or bedtime), varint duration ms, u8 cause,
+ *   u8 app category, u8 flags (0x01 brief check), u16 impact score
+ *
+ * Appends rewrite only the newest month block plus index and footer into a
+ * temporary file that replaces the archive by rename, so a crash leaves
+ * either the old or the new archive, never a torn one.
+ *
+ * Not thread-safe for append; concurrent reads of an unchanged archive are safe.
+ *
+ * @performance Target: < 1ms to load the last 30 nights
+ */
+
+#pragma once
+
+#include "puuyapu_types.h"
+#include <chrono>
+#include <cstdint>
+#include <string>
+#include <vector>
+
+namespace puuyapu {
+
+    /**
+     * @brief Month-indexed history of finished sleep sessions
+     */
+    class SessionArchive {
+    public:
+        static constexpr uint32_t MAGIC = 0x31415350;       ///< "PSA1" in little-endian byte order
+        static constexpr uint16_t FORMAT_VERSION = 1;
+        static constexpr size_t HEADER_BYTES = 16;
+        static constexpr size_t INDEX_ENTRY_BYTES = 32;
+        static constexpr size_t FOOTER_BYTES = 32;
+
+        /**
+         * @brief Index entry for one month block
+         */
+        struct MonthBlock {
+            int32_t month_key;          ///< year * 12 + (month - 1), local calendar month of the night
+            uint32_t session_count;
+            int64_t first_bedtime_ms;
+            int64_t last_bedtime_ms;
+            uint32_t offset;            ///< Byte offset of the block in the file
+            uint32_t length;            ///< Encoded block size in bytes
+        };
+
+        SessionArchive() = default;
+        ~SessionArchive() noexcept;
+
+        SessionArchive(const SessionArchive&) = delete;
+        SessionArchive& operator=(const SessionArchive&) = delete;
+
+        /**
+         * @brief Open an archive, reading only its header, footer and month index
+         *
+         * A missing file opens as an empty archive that the first append creates.
+         *
+         * @param path Archive file path (its directory must be writable for appends)
+         * @return false if the file exists but is not a valid archive
+         * @performance Target: < 100 microseconds (three preads)
+         */
+        bool open(const std::string& path) noexcept;
+
+        bool isOpen() const noexcept { return !path_.empty(); }
+
+        size_t sessionCount() const noexcept { return total_sessions_; }
+
+        /// Month index, oldest first
+        const std::vector<MonthBlock>& months() const noexcept { return index_; }
+
+        /**
+         * @brief Bedtime of the newest archived session (epoch ms), 0 if empty
+         */
+        int64_t lastBedtimeMs() const noexcept {
+            return index_.empty() ? 0 : index_.back().last_bedtime_ms;
+        }
+
+        /**
+         * @brief Append finished sessions newer than the newest archived one
+         *
+         * Invalid sessions (no bedtime or wake time) and sessions not newer
+         * than lastBedtimeMs() are skipped, so appending an overlapping
+         * detection window is idempotent.
+         *
+         * @param sessions Detection results in any order
+         * @return Number of sessions archived, 0 on failure or if nothing was new
+         * @performance Target: < 2ms (copies older months, re-encodes the newest)
+         */
+        size_t append(const std::vector<SleepDetectionResult>& sessions) noexcept;
+
+        /**
+         * @brief Newest nights, oldest first
+         * Reads only the trailing month blocks that hold them.
+         * @param count Maximum number of nights
+         * @performance Target: < 1ms for 30 nights
+         */
+        std::vector<SleepDetectionResult> readLastNights(size_t count) const noexcept;
+
+        /**
+         * @brief Sessions whose bedtime falls in [from, to), oldest first
+         * @performance Target: < 1ms per month of history
+         */
+        std::vector<SleepDetectionResult> readRange(
+                std::chrono::system_clock::time_point from,
+                std::chrono::system_clock::time_point to) const noexcept;
+
+        /**
+         * @brief All sessions of one local calendar month
+         * @param year Calendar year
+         * @param month 1-12
+         */
+        std::vector<SleepDetectionResult> readMonth(int year, unsigned month) const noexcept;
+
+        /**
+         * @brief Month key of a session's night (year * 12 + month - 1)
+         */
+        static int32_t monthKeyOf(std::chrono::system_clock::time_point bedtime) noexcept;
+
+        /**
+         * @brief Encode one session record
+         * @param out Buffer of at least maxRecordSize(session) bytes
+         * @return Bytes written
+         */
+        static size_t encodeSession(const SleepDetectionResult& session,
+                                    int64_t previous_bedtime_ms,
+                                    uint8_t* out) noexcept;
+
+        /**
+         * @brief Decode one session record
+         * @param previous_bedtime_ms In: previous bedtime; out: this record's bedtime
+         * @return Bytes consumed, 0 if the record is truncated or malformed
+         */
+        static size_t decodeSession(const uint8_t* data,
+                                    size_t size,
+                                    int64_t& previous_bedtime_ms,
+                                    SleepDetectionResult& session) noexcept;
+
+        /**
+         * @brief Upper bound on encodeSession output
+         */
+        static size_t maxRecordSize(const SleepDetectionResult& session) noexcept;
+
+    private:
+        bool readIndex(int fd, size_t file_size) noexcept;
+        bool decodeBlock(const MonthBlock& block, std::vector<SleepDetectionResult>& out) const noexcept;
+        void close() noexcept;
+
+        std::string path_;
+        int fd_{-1};                        ///< Read descriptor, -1 for an empty archive
+        uint64_t index_offset_{HEADER_BYTES};
+        size_t total_sessions_{0};
+        std::vector<MonthBlock> index_;
+    };
+
+} // namespace puuyapu
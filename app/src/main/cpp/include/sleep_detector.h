@@ -17,14 +17,53 @@
 #pragma once
 
 #include "puuyapu_types.h"
+#include "clock.h"
+#include "event_timeline.h"
+#include "event_ingress_queue.h"
+#include "preference_store.h"
+#include "event_log.h"
+#include "interaction_analyzer.h"
+#include "pattern_matcher.h"
+#include "scratch_arena.h"
+#include "finalized_session_store.h"
+#include "night_summary_store.h"
+#include "sleep_candidates.h"
+#include "activity_epochs.h"
+#include "metrics.h"
+#include "platform_log.h"
+#include "time_utils.h"
+#include "trace.h"
+#include <array>
 #include <memory>
+#include <string>
 #include <mutex>
 #include <atomic>
-#include <unordered_map>
-#include <android/log.h>
+#include <vector>
 
 namespace puuyapu {
 
+/**
+ * @brief Read-only view of a detection result owned by the detector
+ *
+ * Holds the detector's event lock for its lifetime, so the referenced
+ * result cannot change underneath the caller. Keep it short-lived: every
+ * other query and the ingress drain wait for it, and calling back into
+ * the same detector while holding one deadlocks.
+ */
+    class BorrowedSleepResult {
+    public:
+        BorrowedSleepResult(std::unique_lock<std::mutex> lock, const SleepDetectionResult& result) noexcept
+                : lock_(std::move(lock)), result_(&result) {}
+
+        const SleepDetectionResult& get() const noexcept { return *result_; }
+        const SleepDetectionResult& operator*() const noexcept { return *result_; }
+        const SleepDetectionResult* operator->() const noexcept { return result_; }
+
+    private:
+        std::unique_lock<std::mutex> lock_;
+        const SleepDetectionResult* result_;
+    };
+
 /**
  * @brief High-performance sleep detection engine
  *
@@ -34,9 +73,10 @@ namespace puuyapu {
  *
  * Key Features:
  * - Real-time interaction event processing
- * - Pattern-based sleep period detection
+ * - Pattern-based sleep period detection, learning from finished nights
  * - Confidence scoring with multiple algorithms
- * - Memory-efficient circular buffer storage
+ * - Ordered event timeline with incremental gap tracking
+ * - Lock-free event ingress (producers never wait on detection)
  * - Thread-safe for background service integration
  * - Performance monitoring and optimization
  *
@@ -48,36 +88,88 @@ namespace puuyapu {
  */
     class SleepDetector {
     private:
-        // Thread-safe event storage with circular buffer for memory efficiency
+        // Thread-safe ordered event storage with live gap index.
+        // Mutable: queries apply pending ingress events before reading.
         mutable std::mutex events_mutex_;
-        InteractionEventList recent_events_;
-        size_t event_write_index_{0};
-        bool event_buffer_full_{false};
+        mutable EventTimeline timeline_;
 
-        // User preferences (atomic pointer for lock-free reads)
-        std::atomic<UserPreferences*> preferences_;
-        std::unique_ptr<UserPreferences> preferences_storage_;
+        // Producer-side queue, drained into timeline_ under events_mutex_
+        mutable EventIngressQueue ingress_;
+        std::atomic<size_t> ingress_dropped_events_{0};
+        std::atomic<size_t> ingress_overflow_drains_{0};
 
-        // Performance monitoring
-        mutable std::unordered_map<std::string, std::chrono::microseconds> performance_metrics_;
-        mutable std::mutex metrics_mutex_;
+        // Optional persistent copy of applied events (events_mutex_ held)
+        mutable std::unique_ptr<EventLog> event_log_;
 
-        // Cache for expensive calculations
+        // Snapshot file written by writeSnapshot (path under events_mutex_;
+        // snapshot_mutex_ serializes writers and is taken before events_mutex_).
+        // The log position tells attachEventLog which frames a restored timeline holds.
+        mutable std::mutex snapshot_mutex_;
+        std::string snapshot_path_;
+        std::optional<EventLog::Position> snapshot_log_position_;
+
+        // User preferences (immutable versioned snapshots, lock-free reads)
+        PreferenceStore preferences_;
+
+        // Wall clock for "now"-relative work (retention cutoffs); injected for replays
+        const Clock* clock_;
+
+        // Learned per-weekday schedule, fed from sealed nights (events_mutex_ held)
+        mutable PatternMatcher pattern_matcher_;
+
+        // Detection quality counters (latencies live in the Metrics registry)
+        mutable std::atomic<uint64_t> cache_hits_{0};
+        mutable std::atomic<uint64_t> cache_misses_{0};
+        mutable std::atomic<uint64_t> confidence_sum_micros_{0};   ///< Sum of scores x 1e6
+        mutable std::atomic<uint64_t> confidence_samples_{0};
+
+        // Live result cache (events_mutex_ held). Dropped whenever the timeline
+        // changes; otherwise valid for one preference detection generation and
+        // while current_time stays on the same side of the sleep onset instant,
+        // the only way the passage of time alone changes the result.
         mutable std::optional<SleepDetectionResult> cached_result_;
-        mutable std::chrono::system_clock::time_point last_cache_update_;
-        static constexpr std::chrono::minutes CACHE_VALIDITY_DURATION{5};
+        mutable std::chrono::system_clock::time_point cached_valid_from_;
+        mutable std::chrono::system_clock::time_point cached_valid_until_;
+        mutable uint64_t cached_generation_{0};
+
+        // Ranked sleep windows of the pass that produced cached_result_ (events_mutex_ held)
+        mutable SleepCandidateRanking cached_candidates_;
+        mutable SleepCandidateBatch candidate_batch_;
+
+        // Accelerometer stream: samples are reduced under sensor_mutex_ (taken
+        // before, never inside, events_mutex_); finished epochs are motion
+        // evidence for interruptions and confidence (events_mutex_ held).
+        mutable std::mutex sensor_mutex_;
+        ActivityEpochReducer reducer_;
+        mutable ActivityEpochStore activity_;
+
+        // Sealed nights, served instead of recomputed (events_mutex_ held)
+        mutable FinalizedSessionStore finalized_;
+
+        // Retention tiers below the raw timeline (events_mutex_ held). Raw
+        // nights past the policy are sealed and summarized before eviction;
+        // the check runs when an event crosses into a new night window.
+        RetentionPolicy retention_;
+        mutable NightSummaryStore summaries_;
+        mutable int64_t next_retention_check_ms_{INT64_MIN};
+
+        // Per-pass intermediates, rewound at the start of each pass (events_mutex_ held)
+        mutable ScratchArena scratch_;
 
         // Memory management
         std::atomic<size_t> total_events_processed_{0};
-        std::atomic<size_t> total_sleep_periods_detected_{0};
+        mutable std::atomic<size_t> total_sleep_periods_detected_{0};
+        mutable int64_t counted_live_night_{INT64_MIN};   ///< Night of the last live period counted (events_mutex_ held)
 
     public:
         /**
          * @brief Construct sleep detector with initial preferences
          * @param preferences User sleep preferences for personalized detection
+         * @param clock Wall clock, must outlive the detector (simulated time for replays)
          * @performance Target: < 1ms initialization time
          */
-        explicit SleepDetector(const UserPreferences& preferences);
+        explicit SleepDetector(const UserPreferences& preferences,
+                               const Clock& clock = SystemClock::instance());
 
         /**
          * @brief Destructor - ensures proper cleanup of resources
@@ -95,15 +187,126 @@ namespace puuyapu {
         /**
          * @brief Add new interaction event for processing
          *
-         * Thread-safe method to add interaction events. Uses circular buffer
-         * to maintain bounded memory usage while preserving recent history.
-         * Automatically classifies interaction type based on duration and context.
+         * Thread-safe and non-blocking: the event is published to a lock-free
+         * ingress queue and applied to the ordered timeline at the start of the
+         * next query, so input handling latency does not depend on how long a
+         * detection pass takes. If the queue is full, the event is applied
+         * inline when the event lock is free, and dropped (counted in
+         * Statistics) otherwise.
          *
          * @param event New interaction event to process
-         * @performance Target: < 100 microseconds
+         * @performance Target: < 1 microsecond (queued), < 100 microseconds (inline)
          */
         void addInteractionEvent(const InteractionEvent& event) noexcept;
 
+        /**
+         * @brief Add a batch of interaction events under a single lock
+         *
+         * Used for bulk replays (screen-off flushes, process restarts).
+         * Events may arrive in any order; the cache is invalidated once.
+         *
+         * @param events Pointer to first event
+         * @param count Number of events in the batch
+         * @return Number of events accepted into the timeline
+         * @performance Target: < 20 microseconds per 100 in-order events
+         */
+        size_t addInteractionEvents(const InteractionEvent* events, size_t count) noexcept;
+
+        /**
+         * @brief Add a batch of packed InteractionEvent::serialize records
+         *
+         * Records are decoded one at a time straight into the timeline under
+         * the event lock, without an intermediate event list. Records with an
+         * UNKNOWN type are classified from their duration with the current
+         * ClassificationPolicy.
+         *
+         * @param records count * InteractionEvent::SERIALIZED_SIZE bytes
+         * @param count Number of records
+         * @return Number of events accepted into the timeline
+         * @performance Target: < 20 microseconds per 100 in-order records, no allocation
+         */
+        size_t addSerializedEvents(const uint8_t* records, size_t count) noexcept;
+
+        /**
+         * @brief Add a batch of packed accelerometer samples
+         *
+         * Samples are folded into 30-second activity epochs as they arrive
+         * and never stored; the event lock is taken once per finished epoch
+         * batch, not per sample. Samples older than the open epoch are dropped.
+         *
+         * @param records count AccelerometerRecord records (24 bytes each), oldest first
+         * @param count Number of records
+         * @param clock_offset_ns Wall clock minus the sensor clock, in nanoseconds
+         * @return Finished epochs added to the motion evidence
+         * @performance Target: < 5 nanoseconds per sample
+         */
+        size_t addAccelerometerSamples(const uint8_t* records, size_t count, int64_t clock_offset_ns) noexcept;
+
+#if defined(__ANDROID__)
+        /**
+         * @brief Add accelerometer events read from an ASensorEventQueue
+         * Same reduction as addAccelerometerSamples; other sensor types are skipped.
+         */
+        size_t addSensorEvents(const ASensorEvent* events, size_t count, int64_t clock_offset_ns) noexcept;
+
+        /**
+         * @brief Read everything pending on an enabled accelerometer queue
+         * Call from the queue's looper callback.
+         * @return Finished epochs added
+         */
+        size_t drainSensorQueue(ASensorEventQueue* queue, int64_t clock_offset_ns) noexcept;
+#endif
+
+        /**
+         * @brief Close the open activity epoch, e.g. when the sensor is disabled
+         * @return Epochs added (0 or 1)
+         */
+        size_t flushActivityEpoch() noexcept;
+
+        /**
+         * @brief Restore history from a persistent event log and keep it updated
+         *
+         * Loads every stored event into the timeline directly from the mapped
+         * segments, then appends each event applied afterwards to the log.
+         *
+         * @param event_log Opened event log (ownership transferred)
+         * @return Number of events restored
+         * @performance Target: < 10ms per 100k stored events
+         */
+        size_t attachEventLog(std::unique_ptr<EventLog> event_log) noexcept;
+
+        /**
+         * @brief Restore the detector from a snapshot file and keep it as the snapshot target
+         *
+         * Call on a fresh detector, before any event is applied and before
+         * attachEventLog. Preferences, retention policy, learned patterns,
+         * sealed nights, night summaries, the raw timeline, activity epochs
+         * and detection counters come back as they were written, so the
+         * first detection after a restart needs no warm-up or replay from
+         * Java. An event log attached afterwards only replays the frames
+         * appended after the snapshot. A missing or damaged snapshot leaves
+         * the detector empty; either way later writeSnapshot calls (and
+         * optimizeMemory) write to path.
+         *
+         * @param path Snapshot file (its directory must be writable)
+         * @return true if state was restored
+         * @performance Target: < 5ms for a full raw tier
+         */
+        bool attachSnapshot(const std::string& path) noexcept;
+
+        /**
+         * @brief Write the complete detector state to the attached snapshot path
+         *
+         * State is encoded under the event lock (pending ingress applied
+         * first); the file is written after the lock is released, into a
+         * temporary file renamed over the previous snapshot. The open
+         * activity epoch is not included.
+         *
+         * @return false if no snapshot is attached or the write failed
+         * @performance Target: < 20ms (dominated by fsync)
+         */
+        bool writeSnapshot() const noexcept;
+
         /**
          * @brief Detect sleep period from recent interaction patterns
          *
@@ -121,6 +324,135 @@ namespace puuyapu {
         SleepDetectionResult detectSleepPeriod(
                 const std::chrono::system_clock::time_point& current_time) const;
 
+        /**
+         * @brief Detect sleep without copying the result
+         *
+         * Same detection as detectSleepPeriod, but the returned view refers
+         * to the detector's cached (or last uncached) result and holds the
+         * event lock until it is destroyed.
+         *
+         * @param current_time Current timestamp for real-time analysis
+         * @return Locked view of the detection result
+         * @performance Target: < 1ms for cached results, < 5ms for full analysis; no heap traffic in steady state
+         */
+        BorrowedSleepResult borrowSleepPeriod(
+                const std::chrono::system_clock::time_point& current_time) const;
+
+        /**
+         * @brief Every candidate sleep window of the live detection, ranked
+         *
+         * Runs (or reuses) the same pass as detectSleepPeriod. Each
+         * sleep-like gap of the day before the most recent one is scored
+         * with the calculateConfidenceScore weights in one batch; the best
+         * is the window detectSleepPeriod reports, the rest are
+         * alternatives for the UI to offer (a nap next to the night, say).
+         * Empty when detection fell back to an open sleep with no gap yet.
+         *
+         * @param current_time Current timestamp for real-time analysis
+         * @return Up to SleepCandidateRanking::CAPACITY candidates, best first
+         * @performance Target: < 1ms for cached results; no heap traffic
+         */
+        SleepCandidateRanking rankSleepCandidates(
+                const std::chrono::system_clock::time_point& current_time) const;
+
+        /**
+         * @brief Detect every completed sleep period in a time range
+         *
+         * Splits the range into per-night windows (local noon to noon) and
+         * takes the longest sleep-like gap of each night from the gap index
+         * in a single pass. Sealed nights come from the finalized store, the
+         * rest are evaluated in parallel on the shared analysis thread pool
+         * and sealed once the timeline has moved past their window. Results are in chronological order,
+         * one per night with a detected sleep, ready for
+         * DataProcessor::exportToJSON / exportToCSV. Ongoing sleep (no wake
+         * yet) is not included; use detectSleepPeriod for the live night.
+         *
+         * @param from Start of range
+         * @param to End of range (exclusive)
+         * @return Detected sleep periods, oldest first
+         * @performance Target: < 5ms for 30 nights
+         */
+        std::vector<SleepDetectionResult> detectSleepPeriods(
+                const std::chrono::system_clock::time_point& from,
+                const std::chrono::system_clock::time_point& to) const;
+
+        /**
+         * @brief Detect the sealed nights of a range, for durable history
+         *
+         * Same evaluation as detectSleepPeriods (nights the timeline has
+         * moved past are sealed on the way), but only sealed nights are
+         * returned: their results are final, so an append-only consumer
+         * such as SessionArchive never stores a night that is still in
+         * progress or may be revised.
+         *
+         * @param from Start of range
+         * @param to End of range (exclusive)
+         * @return Sealed sleep periods, oldest first
+         * @performance Target: < 5ms for 30 nights
+         */
+        std::vector<SleepDetectionResult> detectSealedSleepPeriods(
+                const std::chrono::system_clock::time_point& from,
+                const std::chrono::system_clock::time_point& to) const;
+
+        /**
+         * @brief Detect every completed sleep period in a range into scratch memory
+         *
+         * Same nights as detectSleepPeriods, but the night list and results
+         * live in the detector's scratch arena and are handed to the visitor
+         * as one contiguous array, valid only during the call. The visitor
+         * runs with the event lock held and must not call back into this
+         * detector.
+         *
+         * @param from Start of range
+         * @param to End of range (exclusive)
+         * @param visitor Callable as visitor(const SleepDetectionResult* results, size_t count)
+         * @return Number of results visited
+         * @performance Target: < 5ms for 30 nights; no heap traffic in steady state
+         */
+        template<typename Visitor>
+        size_t visitSleepPeriods(const std::chrono::system_clock::time_point& from,
+                                 const std::chrono::system_clock::time_point& to,
+                                 Visitor&& visitor) const {
+            ScopedMetricTimer metric(MetricId::DETECT_SLEEP_PERIODS);
+
+            auto prefs = preferences_.read();
+
+            std::lock_guard<std::mutex> lock(events_mutex_);
+            scratch_.reset();
+
+            ArenaVector<NightSlot> nights = collectNights(*prefs, from, to);
+            ArenaVector<SleepDetectionResult> results(nights.size(), ArenaAllocator<SleepDetectionResult>(scratch_));
+            evaluateNights(*prefs, nights.data(), nights.size(), results.data());
+
+            visitor(static_cast<const SleepDetectionResult*>(results.data()), results.size());
+            return results.size();
+        }
+
+        /**
+         * @brief Visit the retained events of a time window without copying
+         *
+         * The visitor gets an EventRange over [from, to) of the timeline;
+         * it runs with the event lock held, must not call back into this
+         * detector and must not keep the range.
+         *
+         * @param from Start of window
+         * @param to End of window (exclusive)
+         * @param visitor Callable as visitor(const EventRange&)
+         * @return Whatever the visitor returns
+         * @performance O(log n) to locate the window
+         */
+        template<typename Visitor>
+        decltype(auto) visitEvents(const std::chrono::system_clock::time_point& from,
+                                   const std::chrono::system_clock::time_point& to,
+                                   Visitor&& visitor) const {
+            auto prefs = preferences_.read();
+
+            std::lock_guard<std::mutex> lock(events_mutex_);
+            syncTimeline(*prefs);
+            drainIngress();
+            return visitor(static_cast<const EventRange&>(timeline_.range(from, to)));
+        }
+
         /**
          * @brief Calculate confidence score for a sleep session
          *
@@ -144,11 +476,42 @@ namespace puuyapu {
          * take effect immediately for subsequent detections. Validates
          * preferences before applying to ensure reasonable values.
          *
+         * Publishes a new immutable snapshot; in-flight readers keep the
+         * snapshot they pinned. Cached detection results are only
+         * invalidated when a detection input actually changed.
+         *
          * @param new_preferences Updated user preferences
          * @performance Target: < 200 microseconds
          */
         void updateUserPreferences(const UserPreferences& new_preferences) noexcept;
 
+        /**
+         * @brief Get a copy of the current preference snapshot
+         * @return Preferences with version and detection generation
+         * @performance Target: < 1 microsecond
+         */
+        PreferenceSnapshot getPreferenceSnapshot() const noexcept;
+
+        /**
+         * @brief Event classification policy of the current preferences
+         *
+         * Lets producers infer interaction types with the same cutoffs the
+         * detector classifies retained events with.
+         *
+         * @performance Target: < 1 microsecond
+         */
+        ClassificationPolicy getClassificationPolicy() const noexcept;
+
+        /**
+         * @brief React to a system timezone change
+         *
+         * Refreshes the shared TimeZoneContext and drops the cached result,
+         * whose local bedtime and weekday were derived from the old zone.
+         *
+         * @performance Target: < 2 milliseconds (offset span rebuild)
+         */
+        void onTimeZoneChanged() noexcept;
+
         /**
          * @brief Check if user appears to be currently sleeping
          *
@@ -162,6 +525,26 @@ namespace puuyapu {
          */
         bool isCurrentlyAsleep(const std::chrono::system_clock::time_point& current_time) const noexcept;
 
+        /**
+         * @brief Earliest future time at which the detection state changes on its own
+         *
+         * While awake, sleep onset is declared once the minimum interaction
+         * gap has passed since the last meaningful use (isCurrentlyAsleep
+         * flips, detectSleepPeriod reports the bedtime). After a completed
+         * sleep, the night is sealed when its noon-to-noon window closes (the
+         * next detection pass stores and learns it). An open sleep ends only on a new
+         * meaningful event, so it has no time-driven transition.
+         *
+         * Call again after every delivered event, preference change or
+         * transition; the answer only depends on committed history.
+         *
+         * @param current_time Current timestamp
+         * @return Earliest transition after current_time, or kind NONE
+         * @performance Target: < 50 microseconds (O(gaps) worst case, O(1) typical)
+         */
+        StateTransition getNextStateTransition(
+                const std::chrono::system_clock::time_point& current_time) const noexcept;
+
         /**
          * @brief Get estimated sleep start time if currently sleeping
          *
@@ -180,8 +563,9 @@ namespace puuyapu {
          * @brief Clear old interaction data to manage memory usage
          *
          * Removes interaction events older than specified cutoff time.
-         * Maintains recent history for pattern analysis while preventing
-         * unbounded memory growth. Thread-safe operation.
+         * Nights that end before the cutoff are sealed and summarized
+         * first, so their sessions and summaries stay available for
+         * pattern analysis. Thread-safe operation.
          *
          * @param cutoff_time Remove events older than this timestamp
          * @performance Target: < 1 millisecond
@@ -191,14 +575,13 @@ namespace puuyapu {
         /**
          * @brief Get performance metrics for monitoring and optimization
          *
-         * Returns timing information for key operations to enable
-         * performance monitoring and optimization in production.
-         * Includes cache hit rates, average processing times, etc.
+         * Merges the process-wide latency histograms (core and JNI) into
+         * count, mean, p50, p99 and max per registered metric.
          *
-         * @return Map of operation names to average execution times
-         * @performance Target: < 50 microseconds
+         * @return Merged latency snapshot
+         * @performance Target: < 200 microseconds
          */
-        std::unordered_map<std::string, std::chrono::microseconds> getPerformanceMetrics() const;
+        MetricsSnapshot getPerformanceMetrics() const noexcept;
 
         /**
          * @brief Force manual sleep confirmation for improved accuracy
@@ -226,17 +609,104 @@ namespace puuyapu {
             double average_confidence_score;
             std::chrono::microseconds average_detection_time;
             double cache_hit_rate;
+            uint64_t cache_hits;
+            uint64_t cache_misses;
             size_t current_memory_usage_bytes;
+            size_t ingress_pending_events;      ///< Queued, not yet applied to the timeline
+            size_t ingress_dropped_events;      ///< Lost because queue and event lock were both busy
+            size_t ingress_overflow_drains;     ///< Queue-full pushes applied inline by the producer
+            size_t learned_sleep_sessions;      ///< Nights folded into the pattern profile
+            size_t finalized_nights;            ///< Sealed nights served from the store
+            size_t summarized_nights;           ///< Nights kept as summaries after their raw events
+            size_t activity_epochs;             ///< Retained 30-second motion epochs
+            uint64_t dropped_motion_samples;    ///< Accelerometer samples older than the open epoch
+            double schedule_regularity;         ///< 0.0-1.0 from the learned bedtime spread
         };
 
         Statistics getStatistics() const noexcept;
 
+        /**
+         * @brief Aggregate sleep statistics of the sealed nights in a range
+         */
+        struct SleepStatistics {
+            SleepAggregate range;                               ///< Every night of the range
+            std::array<SleepAggregate, SessionAggregateIndex::WEEKDAYS> by_weekday;  ///< Evening weekday, 0=Sunday
+            double target_sleep_hours;                          ///< Preference the debt is measured against
+        };
+
+        /**
+         * @brief Weekly/monthly statistics from the session aggregate index
+         *
+         * Covers every night window (local noon to noon) that overlaps
+         * [from, to): a range built from nightWindowStartOf boundaries holds
+         * exactly its nights, and [now - 7 days, now) holds the last seven
+         * completed nights, since the open night is not sealed yet. Only
+         * sealed nights count: live detection, detectSleepPeriods and
+         * retention seal them, nothing here does.
+         *
+         * @param from Start of range
+         * @param to End of range (exclusive)
+         * @return Range and per-weekday aggregates
+         * @performance Target: O(1) in the range length, < 1 microsecond
+         */
+        SleepStatistics getSleepStatistics(const std::chrono::system_clock::time_point& from,
+                                           const std::chrono::system_clock::time_point& to) const;
+
+        /**
+         * @brief Change how much history each retention tier keeps
+         *
+         * The policy is clamped (RetentionPolicy::clamped) and applied
+         * immediately: surplus raw nights are sealed and summarized, and
+         * the summary and session tiers are trimmed to their new sizes.
+         *
+         * @param policy New tier sizes
+         * @performance Target: < 5 milliseconds per night compacted
+         */
+        void setRetentionPolicy(const RetentionPolicy& policy) noexcept;
+
+        RetentionPolicy getRetentionPolicy() const noexcept;
+
+        /**
+         * @brief Visit the summaries of nights that left the raw tier
+         *
+         * Summaries are handed over oldest first with the event lock held;
+         * the visitor must not call back into this detector.
+         *
+         * @param from Start of range
+         * @param to End of range (exclusive)
+         * @param visitor Callable as visitor(const NightSummary&, const TimeGap* gaps, size_t gap_count)
+         * @return Number of summaries visited
+         */
+        template<typename Visitor>
+        size_t visitNightSummaries(const std::chrono::system_clock::time_point& from,
+                                   const std::chrono::system_clock::time_point& to,
+                                   Visitor&& visitor) const {
+            if (!(from < to)) {
+                return 0;
+            }
+            auto& time_zone = TimeZoneContext::shared();
+            int64_t first_night = time_zone.toCivil(from).night_index;
+            int64_t last_night = time_zone.toCivil(to - std::chrono::milliseconds(1)).night_index;
+
+            std::lock_guard<std::mutex> lock(events_mutex_);
+            size_t visited = 0;
+            for (size_t i = summaries_.lowerBound(first_night);
+                 i < summaries_.size() && summaries_.at(i).night_index <= last_night; ++i) {
+                size_t gap_count = 0;
+                const TimeGap* gaps = summaries_.gapsAt(i, gap_count);
+                visitor(summaries_.at(i), gaps, gap_count);
+                visited++;
+            }
+            return visited;
+        }
+
         /**
          * @brief Optimize memory usage and performance
          *
          * Performs maintenance operations:
-         * - Clears old cached data
+         * - Applies the retention policy (see setRetentionPolicy)
          * - Optimizes internal data structures
+         * - Writes the attached snapshot (see attachSnapshot)
          * - Resets performance counters
          * - Triggers garbage collection of unused objects
          *
@@ -244,118 +714,270 @@ namespace puuyapu {
          */
         void optimizeMemory() noexcept;
 
+        /**
+         * @brief Current instant of the detector's clock
+         * Callers detecting "as of now" use this instead of system_clock.
+         */
+        std::chrono::system_clock::time_point now() const noexcept { return clock_->now(); }
+
     private:
         // Internal helper methods for sleep detection algorithms
 
+        /**
+         * @brief Apply queued ingress events to the timeline (events_mutex_ held)
+         *
+         * Drains at most one queue capacity so a busy producer cannot starve
+         * the caller. Invalidates the cached result if anything was applied.
+         *
+         * @return Number of events drained
+         * @performance Target: < 20 microseconds per 100 in-order events
+         */
+        size_t drainIngress() const noexcept;
+
+        /**
+         * @brief Apply the gap and classification preferences to the timeline (events_mutex_ held)
+         */
+        void syncTimeline(const UserPreferences& prefs) const noexcept;
+
+        /**
+         * @brief Insert into the timeline and persist if accepted (events_mutex_ held)
+         * @return true if the timeline accepted the event
+         */
+        bool applyEvent(const InteractionEvent& event) const noexcept;
+
+        /**
+         * @brief One night of a batch: sealed in the store or backed by a gap
+         */
+        struct NightSlot {
+            int64_t night_index;
+            const TimeGap* gap;     ///< Longest sleep-like gap (unsealed nights)
+            size_t sealed;          ///< Store position, or FinalizedSessionStore::NPOS
+        };
+
+        /**
+         * @brief Run one live detection pass (events_mutex_ held)
+         *
+         * A completed sleep whose night is sealed (or can be sealed now) is
+         * served from the finalized store; only the open tail of the
+         * timeline is evaluated. Every outcome is left in cached_result_.
+         *
+         * @return The cached result, valid until the next pass
+         * @performance Target: < 1ms for cached results, < 5ms for full analysis
+         */
+        const SleepDetectionResult& detectSleepPeriodLocked(
+                const UserPreferences& prefs,
+                uint64_t detection_generation,
+                const std::chrono::system_clock::time_point& current_time) const;
+
+        /**
+         * @brief Nights of a range in order, sealed or with their longest gap (events_mutex_ held)
+         *
+         * Applies pending ingress first. Sealed nights are listed even if
+         * their events were evicted. The list is allocated in scratch_,
+         * which the caller has reset for this pass.
+         *
+         * @return Chronological nights, at most one slot per night window
+         * @performance Target: O(gaps in range + sealed nights in range)
+         */
+        ArenaVector<NightSlot> collectNights(
+                const UserPreferences& prefs,
+                const std::chrono::system_clock::time_point& from,
+                const std::chrono::system_clock::time_point& to) const;
+
+        /**
+         * @brief Fill results for collected nights (events_mutex_ held)
+         *
+         * Sealed nights are loaded from the store; the others are built in
+         * parallel; those whose window closed are sealed and learned, oldest first.
+         *
+         * @param nights Slots from collectNights
+         * @param count Number of nights
+         * @param results Output array of count default-constructed results
+         */
+        void evaluateNights(const UserPreferences& prefs,
+                            const NightSlot* nights,
+                            size_t count,
+                            SleepDetectionResult* results) const;
+
+        /**
+         * @brief True once the timeline holds an event past the night's window,
+         * or current_time has reached its end (events_mutex_ held)
+         *
+         * No later in-order event can then add a gap to that night.
+         */
+        bool isNightSealable(int64_t night_index,
+                             const std::chrono::system_clock::time_point& current_time) const noexcept;
+
+        /**
+         * @brief Evaluate a closed night from its longest gap and seal it (events_mutex_ held)
+         * @return Store position, or FinalizedSessionStore::NPOS if the night has no valid sleep
+         */
+        size_t sealNight(const UserPreferences& prefs, int64_t night_index) const;
+
+        /**
+         * @brief Move nights past the raw tier into the summary tier (events_mutex_ held)
+         *
+         * Compacts whole nights, oldest first, while the oldest retained
+         * night is outside retention_.raw_nights or the timeline is over
+         * retention_.max_raw_events (never the newest night).
+         *
+         * @param reference Instant treated as "now" besides the newest event
+         * @return Number of nights compacted
+         */
+        size_t enforceRetention(std::chrono::system_clock::time_point reference) const;
+
+        /**
+         * @brief Run enforceRetention if an insert may have pushed a night out (events_mutex_ held)
+         * @performance O(1) unless the event starts a new night or exceeds the raw budget
+         */
+        void retainAfterInsert(const InteractionEvent& event) const {
+            int64_t timestamp_ms = std::chrono::duration_cast<std::chrono::milliseconds>(
+                    event.timestamp.time_since_epoch()).count();
+            if (timestamp_ms >= next_retention_check_ms_ ||
+                timeline_.size() > retention_.max_raw_events) {
+                enforceRetention(event.timestamp);
+            }
+        }
+
+        /**
+         * @brief Seal, summarize and evict every event before window_end (events_mutex_ held)
+         * @param prefs Preference snapshot used to seal the night
+         * @param night_index Night of the oldest retained event
+         */
+        void compactNight(const UserPreferences& prefs, int64_t night_index) const;
+
+        /**
+         * @brief Score the sleep-like gaps of the last day as one batch (events_mutex_ held)
+         *
+         * The window is the SLEEP_CANDIDATE_WINDOW before the end of the most
+         * recent sleep-like gap, so the ranking depends only on the timeline
+         * and stays valid with the cached result.
+         *
+         * @param timeline Ordered events
+         * @param prefs Preference snapshot for this pass
+         * @param ranking Receives the ranked candidates (empty if no gap qualifies)
+         * @performance Target: < 50 microseconds (O(gaps + window events))
+         */
+        void rankCandidates(const EventTimeline& timeline,
+                            const UserPreferences& prefs,
+                            SleepCandidateRanking& ranking) const noexcept;
+
         /**
          * @brief Find the last meaningful interaction before sleep
-         * @param events Vector of interaction events to analyze
+         * @param timeline Ordered events (events_mutex_ held)
+         * @param prefs Preference snapshot for this pass
          * @param current_time Current time for relative analysis
          * @return Optional timestamp of last meaningful interaction
-         * @performance Target: < 500 microseconds
+         * @performance Target: < 50 microseconds (O(gaps))
          */
         std::optional<std::chrono::system_clock::time_point> findSleepStartTime(
-                const InteractionEventList& events,
+                const EventTimeline& timeline,
+                const UserPreferences& prefs,
                 const std::chrono::system_clock::time_point& current_time) const noexcept;
 
         /**
          * @brief Find first meaningful interaction after sleep period
-         * @param events Vector of interaction events to analyze
+         * @param timeline Ordered events (events_mutex_ held)
          * @param sleep_start Estimated sleep start time
          * @param current_time Current timestamp for analysis
          * @return Optional timestamp of sleep end
-         * @performance Target: < 500 microseconds
+         * @performance Target: < 50 microseconds (O(log n + k))
          */
         std::optional<std::chrono::system_clock::time_point> findSleepEndTime(
-                const InteractionEventList& events,
+                const EventTimeline& timeline,
                 const std::chrono::system_clock::time_point& sleep_start,
                 const std::chrono::system_clock::time_point& current_time) const noexcept;
 
         /**
          * @brief Analyze sleep interruptions during sleep period
-         * @param events All interaction events
+         * @param timeline Ordered events (events_mutex_ held)
          * @param sleep_start Beginning of sleep period
          * @param sleep_end End of sleep period
          * @return Vector of detected sleep interruptions
-         * @performance Target: < 1 millisecond
+         * @performance Target: < 100 microseconds (O(log n + k))
          */
         SleepInterruptionList analyzeInterruptions(
-                const InteractionEventList& events,
+                const EventTimeline& timeline,
                 const std::chrono::system_clock::time_point& sleep_start,
                 const std::chrono::system_clock::time_point& sleep_end) const noexcept;
 
         /**
-         * @brief Check if current detection can use cached result
-         * @param current_time Current timestamp
-         * @return true if cached result is still valid
-         * @performance Target: < 20 microseconds
-         */
-        bool canUseCachedResult(const std::chrono::system_clock::time_point& current_time) const noexcept;
-
-        /**
-         * @brief Evaluate how well sleep timing matches user's typical pattern
-         * @param sleep_start Detected sleep start time
-         * @param sleep_end Detected sleep end time
-         * @return Pattern consistency score 0.0-1.0
-         * @performance Target: < 300 microseconds
+         * @brief Build a full result (interruptions, quality, confidence) for a sleep span
+         *
+         * Only reads the timeline, so it may run concurrently for different
+         * spans while the caller holds events_mutex_.
+         *
+         * @param timeline Ordered events (events_mutex_ held by caller)
+         * @param prefs Preference snapshot for this pass
+         * @param sleep_start Bedtime
+         * @param sleep_end Wake time
+         * @return Populated detection result
+         * @performance Target: < 200 microseconds (O(log n + k))
          */
-        double evaluatePatternConsistency(
+        SleepDetectionResult buildSleepResult(
+                const EventTimeline& timeline,
+                const UserPreferences& prefs,
                 const std::chrono::system_clock::time_point& sleep_start,
                 const std::chrono::system_clock::time_point& sleep_end) const noexcept;
 
         /**
-         * @brief Record performance metric for monitoring
-         * @param operation Name of operation being measured
-         * @param duration Time taken for operation
-         * @performance Target: < 10 microseconds
+         * @brief Reduce count samples block by block (sensor_mutex_ held)
+         * @param decode Callable as decode(size_t offset, AccelerometerBlock&) returning items consumed
+         * @return Finished epochs added
          */
-        void recordPerformanceMetric(const std::string& operation,
-                                     std::chrono::microseconds duration) const noexcept;
+        template<typename Decode>
+        size_t reduceSamples(size_t count, Decode&& decode) noexcept;
 
         /**
-         * @brief Get events in chronological order for analysis
-         * @return Sorted copy of recent events (thread-safe)
-         * @performance Target: < 1 millisecond
+         * @brief Append finished epochs to the motion evidence (takes events_mutex_)
+         * @return Epochs accepted
          */
-        InteractionEventList getSortedEvents() const;
+        size_t storeEpochs(const ActivityEpoch* epochs, size_t count) noexcept;
 
         /**
-         * @brief Detect interaction gaps that might represent sleep
-         * @param events Sorted interaction events
-         * @param min_gap_duration Minimum gap to consider
-         * @return List of time gaps found
-         * @performance Target: < 500 microseconds
+         * @brief Fold a sealed night into the pattern profile (events_mutex_ held)
+         *
+         * Called only where a night is sealed, so a night still in progress
+         * never reaches the profile. Only confirmed nights are learned:
+         * manually confirmed, or detected with at least MEDIUM confidence.
+         *
+         * @return true if the profile changed
          */
-        TimeGapList detectInteractionGaps(
-                const InteractionEventList& events,
-                std::chrono::milliseconds min_gap_duration) const noexcept;
+        bool learnFromDetection(const SleepDetectionResult& result) const noexcept;
 
         /**
-         * @brief Classify interaction as time check vs meaningful use
-         * @param event Event to classify
-         * @param recent_history Recent events for context
-         * @return Refined interaction type
-         * @performance Target: < 50 microseconds
+         * @brief Check if current detection can use cached result
+         * @param current_time Current timestamp, checked against the validity window (events_mutex_ held)
+         * @param detection_generation Generation of the active preference snapshot
+         * @return true if cached result is still valid
+         * @performance Target: < 20 microseconds
          */
-        InteractionType classifyInteraction(
-                const InteractionEvent& event,
-                const InteractionEventList& recent_history) const noexcept;
+        bool canUseCachedResult(const std::chrono::system_clock::time_point& current_time,
+                                uint64_t detection_generation) const noexcept;
 
         /**
-         * @brief Check if interaction represents brief time check
-         * @param event Event to analyze
-         * @return true if likely time check
-         * @performance Target: < 10 microseconds
+         * @brief Confidence score against a pinned preference snapshot
          */
-        bool isTimeCheck(const InteractionEvent& event) const noexcept;
+        double calculateConfidenceScore(const SleepDetectionResult& session,
+                                        const UserPreferences& prefs) const noexcept;
 
         /**
-         * @brief Check if interaction represents meaningful usage
-         * @param event Event to analyze
-         * @return true if meaningful phone usage
-         * @performance Target: < 10 microseconds
+         * @brief Evaluate how well sleep timing matches user's typical pattern
+         *
+         * Blends the preference schedule with the learned PatternMatcher
+         * profile, weighted by how much the weekday's profile is trusted.
+         * Constant time regardless of learned history.
+         *
+         * @param prefs Preference snapshot for this pass
+         * @param sleep_start Detected sleep start time
+         * @param sleep_end Detected sleep end time
+         * @return Pattern consistency score 0.0-1.0
+         * @performance Target: < 1 microsecond
          */
-        bool isMeaningfulUsage(const InteractionEvent& event) const noexcept;
+        double evaluatePatternConsistency(
+                const UserPreferences& prefs,
+                const std::chrono::system_clock::time_point& sleep_start,
+                const std::chrono::system_clock::time_point& sleep_end) const noexcept;
 
         /**
          * @brief Calculate sleep quality score based on interruptions
@@ -369,119 +991,14 @@ namespace puuyapu {
                 std::chrono::milliseconds total_sleep_duration) const noexcept;
     };
 
-/**
- * @brief Interaction analyzer for real-time event processing
- *
- * Specialized class for fast interaction classification and analysis.
- * Used by SleepDetector for real-time processing of phone usage events.
- */
-    class InteractionAnalyzer {
-    public:
-        /**
-         * @brief Classify interaction types in microseconds
-         * @param event Interaction event to classify
-         * @param recent_history Recent events for context
-         * @return Classified interaction type
-         * @performance Target: < 50 microseconds
-         */
-        static InteractionType classifyInteraction(
-                const InteractionEvent& event,
-                const InteractionEventList& recent_history) noexcept;
-
-        /**
-         * @brief Fast gap detection between interactions
-         * @param events Vector of interaction events (must be sorted)
-         * @param minimum_gap Minimum gap duration to detect
-         * @return Vector of detected time gaps
-         * @performance Target: < 500 microseconds
-         */
-        static TimeGapList detectInteractionGaps(
-                const InteractionEventList& events,
-                std::chrono::milliseconds minimum_gap) noexcept;
-
-        /**
-         * @brief Real-time pattern recognition for sleep detection
-         * @param events Recent interaction events
-         * @param preferences User sleep preferences
-         * @return true if pattern suggests user is sleeping
-         * @performance Target: < 200 microseconds
-         */
-        static bool detectSleepPattern(
-                const InteractionEventList& events,
-                const UserPreferences& preferences) noexcept;
-
-        /**
-         * @brief Check if interaction is likely time check
-         * @param event Interaction to analyze
-         * @return true if likely brief time check
-         * @performance Target: < 10 microseconds
-         */
-        static bool isTimeCheck(const InteractionEvent& event) noexcept;
-
-        /**
-         * @brief Check if interaction represents meaningful usage
-         * @param event Interaction to analyze
-         * @return true if meaningful phone usage
-         * @performance Target: < 10 microseconds
-         */
-        static bool isMeaningfulUsage(const InteractionEvent& event) noexcept;
-    };
-
-// Global utility functions for time calculations and conversions
-
-/**
- * @brief Calculate duration between two time points in hours
- * @param start Start time point
- * @param end End time point
- * @return Duration in hours as double precision
- * @performance Target: < 20 microseconds
- */
-    inline double calculateDurationHours(
-            const std::chrono::system_clock::time_point& start,
-            const std::chrono::system_clock::time_point& end) noexcept {
-
-        auto duration = end - start;
-        return std::chrono::duration<double, std::ratio<3600>>(duration).count();
-    }
-
-/**
- * @brief Check if time point falls within a daily time range
- * @param time_point Time to check
- * @param range_start Start of daily time range (minutes since midnight)
- * @param range_end End of daily time range (minutes since midnight)
- * @return true if time point is within the specified daily range
- * @performance Target: < 50 microseconds
- */
-    bool isWithinDailyTimeRange(
-            const std::chrono::system_clock::time_point& time_point,
-            std::chrono::minutes range_start,
-            std::chrono::minutes range_end) noexcept;
-
-/**
- * @brief Convert system time point to minutes since midnight
- * @param time_point Time point to convert
- * @return Minutes since midnight (0-1439)
- * @performance Target: < 30 microseconds
- */
-    std::chrono::minutes getMinutesSinceMidnight(
-            const std::chrono::system_clock::time_point& time_point) noexcept;
-
-/**
- * @brief Check if time point represents nighttime hours
- * @param time_point Time to check
- * @return true if between 22:00 and 06:00
- * @performance Target: < 30 microseconds
- */
-    bool isNighttime(const std::chrono::system_clock::time_point& time_point) noexcept;
-
 // Performance monitoring and logging macros
 #ifdef DEBUG
     #define SLEEP_LOG_DEBUG(tag, format, ...) \
-        __android_log_print(ANDROID_LOG_DEBUG, tag, format, ##__VA_ARGS__)
+        PUUYAPU_LOG_PRINT(PUUYAPU_LOG_DEBUG, tag, format, ##__VA_ARGS__)
     #define SLEEP_LOG_INFO(tag, format, ...) \
-        __android_log_print(ANDROID_LOG_INFO, tag, format, ##__VA_ARGS__)
+        PUUYAPU_LOG_PRINT(PUUYAPU_LOG_INFO, tag, format, ##__VA_ARGS__)
     #define SLEEP_LOG_PERF(operation, duration_us) \
-        __android_log_print(ANDROID_LOG_DEBUG, "PuuyApu_Perf", \
+        PUUYAPU_LOG_PRINT(PUUYAPU_LOG_DEBUG, "PuuyApu_Perf", \
             "%s took %ld microseconds", operation, duration_us)
 #else
 #define SLEEP_LOG_DEBUG(tag, format, ...)
@@ -490,37 +1007,43 @@ namespace puuyapu {
 #endif
 
 #define SLEEP_LOG_ERROR(tag, format, ...) \
-    __android_log_print(ANDROID_LOG_ERROR, tag, format, ##__VA_ARGS__)
+    PUUYAPU_LOG_PRINT(PUUYAPU_LOG_ERROR, tag, format, ##__VA_ARGS__)
 
 /**
- * @brief RAII performance timer for automatic measurement
+ * @brief RAII performance section for automatic measurement
  *
- * Automatically measures execution time and logs performance data.
- * Use for debugging and optimization of critical code paths.
+ * Always a system trace section (see trace.h), so release builds can be
+ * profiled in the field. Debug builds additionally log the duration.
+ * Takes a string literal and never allocates.
  */
     class PerformanceTimer {
     private:
-        std::string operation_name_;
-        std::chrono::high_resolution_clock::time_point start_time_;
+        trace::ScopedSection section_;
+#ifdef DEBUG
+        const char* operation_name_;
+        std::chrono::steady_clock::time_point start_time_;
+#endif
 
     public:
-        explicit PerformanceTimer(const std::string& operation)
-                : operation_name_(operation), start_time_(std::chrono::high_resolution_clock::now()) {}
+        explicit PerformanceTimer(const char* operation) noexcept
+                : section_(operation)
+#ifdef DEBUG
+                , operation_name_(operation), start_time_(std::chrono::steady_clock::now())
+#endif
+        {}
 
-        ~PerformanceTimer() {
-            auto end_time = std::chrono::high_resolution_clock::now();
+#ifdef DEBUG
+        ~PerformanceTimer() noexcept {
             auto duration = std::chrono::duration_cast<std::chrono::microseconds>(
-                    end_time - start_time_
+                    std::chrono::steady_clock::now() - start_time_
             );
-            SLEEP_LOG_PERF(operation_name_.c_str(), duration.count());
+            SLEEP_LOG_PERF(operation_name_, static_cast<long>(duration.count()));
         }
+#endif
     };
 
-// Convenience macro for performance measurement
-#ifdef DEBUG
-#define MEASURE_PERFORMANCE(operation) PerformanceTimer _timer(operation)
-#else
-#define MEASURE_PERFORMANCE(operation)
-#endif
+// Convenience macro for performance measurement (literal names only)
+#define MEASURE_PERFORMANCE(operation) \
+    PerformanceTimer PUUYAPU_TRACE_CONCAT(_perf_timer_, __LINE__)("" operation)
 
 } // namespace puuyapu
\ No newline at end of file
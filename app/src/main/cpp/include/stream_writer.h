@@ -0,0 +1,149 @@
+/**
+ * @file stream_writer.h
+ * @brief Buffered, allocation-free text output for exporters
+ *
+ * Exporters format into a fixed stack buffer that is handed to an
+ * OutputSink whenever it fills, so peak memory is one buffer no matter
+ * how many sessions are exported. Numbers use std::to_chars and integer
+ * fixed-point; timestamps are formatted from days-since-epoch arithmetic.
+ *
+ * @performance Target: < 100 nanoseconds per formatted field
+ */
+
+#pragma once
+
+#include <chrono>
+#include <cstddef>
+#include <cstdint>
+#include <cstring>
+#include <string>
+
+namespace puuyapu {
+
+    /**
+     * @brief Destination for exported bytes
+     */
+    class OutputSink {
+    public:
+        virtual ~OutputSink() = default;
+
+        /**
+         * @brief Consume one chunk
+         * @return false on failure; the writer stops producing output
+         */
+        virtual bool write(const char* data, size_t size) noexcept = 0;
+    };
+
+    /**
+     * @brief Writes chunks to a file descriptor (file, pipe, socket)
+     * The descriptor is not owned.
+     */
+    class FdSink : public OutputSink {
+    public:
+        explicit FdSink(int fd) noexcept : fd_(fd) {}
+
+        bool write(const char* data, size_t size) noexcept override;
+
+    private:
+        int fd_;
+    };
+
+    /**
+     * @brief Appends chunks to a string (compatibility with string-returning APIs)
+     */
+    class StringSink : public OutputSink {
+    public:
+        bool write(const char* data, size_t size) noexcept override {
+            output_.append(data, size);
+            return true;
+        }
+
+        std::string& str() noexcept { return output_; }
+
+    private:
+        std::string output_;
+    };
+
+    /**
+     * @brief Fixed-buffer formatter in front of an OutputSink
+     *
+     * Failures are sticky: after a sink error, further output is dropped
+     * and ok() returns false. The destructor flushes.
+     */
+    class StreamWriter {
+    public:
+        static constexpr size_t BUFFER_BYTES = 4096;
+
+        explicit StreamWriter(OutputSink& sink) noexcept : sink_(sink) {}
+        ~StreamWriter() noexcept { flush(); }
+
+        StreamWriter(const StreamWriter&) = delete;
+        StreamWriter& operator=(const StreamWriter&) = delete;
+
+        StreamWriter& write(const char* data, size_t size) noexcept;
+
+        StreamWriter& write(const char* text) noexcept {
+            return write(text, std::strlen(text));
+        }
+
+        StreamWriter& write(char c) noexcept {
+            if (used_ == BUFFER_BYTES) {
+                flush();
+            }
+            buffer_[used_++] = c;
+            return *this;
+        }
+
+        StreamWriter& writeBool(bool value) noexcept {
+            return value ? write("true", 4) : write("false", 5);
+        }
+
+        StreamWriter& writeInt(int64_t value) noexcept;
+        StreamWriter& writeUnsigned(uint64_t value) noexcept;
+
+        /**
+         * @brief Decimal with fixed precision, rounded half away from zero
+         * Non-finite values are written as 0 so output stays valid JSON/CSV.
+         * @param precision Digits after the decimal point (0-9)
+         */
+        StreamWriter& writeFixed(double value, int precision = 2) noexcept;
+
+        /**
+         * @brief Unsigned integer, left-padded with zeros to width digits
+         */
+        StreamWriter& writePadded(uint64_t value, int width) noexcept;
+
+        /**
+         * @brief UTC timestamp as ISO 8601 with milliseconds ("2024-03-04T23:15:00.000Z")
+         */
+        StreamWriter& writeIsoTimestamp(std::chrono::system_clock::time_point time_point) noexcept;
+
+        /**
+         * @brief Local calendar date ("2024-03-04")
+         */
+        StreamWriter& writeLocalDate(std::chrono::system_clock::time_point time_point) noexcept;
+
+        /**
+         * @brief Hand buffered bytes to the sink
+         * @return false once any sink write has failed
+         */
+        bool flush() noexcept;
+
+        bool ok() const noexcept { return ok_; }
+
+    private:
+        /// Make room for a small formatted field (at most BUFFER_BYTES)
+        char* reserve(size_t size) noexcept {
+            if (BUFFER_BYTES - used_ < size) {
+                flush();
+            }
+            return buffer_ + used_;
+        }
+
+        OutputSink& sink_;
+        char buffer_[BUFFER_BYTES];
+        size_t used_{0};
+        bool ok_{true};
+    };
+
+} // namespace puuyapu
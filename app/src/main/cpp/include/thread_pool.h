@@ -0,0 +1,85 @@
+/**
+ * @file thread_pool.h
+ * @brief Small fixed-size worker pool for data-parallel analysis passes
+ *
+ * Used for batch work that splits into independent items (per-night
+ * detection windows). The calling thread participates, so a pool with
+ * zero workers degrades to a plain loop on single-core devices.
+ *
+ * @performance Dispatch overhead: one notify + one wait per parallelFor
+ */
+
+#pragma once
+
+#include <atomic>
+#include <condition_variable>
+#include <cstdint>
+#include <functional>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+namespace puuyapu {
+
+    /**
+     * @brief Fixed set of worker threads executing one parallel loop at a time
+     */
+    class ThreadPool {
+    public:
+        /**
+         * @brief Start worker threads
+         * @param worker_count Threads in addition to the caller (0 allowed)
+         */
+        explicit ThreadPool(size_t worker_count);
+
+        /**
+         * @brief Stop and join all workers
+         */
+        ~ThreadPool() noexcept;
+
+        ThreadPool(const ThreadPool&) = delete;
+        ThreadPool& operator=(const ThreadPool&) = delete;
+
+        /**
+         * @brief Process-wide pool sized for the device
+         *
+         * Leaves one core to the UI thread and caps workers at 3 to stay
+         * friendly to big.LITTLE scheduling and battery.
+         */
+        static ThreadPool& shared() noexcept;
+
+        /**
+         * @brief Run body(i) for every i in [0, count) and wait for completion
+         *
+         * Items are claimed dynamically, so uneven items balance out.
+         * A call made while another one is running does not wait for the
+         * pool: it runs all of its items on the calling thread.
+         *
+         * @param count Number of items
+         * @param body Callable invoked once per item, possibly concurrently
+         */
+        void parallelFor(size_t count, const std::function<void(size_t)>& body) noexcept;
+
+        size_t workerCount() const noexcept { return workers_.size(); }
+
+    private:
+        void workerLoop() noexcept;
+        void runItems() noexcept;
+
+        std::vector<std::thread> workers_;
+
+        std::mutex submit_mutex_;           ///< Owned by the parallelFor using the workers
+        std::mutex mutex_;
+        std::condition_variable work_available_;
+        std::condition_variable work_done_;
+
+        // Current job (published under mutex_)
+        const std::function<void(size_t)>* body_{nullptr};
+        size_t count_{0};
+        std::atomic<size_t> next_item_{0};
+        size_t pending_workers_{0};
+        uint64_t generation_{0};
+        bool stopping_{false};
+    };
+
+} // namespace puuyapu
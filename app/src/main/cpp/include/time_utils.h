@@ -0,0 +1,180 @@
+/**
+ * @file time_utils.h
+ * @brief Civil-time conversion and daily time-range helpers
+ *
+ * Local time is derived from cached UTC offset spans instead of calling
+ * localtime for every conversion. A span covers the interval between two
+ * DST transitions; conversions inside a cached one are pure arithmetic
+ * and lock-free, so batch and SIMD paths can classify night windows
+ * without libc calls.
+ *
+ * @performance Target: < 50 nanoseconds per cached conversion
+ */
+
+#pragma once
+
+#include <atomic>
+#include <chrono>
+#include <cstdint>
+#include <mutex>
+
+namespace puuyapu {
+
+    /**
+     * @brief Local calendar view of one instant
+     */
+    struct CivilTime {
+        int minute_of_day;          ///< 0-1439
+        int weekday;                ///< 0=Sunday, ..., 6=Saturday
+        int64_t local_day;          ///< Local calendar day, days since 1970-01-01
+        int64_t night_index;        ///< Noon-to-noon window, numbered by the local day of its evening
+        int32_t utc_offset_seconds; ///< Local minus UTC
+    };
+
+    /**
+     * @brief Process-wide timezone cache
+     *
+     * Holds up to SPAN_SLOTS spans, each the UTC offset valid over
+     * [begin, end), the bounds being the surrounding DST transitions (or
+     * one year either side for zones without DST). Readers use a sequence
+     * lock and never block. A lookup outside every cached span, on either
+     * side, resolves its span once and replaces the oldest slot, so the
+     * current span and its neighbours stay cached while lookups go back
+     * and forth across a transition (future night windows, replays,
+     * history queries).
+     */
+    class TimeZoneContext {
+    public:
+        static constexpr size_t SPAN_SLOTS = 4;
+
+        static TimeZoneContext& shared() noexcept;
+
+        /**
+         * @brief Convert instant to local civil fields
+         * @performance Target: < 50 nanoseconds (cached span)
+         */
+        CivilTime toCivil(std::chrono::system_clock::time_point time_point) noexcept;
+
+        /**
+         * @brief Local offset in effect at an instant
+         */
+        int32_t utcOffsetAt(std::chrono::system_clock::time_point time_point) noexcept;
+
+        /**
+         * @brief Start of the night window (local noon) containing time_point
+         * Night windows run noon to noon so a whole sleep falls in one window.
+         */
+        std::chrono::system_clock::time_point nightWindowStart(
+                std::chrono::system_clock::time_point time_point) noexcept;
+
+        /**
+         * @brief Local noon of a night index (start of that night window)
+         * Correct across 23h/25h days: each noon is resolved with its own offset.
+         */
+        std::chrono::system_clock::time_point nightWindowStartOf(int64_t night_index) noexcept;
+
+        /**
+         * @brief Drop the cached span and re-read the system timezone
+         * Call when the platform reports a timezone change.
+         */
+        void invalidate() noexcept;
+
+        /// Number of span refreshes so far (for diagnostics)
+        uint64_t refreshCount() const noexcept { return refresh_count_.load(std::memory_order_relaxed); }
+
+        /// Number of localtime_r calls so far, by refreshes and uncached lookups (for diagnostics)
+        static uint64_t systemLookupCount() noexcept;
+
+    private:
+        TimeZoneContext() noexcept = default;
+
+        bool tryCached(int64_t epoch_seconds, int32_t& offset_seconds) const noexcept;
+        void refresh(int64_t epoch_seconds) noexcept;
+
+        struct Span {
+            std::atomic<int64_t> begin{0};
+            std::atomic<int64_t> end{0};        ///< Empty span until filled
+            std::atomic<int32_t> offset{0};
+        };
+
+        // Seqlock-protected spans (odd sequence while a writer updates them)
+        std::atomic<uint64_t> sequence_{0};
+        Span spans_[SPAN_SLOTS];
+
+        std::mutex refresh_mutex_;
+        size_t next_slot_{0};                   ///< Oldest slot, replaced next (refresh_mutex_ held)
+        std::atomic<uint64_t> refresh_count_{0};
+    };
+
+    /**
+     * @brief Proleptic Gregorian date
+     */
+    struct CivilDate {
+        int64_t year;
+        unsigned month;     ///< 1-12
+        unsigned day;       ///< 1-31
+    };
+
+/**
+ * @brief Convert days since 1970-01-01 to a calendar date
+ * Pure arithmetic (H. Hinnant's days-to-civil), valid for any int64 day count in practice.
+ * @performance Target: < 10 nanoseconds
+ */
+    constexpr CivilDate civilFromDays(int64_t days) noexcept {
+        days += 719468;
+        int64_t era = (days >= 0 ? days : days - 146096) / 146097;
+        auto day_of_era = static_cast<unsigned>(days - era * 146097);
+        unsigned year_of_era = (day_of_era - day_of_era / 1460 + day_of_era / 36524 - day_of_era / 146096) / 365;
+        unsigned day_of_year = day_of_era - (365 * year_of_era + year_of_era / 4 - year_of_era / 100);
+        unsigned month_index = (5 * day_of_year + 2) / 153;
+        unsigned day = day_of_year - (153 * month_index + 2) / 5 + 1;
+        unsigned month = month_index < 10 ? month_index + 3 : month_index - 9;
+        return CivilDate{static_cast<int64_t>(year_of_era) + era * 400 + (month <= 2 ? 1 : 0), month, day};
+    }
+
+/**
+ * @brief Calculate duration between two time points in hours
+ * @param start Start time point
+ * @param end End time point
+ * @return Duration in hours as double precision
+ * @performance Target: < 20 microseconds
+ */
+    inline double calculateDurationHours(
+            const std::chrono::system_clock::time_point& start,
+            const std::chrono::system_clock::time_point& end) noexcept {
+
+        auto duration = end - start;
+        return std::chrono::duration<double, std::ratio<3600>>(duration).count();
+    }
+
+/**
+ * @brief Check if time point falls within a daily time range
+ * @param time_point Time to check
+ * @param range_start Start of daily time range (minutes since midnight)
+ * @param range_end End of daily time range (minutes since midnight)
+ * @return true if time point is within the specified daily range
+ * @performance Target: < 50 microseconds
+ */
+    bool isWithinDailyTimeRange(
+            const std::chrono::system_clock::time_point& time_point,
+            std::chrono::minutes range_start,
+            std::chrono::minutes range_end) noexcept;
+
+/**
+ * @brief Convert system time point to minutes since midnight
+ * @param time_point Time point to convert
+ * @return Minutes since midnight (0-1439)
+ * @performance Target: < 30 microseconds
+ */
+    std::chrono::minutes getMinutesSinceMidnight(
+            const std::chrono::system_clock::time_point& time_point) noexcept;
+
+/**
+ * @brief Check if time point represents nighttime hours
+ * @param time_point Time to check
+ * @return true if between 22:00 and 06:00
+ * @performance Target: < 30 microseconds
+ */
+    bool isNighttime(const std::chrono::system_clock::time_point& time_point) noexcept;
+
+} // namespace puuyapu
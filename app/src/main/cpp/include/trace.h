@@ -0,0 +1,91 @@
+/**
+ * @file trace.h
+ * @brief System trace (ATrace/Perfetto) sections and counters
+ *
+ * Native detection cost shows up next to the Java service in a system
+ * trace: sections are emitted with ATrace_beginSection/endSection and
+ * counter tracks with ATrace_setCounter. Nothing is formatted or
+ * allocated: names must be string literals, and every call checks
+ * ATrace_isEnabled first, so a release build pays one relaxed load per
+ * section while tracing is off. Host builds compile to nothing.
+ *
+ * Counter names live under the "PuuyApu." prefix so they group in the UI.
+ *
+ * @performance Target: < 20 nanoseconds per section with tracing off
+ */
+
+#pragma once
+
+#include <cstdint>
+
+#if defined(__ANDROID__)
+#include <android/trace.h>
+#endif
+
+namespace puuyapu {
+namespace trace {
+
+#if defined(__ANDROID__)
+
+    inline bool isEnabled() noexcept { return ATrace_isEnabled(); }
+
+    inline void beginSection(const char* name) noexcept { ATrace_beginSection(name); }
+    inline void endSection() noexcept { ATrace_endSection(); }
+
+    inline void setCounter(const char* name, int64_t value) noexcept {
+        if (ATrace_isEnabled()) {
+            ATrace_setCounter(name, value);
+        }
+    }
+
+#else
+
+    constexpr bool isEnabled() noexcept { return false; }
+
+    inline void beginSection(const char*) noexcept {}
+    inline void endSection() noexcept {}
+    inline void setCounter(const char*, int64_t) noexcept {}
+
+#endif
+
+    /**
+     * @brief Trace section for the enclosing scope
+     *
+     * Whether tracing is on is sampled once at entry, so a section is
+     * always closed on the thread that opened it.
+     */
+    class ScopedSection {
+    public:
+        /// The pointer is handed to the tracer as is: literals or static tables (metricName) only
+        explicit ScopedSection(const char* static_name) noexcept : active_(isEnabled()) {
+            if (active_) {
+                beginSection(static_name);
+            }
+        }
+
+        ~ScopedSection() noexcept {
+            if (active_) {
+                endSection();
+            }
+        }
+
+        ScopedSection(const ScopedSection&) = delete;
+        ScopedSection& operator=(const ScopedSection&) = delete;
+
+    private:
+        bool active_;
+    };
+
+} // namespace trace
+} // namespace puuyapu
+
+#define PUUYAPU_TRACE_CONCAT_INNER(a, b) a##b
+#define PUUYAPU_TRACE_CONCAT(a, b) PUUYAPU_TRACE_CONCAT_INNER(a, b)
+
+/// Trace the rest of the enclosing scope under a literal name ("" rejects anything else)
+#define TRACE_SECTION(name) \
+    ::puuyapu::trace::ScopedSection PUUYAPU_TRACE_CONCAT(puuyapu_trace_section_, __LINE__)("" name)
+
+/// Publish a counter track sample (literal name)
+#define TRACE_COUNTER(name, value) \
+    ::puuyapu::trace::setCounter("" name, static_cast<int64_t>(value))
@@ -14,26 +14,49 @@
 #include <memory>
 #include <chrono>
 #include <string>
+#include <cstring>
+#include <vector>
+#include <algorithm>
+#include <mutex>
 
 // Include our fixed headers
 #include "puuyapu_types.h"
 #include "sleep_detector.h"
+#include "data_processor.h"
+#include "metrics.h"
+#include "session_archive.h"
+#include "detection_worker.h"
+#include "detector_registry.h"
+#include "trace.h"
 
 using namespace puuyapu;
 
-// Global instances to avoid recreation overhead (thread-safe)
-static std::unique_ptr<SleepDetector> g_sleepDetector;
+// Detector behind the NativeSleepTracker entry points. It lives in the
+// shared DetectorRegistry like every NativeDetector handle; calls pin it
+// with a lease, so re-initialization never frees it under a running call.
+static std::atomic<DetectorHandle> g_defaultDetector{INVALID_DETECTOR_HANDLE};
 static std::mutex g_detectorMutex;
 
+// VM of the loaded library, used to attach the detection worker thread
+static JavaVM* g_javaVM = nullptr;
+
+// Java receiver of worker results (recursive: the callback may replace it)
+static jobject g_detectionListener = nullptr;
+static jmethodID g_detectionListenerMethod = nullptr;
+static std::recursive_mutex g_listenerMutex;
+
+// Finished-session history (history screen), serialized by its own mutex
+static std::unique_ptr<SessionArchive> g_sessionArchive;
+static std::mutex g_archiveMutex;
+
 // JNI class and method ID caching for performance
 static jclass g_sleepResultClass = nullptr;
 static jmethodID g_sleepResultConstructor = nullptr;
 static jclass g_interruptionClass = nullptr;
 static jmethodID g_interruptionConstructor = nullptr;
-
-// Performance monitoring
-static std::unordered_map<std::string, std::chrono::microseconds> g_jniMetrics;
-static std::mutex g_metricsMutex;
+static jclass g_arrayListClass = nullptr;
+static jmethodID g_arrayListConstructor = nullptr;
+static jmethodID g_arrayListAdd = nullptr;
 
 constexpr const char* JNI_LOG_TAG = "PuuyApu_JNI";
 
@@ -43,25 +66,22 @@ constexpr const char* JNI_LOG_TAG = "PuuyApu_JNI";
  */
 class JNIPerformanceTimer {
 private:
-    std::string operation_;
-    std::chrono::high_resolution_clock::time_point startTime_;
+    MetricId metric_;
+    trace::ScopedSection section_;      // Named by the static metric table
+    std::chrono::steady_clock::time_point startTime_;
 
 public:
-    explicit JNIPerformanceTimer(const std::string& operation)
-            : operation_(operation), startTime_(std::chrono::high_resolution_clock::now()) {}
+    explicit JNIPerformanceTimer(MetricId metric)
+            : metric_(metric), section_(metricName(metric)), startTime_(std::chrono::steady_clock::now()) {}
 
     ~JNIPerformanceTimer() {
-        auto endTime = std::chrono::high_resolution_clock::now();
-        auto duration = std::chrono::duration_cast<std::chrono::microseconds>(
-                endTime - startTime_
-        );
-
-        std::lock_guard<std::mutex> lock(g_metricsMutex);
-        g_jniMetrics[operation_] = duration;
+        auto duration = std::chrono::steady_clock::now() - startTime_;
+        Metrics::record(metric_, duration);
 
 #ifdef DEBUG
         __android_log_print(ANDROID_LOG_DEBUG, JNI_LOG_TAG,
-            "JNI %s took %ld microseconds", operation_.c_str(), duration.count());
+            "JNI %s took %lld microseconds", metricName(metric_),
+            static_cast<long long>(std::chrono::duration_cast<std::chrono::microseconds>(duration).count()));
 #endif
     }
 };
@@ -106,6 +126,11 @@ public:
  * Caches JNI references for performance
  */
 bool initializeJNIReferences(JNIEnv* env) {
+    // Cached for the life of the process: re-initialization only replaces the detector
+    if (g_arrayListConstructor && g_arrayListAdd) {
+        return true;
+    }
+
     // Cache SleepDetectionResult class and constructor
     jclass localSleepResultClass = env->FindClass("io/nava/puuyapu/app/models/SleepDetectionResult");
     if (!localSleepResultClass) {
@@ -138,7 +163,25 @@ bool initializeJNIReferences(JNIEnv* env) {
     env->DeleteLocalRef(localSleepResultClass);
     env->DeleteLocalRef(localInterruptionClass);
 
-    return g_interruptionConstructor != nullptr;
+    if (!g_interruptionConstructor) {
+        return false;
+    }
+
+    // Cache ArrayList class and methods used for the interruptions list
+    jclass localArrayListClass = env->FindClass("java/util/ArrayList");
+    if (!localArrayListClass) {
+        __android_log_print(ANDROID_LOG_ERROR, JNI_LOG_TAG,
+                            "Failed to find ArrayList class");
+        return false;
+    }
+
+    g_arrayListClass = static_cast<jclass>(env->NewGlobalRef(localArrayListClass));
+    g_arrayListConstructor = env->GetMethodID(g_arrayListClass, "<init>", "(I)V");
+    g_arrayListAdd = env->GetMethodID(g_arrayListClass, "add", "(Ljava/lang/Object;)Z");
+
+    env->DeleteLocalRef(localArrayListClass);
+
+    return g_arrayListConstructor != nullptr && g_arrayListAdd != nullptr;
 }
 
 /**
@@ -146,7 +189,7 @@ bool initializeJNIReferences(JNIEnv* env) {
  * Handles proper type conversions and null cases
  */
 jobject createJavaSleepResult(JNIEnv* env, const SleepDetectionResult& result) {
-    if (!g_sleepResultClass || !g_sleepResultConstructor) {
+    if (!g_sleepResultClass || !g_sleepResultConstructor || !g_arrayListClass) {
         __android_log_print(ANDROID_LOG_ERROR, JNI_LOG_TAG,
                             "JNI references not initialized");
         return nullptr;
@@ -166,12 +209,9 @@ jobject createJavaSleepResult(JNIEnv* env, const SleepDetectionResult& result) {
         wakeTimeMs = std::chrono::duration_cast<std::chrono::milliseconds>(wakeTimeEpoch).count();
     }
 
-    // Create Java ArrayList for interruptions
-    jclass arrayListClass = env->FindClass("java/util/ArrayList");
-    jmethodID arrayListConstructor = env->GetMethodID(arrayListClass, "<init>", "()V");
-    jmethodID arrayListAdd = env->GetMethodID(arrayListClass, "add", "(Ljava/lang/Object;)Z");
-
-    jobject interruptionsList = env->NewObject(arrayListClass, arrayListConstructor);
+    // Create Java ArrayList for interruptions (presized, cached class/method IDs)
+    jobject interruptionsList = env->NewObject(g_arrayListClass, g_arrayListConstructor,
+                                               static_cast<jint>(result.interruptions.size()));
 
     // Add interruptions to list
     for (const auto& interruption : result.interruptions) {
@@ -186,7 +226,7 @@ jobject createJavaSleepResult(JNIEnv* env, const SleepDetectionResult& result) {
                                                   interruptionMs, durationMs, interactionType);
 
         if (javaInterruption) {
-            env->CallBooleanMethod(interruptionsList, arrayListAdd, javaInterruption);
+            env->CallBooleanMethod(interruptionsList, g_arrayListAdd, javaInterruption);
             env->DeleteLocalRef(javaInterruption);
         }
     }
@@ -202,12 +242,152 @@ jobject createJavaSleepResult(JNIEnv* env, const SleepDetectionResult& result) {
                                              interruptionsList, qualityScore, isManuallyConfirmed);
 
     // Clean up local references
-    env->DeleteLocalRef(arrayListClass);
     env->DeleteLocalRef(interruptionsList);
 
     return javaSleepResult;
 }
 
+/**
+ * @brief Forwards worker results to the registered Java listener
+ * Runs on the worker thread, which is attached to the VM once for its lifetime.
+ * One instance serves every default detector, and an old worker may still be
+ * draining while its replacement starts, so the env is kept per thread.
+ */
+class JNIDetectionListener final : public DetectionListener {
+public:
+    void onWorkerStarted() noexcept override {
+        if (g_javaVM && g_javaVM->AttachCurrentThread(&workerEnv_, nullptr) != JNI_OK) {
+            __android_log_print(ANDROID_LOG_ERROR, JNI_LOG_TAG,
+                                "Failed to attach detection worker thread");
+            workerEnv_ = nullptr;
+        }
+    }
+
+    void onWorkerStopping() noexcept override {
+        if (workerEnv_) {
+            g_javaVM->DetachCurrentThread();
+            workerEnv_ = nullptr;
+        }
+    }
+
+    void onDetectionComplete(const DetectionResponse& response) noexcept override {
+        JNIEnv* env = workerEnv_;
+        if (!env) {
+            return;
+        }
+
+        std::lock_guard<std::recursive_mutex> lock(g_listenerMutex);
+        if (!g_detectionListener || !g_detectionListenerMethod) {
+            return;
+        }
+
+        // value: asleep or snapshot-written flag, or estimated sleep start in ms (-1 if none)
+        jlong value = 0;
+        if (response.kind == DetectionRequestKind::IS_CURRENTLY_ASLEEP) {
+            value = response.asleep ? 1 : 0;
+        } else if (response.kind == DetectionRequestKind::WRITE_SNAPSHOT) {
+            value = response.snapshot_written ? 1 : 0;
+        } else if (response.kind == DetectionRequestKind::ESTIMATED_SLEEP_START) {
+            value = response.sleep_start
+                    ? std::chrono::duration_cast<std::chrono::milliseconds>(
+                            response.sleep_start->time_since_epoch()).count()
+                    : -1;
+        }
+
+        jobject result = response.sleep ? createJavaSleepResult(env, *response.sleep) : nullptr;
+
+        env->CallVoidMethod(g_detectionListener, g_detectionListenerMethod,
+                            static_cast<jint>(response.kind),
+                            static_cast<jlong>(response.request_id),
+                            static_cast<jint>(response.coalesced),
+                            value, result);
+
+        // A throwing listener must not leave the thread with a pending exception
+        if (env->ExceptionCheck()) {
+            env->ExceptionDescribe();
+            env->ExceptionClear();
+        }
+        if (result) {
+            env->DeleteLocalRef(result);
+        }
+    }
+
+private:
+    static thread_local JNIEnv* workerEnv_;    ///< This worker's env, valid between start and stop
+};
+
+thread_local JNIEnv* JNIDetectionListener::workerEnv_ = nullptr;
+
+static JNIDetectionListener g_jniDetectionListener;
+
+/**
+ * @brief Replace the default detector (g_detectorMutex held)
+ * The previous one is destroyed once the last call using it returns
+ */
+static void installDetector(std::unique_ptr<SleepDetector> detector) {
+    auto& registry = DetectorRegistry::shared();
+    DetectorHandle handle = registry.create(std::move(detector), &g_jniDetectionListener);
+
+    // Calls still running on the previous detector finish on their lease
+    DetectorHandle previous = g_defaultDetector.exchange(handle, std::memory_order_acq_rel);
+    if (previous != INVALID_DETECTOR_HANDLE) {
+        registry.destroy(previous);
+    }
+}
+
+/**
+ * @brief Pin the detector behind the NativeSleepTracker entry points
+ * @return Empty lease if not initialized
+ */
+static DetectorLease defaultDetector() noexcept {
+    return DetectorRegistry::shared().acquire(g_defaultDetector.load(std::memory_order_acquire));
+}
+
+/**
+ * @brief Add serialized records held in a long[] (4 longs per record)
+ * @return Number of events accepted, or -1 on invalid input
+ */
+static jint addEventArray(JNIEnv* env, SleepDetector& detector, jlongArray records) {
+    constexpr size_t LONGS_PER_EVENT = InteractionEvent::SERIALIZED_SIZE / sizeof(jlong);
+
+    jsize length = env->GetArrayLength(records);
+    if (length % LONGS_PER_EVENT != 0) {
+        __android_log_print(ANDROID_LOG_ERROR, JNI_LOG_TAG,
+                            "Invalid event array length: %d", length);
+        return -1;
+    }
+
+    SafeJNIArray<jlong> elements(env, records);
+    if (!elements.isValid()) {
+        return -1;
+    }
+
+    return static_cast<jint>(detector.addSerializedEvents(reinterpret_cast<const uint8_t*>(elements.get()),
+                                                          static_cast<size_t>(length) / LONGS_PER_EVENT));
+}
+
+/**
+ * @brief Open the event log in an app-private directory
+ * @param durabilityMode EventLog::Durability (0 = page cache, 1 = batched msync)
+ * @return The opened log, or nullptr if storageDir is null or the log cannot be opened
+ */
+static std::unique_ptr<EventLog> openEventLog(JNIEnv* env, jstring storageDir, jint durabilityMode) {
+    const char* directory = storageDir ? env->GetStringUTFChars(storageDir, nullptr) : nullptr;
+    if (!directory) {
+        return nullptr;
+    }
+
+    auto durability = durabilityMode == static_cast<jint>(EventLog::Durability::BATCHED)
+                      ? EventLog::Durability::BATCHED
+                      : EventLog::Durability::NONE;
+
+    auto eventLog = std::make_unique<EventLog>();
+    bool opened = eventLog->open(directory, durability);
+    env->ReleaseStringUTFChars(storageDir, directory);
+
+    return opened ? std::move(eventLog) : nullptr;
+}
+
 // ============================================================================
 // JNI Method Implementations
 // ============================================================================
@@ -216,7 +396,7 @@ extern "C" JNIEXPORT jboolean JNICALL
 Java_io_nava_puuyapu_app_native_NativeSleepTracker_initializeNative(
         JNIEnv* env, jobject thiz) {
 
-    JNIPerformanceTimer timer("initializeNative");
+    JNIPerformanceTimer timer(MetricId::JNI_INITIALIZE);
 
     std::lock_guard<std::mutex> lock(g_detectorMutex);
 
@@ -230,7 +410,7 @@ Java_io_nava_puuyapu_app_native_NativeSleepTracker_initializeNative(
 
         // Create sleep detector with default preferences
         UserPreferences defaultPrefs;
-        g_sleepDetector = std::make_unique<SleepDetector>(defaultPrefs);
+        installDetector(std::make_unique<SleepDetector>(defaultPrefs));
 
         __android_log_print(ANDROID_LOG_INFO, JNI_LOG_TAG,
                             "Native sleep detector initialized successfully");
@@ -244,14 +424,133 @@ Java_io_nava_puuyapu_app_native_NativeSleepTracker_initializeNative(
     }
 }
 
+/**
+ * @brief Initialize the detector backed by a persistent event log
+ * History stored in storageDir is mapped and restored without any JNI
+ * round trips; subsequent events are appended to the log.
+ * @param storageDir App-private directory reserved for the event log
+ * @param durabilityMode EventLog::Durability (0 = page cache, 1 = batched msync)
+ * @return Number of restored events, or -1 if initialization failed.
+ *         If the log cannot be opened the detector still runs in memory (0).
+ */
+extern "C" JNIEXPORT jint JNICALL
+Java_io_nava_puuyapu_app_native_NativeSleepTracker_initializeNativeWithStorage(
+        JNIEnv* env, jobject thiz, jstring storageDir, jint durabilityMode) {
+
+    JNIPerformanceTimer timer(MetricId::JNI_INITIALIZE_WITH_STORAGE);
+
+    std::lock_guard<std::mutex> lock(g_detectorMutex);
+
+    try {
+        if (!initializeJNIReferences(env)) {
+            __android_log_print(ANDROID_LOG_ERROR, JNI_LOG_TAG,
+                                "Failed to initialize JNI references");
+            return -1;
+        }
+
+        // History is replayed before the detector is published: no call can see a partial timeline
+        UserPreferences defaultPrefs;
+        auto detector = std::make_unique<SleepDetector>(defaultPrefs);
+
+        size_t restored = 0;
+        if (!storageDir) {
+            __android_log_print(ANDROID_LOG_ERROR, JNI_LOG_TAG,
+                                "No storage directory, running without event log");
+        } else if (std::unique_ptr<EventLog> eventLog = openEventLog(env, storageDir, durabilityMode)) {
+            restored = detector->attachEventLog(std::move(eventLog));
+        } else {
+            __android_log_print(ANDROID_LOG_ERROR, JNI_LOG_TAG,
+                                "Failed to open event log, running without persistence");
+        }
+
+        installDetector(std::move(detector));
+
+        __android_log_print(ANDROID_LOG_INFO, JNI_LOG_TAG,
+                            "Native sleep detector initialized with %zu restored events", restored);
+
+        return static_cast<jint>(restored);
+
+    } catch (const std::exception& e) {
+        __android_log_print(ANDROID_LOG_ERROR, JNI_LOG_TAG,
+                            "Exception during initialization: %s", e.what());
+        return -1;
+    }
+}
+
+/**
+ * @brief Initialize the detector from a state snapshot, for cold start after process death
+ * Preferences, learned patterns, sealed nights, the raw timeline and counters
+ * are mapped back from snapshotPath before the detector is published, so the
+ * first detectSleep answers without warm-up or replay from Java. With a
+ * storageDir, the event log replays only what was appended after the
+ * snapshot. Later writes go to snapshotPath on optimizeMemory and on
+ * postDetectionRequest(4) (call it from a periodic timer).
+ * @param snapshotPath App-private snapshot file (written atomically)
+ * @param storageDir Event log directory, or null to run without one
+ * @param durabilityMode EventLog::Durability (0 = page cache, 1 = batched msync)
+ * @return 1 if state was restored, 0 if the detector started empty
+ *         (no or unusable snapshot), -1 if initialization failed
+ */
+extern "C" JNIEXPORT jint JNICALL
+Java_io_nava_puuyapu_app_native_NativeSleepTracker_initializeNativeFromSnapshot(
+        JNIEnv* env, jobject thiz, jstring snapshotPath, jstring storageDir, jint durabilityMode) {
+
+    JNIPerformanceTimer timer(MetricId::JNI_INITIALIZE_FROM_SNAPSHOT);
+
+    std::lock_guard<std::mutex> lock(g_detectorMutex);
+
+    try {
+        if (!initializeJNIReferences(env)) {
+            __android_log_print(ANDROID_LOG_ERROR, JNI_LOG_TAG,
+                                "Failed to initialize JNI references");
+            return -1;
+        }
+
+        const char* path = snapshotPath ? env->GetStringUTFChars(snapshotPath, nullptr) : nullptr;
+        if (!path) {
+            __android_log_print(ANDROID_LOG_ERROR, JNI_LOG_TAG,
+                                "initializeNativeFromSnapshot requires a snapshot path");
+            return -1;
+        }
+
+        // Restored before it is published: no call can see a half-loaded detector
+        UserPreferences defaultPrefs;
+        auto detector = std::make_unique<SleepDetector>(defaultPrefs);
+        bool restored = detector->attachSnapshot(path);
+        env->ReleaseStringUTFChars(snapshotPath, path);
+
+        size_t replayed = 0;
+        if (std::unique_ptr<EventLog> eventLog = openEventLog(env, storageDir, durabilityMode)) {
+            replayed = detector->attachEventLog(std::move(eventLog));
+        } else if (storageDir) {
+            __android_log_print(ANDROID_LOG_ERROR, JNI_LOG_TAG,
+                                "Failed to open event log, running without persistence");
+        }
+
+        installDetector(std::move(detector));
+
+        __android_log_print(ANDROID_LOG_INFO, JNI_LOG_TAG,
+                            "Native sleep detector initialized (%s snapshot, %zu events replayed from log)",
+                            restored ? "restored" : "no", replayed);
+
+        return restored ? 1 : 0;
+
+    } catch (const std::exception& e) {
+        __android_log_print(ANDROID_LOG_ERROR, JNI_LOG_TAG,
+                            "Exception during initialization: %s", e.what());
+        return -1;
+    }
+}
+
 extern "C" JNIEXPORT jint JNICALL
 Java_io_nava_puuyapu_app_native_NativeSleepTracker_addInteractionEvent(
         JNIEnv* env, jobject thiz,
         jlong timestamp, jint appType, jlong duration) {
 
-    JNIPerformanceTimer timer("addInteractionEvent");
+    JNIPerformanceTimer timer(MetricId::JNI_ADD_INTERACTION_EVENT);
 
-    if (!g_sleepDetector) {
+    DetectorLease detector = defaultDetector();
+    if (!detector) {
         __android_log_print(ANDROID_LOG_ERROR, JNI_LOG_TAG,
                             "Sleep detector not initialized");
         return static_cast<jint>(InteractionType::UNKNOWN);
@@ -267,16 +566,10 @@ Java_io_nava_puuyapu_app_native_NativeSleepTracker_addInteractionEvent(
         event.category = static_cast<AppCategory>(appType);
 
         // Classify interaction type based on duration and context
-        if (duration < 30000) { // Less than 30 seconds
-            event.type = InteractionType::TIME_CHECK;
-        } else if (duration < 300000) { // Less than 5 minutes
-            event.type = InteractionType::MEANINGFUL_USE;
-        } else {
-            event.type = InteractionType::EXTENDED_USE;
-        }
+        event.type = detector->getClassificationPolicy().inferType(duration);
 
         // Add event to detector for processing
-        g_sleepDetector->addInteractionEvent(event);
+        detector->addInteractionEvent(event);
 
         return static_cast<jint>(event.type);
 
@@ -287,167 +580,1106 @@ Java_io_nava_puuyapu_app_native_NativeSleepTracker_addInteractionEvent(
     }
 }
 
-extern "C" JNIEXPORT jobject JNICALL
-Java_io_nava_puuyapu_app_native_NativeSleepTracker_detectSleep(
-        JNIEnv* env, jobject thiz) {
+/**
+ * @brief Add a batch of events from a direct ByteBuffer
+ * Buffer holds count records in the InteractionEvent::serialize layout
+ * (32 bytes each, little-endian); the whole batch is added under one lock
+ * @return Number of events accepted, or -1 on invalid input
+ */
+extern "C" JNIEXPORT jint JNICALL
+Java_io_nava_puuyapu_app_native_NativeSleepTracker_addInteractionEvents(
+        JNIEnv* env, jobject thiz,
+        jobject buffer, jint count) {
 
-    JNIPerformanceTimer timer("detectSleep");
+    JNIPerformanceTimer timer(MetricId::JNI_ADD_INTERACTION_EVENTS);
 
-    if (!g_sleepDetector) {
+    DetectorLease detector = defaultDetector();
+    if (!detector) {
         __android_log_print(ANDROID_LOG_ERROR, JNI_LOG_TAG,
                             "Sleep detector not initialized");
-        return nullptr;
+        return -1;
     }
 
     try {
-        // Perform sleep detection
-        auto currentTime = std::chrono::system_clock::now();
-        auto result = g_sleepDetector->detectSleepPeriod(currentTime);
+        auto* records = static_cast<const uint8_t*>(env->GetDirectBufferAddress(buffer));
+        jlong capacity = env->GetDirectBufferCapacity(buffer);
 
-        // Convert C++ result to Java object
-        return createJavaSleepResult(env, result);
+        if (!records || count < 0 ||
+            capacity < static_cast<jlong>(count) * static_cast<jlong>(InteractionEvent::SERIALIZED_SIZE)) {
+            __android_log_print(ANDROID_LOG_ERROR, JNI_LOG_TAG,
+                                "Invalid event buffer: count=%d, capacity=%lld",
+                                count, static_cast<long long>(capacity));
+            return -1;
+        }
+
+        return static_cast<jint>(detector->addSerializedEvents(records, static_cast<size_t>(count)));
 
     } catch (const std::exception& e) {
         __android_log_print(ANDROID_LOG_ERROR, JNI_LOG_TAG,
-                            "Exception in detectSleep: %s", e.what());
-        return nullptr;
+                            "Exception in addInteractionEvents: %s", e.what());
+        return -1;
     }
 }
 
-extern "C" JNIEXPORT jdouble JNICALL
-Java_io_nava_puuyapu_app_native_NativeSleepTracker_calculateConfidence(
+/**
+ * @brief Add accelerometer samples from a direct ByteBuffer
+ * Buffer holds count AccelerometerRecord records (24 bytes each, little-endian:
+ * i64 SensorEvent.timestamp, f32 x, y, z in m/s^2, u32 reserved). Samples are
+ * reduced to 30-second activity epochs on the spot and not retained.
+ * @param clockOffsetNs System.currentTimeMillis() * 1e6 - SystemClock.elapsedRealtimeNanos()
+ * @return Finished epochs added, or -1 on invalid input
+ */
+extern "C" JNIEXPORT jint JNICALL
+Java_io_nava_puuyapu_app_native_NativeSleepTracker_addAccelerometerSamples(
         JNIEnv* env, jobject thiz,
-        jlong bedtime, jlong wakeTime) {
+        jobject buffer, jint count, jlong clockOffsetNs) {
 
-    JNIPerformanceTimer timer("calculateConfidence");
+    JNIPerformanceTimer timer(MetricId::JNI_ADD_ACCELEROMETER_SAMPLES);
 
-    if (!g_sleepDetector) {
+    DetectorLease detector = defaultDetector();
+    if (!detector) {
         __android_log_print(ANDROID_LOG_ERROR, JNI_LOG_TAG,
                             "Sleep detector not initialized");
-        return 0.0;
+        return -1;
     }
 
     try {
-        // Create sleep result for confidence calculation
-        SleepDetectionResult session;
-        session.bedtime = std::chrono::system_clock::time_point(
-                std::chrono::milliseconds(bedtime)
-        );
-        session.wake_time = std::chrono::system_clock::time_point(
-                std::chrono::milliseconds(wakeTime)
-        );
+        auto* records = static_cast<const uint8_t*>(env->GetDirectBufferAddress(buffer));
+        jlong capacity = env->GetDirectBufferCapacity(buffer);
 
-        // Calculate duration
-        if (session.bedtime.has_value() && session.wake_time.has_value()) {
-            session.duration = std::chrono::duration<double, std::ratio<3600>>(
-                    calculateDurationHours(session.bedtime.value(), session.wake_time.value())
-            );
+        if (!records || count < 0 ||
+            capacity < static_cast<jlong>(count) * static_cast<jlong>(AccelerometerRecord::SERIALIZED_SIZE)) {
+            __android_log_print(ANDROID_LOG_ERROR, JNI_LOG_TAG,
+                                "Invalid accelerometer buffer: count=%d, capacity=%lld",
+                                count, static_cast<long long>(capacity));
+            return -1;
         }
 
-        double confidence = g_sleepDetector->calculateConfidenceScore(session);
-        return static_cast<jdouble>(confidence);
+        return static_cast<jint>(detector->addAccelerometerSamples(records, static_cast<size_t>(count),
+                                                                   static_cast<int64_t>(clockOffsetNs)));
 
     } catch (const std::exception& e) {
         __android_log_print(ANDROID_LOG_ERROR, JNI_LOG_TAG,
-                            "Exception in calculateConfidence: %s", e.what());
-        return 0.0;
+                            "Exception in addAccelerometerSamples: %s", e.what());
+        return -1;
     }
 }
 
-extern "C" JNIEXPORT void JNICALL
-Java_io_nava_puuyapu_app_native_NativeSleepTracker_updateUserPreferences(
+/**
+ * @brief Close the open activity epoch (call when the accelerometer is unregistered)
+ * @return Epochs added (0 or 1), or -1 if not initialized
+ */
+extern "C" JNIEXPORT jint JNICALL
+Java_io_nava_puuyapu_app_native_NativeSleepTracker_flushActivityEpoch(
+        JNIEnv* env, jobject thiz) {
+
+    DetectorLease detector = defaultDetector();
+    if (!detector) {
+        return -1;
+    }
+    return static_cast<jint>(detector->flushActivityEpoch());
+}
+
+/**
+ * @brief Add a batch of events from a long[] (4 longs per record)
+ * Same record layout as the ByteBuffer variant, packed into jlongs
+ * @return Number of events accepted, or -1 on invalid input
+ */
+extern "C" JNIEXPORT jint JNICALL
+Java_io_nava_puuyapu_app_native_NativeSleepTracker_addInteractionEventsArray(
         JNIEnv* env, jobject thiz,
-        jdouble targetSleepHours, jlong preferredBedtime, jlong preferredWakeTime) {
+        jlongArray records) {
 
-    JNIPerformanceTimer timer("updateUserPreferences");
+    JNIPerformanceTimer timer(MetricId::JNI_ADD_INTERACTION_EVENTS_ARRAY);
 
-    if (!g_sleepDetector) {
+    DetectorLease detector = defaultDetector();
+    if (!detector) {
         __android_log_print(ANDROID_LOG_ERROR, JNI_LOG_TAG,
                             "Sleep detector not initialized");
-        return;
+        return -1;
     }
 
     try {
-        UserPreferences preferences;
-        preferences.target_sleep_hours = std::chrono::duration<double, std::ratio<3600>>(targetSleepHours);
-
-        // Convert timestamps to minutes since midnight
-        auto bedtime_tp = std::chrono::system_clock::time_point(std::chrono::milliseconds(preferredBedtime));
-        auto waketime_tp = std::chrono::system_clock::time_point(std::chrono::milliseconds(preferredWakeTime));
-
-        preferences.target_bedtime = getMinutesSinceMidnight(bedtime_tp);
-        preferences.target_wake_time = getMinutesSinceMidnight(waketime_tp);
-        preferences.weekday_bedtime = preferences.target_bedtime;
-        preferences.weekend_bedtime = preferences.target_bedtime;
-
-        g_sleepDetector->updateUserPreferences(preferences);
-
-        __android_log_print(ANDROID_LOG_INFO, JNI_LOG_TAG,
-                            "User preferences updated: target=%.1f hours", targetSleepHours);
+        return addEventArray(env, *detector, records);
 
     } catch (const std::exception& e) {
         __android_log_print(ANDROID_LOG_ERROR, JNI_LOG_TAG,
-                            "Exception in updateUserPreferences: %s", e.what());
+                            "Exception in addInteractionEventsArray: %s", e.what());
+        return -1;
     }
 }
 
-extern "C" JNIEXPORT jboolean JNICALL
-Java_io_nava_puuyapu_app_native_NativeSleepTracker_isCurrentlyAsleep(
+extern "C" JNIEXPORT jobject JNICALL
+Java_io_nava_puuyapu_app_native_NativeSleepTracker_detectSleep(
         JNIEnv* env, jobject thiz) {
 
-    JNIPerformanceTimer timer("isCurrentlyAsleep");
+    JNIPerformanceTimer timer(MetricId::JNI_DETECT_SLEEP);
 
-    if (!g_sleepDetector) {
-        return JNI_FALSE;
+    DetectorLease detector = defaultDetector();
+    if (!detector) {
+        __android_log_print(ANDROID_LOG_ERROR, JNI_LOG_TAG,
+                            "Sleep detector not initialized");
+        return nullptr;
     }
 
     try {
-        auto currentTime = std::chrono::system_clock::now();
-        bool isAsleep = g_sleepDetector->isCurrentlyAsleep(currentTime);
-        return isAsleep ? JNI_TRUE : JNI_FALSE;
+        // Perform sleep detection
+        auto currentTime = detector->now();
+        auto result = detector->detectSleepPeriod(currentTime);
+
+        // Convert C++ result to Java object
+        return createJavaSleepResult(env, result);
 
     } catch (const std::exception& e) {
         __android_log_print(ANDROID_LOG_ERROR, JNI_LOG_TAG,
-                            "Exception in isCurrentlyAsleep: %s", e.what());
-        return JNI_FALSE;
+                            "Exception in detectSleep: %s", e.what());
+        return nullptr;
     }
 }
 
-extern "C" JNIEXPORT jlong JNICALL
-Java_io_nava_puuyapu_app_native_NativeSleepTracker_getEstimatedSleepStart(
-        JNIEnv* env, jobject thiz) {
+/**
+ * @brief Address and capacity of a direct ByteBuffer
+ * @return nullptr if the buffer is not direct or empty
+ */
+static uint8_t* directBuffer(JNIEnv* env, jobject buffer, size_t& capacity) {
+    auto* address = static_cast<uint8_t*>(env->GetDirectBufferAddress(buffer));
+    jlong bytes = env->GetDirectBufferCapacity(buffer);
+    if (!address || bytes <= 0) {
+        return nullptr;
+    }
+    capacity = static_cast<size_t>(bytes);
+    return address;
+}
+
+/**
+ * @brief Serialize the detection at currentTime straight from the detector's result, no copy
+ * @return Bytes written, or the negated required size if capacity is too small
+ */
+static jint packSleepPeriod(SleepDetector& detector, std::chrono::system_clock::time_point currentTime,
+                           uint8_t* output, size_t capacity) {
+    auto borrowed = detector.borrowSleepPeriod(currentTime);
+    const SleepDetectionResult& result = *borrowed;
+
+    size_t required = DataProcessor::packedResultSize(result);
+    if (required > capacity) {
+        return -static_cast<jint>(required);
+    }
+
+    return static_cast<jint>(DataProcessor::serializePacked(result, output, capacity));
+}
+
+/**
+ * @brief Detect sleep and write the result into a caller-provided direct ByteBuffer
+ * Layout is DataProcessor::serializePacked (versioned, little-endian); no Java
+ * objects are allocated, Java decodes the buffer lazily
+ * @return Bytes written; if the buffer is too small, the negated required size
+ *         (nothing written); 0 on error
+ */
+extern "C" JNIEXPORT jint JNICALL
+Java_io_nava_puuyapu_app_native_NativeSleepTracker_detectSleepPacked(
+        JNIEnv* env, jobject thiz, jobject buffer) {
 
-    JNIPerformanceTimer timer("getEstimatedSleepStart");
+    JNIPerformanceTimer timer(MetricId::JNI_DETECT_SLEEP_PACKED);
 
-    if (!g_sleepDetector) {
+    DetectorLease detector = defaultDetector();
+    if (!detector) {
+        __android_log_print(ANDROID_LOG_ERROR, JNI_LOG_TAG,
+                            "Sleep detector not initialized");
         return 0;
     }
 
     try {
-        auto currentTime = std::chrono::system_clock::now();
-        auto sleepStart = g_sleepDetector->getEstimatedSleepStart(currentTime);
-
-        if (sleepStart.has_value()) {
-            auto epoch = sleepStart.value().time_since_epoch();
-            return std::chrono::duration_cast<std::chrono::milliseconds>(epoch).count();
+        size_t capacity = 0;
+        uint8_t* output = directBuffer(env, buffer, capacity);
+        if (!output) {
+            __android_log_print(ANDROID_LOG_ERROR, JNI_LOG_TAG,
+                                "detectSleepPacked requires a direct ByteBuffer");
+            return 0;
         }
 
-        return 0;
+        return packSleepPeriod(*detector, detector->now(), output, capacity);
 
     } catch (const std::exception& e) {
         __android_log_print(ANDROID_LOG_ERROR, JNI_LOG_TAG,
-                            "Exception in getEstimatedSleepStart: %s", e.what());
+                            "Exception in detectSleepPacked: %s", e.what());
         return 0;
     }
 }
 
-extern "C" JNIEXPORT void JNICALL
-Java_io_nava_puuyapu_app_native_NativeSleepTracker_clearOldData(
-        JNIEnv* env, jobject thiz, jlong cutoffTimestamp) {
+/**
+ * @brief Pack a candidate ranking, best first
+ * Layout: u32 candidate count, u32 candidates evaluated, then per candidate
+ * i64 bedtime (ms), i64 wake time (ms), f32 score, f32 duration (hours),
+ * f32 pattern match, f32 quality, u8 SleepConfidence, u8 flags
+ * (bit 0 nighttime, bit 1 manually confirmed), u16 reserved (36 bytes)
+ * @return Bytes written, or the negated required size if capacity is too small
+ */
+static jint packSleepCandidates(const SleepCandidateRanking& ranking, uint8_t* output, size_t capacity) {
+    constexpr size_t CANDIDATES_HEADER_SIZE = 8;
+    constexpr size_t CANDIDATE_RECORD_SIZE = 36;
 
-    JNIPerformanceTimer timer("clearOldData");
+    size_t required = CANDIDATES_HEADER_SIZE + ranking.count * CANDIDATE_RECORD_SIZE;
+    if (required > capacity) {
+        return -static_cast<jint>(required);
+    }
 
-    if (!g_sleepDetector) {
+    uint32_t count = static_cast<uint32_t>(ranking.count);
+    uint32_t evaluated = static_cast<uint32_t>(ranking.evaluated);
+    std::memcpy(output, &count, sizeof(uint32_t));
+    std::memcpy(output + 4, &evaluated, sizeof(uint32_t));
+
+    uint8_t* record = output + CANDIDATES_HEADER_SIZE;
+    for (const SleepCandidate& candidate : ranking) {
+        int64_t bedtime_ms = std::chrono::duration_cast<std::chrono::milliseconds>(
+                candidate.bedtime.time_since_epoch()).count();
+        int64_t wake_ms = std::chrono::duration_cast<std::chrono::milliseconds>(
+                candidate.wake_time.time_since_epoch()).count();
+        float scores[4] = {
+                static_cast<float>(candidate.score),
+                static_cast<float>(candidate.duration_hours),
+                static_cast<float>(candidate.pattern_match_score),
+                static_cast<float>(candidate.quality_score)
+        };
+        uint8_t tail[4] = {
+                static_cast<uint8_t>(candidate.confidence()),
+                static_cast<uint8_t>((candidate.is_nighttime ? 1u : 0u) | (candidate.is_manually_confirmed ? 2u : 0u)),
+                0, 0
+        };
+
+        std::memcpy(record, &bedtime_ms, sizeof(int64_t));
+        std::memcpy(record + 8, &wake_ms, sizeof(int64_t));
+        std::memcpy(record + 16, scores, sizeof(scores));
+        std::memcpy(record + 32, tail, sizeof(tail));
+        record += CANDIDATE_RECORD_SIZE;
+    }
+    return static_cast<jint>(required);
+}
+
+/**
+ * @brief Rank the candidate sleep windows of the live detection into a direct ByteBuffer
+ * The first candidate is the window detectSleepPacked reports; the rest are
+ * alternatives for the UI (layout: see packSleepCandidates). Reuses the
+ * cached detection pass, so calling both costs one detection.
+ * @return Bytes written; if the buffer is too small, the negated required size
+ *         (nothing written); 0 on error
+ */
+extern "C" JNIEXPORT jint JNICALL
+Java_io_nava_puuyapu_app_native_NativeSleepTracker_rankSleepCandidatesPacked(
+        JNIEnv* env, jobject thiz, jobject buffer) {
+
+    JNIPerformanceTimer timer(MetricId::JNI_RANK_SLEEP_CANDIDATES);
+
+    DetectorLease detector = defaultDetector();
+    size_t capacity = 0;
+    uint8_t* output = detector ? directBuffer(env, buffer, capacity) : nullptr;
+    if (!output) {
+        __android_log_print(ANDROID_LOG_ERROR, JNI_LOG_TAG,
+                            "rankSleepCandidatesPacked requires an initialized detector and a direct ByteBuffer");
+        return 0;
+    }
+
+    try {
+        return packSleepCandidates(detector->rankSleepCandidates(detector->now()), output, capacity);
+
+    } catch (const std::exception& e) {
+        __android_log_print(ANDROID_LOG_ERROR, JNI_LOG_TAG,
+                            "Exception in rankSleepCandidatesPacked: %s", e.what());
+        return 0;
+    }
+}
+
+/**
+ * @brief Pack results back to back behind a u32 count and a u32 reserved word
+ * @return Bytes written, or the negated required size if capacity is too small
+ */
+static jint writePackedBatch(const SleepDetectionResult* results, size_t count,
+                             uint8_t* output, size_t capacity) {
+    constexpr size_t BATCH_HEADER_SIZE = 8;
+    size_t required = BATCH_HEADER_SIZE;
+    for (size_t i = 0; i < count; ++i) {
+        required += DataProcessor::packedResultSize(results[i]);
+    }
+    if (required > capacity) {
+        return -static_cast<jint>(required);
+    }
+
+    uint32_t packed_count = static_cast<uint32_t>(count);
+    uint32_t reserved = 0;
+    std::memcpy(output, &packed_count, sizeof(uint32_t));
+    std::memcpy(output + 4, &reserved, sizeof(uint32_t));
+
+    size_t offset = BATCH_HEADER_SIZE;
+    for (size_t i = 0; i < count; ++i) {
+        offset += DataProcessor::serializePacked(results[i], output + offset, required - offset);
+    }
+
+    return static_cast<jint>(offset);
+}
+
+/**
+ * @brief Pack every night in [fromMs, toMs) from the detector's scratch results, nothing is copied
+ * @return Bytes written, or the negated required size if capacity is too small
+ */
+static jint packSleepPeriods(SleepDetector& detector, jlong fromMs, jlong toMs,
+                             uint8_t* output, size_t capacity) {
+    jint written = 0;
+    detector.visitSleepPeriods(
+            std::chrono::system_clock::time_point(std::chrono::milliseconds(fromMs)),
+            std::chrono::system_clock::time_point(std::chrono::milliseconds(toMs)),
+            [&](const SleepDetectionResult* results, size_t count) {
+                written = writePackedBatch(results, count, output, capacity);
+            });
+    return written;
+}
+
+/**
+ * @brief Detect all nights in [fromMs, toMs) into a caller-provided direct ByteBuffer
+ * Layout: u32 result count, u32 reserved, then count records in the
+ * DataProcessor::serializePacked layout back to back (each self-sized)
+ * @return Bytes written; if the buffer is too small, the negated required size
+ *         (nothing written); 0 on error
+ */
+extern "C" JNIEXPORT jint JNICALL
+Java_io_nava_puuyapu_app_native_NativeSleepTracker_detectSleepPeriodsPacked(
+        JNIEnv* env, jobject thiz, jlong fromMs, jlong toMs, jobject buffer) {
+
+    JNIPerformanceTimer timer(MetricId::JNI_DETECT_SLEEP_PERIODS_PACKED);
+
+    DetectorLease detector = defaultDetector();
+    if (!detector) {
+        __android_log_print(ANDROID_LOG_ERROR, JNI_LOG_TAG,
+                            "Sleep detector not initialized");
+        return 0;
+    }
+
+    try {
+        size_t capacity = 0;
+        uint8_t* output = directBuffer(env, buffer, capacity);
+        if (!output) {
+            __android_log_print(ANDROID_LOG_ERROR, JNI_LOG_TAG,
+                                "detectSleepPeriodsPacked requires a direct ByteBuffer");
+            return 0;
+        }
+
+        return packSleepPeriods(*detector, fromMs, toMs, output, capacity);
+
+    } catch (const std::exception& e) {
+        __android_log_print(ANDROID_LOG_ERROR, JNI_LOG_TAG,
+                            "Exception in detectSleepPeriodsPacked: %s", e.what());
+        return 0;
+    }
+}
+
+/**
+ * @brief Pack the retained events of [from, to) straight from the timeline columns
+ * Layout: u32 event count, u32 time-check count, i64 total duration (ms),
+ * then count InteractionEvent::serialize records (32 bytes each)
+ * @return Bytes written, or the negated required size if capacity is too small
+ */
+static jint packEventRange(SleepDetector& detector,
+                           std::chrono::system_clock::time_point from,
+                           std::chrono::system_clock::time_point to,
+                           uint8_t* output, size_t capacity) {
+    constexpr size_t RANGE_HEADER_SIZE = 16;
+
+    return detector.visitEvents(from, to, [&](const EventRange& range) -> jint {
+        size_t required = RANGE_HEADER_SIZE + range.size() * InteractionEvent::SERIALIZED_SIZE;
+        if (required > capacity) {
+            return -static_cast<jint>(required);
+        }
+
+        uint32_t count = static_cast<uint32_t>(range.size());
+        uint32_t time_checks = static_cast<uint32_t>(range.timeCheckCount());
+        int64_t total_duration_ms = range.totalDuration().count();
+        std::memcpy(output, &count, sizeof(uint32_t));
+        std::memcpy(output + 4, &time_checks, sizeof(uint32_t));
+        std::memcpy(output + 8, &total_duration_ms, sizeof(int64_t));
+
+        uint8_t* record = output + RANGE_HEADER_SIZE;
+        for (size_t k = 0; k < range.size(); ++k) {
+            range.eventAt(k).serialize(record);
+            record += InteractionEvent::SERIALIZED_SIZE;
+        }
+        return static_cast<jint>(required);
+    });
+}
+
+/**
+ * @brief Retained events in [fromMs, toMs) into a caller-provided direct ByteBuffer
+ * Layout: see packEventRange. Only raw-tier nights have events.
+ * @return Bytes written; if the buffer is too small, the negated required size
+ *         (nothing written); 0 on error
+ */
+extern "C" JNIEXPORT jint JNICALL
+Java_io_nava_puuyapu_app_native_NativeSleepTracker_getEventsPacked(
+        JNIEnv* env, jobject thiz, jlong fromMs, jlong toMs, jobject buffer) {
+
+    JNIPerformanceTimer timer(MetricId::JNI_GET_EVENTS_PACKED);
+
+    DetectorLease detector = defaultDetector();
+    size_t capacity = 0;
+    uint8_t* output = detector ? directBuffer(env, buffer, capacity) : nullptr;
+    if (!output) {
+        __android_log_print(ANDROID_LOG_ERROR, JNI_LOG_TAG,
+                            "getEventsPacked requires an initialized detector and a direct ByteBuffer");
+        return 0;
+    }
+
+    try {
+        return packEventRange(*detector,
+                              std::chrono::system_clock::time_point(std::chrono::milliseconds(fromMs)),
+                              std::chrono::system_clock::time_point(std::chrono::milliseconds(toMs)),
+                              output, capacity);
+
+    } catch (const std::exception& e) {
+        __android_log_print(ANDROID_LOG_ERROR, JNI_LOG_TAG,
+                            "Exception in getEventsPacked: %s", e.what());
+        return 0;
+    }
+}
+
+/**
+ * @brief Events of the night window (local noon to noon) containing timestampMs
+ * Layout: see packEventRange
+ * @return Bytes written; if the buffer is too small, the negated required size
+ *         (nothing written); 0 on error
+ */
+extern "C" JNIEXPORT jint JNICALL
+Java_io_nava_puuyapu_app_native_NativeSleepTracker_getNightEventsPacked(
+        JNIEnv* env, jobject thiz, jlong timestampMs, jobject buffer) {
+
+    JNIPerformanceTimer timer(MetricId::JNI_GET_EVENTS_PACKED);
+
+    DetectorLease detector = defaultDetector();
+    size_t capacity = 0;
+    uint8_t* output = detector ? directBuffer(env, buffer, capacity) : nullptr;
+    if (!output) {
+        __android_log_print(ANDROID_LOG_ERROR, JNI_LOG_TAG,
+                            "getNightEventsPacked requires an initialized detector and a direct ByteBuffer");
+        return 0;
+    }
+
+    try {
+        auto& time_zone = TimeZoneContext::shared();
+        auto time_point = std::chrono::system_clock::time_point(std::chrono::milliseconds(timestampMs));
+        int64_t night_index = time_zone.toCivil(time_point).night_index;
+
+        return packEventRange(*detector,
+                              time_zone.nightWindowStartOf(night_index),
+                              time_zone.nightWindowStartOf(night_index + 1),
+                              output, capacity);
+
+    } catch (const std::exception& e) {
+        __android_log_print(ANDROID_LOG_ERROR, JNI_LOG_TAG,
+                            "Exception in getNightEventsPacked: %s", e.what());
+        return 0;
+    }
+}
+
+/**
+ * @brief Chunked sink writing into a java.io.OutputStream
+ * One reusable byte[] of the writer's buffer size; a pending Java exception
+ * fails the sink and is left for the caller to observe.
+ */
+class JavaOutputStreamSink : public OutputSink {
+public:
+    JavaOutputStreamSink(JNIEnv* env, jobject stream) noexcept : env_(env), stream_(stream) {
+        jclass streamClass = env->GetObjectClass(stream);
+        write_ = env->GetMethodID(streamClass, "write", "([BII)V");
+        env->DeleteLocalRef(streamClass);
+        if (write_) {
+            chunk_ = env->NewByteArray(static_cast<jsize>(StreamWriter::BUFFER_BYTES));
+        }
+    }
+
+    ~JavaOutputStreamSink() override {
+        if (chunk_) {
+            env_->DeleteLocalRef(chunk_);
+        }
+    }
+
+    bool isValid() const noexcept { return chunk_ != nullptr; }
+
+    bool write(const char* data, size_t size) noexcept override {
+        while (size > 0) {
+            auto length = static_cast<jsize>(std::min(size, StreamWriter::BUFFER_BYTES));
+            env_->SetByteArrayRegion(chunk_, 0, length, reinterpret_cast<const jbyte*>(data));
+            env_->CallVoidMethod(stream_, write_, chunk_, 0, length);
+            if (env_->ExceptionCheck()) {
+                return false;
+            }
+            data += length;
+            size -= static_cast<size_t>(length);
+        }
+        return true;
+    }
+
+private:
+    JNIEnv* env_;
+    jobject stream_;
+    jmethodID write_ = nullptr;
+    jbyteArray chunk_ = nullptr;
+};
+
+/**
+ * @brief Detect nights in [fromMs, toMs) and stream them as JSON (format 0) or CSV (format 1)
+ */
+static bool writeSleepHistory(SleepDetector& detector, jlong fromMs, jlong toMs, jint format,
+                              OutputSink& sink) {
+    auto results = detector.detectSleepPeriods(
+            std::chrono::system_clock::time_point(std::chrono::milliseconds(fromMs)),
+            std::chrono::system_clock::time_point(std::chrono::milliseconds(toMs)));
+
+    return (format == 1)
+           ? DataProcessor::exportToCSV(results, sink)
+           : DataProcessor::exportToJSON(results, sink);
+}
+
+/**
+ * @brief Export all nights in [fromMs, toMs) as JSON (format 0) or CSV (format 1)
+ */
+extern "C" JNIEXPORT jstring JNICALL
+Java_io_nava_puuyapu_app_native_NativeSleepTracker_exportSleepHistory(
+        JNIEnv* env, jobject thiz, jlong fromMs, jlong toMs, jint format) {
+
+    JNIPerformanceTimer timer(MetricId::JNI_EXPORT_SLEEP_HISTORY);
+
+    DetectorLease detector = defaultDetector();
+    if (!detector) {
+        __android_log_print(ANDROID_LOG_ERROR, JNI_LOG_TAG,
+                            "Sleep detector not initialized");
+        return env->NewStringUTF("");
+    }
+
+    try {
+        StringSink sink;
+        writeSleepHistory(*detector, fromMs, toMs, format, sink);
+
+        return env->NewStringUTF(sink.str().c_str());
+
+    } catch (const std::exception& e) {
+        __android_log_print(ANDROID_LOG_ERROR, JNI_LOG_TAG,
+                            "Exception in exportSleepHistory: %s", e.what());
+        return env->NewStringUTF("");
+    }
+}
+
+/**
+ * @brief Stream sleep history to a file descriptor (e.g. ParcelFileDescriptor.getFd())
+ * The descriptor stays owned by the caller.
+ * @return true if every chunk was written
+ */
+extern "C" JNIEXPORT jboolean JNICALL
+Java_io_nava_puuyapu_app_native_NativeSleepTracker_exportSleepHistoryToFd(
+        JNIEnv* env, jobject thiz, jlong fromMs, jlong toMs, jint format, jint fd) {
+
+    JNIPerformanceTimer timer(MetricId::JNI_EXPORT_SLEEP_HISTORY);
+
+    DetectorLease detector = defaultDetector();
+    if (!detector || fd < 0) {
+        __android_log_print(ANDROID_LOG_ERROR, JNI_LOG_TAG,
+                            "Sleep detector not initialized or invalid descriptor");
+        return JNI_FALSE;
+    }
+
+    try {
+        FdSink sink(fd);
+        return writeSleepHistory(*detector, fromMs, toMs, format, sink) ? JNI_TRUE : JNI_FALSE;
+
+    } catch (const std::exception& e) {
+        __android_log_print(ANDROID_LOG_ERROR, JNI_LOG_TAG,
+                            "Exception in exportSleepHistoryToFd: %s", e.what());
+        return JNI_FALSE;
+    }
+}
+
+/**
+ * @brief Open (or prepare) the finished-session archive
+ * Reads only the archive's footer and month index.
+ * @param archivePath App-private file path, created by the first archiveSleepHistory
+ * @return false if the file exists but is damaged
+ */
+extern "C" JNIEXPORT jboolean JNICALL
+Java_io_nava_puuyapu_app_native_NativeSleepTracker_openSessionArchive(
+        JNIEnv* env, jobject thiz, jstring archivePath) {
+
+    JNIPerformanceTimer timer(MetricId::JNI_OPEN_SESSION_ARCHIVE);
+
+    const char* path = archivePath ? env->GetStringUTFChars(archivePath, nullptr) : nullptr;
+    if (!path) {
+        return JNI_FALSE;
+    }
+
+    std::lock_guard<std::mutex> lock(g_archiveMutex);
+    auto archive = std::make_unique<SessionArchive>();
+    bool opened = archive->open(path);
+    env->ReleaseStringUTFChars(archivePath, path);
+
+    if (!opened) {
+        __android_log_print(ANDROID_LOG_ERROR, JNI_LOG_TAG,
+                            "Session archive is damaged, history unavailable");
+        g_sessionArchive.reset();
+        return JNI_FALSE;
+    }
+
+    g_sessionArchive = std::move(archive);
+    return JNI_TRUE;
+}
+
+/**
+ * @brief Detect nights in [fromMs, toMs) and append the sealed ones to the archive
+ * Only sealed nights are final; a night still in progress is archived on a
+ * later call, once sealed. Nights already archived are skipped, so
+ * overlapping windows are safe.
+ * @return Number of nights archived, -1 on error
+ */
+extern "C" JNIEXPORT jint JNICALL
+Java_io_nava_puuyapu_app_native_NativeSleepTracker_archiveSleepHistory(
+        JNIEnv* env, jobject thiz, jlong fromMs, jlong toMs) {
+
+    JNIPerformanceTimer timer(MetricId::JNI_ARCHIVE_SLEEP_HISTORY);
+
+    DetectorLease detector = defaultDetector();
+    if (!detector) {
+        __android_log_print(ANDROID_LOG_ERROR, JNI_LOG_TAG,
+                            "Sleep detector not initialized");
+        return -1;
+    }
+
+    try {
+        // The archive is append-only: a provisional night could never be corrected
+        auto results = detector->detectSealedSleepPeriods(
+                std::chrono::system_clock::time_point(std::chrono::milliseconds(fromMs)),
+                std::chrono::system_clock::time_point(std::chrono::milliseconds(toMs)));
+
+        std::lock_guard<std::mutex> lock(g_archiveMutex);
+        if (!g_sessionArchive) {
+            __android_log_print(ANDROID_LOG_ERROR, JNI_LOG_TAG,
+                                "Session archive not opened");
+            return -1;
+        }
+
+        return static_cast<jint>(g_sessionArchive->append(results));
+
+    } catch (const std::exception& e) {
+        __android_log_print(ANDROID_LOG_ERROR, JNI_LOG_TAG,
+                            "Exception in archiveSleepHistory: %s", e.what());
+        return -1;
+    }
+}
+
+/**
+ * @brief Load the newest archived nights into a caller-provided direct ByteBuffer
+ * Same layout as detectSleepPeriodsPacked, oldest night first.
+ * @return Bytes written; if the buffer is too small, the negated required size
+ *         (nothing written); 0 on error
+ */
+extern "C" JNIEXPORT jint JNICALL
+Java_io_nava_puuyapu_app_native_NativeSleepTracker_loadRecentNightsPacked(
+        JNIEnv* env, jobject thiz, jint count, jobject buffer) {
+
+    JNIPerformanceTimer timer(MetricId::JNI_LOAD_RECENT_NIGHTS_PACKED);
+
+    try {
+        auto* output = static_cast<uint8_t*>(env->GetDirectBufferAddress(buffer));
+        jlong capacity = env->GetDirectBufferCapacity(buffer);
+
+        if (!output || capacity <= 0 || count < 0) {
+            __android_log_print(ANDROID_LOG_ERROR, JNI_LOG_TAG,
+                                "loadRecentNightsPacked requires a direct ByteBuffer");
+            return 0;
+        }
+
+        std::vector<SleepDetectionResult> nights;
+        {
+            std::lock_guard<std::mutex> lock(g_archiveMutex);
+            if (!g_sessionArchive) {
+                __android_log_print(ANDROID_LOG_ERROR, JNI_LOG_TAG,
+                                    "Session archive not opened");
+                return 0;
+            }
+            nights = g_sessionArchive->readLastNights(static_cast<size_t>(count));
+        }
+
+        return writePackedBatch(nights.data(), nights.size(), output, static_cast<size_t>(capacity));
+
+    } catch (const std::exception& e) {
+        __android_log_print(ANDROID_LOG_ERROR, JNI_LOG_TAG,
+                            "Exception in loadRecentNightsPacked: %s", e.what());
+        return 0;
+    }
+}
+
+/**
+ * @brief Stream sleep history into a java.io.OutputStream in 4KB chunks
+ * @return true if every chunk was written (an IOException stays pending otherwise)
+ */
+extern "C" JNIEXPORT jboolean JNICALL
+Java_io_nava_puuyapu_app_native_NativeSleepTracker_exportSleepHistoryToStream(
+        JNIEnv* env, jobject thiz, jlong fromMs, jlong toMs, jint format, jobject outputStream) {
+
+    JNIPerformanceTimer timer(MetricId::JNI_EXPORT_SLEEP_HISTORY);
+
+    DetectorLease detector = defaultDetector();
+    if (!detector || !outputStream) {
+        __android_log_print(ANDROID_LOG_ERROR, JNI_LOG_TAG,
+                            "Sleep detector not initialized or null stream");
+        return JNI_FALSE;
+    }
+
+    try {
+        JavaOutputStreamSink sink(env, outputStream);
+        if (!sink.isValid()) {
+            return JNI_FALSE;
+        }
+        return writeSleepHistory(*detector, fromMs, toMs, format, sink) ? JNI_TRUE : JNI_FALSE;
+
+    } catch (const std::exception& e) {
+        __android_log_print(ANDROID_LOG_ERROR, JNI_LOG_TAG,
+                            "Exception in exportSleepHistoryToStream: %s", e.what());
+        return JNI_FALSE;
+    }
+}
+
+extern "C" JNIEXPORT jdouble JNICALL
+Java_io_nava_puuyapu_app_native_NativeSleepTracker_calculateConfidence(
+        JNIEnv* env, jobject thiz,
+        jlong bedtime, jlong wakeTime) {
+
+    JNIPerformanceTimer timer(MetricId::JNI_CALCULATE_CONFIDENCE);
+
+    DetectorLease detector = defaultDetector();
+    if (!detector) {
+        __android_log_print(ANDROID_LOG_ERROR, JNI_LOG_TAG,
+                            "Sleep detector not initialized");
+        return 0.0;
+    }
+
+    try {
+        // Create sleep result for confidence calculation
+        SleepDetectionResult session;
+        session.bedtime = std::chrono::system_clock::time_point(
+                std::chrono::milliseconds(bedtime)
+        );
+        session.wake_time = std::chrono::system_clock::time_point(
+                std::chrono::milliseconds(wakeTime)
+        );
+
+        // Calculate duration
+        if (session.bedtime.has_value() && session.wake_time.has_value()) {
+            session.duration = std::chrono::duration<double, std::ratio<3600>>(
+                    calculateDurationHours(session.bedtime.value(), session.wake_time.value())
+            );
+        }
+
+        double confidence = detector->calculateConfidenceScore(session);
+        return static_cast<jdouble>(confidence);
+
+    } catch (const std::exception& e) {
+        __android_log_print(ANDROID_LOG_ERROR, JNI_LOG_TAG,
+                            "Exception in calculateConfidence: %s", e.what());
+        return 0.0;
+    }
+}
+
+extern "C" JNIEXPORT void JNICALL
+Java_io_nava_puuyapu_app_native_NativeSleepTracker_updateUserPreferences(
+        JNIEnv* env, jobject thiz,
+        jdouble targetSleepHours, jlong preferredBedtime, jlong preferredWakeTime) {
+
+    JNIPerformanceTimer timer(MetricId::JNI_UPDATE_PREFERENCES);
+
+    DetectorLease detector = defaultDetector();
+    if (!detector) {
+        __android_log_print(ANDROID_LOG_ERROR, JNI_LOG_TAG,
+                            "Sleep detector not initialized");
+        return;
+    }
+
+    try {
+        UserPreferences preferences;
+        preferences.target_sleep_hours = std::chrono::duration<double, std::ratio<3600>>(targetSleepHours);
+
+        // Convert timestamps to minutes since midnight
+        auto bedtime_tp = std::chrono::system_clock::time_point(std::chrono::milliseconds(preferredBedtime));
+        auto waketime_tp = std::chrono::system_clock::time_point(std::chrono::milliseconds(preferredWakeTime));
+
+        preferences.target_bedtime = getMinutesSinceMidnight(bedtime_tp);
+        preferences.target_wake_time = getMinutesSinceMidnight(waketime_tp);
+        preferences.weekday_bedtime = preferences.target_bedtime;
+        preferences.weekend_bedtime = preferences.target_bedtime;
+
+        detector->updateUserPreferences(preferences);
+
+        __android_log_print(ANDROID_LOG_INFO, JNI_LOG_TAG,
+                            "User preferences updated: target=%.1f hours", targetSleepHours);
+
+    } catch (const std::exception& e) {
+        __android_log_print(ANDROID_LOG_ERROR, JNI_LOG_TAG,
+                            "Exception in updateUserPreferences: %s", e.what());
+    }
+}
+
+/**
+ * @brief Apply every detection preference (updateUserPreferences keeps only one bedtime)
+ * Times of day are minutes since local midnight (0-1439; a weekend bedtime
+ * of 1440 is midnight). Invalid sets are rejected and the current one kept.
+ * @return true if the preferences were applied
+ */
+extern "C" JNIEXPORT jboolean JNICALL
+Java_io_nava_puuyapu_app_native_NativeSleepTracker_setUserPreferences(
+        JNIEnv* env, jobject thiz,
+        jdouble targetSleepHours, jint targetBedtimeMinutes, jint targetWakeMinutes,
+        jint weekdayBedtimeMinutes, jint weekendBedtimeMinutes,
+        jlong minimumGapSeconds, jlong timeCheckSeconds,
+        jboolean smartDetection, jboolean trackInterruptions, jdouble confidenceThreshold) {
+
+    JNIPerformanceTimer timer(MetricId::JNI_SET_USER_PREFERENCES);
+
+    DetectorLease detector = defaultDetector();
+    if (!detector) {
+        __android_log_print(ANDROID_LOG_ERROR, JNI_LOG_TAG,
+                            "Sleep detector not initialized");
+        return JNI_FALSE;
+    }
+
+    try {
+        UserPreferences preferences;
+        preferences.target_sleep_hours = std::chrono::duration<double, std::ratio<3600>>(targetSleepHours);
+        preferences.target_bedtime = std::chrono::minutes(targetBedtimeMinutes);
+        preferences.target_wake_time = std::chrono::minutes(targetWakeMinutes);
+        preferences.weekday_bedtime = std::chrono::minutes(weekdayBedtimeMinutes);
+        preferences.weekend_bedtime = std::chrono::minutes(weekendBedtimeMinutes);
+        preferences.minimum_interaction_gap = std::chrono::seconds(minimumGapSeconds);
+        preferences.time_check_threshold = std::chrono::seconds(timeCheckSeconds);
+        preferences.enable_smart_detection = smartDetection == JNI_TRUE;
+        preferences.track_interruptions = trackInterruptions == JNI_TRUE;
+        preferences.confidence_threshold = confidenceThreshold;
+
+        if (!preferences.isValid()) {
+            __android_log_print(ANDROID_LOG_ERROR, JNI_LOG_TAG,
+                                "Invalid preferences: target=%.1f hours, gap=%lld s, threshold=%.2f",
+                                targetSleepHours, static_cast<long long>(minimumGapSeconds), confidenceThreshold);
+            return JNI_FALSE;
+        }
+
+        detector->updateUserPreferences(preferences);
+        return JNI_TRUE;
+
+    } catch (const std::exception& e) {
+        __android_log_print(ANDROID_LOG_ERROR, JNI_LOG_TAG,
+                            "Exception in setUserPreferences: %s", e.what());
+        return JNI_FALSE;
+    }
+}
+
+extern "C" JNIEXPORT void JNICALL
+Java_io_nava_puuyapu_app_native_NativeSleepTracker_onTimeZoneChanged(
+        JNIEnv* env, jobject thiz) {
+
+    // Called from the ACTION_TIMEZONE_CHANGED receiver
+    if (DetectorLease detector = defaultDetector()) {
+        detector->onTimeZoneChanged();
+    } else {
+        TimeZoneContext::shared().invalidate();
+    }
+
+    __android_log_print(ANDROID_LOG_INFO, JNI_LOG_TAG, "Timezone change applied");
+}
+
+extern "C" JNIEXPORT jboolean JNICALL
+Java_io_nava_puuyapu_app_native_NativeSleepTracker_isCurrentlyAsleep(
+        JNIEnv* env, jobject thiz) {
+
+    JNIPerformanceTimer timer(MetricId::JNI_IS_CURRENTLY_ASLEEP);
+
+    DetectorLease detector = defaultDetector();
+    if (!detector) {
+        return JNI_FALSE;
+    }
+
+    try {
+        auto currentTime = detector->now();
+        bool isAsleep = detector->isCurrentlyAsleep(currentTime);
+        return isAsleep ? JNI_TRUE : JNI_FALSE;
+
+    } catch (const std::exception& e) {
+        __android_log_print(ANDROID_LOG_ERROR, JNI_LOG_TAG,
+                            "Exception in isCurrentlyAsleep: %s", e.what());
+        return JNI_FALSE;
+    }
+}
+
+extern "C" JNIEXPORT jlong JNICALL
+Java_io_nava_puuyapu_app_native_NativeSleepTracker_getEstimatedSleepStart(
+        JNIEnv* env, jobject thiz) {
+
+    JNIPerformanceTimer timer(MetricId::JNI_GET_ESTIMATED_SLEEP_START);
+
+    DetectorLease detector = defaultDetector();
+    if (!detector) {
+        return 0;
+    }
+
+    try {
+        auto currentTime = detector->now();
+        auto sleepStart = detector->getEstimatedSleepStart(currentTime);
+
+        if (sleepStart.has_value()) {
+            auto epoch = sleepStart.value().time_since_epoch();
+            return std::chrono::duration_cast<std::chrono::milliseconds>(epoch).count();
+        }
+
+        return 0;
+
+    } catch (const std::exception& e) {
+        __android_log_print(ANDROID_LOG_ERROR, JNI_LOG_TAG,
+                            "Exception in getEstimatedSleepStart: %s", e.what());
+        return 0;
+    }
+}
+
+/**
+ * @brief Next time-driven detection state change, for one exact alarm instead of polling
+ * @return long[2] {kind, epoch ms}: kind is StateTransitionKind (0 = none, the
+ *         time is then 0); nullptr on error
+ */
+extern "C" JNIEXPORT jlongArray JNICALL
+Java_io_nava_puuyapu_app_native_NativeSleepTracker_getNextStateTransition(
+        JNIEnv* env, jobject thiz) {
+
+    JNIPerformanceTimer timer(MetricId::JNI_GET_NEXT_STATE_TRANSITION);
+
+    DetectorLease detector = defaultDetector();
+    if (!detector) {
+        return nullptr;
+    }
+
+    try {
+        auto currentTime = detector->now();
+        StateTransition next = detector->getNextStateTransition(currentTime);
+
+        jlong values[2] = {static_cast<jlong>(next.kind), 0};
+        if (next.hasTransition()) {
+            values[1] = std::chrono::duration_cast<std::chrono::milliseconds>(
+                    next.at.time_since_epoch()).count();
+        }
+
+        jlongArray result = env->NewLongArray(2);
+        if (!result) {
+            return nullptr;
+        }
+        env->SetLongArrayRegion(result, 0, 2, values);
+        return result;
+
+    } catch (const std::exception& e) {
+        __android_log_print(ANDROID_LOG_ERROR, JNI_LOG_TAG,
+                            "Exception in getNextStateTransition: %s", e.what());
+        return nullptr;
+    }
+}
+
+/// Doubles per aggregate block of getSleepStatistics
+static constexpr size_t SLEEP_STATISTICS_FIELDS = 10;
+
+/**
+ * @brief Flatten one aggregate into SLEEP_STATISTICS_FIELDS doubles
+ */
+static void packSleepAggregate(const SleepAggregate& aggregate, double target_hours, jdouble* out) {
+    out[0] = aggregate.sessions;
+    out[1] = aggregate.averageDurationHours();
+    out[2] = aggregate.duration_hours;
+    out[3] = aggregate.sleepDebtHours(target_hours);
+    out[4] = aggregate.averageEfficiency();
+    out[5] = aggregate.averageQuality();
+    out[6] = aggregate.meanBedtimeMinuteOfDay();
+    out[7] = aggregate.bedtimeSpreadMinutes();
+    out[8] = aggregate.regularity();
+    out[9] = aggregate.interruptionsPerNight();
+}
+
+/**
+ * @brief Weekly/monthly statistics of the sealed nights in [fromMs, toMs)
+ * @return double[80]: 8 blocks (whole range, then evening weekday Sunday..Saturday)
+ *         of 10 fields {sessions, average hours, total hours, sleep debt hours
+ *         (vs. target, negative is surplus), average efficiency, average quality,
+ *         mean bedtime minute of day, bedtime spread minutes, regularity,
+ *         interruptions per night}; nullptr on error
+ */
+extern "C" JNIEXPORT jdoubleArray JNICALL
+Java_io_nava_puuyapu_app_native_NativeSleepTracker_getSleepStatistics(
+        JNIEnv* env, jobject thiz, jlong fromMs, jlong toMs) {
+
+    JNIPerformanceTimer timer(MetricId::JNI_GET_SLEEP_STATISTICS);
+
+    DetectorLease detector = defaultDetector();
+    if (!detector) {
+        __android_log_print(ANDROID_LOG_ERROR, JNI_LOG_TAG,
+                            "Sleep detector not initialized");
+        return nullptr;
+    }
+
+    try {
+        SleepDetector::SleepStatistics statistics = detector->getSleepStatistics(
+                std::chrono::system_clock::time_point(std::chrono::milliseconds(fromMs)),
+                std::chrono::system_clock::time_point(std::chrono::milliseconds(toMs)));
+
+        constexpr size_t BLOCKS = 1 + SessionAggregateIndex::WEEKDAYS;
+        jdouble values[BLOCKS * SLEEP_STATISTICS_FIELDS];
+        packSleepAggregate(statistics.range, statistics.target_sleep_hours, values);
+        for (size_t weekday = 0; weekday < statistics.by_weekday.size(); ++weekday) {
+            packSleepAggregate(statistics.by_weekday[weekday], statistics.target_sleep_hours,
+                               values + (weekday + 1) * SLEEP_STATISTICS_FIELDS);
+        }
+
+        jdoubleArray result = env->NewDoubleArray(static_cast<jsize>(BLOCKS * SLEEP_STATISTICS_FIELDS));
+        if (!result) {
+            return nullptr;
+        }
+        env->SetDoubleArrayRegion(result, 0, static_cast<jsize>(BLOCKS * SLEEP_STATISTICS_FIELDS), values);
+        return result;
+
+    } catch (const std::exception& e) {
+        __android_log_print(ANDROID_LOG_ERROR, JNI_LOG_TAG,
+                            "Exception in getSleepStatistics: %s", e.what());
+        return nullptr;
+    }
+}
+
+/**
+ * @brief Size the retention tiers (see RetentionPolicy); values are clamped
+ * @param rawNights Nights of raw events kept
+ * @param summaryNights Nights of compact summaries kept after that
+ * @param sessionNights Finalized sessions kept
+ * @param maxRawEvents Raw event budget
+ */
+extern "C" JNIEXPORT void JNICALL
+Java_io_nava_puuyapu_app_native_NativeSleepTracker_setRetentionPolicy(
+        JNIEnv* env, jobject thiz, jint rawNights, jint summaryNights, jint sessionNights, jint maxRawEvents) {
+
+    JNIPerformanceTimer timer(MetricId::JNI_SET_RETENTION_POLICY);
+
+    DetectorLease detector = defaultDetector();
+    if (!detector) {
+        return;
+    }
+
+    RetentionPolicy policy;
+    policy.raw_nights = static_cast<uint32_t>(std::max<jint>(rawNights, 0));
+    policy.summary_nights = static_cast<uint32_t>(std::max<jint>(summaryNights, 0));
+    policy.session_nights = static_cast<uint32_t>(std::max<jint>(sessionNights, 0));
+    policy.max_raw_events = static_cast<size_t>(std::max<jint>(maxRawEvents, 0));
+    detector->setRetentionPolicy(policy);
+}
+
+extern "C" JNIEXPORT void JNICALL
+Java_io_nava_puuyapu_app_native_NativeSleepTracker_clearOldData(
+        JNIEnv* env, jobject thiz, jlong cutoffTimestamp) {
+
+    JNIPerformanceTimer timer(MetricId::JNI_CLEAR_OLD_DATA);
+
+    DetectorLease detector = defaultDetector();
+    if (!detector) {
         return;
     }
 
@@ -456,7 +1688,7 @@ Java_io_nava_puuyapu_app_native_NativeSleepTracker_clearOldData(
                 std::chrono::milliseconds(cutoffTimestamp)
         );
 
-        g_sleepDetector->clearOldData(cutoffTime);
+        detector->clearOldData(cutoffTime);
 
         __android_log_print(ANDROID_LOG_DEBUG, JNI_LOG_TAG,
                             "Cleared data older than timestamp %lld", cutoffTimestamp);
@@ -471,21 +1703,19 @@ extern "C" JNIEXPORT void JNICALL
 Java_io_nava_puuyapu_app_native_NativeSleepTracker_optimizeMemory(
         JNIEnv* env, jobject thiz) {
 
-    JNIPerformanceTimer timer("optimizeMemory");
+    JNIPerformanceTimer timer(MetricId::JNI_OPTIMIZE_MEMORY);
 
     try {
-        if (g_sleepDetector) {
-            g_sleepDetector->optimizeMemory();
-        }
-
-        // Clear JNI performance metrics
-        {
-            std::lock_guard<std::mutex> lock(g_metricsMutex);
-            g_jniMetrics.clear();
+        // Also resets the shared metrics registry (core and JNI samples).
+        // Called from lifecycle callbacks: run it on the detection worker
+        if (DetectorLease detector = defaultDetector()) {
+            detector.worker().post(DetectionRequestKind::OPTIMIZE_MEMORY, detector->now());
+            __android_log_print(ANDROID_LOG_INFO, JNI_LOG_TAG, "Memory optimization queued");
+        } else {
+            Metrics::reset();
+            __android_log_print(ANDROID_LOG_INFO, JNI_LOG_TAG, "Memory optimization completed");
         }
 
-        __android_log_print(ANDROID_LOG_INFO, JNI_LOG_TAG, "Memory optimization completed");
-
     } catch (const std::exception& e) {
         __android_log_print(ANDROID_LOG_ERROR, JNI_LOG_TAG,
                             "Exception in optimizeMemory: %s", e.what());
@@ -496,9 +1726,10 @@ extern "C" JNIEXPORT void JNICALL
 Java_io_nava_puuyapu_app_native_NativeSleepTracker_confirmManualSleep(
         JNIEnv* env, jobject thiz, jlong timestamp) {
 
-    JNIPerformanceTimer timer("confirmManualSleep");
+    JNIPerformanceTimer timer(MetricId::JNI_CONFIRM_MANUAL_SLEEP);
 
-    if (!g_sleepDetector) {
+    DetectorLease detector = defaultDetector();
+    if (!detector) {
         __android_log_print(ANDROID_LOG_ERROR, JNI_LOG_TAG,
                             "Sleep detector not initialized");
         return;
@@ -509,7 +1740,7 @@ Java_io_nava_puuyapu_app_native_NativeSleepTracker_confirmManualSleep(
                 std::chrono::milliseconds(timestamp)
         );
 
-        g_sleepDetector->confirmManualSleep(sleepTime);
+        detector->confirmManualSleep(sleepTime);
 
         __android_log_print(ANDROID_LOG_INFO, JNI_LOG_TAG,
                             "Manual sleep confirmation recorded at timestamp %lld", timestamp);
@@ -524,39 +1755,242 @@ extern "C" JNIEXPORT jstring JNICALL
 Java_io_nava_puuyapu_app_native_NativeSleepTracker_getPerformanceMetrics(
         JNIEnv* env, jobject thiz) {
 
-    JNIPerformanceTimer timer("getPerformanceMetrics");
+    JNIPerformanceTimer timer(MetricId::JNI_GET_PERFORMANCE_METRICS);
 
     try {
-        // Create JSON string with performance metrics
-        std::string json = "{";
+        // One registry holds both core and JNI latencies
+        std::string json = DataProcessor::exportPerformanceMetrics(Metrics::snapshot());
 
-        if (g_sleepDetector) {
-            auto metrics = g_sleepDetector->getPerformanceMetrics();
-            bool first = true;
+        return env->NewStringUTF(json.c_str());
 
-            for (const auto& [operation, duration] : metrics) {
-                if (!first) json += ",";
-                json += "\"" + operation + "\":" + std::to_string(duration.count());
-                first = false;
-            }
+    } catch (const std::exception& e) {
+        __android_log_print(ANDROID_LOG_ERROR, JNI_LOG_TAG,
+                            "Exception in getPerformanceMetrics: %s", e.what());
+        return env->NewStringUTF("{}");
+    }
+}
 
-            // Add JNI metrics
-            std::lock_guard<std::mutex> lock(g_metricsMutex);
-            for (const auto& [operation, duration] : g_jniMetrics) {
-                if (!first) json += ",";
-                json += "\"jni_" + operation + "\":" + std::to_string(duration.count());
-                first = false;
-            }
-        }
+/**
+ * @brief Register the receiver of asynchronous detection results
+ * The listener implements
+ * void onDetectionResult(int kind, long requestId, int coalesced, long value, SleepDetectionResult result)
+ * and is invoked on the native detection thread.
+ * @param listener Receiver, or null to stop delivering results
+ * @return false if the listener lacks onDetectionResult
+ */
+extern "C" JNIEXPORT jboolean JNICALL
+Java_io_nava_puuyapu_app_native_NativeSleepTracker_setDetectionListener(
+        JNIEnv* env, jobject thiz, jobject listener) {
 
-        json += "}";
+    JNIPerformanceTimer timer(MetricId::JNI_SET_DETECTION_LISTENER);
 
-        return env->NewStringUTF(json.c_str());
+    std::lock_guard<std::recursive_mutex> lock(g_listenerMutex);
+
+    if (g_detectionListener) {
+        env->DeleteGlobalRef(g_detectionListener);
+        g_detectionListener = nullptr;
+        g_detectionListenerMethod = nullptr;
+    }
+    if (!listener) {
+        return JNI_TRUE;
+    }
+
+    jclass listenerClass = env->GetObjectClass(listener);
+    jmethodID method = env->GetMethodID(listenerClass, "onDetectionResult",
+                                        "(IJIJLio/nava/puuyapu/app/models/SleepDetectionResult;)V");
+    env->DeleteLocalRef(listenerClass);
+    if (!method) {
+        env->ExceptionClear();
+        __android_log_print(ANDROID_LOG_ERROR, JNI_LOG_TAG,
+                            "Detection listener has no onDetectionResult method");
+        return JNI_FALSE;
+    }
+
+    g_detectionListener = env->NewGlobalRef(listener);
+    g_detectionListenerMethod = method;
+    return JNI_TRUE;
+}
+
+/**
+ * @brief Queue detection work on the native worker thread
+ * Pending requests of the same kind merge into one pass evaluated at the
+ * newest timestamp; the result arrives through the detection listener.
+ * @param kind DetectionRequestKind (0 detect, 1 asleep, 2 sleep start, 3 optimize memory,
+ *             4 write snapshot)
+ * @param timestamp Evaluation instant in ms since epoch
+ * @return Request id reported back with the result, or -1 on failure
+ */
+extern "C" JNIEXPORT jlong JNICALL
+Java_io_nava_puuyapu_app_native_NativeSleepTracker_postDetectionRequest(
+        JNIEnv* env, jobject thiz, jint kind, jlong timestamp) {
+
+    JNIPerformanceTimer timer(MetricId::JNI_POST_DETECTION_REQUEST);
+
+    DetectorLease detector = defaultDetector();
+    if (!detector) {
+        __android_log_print(ANDROID_LOG_ERROR, JNI_LOG_TAG,
+                            "Sleep detector not initialized");
+        return -1;
+    }
+    if (kind < 0 || kind >= static_cast<jint>(DETECTION_REQUEST_KINDS)) {
+        __android_log_print(ANDROID_LOG_ERROR, JNI_LOG_TAG,
+                            "Invalid detection request kind %d", kind);
+        return -1;
+    }
+
+    uint64_t requestId = detector.worker().post(
+            static_cast<DetectionRequestKind>(kind),
+            std::chrono::system_clock::time_point(std::chrono::milliseconds(timestamp)));
+
+    return requestId > 0 ? static_cast<jlong>(requestId) : -1;
+}
+
+// ============================================================================
+// Handle API (io.nava.puuyapu.app.native.NativeDetector)
+//
+// Independent detectors addressed by DetectorRegistry handles, for callers
+// that need more than the default detector (off-device log replay).
+// Calls pin their detector with a lease and take no global lock, so
+// different handles run fully in parallel. Times are explicit so replays
+// are deterministic.
+// ============================================================================
+
+/**
+ * @brief Create a detector with default preferences
+ * @return Opaque handle, or 0 if the detector table is full
+ */
+extern "C" JNIEXPORT jlong JNICALL
+Java_io_nava_puuyapu_app_native_NativeDetector_create(JNIEnv* env, jclass clazz) {
+    JNIPerformanceTimer timer(MetricId::JNI_CREATE_DETECTOR);
+
+    try {
+        DetectorHandle handle = DetectorRegistry::shared().create(
+                std::make_unique<SleepDetector>(UserPreferences{}));
+        return static_cast<jlong>(handle);
 
     } catch (const std::exception& e) {
         __android_log_print(ANDROID_LOG_ERROR, JNI_LOG_TAG,
-                            "Exception in getPerformanceMetrics: %s", e.what());
-        return env->NewStringUTF("{}");
+                            "Exception in NativeDetector.create: %s", e.what());
+        return 0;
+    }
+}
+
+/**
+ * @brief Destroy a detector; calls still running on it complete first
+ * @return false if the handle was not live
+ */
+extern "C" JNIEXPORT jboolean JNICALL
+Java_io_nava_puuyapu_app_native_NativeDetector_destroy(JNIEnv* env, jclass clazz, jlong handle) {
+    JNIPerformanceTimer timer(MetricId::JNI_DESTROY_DETECTOR);
+
+    return DetectorRegistry::shared().destroy(static_cast<DetectorHandle>(handle)) ? JNI_TRUE : JNI_FALSE;
+}
+
+/**
+ * @brief Add serialized InteractionEvent records (4 longs each)
+ * @return Number of events accepted, or -1 on invalid handle or input
+ */
+extern "C" JNIEXPORT jint JNICALL
+Java_io_nava_puuyapu_app_native_NativeDetector_addInteractionEvents(
+        JNIEnv* env, jclass clazz, jlong handle, jlongArray records) {
+
+    JNIPerformanceTimer timer(MetricId::JNI_ADD_INTERACTION_EVENTS_ARRAY);
+
+    DetectorLease detector = DetectorRegistry::shared().acquire(static_cast<DetectorHandle>(handle));
+    if (!detector) {
+        return -1;
+    }
+
+    try {
+        return addEventArray(env, *detector, records);
+
+    } catch (const std::exception& e) {
+        __android_log_print(ANDROID_LOG_ERROR, JNI_LOG_TAG,
+                            "Exception in NativeDetector.addInteractionEvents: %s", e.what());
+        return -1;
+    }
+}
+
+/**
+ * @brief Detect sleep as of nowMs into a direct ByteBuffer (detectSleepPacked layout)
+ * @return Bytes written, the negated required size, or 0 on error
+ */
+extern "C" JNIEXPORT jint JNICALL
+Java_io_nava_puuyapu_app_native_NativeDetector_detectSleepPacked(
+        JNIEnv* env, jclass clazz, jlong handle, jlong nowMs, jobject buffer) {
+
+    JNIPerformanceTimer timer(MetricId::JNI_DETECT_SLEEP_PACKED);
+
+    DetectorLease detector = DetectorRegistry::shared().acquire(static_cast<DetectorHandle>(handle));
+    size_t capacity = 0;
+    uint8_t* output = detector ? directBuffer(env, buffer, capacity) : nullptr;
+    if (!output) {
+        return 0;
+    }
+
+    try {
+        return packSleepPeriod(*detector,
+                               std::chrono::system_clock::time_point(std::chrono::milliseconds(nowMs)),
+                               output, capacity);
+
+    } catch (const std::exception& e) {
+        __android_log_print(ANDROID_LOG_ERROR, JNI_LOG_TAG,
+                            "Exception in NativeDetector.detectSleepPacked: %s", e.what());
+        return 0;
+    }
+}
+
+/**
+ * @brief Detect all nights in [fromMs, toMs) into a direct ByteBuffer (detectSleepPeriodsPacked layout)
+ * @return Bytes written, the negated required size, or 0 on error
+ */
+extern "C" JNIEXPORT jint JNICALL
+Java_io_nava_puuyapu_app_native_NativeDetector_detectSleepPeriodsPacked(
+        JNIEnv* env, jclass clazz, jlong handle, jlong fromMs, jlong toMs, jobject buffer) {
+
+    JNIPerformanceTimer timer(MetricId::JNI_DETECT_SLEEP_PERIODS_PACKED);
+
+    DetectorLease detector = DetectorRegistry::shared().acquire(static_cast<DetectorHandle>(handle));
+    size_t capacity = 0;
+    uint8_t* output = detector ? directBuffer(env, buffer, capacity) : nullptr;
+    if (!output) {
+        return 0;
+    }
+
+    try {
+        return packSleepPeriods(*detector, fromMs, toMs, output, capacity);
+
+    } catch (const std::exception& e) {
+        __android_log_print(ANDROID_LOG_ERROR, JNI_LOG_TAG,
+                            "Exception in NativeDetector.detectSleepPeriodsPacked: %s", e.what());
+        return 0;
+    }
+}
+
+extern "C" JNIEXPORT jboolean JNICALL
+Java_io_nava_puuyapu_app_native_NativeDetector_isCurrentlyAsleep(
+        JNIEnv* env, jclass clazz, jlong handle, jlong nowMs) {
+
+    JNIPerformanceTimer timer(MetricId::JNI_IS_CURRENTLY_ASLEEP);
+
+    DetectorLease detector = DetectorRegistry::shared().acquire(static_cast<DetectorHandle>(handle));
+    if (!detector) {
+        return JNI_FALSE;
+    }
+
+    auto currentTime = std::chrono::system_clock::time_point(std::chrono::milliseconds(nowMs));
+    return detector->isCurrentlyAsleep(currentTime) ? JNI_TRUE : JNI_FALSE;
+}
+
+extern "C" JNIEXPORT void JNICALL
+Java_io_nava_puuyapu_app_native_NativeDetector_clearOldData(
+        JNIEnv* env, jclass clazz, jlong handle, jlong cutoffTimestamp) {
+
+    JNIPerformanceTimer timer(MetricId::JNI_CLEAR_OLD_DATA);
+
+    DetectorLease detector = DetectorRegistry::shared().acquire(static_cast<DetectorHandle>(handle));
+    if (detector) {
+        detector->clearOldData(std::chrono::system_clock::time_point(std::chrono::milliseconds(cutoffTimestamp)));
     }
 }
 
@@ -564,6 +1998,7 @@ Java_io_nava_puuyapu_app_native_NativeSleepTracker_getPerformanceMetrics(
 
 extern "C" JNIEXPORT jint JNICALL
 JNI_OnLoad(JavaVM* vm, void* reserved) {
+    g_javaVM = vm;
     __android_log_print(ANDROID_LOG_INFO, JNI_LOG_TAG,
                         "Native library loaded successfully");
     return JNI_VERSION_1_6;
@@ -571,8 +2006,13 @@ JNI_OnLoad(JavaVM* vm, void* reserved) {
 
 extern "C" JNIEXPORT void JNICALL
 JNI_OnUnload(JavaVM* vm, void* reserved) {
-    JNIEnv* env;
-    if (vm->GetEnv(reinterpret_cast<void**>(&env), JNI_VERSION_1_6) == JNI_OK) {
+    // Global references can only be deleted through a valid env of this thread
+    JNIEnv* env = nullptr;
+    if (vm->GetEnv(reinterpret_cast<void**>(&env), JNI_VERSION_1_6) != JNI_OK) {
+        env = nullptr;
+    }
+
+    if (env) {
         // Clean up global references
         if (g_sleepResultClass) {
             env->DeleteGlobalRef(g_sleepResultClass);
@@ -582,12 +2022,31 @@ JNI_OnUnload(JavaVM* vm, void* reserved) {
             env->DeleteGlobalRef(g_interruptionClass);
             g_interruptionClass = nullptr;
         }
+        if (g_arrayListClass) {
+            env->DeleteGlobalRef(g_arrayListClass);
+            g_arrayListClass = nullptr;
+        }
     }
 
-    // Clean up C++ objects
+    // Clean up C++ objects (joins the detection worker unless a call still holds it)
     {
         std::lock_guard<std::mutex> lock(g_detectorMutex);
-        g_sleepDetector.reset();
+        DetectorHandle handle = g_defaultDetector.exchange(INVALID_DETECTOR_HANDLE);
+        if (handle != INVALID_DETECTOR_HANDLE) {
+            DetectorRegistry::shared().destroy(handle);
+        }
+    }
+    {
+        std::lock_guard<std::recursive_mutex> lock(g_listenerMutex);
+        if (g_detectionListener && env) {
+            env->DeleteGlobalRef(g_detectionListener);
+        }
+        g_detectionListener = nullptr;
+        g_detectionListenerMethod = nullptr;
+    }
+    {
+        std::lock_guard<std::mutex> lock(g_archiveMutex);
+        g_sessionArchive.reset();
     }
 
     __android_log_print(ANDROID_LOG_INFO, JNI_LOG_TAG,
@@ -0,0 +1,148 @@
+/**
+ * @file detector_snapshot_tests.cpp
+ * @brief SleepDetector snapshot round trip and rejection of damaged files
+ *
+ * Runs in UTC with a ManualClock. Results are compared in the packed
+ * layout, with the same digest as tools/detection_replay.
+ */
+
+#include "test_harness.h"
+#include "sleep_detector.h"
+#include "data_processor.h"
+#include "checksum.h"
+#include <cstdio>
+#include <cstdlib>
+#include <fcntl.h>
+#include <unistd.h>
+
+using namespace puuyapu;
+using namespace std::chrono;
+
+namespace {
+    constexpr int64_t DAY0 = 20000;     ///< 2024-10-04, a Friday
+    constexpr int DAYS = 6;
+
+    system_clock::time_point day0() {
+        return system_clock::time_point(hours(24 * DAY0));
+    }
+
+    void useUtc() {
+        setenv("TZ", "UTC", 1);
+        TimeZoneContext::shared().invalidate();
+    }
+
+    void addAwake(SleepDetector& detector, system_clock::time_point from, system_clock::time_point to) {
+        std::vector<InteractionEvent> events;
+        for (auto t = from; t < to; t += minutes(1)) {
+            events.emplace_back(t, seconds(20), InteractionType::MEANINGFUL_USE);
+        }
+        detector.addInteractionEvents(events.data(), events.size());
+    }
+
+    std::string snapshotPath(const char* name) {
+        char path[128];
+        std::snprintf(path, sizeof(path), "/tmp/puuyapu_test_%s_%d.snap", name, static_cast<int>(getpid()));
+        unlink(path);
+        return path;
+    }
+
+    std::vector<uint8_t> packed(const SleepDetectionResult& result) {
+        std::vector<uint8_t> bytes(DataProcessor::packedResultSize(result));
+        DataProcessor::serializePacked(result, bytes.data(), bytes.size());
+        return bytes;
+    }
+
+    /// Digest of the per-night sessions, as printed by the replay tool
+    uint32_t sessionsDigest(const SleepDetector& detector, system_clock::time_point to) {
+        uint32_t digest = 0;
+        for (const auto& session : detector.detectSleepPeriods(day0(), to)) {
+            std::vector<uint8_t> bytes = packed(session);
+            digest = crc32(bytes.data(), bytes.size()) ^ (digest * 31u);
+        }
+        return digest;
+    }
+
+    UserPreferences shortSleeper() {
+        UserPreferences prefs;
+        prefs.target_sleep_hours = hours(7);
+        return prefs;
+    }
+
+    /// Six days up 07:00-23:00 with a brief check at 03:00 each night; nights 0-4 sealed
+    void buildHistory(SleepDetector& detector, ManualClock& clock) {
+        for (int day = 0; day < DAYS; ++day) {
+            auto morning = day0() + hours(24 * day + 7);
+            addAwake(detector, morning, morning + hours(16));
+            detector.addInteractionEvent(InteractionEvent(morning + hours(20), seconds(5), InteractionType::TIME_CHECK));
+        }
+        clock.set(day0() + hours(24 * (DAYS - 1) + 23));
+        detector.detectSleepPeriods(day0(), clock.now());
+    }
+}
+
+PUUYAPU_TEST(restored_detector_detects_exactly_like_the_original) {
+    useUtc();
+    std::string path = snapshotPath("round_trip");
+    ManualClock clock(day0());
+
+    SleepDetector original(shortSleeper(), clock);
+    original.attachSnapshot(path);
+    buildHistory(original, clock);
+    EXPECT_TRUE(original.writeSnapshot());
+
+    SleepDetector restored(UserPreferences{}, clock);
+    EXPECT_TRUE(restored.attachSnapshot(path));
+
+    // The open night, live at 03:30, and every night in the packed layout
+    clock.advance(hours(4) + minutes(30));
+    EXPECT_TRUE(packed(restored.detectSleepPeriod(clock.now())) == packed(original.detectSleepPeriod(clock.now())));
+    EXPECT_EQ(sessionsDigest(restored, clock.now()), sessionsDigest(original, clock.now()));
+
+    SleepDetector::Statistics expected = original.getStatistics();
+    SleepDetector::Statistics actual = restored.getStatistics();
+    EXPECT_EQ(actual.total_events_processed, expected.total_events_processed);
+    EXPECT_EQ(actual.finalized_nights, expected.finalized_nights);
+    EXPECT_EQ(actual.learned_sleep_sessions, expected.learned_sleep_sessions);
+    EXPECT_EQ(actual.finalized_nights, static_cast<size_t>(DAYS - 1));
+
+    // Preferences came back with the state
+    EXPECT_EQ(restored.getSleepStatistics(day0(), clock.now()).target_sleep_hours, 7.0);
+    unlink(path.c_str());
+}
+
+PUUYAPU_TEST(snapshot_with_a_bad_checksum_leaves_the_detector_untouched) {
+    useUtc();
+    std::string path = snapshotPath("bad_crc");
+    ManualClock clock(day0());
+
+    SleepDetector original(shortSleeper(), clock);
+    original.attachSnapshot(path);
+    buildHistory(original, clock);
+    EXPECT_TRUE(original.writeSnapshot());
+
+    // One flipped bit in the last section byte
+    int fd = ::open(path.c_str(), O_RDWR);
+    off_t last = lseek(fd, -1, SEEK_END);
+    uint8_t byte = 0;
+    EXPECT_TRUE(pread(fd, &byte, 1, last) == 1);
+    byte ^= 0x01;
+    EXPECT_TRUE(pwrite(fd, &byte, 1, last) == 1);
+    ::close(fd);
+
+    SleepDetector restored(UserPreferences{}, clock);
+    EXPECT_TRUE(!restored.attachSnapshot(path));
+    EXPECT_EQ(restored.getStatistics().total_events_processed, static_cast<size_t>(0));
+    EXPECT_EQ(restored.getStatistics().finalized_nights, static_cast<size_t>(0));
+    EXPECT_EQ(restored.getSleepStatistics(day0(), clock.now()).target_sleep_hours,
+              UserPreferences{}.target_sleep_hours.count());
+
+    // Still attached: the next write replaces the damaged file
+    addAwake(restored, clock.now(), clock.now() + minutes(10));
+    EXPECT_TRUE(restored.writeSnapshot());
+    SleepDetector reloaded(UserPreferences{}, clock);
+    EXPECT_TRUE(reloaded.attachSnapshot(path));
+    EXPECT_EQ(reloaded.getStatistics().total_events_processed, static_cast<size_t>(10));
+    unlink(path.c_str());
+}
+
+PUUYAPU_TEST_MAIN()
@@ -0,0 +1,204 @@
+/**
+ * @file event_log_tests.cpp
+ * @brief EventLog persistence, torn tails and damaged or unreadable segments
+ *
+ * Each test works in its own temporary directory. Frames are patched
+ * through the file, the way a torn write or bit rot would leave them.
+ */
+
+#include "test_harness.h"
+#include "event_log.h"
+#include <algorithm>
+#include <cstdio>
+#include <cstdlib>
+#include <dirent.h>
+#include <fcntl.h>
+#include <string>
+#include <sys/resource.h>
+#include <unistd.h>
+#include <vector>
+
+using namespace puuyapu;
+using namespace std::chrono;
+
+namespace {
+    constexpr size_t CRC_OFFSET = InteractionEvent::SERIALIZED_SIZE + sizeof(uint32_t);
+
+    std::string makeDirectory() {
+        char path[] = "/tmp/puuyapu_event_log_XXXXXX";
+        return mkdtemp(path) ? path : "";
+    }
+
+    void removeDirectory(const std::string& directory) {
+        if (DIR* dir = opendir(directory.c_str())) {
+            while (dirent* entry = readdir(dir)) {
+                if (entry->d_name[0] != '.') {
+                    unlink((directory + "/" + entry->d_name).c_str());
+                }
+            }
+            closedir(dir);
+        }
+        rmdir(directory.c_str());
+    }
+
+    std::string segmentPath(const std::string& directory, uint64_t sequence) {
+        char name[32];
+        std::snprintf(name, sizeof(name), "/events-%016llx.log", static_cast<unsigned long long>(sequence));
+        return directory + name;
+    }
+
+    InteractionEvent eventAt(size_t i) {
+        return InteractionEvent(system_clock::time_point(hours(24 * 20000) + minutes(i)),
+                                seconds(20), InteractionType::MEANINGFUL_USE);
+    }
+
+    void appendEvents(EventLog& log, size_t first, size_t count) {
+        for (size_t i = first; i < first + count; ++i) {
+            EXPECT_TRUE(log.append(eventAt(i)));
+        }
+    }
+
+    /// Events of the log in order, or the index of the first one out of place
+    size_t matchingPrefix(const EventLog& log) {
+        size_t matching = 0;
+        bool in_order = true;
+        log.forEach([&](const InteractionEvent& event) {
+            in_order = in_order && event.timestamp == eventAt(matching).timestamp;
+            matching += in_order ? 1 : 0;
+        });
+        return matching;
+    }
+
+    void patchByte(const std::string& path, size_t offset) {
+        int fd = ::open(path.c_str(), O_RDWR);
+        uint8_t byte = 0;
+        EXPECT_TRUE(pread(fd, &byte, 1, static_cast<off_t>(offset)) == 1);
+        byte ^= 0x5A;
+        EXPECT_TRUE(pwrite(fd, &byte, 1, static_cast<off_t>(offset)) == 1);
+        ::close(fd);
+    }
+
+    size_t frameOffset(size_t index) {
+        return EventLog::HEADER_BYTES + index * EventLog::FRAME_BYTES;
+    }
+}
+
+PUUYAPU_TEST(reopen_restores_every_event_across_segments) {
+    std::string directory = makeDirectory();
+    size_t count = EventLog::FRAMES_PER_SEGMENT + 100;
+    {
+        EventLog log;
+        EXPECT_TRUE(log.open(directory, EventLog::Durability::BATCHED));
+        appendEvents(log, 0, count);
+        EXPECT_EQ(log.segmentCount(), static_cast<size_t>(2));
+    }
+
+    EventLog log;
+    EXPECT_TRUE(log.open(directory, EventLog::Durability::NONE));
+    EXPECT_EQ(log.eventCount(), count);
+    EXPECT_EQ(matchingPrefix(log), count);
+    removeDirectory(directory);
+}
+
+PUUYAPU_TEST(torn_tail_frame_ends_the_segment_and_is_overwritten) {
+    std::string directory = makeDirectory();
+    {
+        EventLog log;
+        EXPECT_TRUE(log.open(directory, EventLog::Durability::NONE));
+        appendEvents(log, 0, 10);
+    }
+    patchByte(segmentPath(directory, 1), frameOffset(9) + CRC_OFFSET);
+
+    {
+        EventLog log;
+        EXPECT_TRUE(log.open(directory, EventLog::Durability::NONE));
+        EXPECT_EQ(log.eventCount(), static_cast<size_t>(9));
+        EXPECT_EQ(matchingPrefix(log), static_cast<size_t>(9));
+
+        // The next append takes the torn frame's slot
+        appendEvents(log, 9, 3);
+    }
+
+    EventLog log;
+    EXPECT_TRUE(log.open(directory, EventLog::Durability::NONE));
+    EXPECT_EQ(log.eventCount(), static_cast<size_t>(12));
+    EXPECT_EQ(matchingPrefix(log), static_cast<size_t>(12));
+    removeDirectory(directory);
+}
+
+PUUYAPU_TEST(corrupted_record_drops_it_and_everything_after_it) {
+    std::string directory = makeDirectory();
+    {
+        EventLog log;
+        EXPECT_TRUE(log.open(directory, EventLog::Durability::NONE));
+        appendEvents(log, 0, 10);
+    }
+    patchByte(segmentPath(directory, 1), frameOffset(4) + 3);
+
+    EventLog log;
+    EXPECT_TRUE(log.open(directory, EventLog::Durability::NONE));
+    EXPECT_EQ(log.eventCount(), static_cast<size_t>(4));
+    removeDirectory(directory);
+}
+
+PUUYAPU_TEST(segment_with_damaged_header_or_size_is_discarded) {
+    std::string directory = makeDirectory();
+    size_t count = 2 * EventLog::FRAMES_PER_SEGMENT + 5;
+    {
+        EventLog log;
+        EXPECT_TRUE(log.open(directory, EventLog::Durability::NONE));
+        appendEvents(log, 0, count);
+        EXPECT_EQ(log.segmentCount(), static_cast<size_t>(3));
+    }
+    patchByte(segmentPath(directory, 1), 0);
+    EXPECT_EQ(truncate(segmentPath(directory, 2).c_str(), static_cast<off_t>(EventLog::SEGMENT_BYTES / 2)), 0);
+
+    EventLog log;
+    EXPECT_TRUE(log.open(directory, EventLog::Durability::NONE));
+    EXPECT_EQ(log.segmentCount(), static_cast<size_t>(1));
+    EXPECT_EQ(log.eventCount(), static_cast<size_t>(5));
+    EXPECT_TRUE(access(segmentPath(directory, 1).c_str(), F_OK) != 0);
+    EXPECT_TRUE(access(segmentPath(directory, 2).c_str(), F_OK) != 0);
+    removeDirectory(directory);
+}
+
+PUUYAPU_TEST(descriptor_exhaustion_fails_open_and_keeps_the_history) {
+    std::string directory = makeDirectory();
+    size_t count = EventLog::FRAMES_PER_SEGMENT + 5;
+    {
+        EventLog log;
+        EXPECT_TRUE(log.open(directory, EventLog::Durability::NONE));
+        appendEvents(log, 0, count);
+    }
+
+    // Leave one descriptor: enough for the directory scan and the first
+    // segment, not for the second
+    rlimit limit{};
+    getrlimit(RLIMIT_NOFILE, &limit);
+    rlimit lowered = limit;
+    lowered.rlim_cur = std::min<rlim_t>(limit.rlim_cur, 256);
+    setrlimit(RLIMIT_NOFILE, &lowered);
+    std::vector<int> held;
+    for (int fd = dup(0); fd >= 0; fd = dup(0)) {
+        held.push_back(fd);
+    }
+    ::close(held.back());
+    held.pop_back();
+
+    {
+        EventLog log;
+        EXPECT_TRUE(!log.open(directory, EventLog::Durability::NONE));
+    }
+    for (int fd : held) {
+        ::close(fd);
+    }
+    setrlimit(RLIMIT_NOFILE, &limit);
+
+    EventLog log;
+    EXPECT_TRUE(log.open(directory, EventLog::Durability::NONE));
+    EXPECT_EQ(log.eventCount(), count);
+    EXPECT_EQ(matchingPrefix(log), count);
+    removeDirectory(directory);
+}
+
+PUUYAPU_TEST_MAIN()
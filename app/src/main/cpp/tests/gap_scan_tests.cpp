@@ -0,0 +1,211 @@
+/**
+ * @file gap_scan_tests.cpp
+ * @brief scanInteractionGaps and the flag helpers against per-event reference loops
+ *
+ * Built twice: with the target's SIMD mask backend and with
+ * PUUYAPU_NO_SIMD, so every backend is checked against the same loops.
+ * Histories are randomized from fixed seeds and cover partial words,
+ * block boundaries, equal timestamps and both dense and sparse anchors.
+ */
+
+#include "test_harness.h"
+#include "gap_scan.h"
+#include <cstring>
+#include <iterator>
+#include <random>
+#include <vector>
+
+using namespace puuyapu;
+using namespace std::chrono;
+
+namespace {
+    constexpr int HISTORIES = 400;
+    constexpr uint8_t MEANINGFUL = EventColumnStore::FLAG_MEANINGFUL;
+    constexpr uint8_t TIME_CHECK = EventColumnStore::FLAG_TIME_CHECK;
+
+    struct History {
+        std::vector<uint8_t> flags;
+        std::vector<system_clock::time_point> times;
+        milliseconds min_gap;
+    };
+
+    History randomHistory(std::mt19937& random) {
+        static const size_t LENGTHS[] = {0, 1, 15, 16, 17, 1023, 1024, 1025, 3000};
+        static const milliseconds MIN_GAPS[] = {minutes(1), minutes(30), hours(4)};
+
+        History history;
+        std::uniform_int_distribution<size_t> pick_length(0, 2 * std::size(LENGTHS) - 1);
+        size_t choice = pick_length(random);
+        size_t count = choice < std::size(LENGTHS)
+                       ? LENGTHS[choice]
+                       : std::uniform_int_distribution<size_t>(0, 5000)(random);
+        history.min_gap = MIN_GAPS[std::uniform_int_distribution<size_t>(0, 2)(random)];
+
+        // Per history: how often anchors appear and how long the pauses are
+        double meaningful_rate = std::uniform_real_distribution<double>(0.02, 0.9)(random);
+        double pause_rate = std::uniform_real_distribution<double>(0.0, 0.05)(random);
+        std::bernoulli_distribution is_meaningful(meaningful_rate);
+        std::bernoulli_distribution is_time_check(0.3);
+        std::bernoulli_distribution is_pause(pause_rate);
+        std::bernoulli_distribution same_time(0.05);
+        std::uniform_int_distribution<int> other_bits(0, 255);
+        std::uniform_int_distribution<int64_t> step_ms(1, 120000);
+        std::uniform_int_distribution<int64_t> pause_ms(0, 8 * 3600 * 1000);
+
+        auto time = system_clock::time_point(hours(24 * 20000));
+        for (size_t i = 0; i < count; ++i) {
+            uint8_t flags = static_cast<uint8_t>(other_bits(random)) & ~(MEANINGFUL | TIME_CHECK);
+            flags |= is_meaningful(random) ? MEANINGFUL : 0;
+            flags |= is_time_check(random) ? TIME_CHECK : 0;
+            history.flags.push_back(flags);
+
+            if (!same_time(random)) {
+                time += milliseconds(is_pause(random) ? pause_ms(random) : step_ms(random));
+            }
+            history.times.push_back(time);
+        }
+        return history;
+    }
+
+    /// The per-event walk scanInteractionGaps replaced (EventTimeline::trackAppended)
+    void referenceScan(const History& history, GapScanState& state, TimeGapList& gaps) {
+        for (size_t i = 0; i < history.flags.size(); ++i) {
+            uint8_t flags = history.flags[i];
+            if (state.anchor_index == GapScanState::NPOS) {
+                state.anchor_index = i;
+                state.brief_since_anchor = 0;
+                if (flags & MEANINGFUL) {
+                    state.last_meaningful_index = i;
+                }
+                continue;
+            }
+
+            if (flags & MEANINGFUL) {
+                auto event_time = history.times[i];
+                auto anchor_time = history.times[state.anchor_index];
+                if (event_time - anchor_time >= history.min_gap) {
+                    TimeGap gap(anchor_time, event_time);
+                    gap.brief_interaction_count = state.brief_since_anchor;
+                    gap.contains_brief_interactions = state.brief_since_anchor > 0;
+                    gaps.push_back(gap);
+                }
+                state.anchor_index = i;
+                state.last_meaningful_index = i;
+                state.brief_since_anchor = 0;
+            } else if (flags & TIME_CHECK) {
+                state.brief_since_anchor++;
+            }
+        }
+    }
+
+    bool sameGaps(const TimeGapList& actual, const TimeGapList& expected) {
+        if (actual.size() != expected.size()) {
+            return false;
+        }
+        for (size_t i = 0; i < actual.size(); ++i) {
+            if (actual[i].start_time != expected[i].start_time ||
+                actual[i].end_time != expected[i].end_time ||
+                actual[i].duration != expected[i].duration ||
+                actual[i].brief_interaction_count != expected[i].brief_interaction_count ||
+                actual[i].contains_brief_interactions != expected[i].contains_brief_interactions) {
+                return false;
+            }
+        }
+        return true;
+    }
+
+    bool sameState(const GapScanState& actual, const GapScanState& expected) {
+        return actual.anchor_index == expected.anchor_index &&
+               actual.last_meaningful_index == expected.last_meaningful_index &&
+               actual.brief_since_anchor == expected.brief_since_anchor;
+    }
+
+    template<typename Check>
+    void forEachHistory(Check&& check) {
+        std::mt19937 random(20240917u);
+        for (int i = 0; i < HISTORIES; ++i) {
+            check(randomHistory(random), random);
+        }
+    }
+}
+
+PUUYAPU_TEST(gaps_match_the_per_event_loop) {
+    forEachHistory([](const History& history, std::mt19937&) {
+        GapScanState expected_state;
+        TimeGapList expected;
+        referenceScan(history, expected_state, expected);
+
+        GapScanState state;
+        TimeGapList gaps;
+        auto time_at = [&history](size_t index) { return history.times[index]; };
+        scanInteractionGaps(history.flags.data(), history.flags.size(), 0, time_at,
+                            history.min_gap, state, gaps);
+
+        EXPECT_TRUE(sameGaps(gaps, expected));
+        EXPECT_TRUE(sameState(state, expected_state));
+    });
+}
+
+PUUYAPU_TEST(scanning_in_pieces_matches_one_pass) {
+    forEachHistory([](const History& history, std::mt19937& random) {
+        GapScanState expected_state;
+        TimeGapList expected;
+        referenceScan(history, expected_state, expected);
+
+        // Pieces of any length, carrying the state (absolute indices)
+        GapScanState state;
+        TimeGapList gaps;
+        auto time_at = [&history](size_t index) { return history.times[index]; };
+        std::uniform_int_distribution<size_t> piece(1, 2100);
+        for (size_t begin = 0; begin < history.flags.size();) {
+            size_t count = std::min(piece(random), history.flags.size() - begin);
+            scanInteractionGaps(history.flags.data() + begin, count, begin, time_at,
+                                history.min_gap, state, gaps);
+            begin += count;
+        }
+
+        EXPECT_TRUE(sameGaps(gaps, expected));
+        EXPECT_TRUE(sameState(state, expected_state));
+    });
+}
+
+PUUYAPU_TEST(flag_masks_count_and_find_match_the_flag_bytes) {
+    forEachHistory([](const History& history, std::mt19937&) {
+        const uint8_t* flags = history.flags.data();
+        size_t count = std::min<size_t>(history.flags.size(), GAP_SCAN_BLOCK);
+        std::vector<uint16_t> meaningful((count + GAP_SCAN_LANES - 1) / GAP_SCAN_LANES);
+        std::vector<uint16_t> time_checks(meaningful.size());
+        buildFlagMasks(flags, count, meaningful.data(), time_checks.data());
+        for (size_t i = 0; i < count; ++i) {
+            bool meaningful_bit = (meaningful[i / GAP_SCAN_LANES] >> (i % GAP_SCAN_LANES)) & 1u;
+            bool time_check_bit = (time_checks[i / GAP_SCAN_LANES] >> (i % GAP_SCAN_LANES)) & 1u;
+            EXPECT_EQ(meaningful_bit, (flags[i] & MEANINGFUL) != 0);
+            EXPECT_EQ(time_check_bit, (flags[i] & TIME_CHECK) != 0);
+        }
+
+        for (uint8_t flag : {MEANINGFUL, TIME_CHECK, uint8_t(0x80)}) {
+            size_t expected_count = 0;
+            size_t expected_first = history.flags.size();
+            for (size_t i = 0; i < history.flags.size(); ++i) {
+                if (flags[i] & flag) {
+                    expected_first = std::min(expected_first, i);
+                    expected_count++;
+                }
+            }
+            EXPECT_EQ(countFlagged(flags, history.flags.size(), flag), expected_count);
+            EXPECT_EQ(findFlagged(flags, history.flags.size(), flag), expected_first);
+        }
+    });
+}
+
+PUUYAPU_TEST(backend_is_the_one_compiled) {
+#if defined(PUUYAPU_NO_SIMD)
+    EXPECT_TRUE(std::strcmp(gapScanBackend(), "scalar") == 0);
+#elif defined(__SSE2__)
+    EXPECT_TRUE(std::strcmp(gapScanBackend(), "sse2") == 0);
+#elif defined(__ARM_NEON) || defined(__ARM_NEON__)
+    EXPECT_TRUE(std::strcmp(gapScanBackend(), "neon") == 0);
+#endif
+}
+
+PUUYAPU_TEST_MAIN()
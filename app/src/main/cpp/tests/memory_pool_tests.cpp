@@ -0,0 +1,109 @@
+/**
+ * @file memory_pool_tests.cpp
+ * @brief BlockPoolAllocator across threads and thread teardown
+ *
+ * Each test uses its own allocator instantiation, so the slab counts are
+ * not shared with other tests or with SleepInterruptionList.
+ */
+
+#include "test_harness.h"
+#include "memory_pool.h"
+#include <thread>
+#include <vector>
+
+using namespace puuyapu;
+
+namespace {
+    constexpr size_t POOL_BLOCKS = 32;
+
+    template<size_t Tag>
+    using PooledInts = std::vector<int, BlockPoolAllocator<int, 8 + Tag, POOL_BLOCKS>>;
+
+    template<typename Vector>
+    size_t availableBlocks() {
+        return Vector::allocator_type::availableBlocks();
+    }
+
+    /// Destroys its vector during thread teardown, after the thread's cache
+    template<typename Vector>
+    struct LateOwner {
+        Vector values;
+        ~LateOwner() { values = Vector(); }
+    };
+}
+
+PUUYAPU_TEST(free_on_another_thread_after_the_allocating_thread_exited) {
+    using Ints = PooledInts<0>;
+    std::vector<Ints> lists;
+
+    std::thread producer([&lists] {
+        for (int i = 0; i < 20; ++i) {
+            Ints values;
+            values.reserve(8);
+            values.push_back(i);
+            lists.push_back(std::move(values));
+        }
+    });
+    producer.join();
+    EXPECT_EQ(availableBlocks<Ints>(), POOL_BLOCKS - 20);
+
+    std::thread consumer([&lists] {
+        for (int i = 0; i < 20; ++i) {
+            EXPECT_EQ(lists[i].front(), i);
+        }
+        lists.clear();
+    });
+    consumer.join();
+
+    // Both threads' caches went back to the slab when they exited
+    EXPECT_EQ(availableBlocks<Ints>(), POOL_BLOCKS);
+}
+
+PUUYAPU_TEST(free_during_thread_teardown_after_the_cache_is_gone) {
+    using Ints = PooledInts<1>;
+
+    std::thread worker([] {
+        // Constructed before the cache, so destroyed after it
+        static thread_local LateOwner<Ints> owner;
+        owner.values.reserve(8);
+        owner.values.push_back(42);
+
+        Ints scratch;
+        scratch.reserve(8);
+    });
+    worker.join();
+
+    EXPECT_EQ(availableBlocks<Ints>(), POOL_BLOCKS);
+}
+
+PUUYAPU_TEST(release_thread_cache_returns_parked_blocks) {
+    using Ints = PooledInts<2>;
+
+    {
+        std::vector<Ints> lists(10);
+        for (auto& values : lists) {
+            values.reserve(8);
+        }
+    }
+    EXPECT_TRUE(availableBlocks<Ints>() < POOL_BLOCKS);
+
+    Ints::allocator_type::releaseThreadCache();
+    EXPECT_EQ(availableBlocks<Ints>(), POOL_BLOCKS);
+}
+
+PUUYAPU_TEST(exhausted_slab_falls_back_to_the_heap) {
+    using Ints = PooledInts<3>;
+
+    std::vector<Ints> lists(POOL_BLOCKS + 4);
+    for (auto& values : lists) {
+        values.reserve(8);
+        values.push_back(7);
+    }
+    EXPECT_EQ(availableBlocks<Ints>(), static_cast<size_t>(0));
+
+    lists.clear();
+    Ints::allocator_type::releaseThreadCache();
+    EXPECT_EQ(availableBlocks<Ints>(), POOL_BLOCKS);
+}
+
+PUUYAPU_TEST_MAIN()
@@ -0,0 +1,254 @@
+/**
+ * @file session_archive_tests.cpp
+ * @brief SessionArchive record coding, month-indexed reads and damaged files
+ *
+ * Runs in UTC. Nights start 2025-01-20 and run past two month ends; a
+ * night's month is that of its noon-to-noon window, so a bedtime after
+ * midnight on the 1st still belongs to the previous month.
+ */
+
+#include "test_harness.h"
+#include "session_archive.h"
+#include "time_utils.h"
+#include <algorithm>
+#include <cmath>
+#include <cstdio>
+#include <cstdlib>
+#include <fcntl.h>
+#include <string>
+#include <sys/stat.h>
+#include <unistd.h>
+#include <vector>
+
+using namespace puuyapu;
+using namespace std::chrono;
+
+namespace {
+    constexpr int64_t JANUARY_20 = 20108;       ///< 2025-01-20, days since the epoch
+    constexpr int64_t FEBRUARY_1 = 20120;
+    constexpr int64_t MARCH_1 = 20148;
+    constexpr int NIGHTS = 45;                  ///< Through the night of 2025-03-05
+    constexpr double SCORE_STEP = 1.0 / 65535;
+
+    void useUtc() {
+        setenv("TZ", "UTC", 1);
+        TimeZoneContext::shared().invalidate();
+    }
+
+    system_clock::time_point dayStart(int64_t day) {
+        return system_clock::time_point(hours(24 * day));
+    }
+
+    /// Night n: bedtime around 23:00 (00:30 on nights 1, 6, 11...), up to three interruptions
+    SleepDetectionResult night(int n) {
+        SleepDetectionResult session;
+        auto bedtime = dayStart(JANUARY_20 + n) + hours(23) + minutes(n % 5 == 1 ? 90 : n) + milliseconds(n * 7);
+        session.bedtime = bedtime;
+        session.wake_time = bedtime + hours(7) + minutes(n % 40);
+        session.duration = duration<double, std::ratio<3600>>(7.0 + (n % 40) / 60.0 - (n % 3) * 0.25);
+        session.confidence = static_cast<SleepConfidence>(n % 5);
+        session.is_manually_confirmed = n % 2 == 0;
+        session.quality_score = (n % 10) / 10.0;
+        session.pattern_match_score = 1.0 - (n % 7) / 7.0;
+        for (int i = 0; i < n % 4; ++i) {
+            SleepInterruption interruption(bedtime + hours(1 + 2 * i) + seconds(n), seconds(10 + 60 * i),
+                                           i % 2 ? InteractionType::MEANINGFUL_USE : InteractionType::TIME_CHECK,
+                                           static_cast<AppCategory>(i));
+            interruption.impact_score = 0.25 * i;
+            session.interruptions.push_back(interruption);
+        }
+        return session;
+    }
+
+    std::vector<SleepDetectionResult> nights(int first, int count) {
+        std::vector<SleepDetectionResult> sessions;
+        for (int n = first; n < first + count; ++n) {
+            sessions.push_back(night(n));
+        }
+        return sessions;
+    }
+
+    bool sameSession(const SleepDetectionResult& actual, const SleepDetectionResult& expected) {
+        bool same = actual.bedtime == expected.bedtime &&
+                    actual.wake_time == expected.wake_time &&
+                    std::abs(actual.duration.count() - expected.duration.count()) < 1e-6 &&
+                    actual.confidence == expected.confidence &&
+                    actual.is_manually_confirmed == expected.is_manually_confirmed &&
+                    std::abs(actual.quality_score - expected.quality_score) <= SCORE_STEP &&
+                    std::abs(actual.pattern_match_score - expected.pattern_match_score) <= SCORE_STEP &&
+                    actual.interruptions.size() == expected.interruptions.size();
+        for (size_t i = 0; same && i < actual.interruptions.size(); ++i) {
+            const auto& a = actual.interruptions[i];
+            const auto& e = expected.interruptions[i];
+            same = a.timestamp == e.timestamp && a.duration == e.duration && a.cause == e.cause &&
+                   a.app_category == e.app_category && a.is_brief_check == e.is_brief_check &&
+                   std::abs(a.impact_score - e.impact_score) <= SCORE_STEP;
+        }
+        return same;
+    }
+
+    /// Sessions equal to nights [first, first + count)
+    bool areNights(const std::vector<SleepDetectionResult>& sessions, int first, int count) {
+        if (sessions.size() != static_cast<size_t>(count)) {
+            return false;
+        }
+        for (int i = 0; i < count; ++i) {
+            if (!sameSession(sessions[i], night(first + i))) {
+                return false;
+            }
+        }
+        return true;
+    }
+
+    std::string archivePath(const char* name) {
+        char path[128];
+        std::snprintf(path, sizeof(path), "/tmp/puuyapu_test_%s_%d.psa", name, static_cast<int>(getpid()));
+        unlink(path);
+        return path;
+    }
+
+    void flipByte(const std::string& path, off_t offset_from_end) {
+        int fd = ::open(path.c_str(), O_RDWR);
+        off_t offset = lseek(fd, -offset_from_end, SEEK_END);
+        uint8_t byte = 0;
+        EXPECT_TRUE(pread(fd, &byte, 1, offset) == 1);
+        byte ^= 0x40;
+        EXPECT_TRUE(pwrite(fd, &byte, 1, offset) == 1);
+        ::close(fd);
+    }
+
+    std::string writeArchive(const char* name) {
+        std::string path = archivePath(name);
+        SessionArchive archive;
+        EXPECT_TRUE(archive.open(path));
+        EXPECT_EQ(archive.append(nights(0, NIGHTS)), static_cast<size_t>(NIGHTS));
+        return path;
+    }
+}
+
+PUUYAPU_TEST(session_records_round_trip) {
+    useUtc();
+    int64_t previous_ms = 0;
+    std::vector<uint8_t> bytes;
+    for (int n = 0; n < NIGHTS; ++n) {
+        SleepDetectionResult session = night(n);
+        size_t used = bytes.size();
+        bytes.resize(used + SessionArchive::maxRecordSize(session));
+        used += SessionArchive::encodeSession(session, previous_ms, bytes.data() + used);
+        bytes.resize(used);
+        previous_ms = std::chrono::duration_cast<milliseconds>(session.bedtime->time_since_epoch()).count();
+    }
+
+    // Decoding chains the bedtime deltas record by record
+    previous_ms = 0;
+    size_t offset = 0;
+    for (int n = 0; n < NIGHTS; ++n) {
+        SleepDetectionResult decoded;
+        size_t consumed = SessionArchive::decodeSession(bytes.data() + offset, bytes.size() - offset,
+                                                         previous_ms, decoded);
+        EXPECT_TRUE(consumed > 0);
+        EXPECT_TRUE(sameSession(decoded, night(n)));
+        offset += consumed;
+    }
+    EXPECT_EQ(offset, bytes.size());
+}
+
+PUUYAPU_TEST(truncated_record_is_rejected) {
+    useUtc();
+    SleepDetectionResult session = night(3);
+    std::vector<uint8_t> bytes(SessionArchive::maxRecordSize(session));
+    bytes.resize(SessionArchive::encodeSession(session, 0, bytes.data()));
+
+    for (size_t length = 0; length < bytes.size(); ++length) {
+        int64_t previous_ms = 0;
+        SleepDetectionResult decoded;
+        EXPECT_EQ(SessionArchive::decodeSession(bytes.data(), length, previous_ms, decoded), static_cast<size_t>(0));
+        EXPECT_EQ(previous_ms, 0);
+    }
+}
+
+PUUYAPU_TEST(reads_cross_month_boundaries) {
+    useUtc();
+    std::string path = writeArchive("months");
+
+    SessionArchive archive;
+    EXPECT_TRUE(archive.open(path));
+    EXPECT_EQ(archive.sessionCount(), static_cast<size_t>(NIGHTS));
+    EXPECT_EQ(archive.months().size(), static_cast<size_t>(3));
+
+    // January holds nights 0-11, including the 00:30 bedtime on February 1
+    int january_nights = static_cast<int>(FEBRUARY_1 - JANUARY_20);
+    int february_nights = static_cast<int>(MARCH_1 - FEBRUARY_1);
+    EXPECT_TRUE(areNights(archive.readMonth(2025, 1), 0, january_nights));
+    EXPECT_TRUE(areNights(archive.readMonth(2025, 2), january_nights, february_nights));
+    EXPECT_TRUE(archive.readMonth(2025, 4).empty());
+
+    // The last nights span March and February
+    EXPECT_TRUE(areNights(archive.readLastNights(10), NIGHTS - 10, 10));
+    EXPECT_TRUE(areNights(archive.readLastNights(NIGHTS + 5), 0, NIGHTS));
+    EXPECT_TRUE(archive.readLastNights(0).empty());
+
+    // Bedtime ranges trim the partial months at either end
+    EXPECT_TRUE(areNights(archive.readRange(dayStart(FEBRUARY_1 - 3), dayStart(FEBRUARY_1 + 3)),
+                          january_nights - 3, 6));
+    EXPECT_TRUE(areNights(archive.readRange(dayStart(JANUARY_20), dayStart(MARCH_1 + 30)), 0, NIGHTS));
+    EXPECT_TRUE(areNights(archive.readRange(*night(20).bedtime, *night(21).bedtime), 20, 1));
+    EXPECT_TRUE(archive.readRange(dayStart(MARCH_1 + 30), dayStart(MARCH_1 + 40)).empty());
+    unlink(path.c_str());
+}
+
+PUUYAPU_TEST(appends_in_pieces_match_one_append) {
+    useUtc();
+    std::string path = archivePath("pieces");
+    {
+        SessionArchive archive;
+        EXPECT_TRUE(archive.open(path));
+        // Overlapping windows: only sessions newer than the archive are added
+        for (int end = 4; end < NIGHTS + 4; end += 4) {
+            int first = std::max(0, end - 7);
+            archive.append(nights(first, std::min(end, NIGHTS) - first));
+        }
+        EXPECT_EQ(archive.append(nights(0, NIGHTS)), static_cast<size_t>(0));
+    }
+
+    SessionArchive archive;
+    EXPECT_TRUE(archive.open(path));
+    EXPECT_EQ(archive.sessionCount(), static_cast<size_t>(NIGHTS));
+    EXPECT_EQ(archive.months().size(), static_cast<size_t>(3));
+    EXPECT_TRUE(areNights(archive.readLastNights(NIGHTS), 0, NIGHTS));
+    unlink(path.c_str());
+}
+
+PUUYAPU_TEST(missing_file_opens_empty) {
+    std::string path = archivePath("missing");
+    SessionArchive archive;
+    EXPECT_TRUE(archive.open(path));
+    EXPECT_EQ(archive.sessionCount(), static_cast<size_t>(0));
+    EXPECT_TRUE(archive.readLastNights(5).empty());
+}
+
+PUUYAPU_TEST(damaged_footer_or_index_is_rejected) {
+    useUtc();
+    constexpr off_t FOOTER = SessionArchive::FOOTER_BYTES;
+
+    // Footer magic, footer index CRC, one byte of the last index entry
+    for (off_t from_end : {off_t(1), FOOTER - 16, FOOTER + 5}) {
+        std::string path = writeArchive("damaged");
+        flipByte(path, from_end);
+        SessionArchive archive;
+        EXPECT_TRUE(!archive.open(path));
+        EXPECT_EQ(archive.sessionCount(), static_cast<size_t>(0));
+        unlink(path.c_str());
+    }
+
+    // A torn tail moves the footer
+    std::string path = writeArchive("truncated");
+    struct stat info{};
+    EXPECT_EQ(stat(path.c_str(), &info), 0);
+    EXPECT_EQ(truncate(path.c_str(), info.st_size - 8), 0);
+    SessionArchive archive;
+    EXPECT_TRUE(!archive.open(path));
+    unlink(path.c_str());
+}
+
+PUUYAPU_TEST_MAIN()
@@ -0,0 +1,198 @@
+/**
+ * @file sleep_detector_tests.cpp
+ * @brief SleepDetector sealing and learning nights, and range statistics
+ *
+ * Runs in UTC with a ManualClock. Awake stretches are one meaningful
+ * interaction per minute; anything else is a gap, and a sleep starts at
+ * the last interaction before it.
+ */
+
+#include "test_harness.h"
+#include "sleep_detector.h"
+#include "pattern_matcher.h"
+#include "detector_snapshot.h"
+#include <cstdio>
+#include <cstdlib>
+#include <unistd.h>
+
+using namespace puuyapu;
+using namespace std::chrono;
+
+namespace {
+    constexpr int64_t DAY0 = 20000;     ///< 2024-10-04, a Friday
+
+    system_clock::time_point day0() {
+        return system_clock::time_point(hours(24 * DAY0));
+    }
+
+    void useUtc() {
+        setenv("TZ", "UTC", 1);
+        TimeZoneContext::shared().invalidate();
+    }
+
+    void addAwake(SleepDetector& detector, system_clock::time_point from, system_clock::time_point to) {
+        std::vector<InteractionEvent> events;
+        for (auto t = from; t < to; t += minutes(1)) {
+            events.emplace_back(t, seconds(20), InteractionType::MEANINGFUL_USE);
+        }
+        detector.addInteractionEvents(events.data(), events.size());
+    }
+
+    /// The detector's learned profile, read back through its snapshot
+    PatternMatcher learnedPatterns(const SleepDetector& detector, const std::string& path) {
+        PatternMatcher patterns;
+        DetectorSnapshot snapshot;
+        SnapshotReader reader;
+        EXPECT_TRUE(detector.writeSnapshot());
+        EXPECT_TRUE(snapshot.open(path));
+        EXPECT_TRUE(snapshot.section(SnapshotSection::PATTERNS, reader) && patterns.readFrom(reader));
+        return patterns;
+    }
+
+    std::string snapshotPath(const char* name) {
+        char path[128];
+        std::snprintf(path, sizeof(path), "/tmp/puuyapu_test_%s_%d.snap", name, static_cast<int>(getpid()));
+        unlink(path);
+        return path;
+    }
+}
+
+PUUYAPU_TEST(mid_night_detection_does_not_learn_the_open_night) {
+    useUtc();
+    ManualClock clock(day0());
+    SleepDetector detector(UserPreferences{}, clock);
+    std::string path = snapshotPath("mid_night");
+    detector.attachSnapshot(path);
+
+    // Friday: asleep 21:00-01:30, up for half an hour, asleep again 02:00-09:00
+    auto first_bedtime = day0() + hours(21) - minutes(1);
+    auto second_bedtime = day0() + hours(26) - minutes(1);
+    addAwake(detector, day0() + hours(7), first_bedtime + minutes(1));
+    addAwake(detector, day0() + hours(25) + minutes(30), second_bedtime + minutes(1));
+    detector.confirmManualSleep(first_bedtime);
+    detector.confirmManualSleep(second_bedtime);
+
+    // 02:30: the first stretch is a complete, confirmed sleep of a night still open
+    clock.set(second_bedtime + minutes(31));
+    SleepDetectionResult live = detector.detectSleepPeriod(clock.now());
+    EXPECT_TRUE(live.isValid() && live.is_manually_confirmed);
+    EXPECT_TRUE(live.bedtime == first_bedtime);
+    EXPECT_EQ(detector.getStatistics().learned_sleep_sessions, static_cast<size_t>(0));
+    EXPECT_EQ(detector.getStatistics().finalized_nights, static_cast<size_t>(0));
+
+    // Past Saturday noon the night seals with its longest sleep, and that is what is learned
+    addAwake(detector, day0() + hours(33), day0() + hours(37));
+    clock.set(day0() + hours(37));
+    detector.detectSleepPeriod(clock.now());
+    EXPECT_EQ(detector.getStatistics().finalized_nights, static_cast<size_t>(1));
+    EXPECT_EQ(detector.getStatistics().learned_sleep_sessions, static_cast<size_t>(1));
+
+    PatternMatcher patterns = learnedPatterns(detector, path);
+    int friday = TimeZoneContext::shared().toCivil(first_bedtime).weekday;
+    int saturday = TimeZoneContext::shared().toCivil(second_bedtime).weekday;
+    EXPECT_EQ(patterns.getExpectedBedtime(saturday), minutes(2 * 60 - 1));
+    EXPECT_EQ(patterns.getPatternConfidence(friday), 0.0);
+    unlink(path.c_str());
+}
+
+PUUYAPU_TEST(batch_detection_learns_every_sealed_night_once) {
+    useUtc();
+    ManualClock clock(day0());
+    SleepDetector detector(UserPreferences{}, clock);
+
+    // Four nights of 23:00-07:00 sleep, confirmed; at 02:00 the fourth is in progress
+    constexpr int NIGHTS = 4;
+    for (int night = 0; night < NIGHTS; ++night) {
+        auto morning = day0() + hours(24 * night + 7);
+        addAwake(detector, morning, morning + hours(16));
+        detector.confirmManualSleep(morning + hours(16));
+    }
+    clock.set(day0() + hours(24 * (NIGHTS - 1) + 23 + 3));
+
+    // The live pass seals and learns the newest closed night first...
+    detector.detectSleepPeriod(clock.now());
+    EXPECT_EQ(detector.getStatistics().learned_sleep_sessions, static_cast<size_t>(1));
+
+    // ...and the older nights the batch seals after it are still learned
+
+    auto results = detector.detectSleepPeriods(day0(), clock.now());
+    EXPECT_EQ(results.size(), static_cast<size_t>(NIGHTS - 1));
+    EXPECT_EQ(detector.getStatistics().finalized_nights, static_cast<size_t>(NIGHTS - 1));
+    EXPECT_EQ(detector.getStatistics().learned_sleep_sessions, static_cast<size_t>(NIGHTS - 1));
+
+    // Asking again finds them sealed and learns nothing twice
+    detector.detectSleepPeriods(day0(), clock.now());
+    EXPECT_EQ(detector.getStatistics().learned_sleep_sessions, static_cast<size_t>(NIGHTS - 1));
+}
+
+PUUYAPU_TEST(night_finalized_transition_seals_the_night_when_it_fires) {
+    useUtc();
+    ManualClock clock(day0());
+    SleepDetector detector(UserPreferences{}, clock);
+
+    // Asleep 23:00-07:00, then up until 10:00 with no event after noon yet
+    addAwake(detector, day0() + hours(7), day0() + hours(23));
+    addAwake(detector, day0() + hours(31), day0() + hours(34));
+    clock.set(day0() + hours(34));
+
+    StateTransition next = detector.getNextStateTransition(clock.now());
+    EXPECT_TRUE(next.kind == StateTransitionKind::NIGHT_FINALIZED);
+    EXPECT_TRUE(next.at == TimeZoneContext::shared().nightWindowStartOf(DAY0 + 1));
+
+    clock.set(next.at - milliseconds(1));
+    SleepDetectionResult before = detector.detectSleepPeriod(clock.now());
+    EXPECT_TRUE(before.isValid());
+    EXPECT_EQ(detector.getStatistics().finalized_nights, static_cast<size_t>(0));
+    EXPECT_EQ(detector.getStatistics().learned_sleep_sessions, static_cast<size_t>(0));
+
+    // At the reported instant the same night comes back sealed and learned
+    clock.set(next.at);
+    SleepDetectionResult after = detector.detectSleepPeriod(clock.now());
+    EXPECT_TRUE(after.bedtime == before.bedtime);
+    EXPECT_EQ(detector.getStatistics().finalized_nights, static_cast<size_t>(1));
+    EXPECT_EQ(detector.getStatistics().learned_sleep_sessions, static_cast<size_t>(1));
+
+    // Only sleep onset is left
+    next = detector.getNextStateTransition(clock.now());
+    EXPECT_TRUE(next.kind == StateTransitionKind::SLEEP_ONSET);
+    EXPECT_TRUE(next.at == day0() + hours(34) - minutes(1) + UserPreferences{}.minimum_interaction_gap);
+}
+
+PUUYAPU_TEST(sleep_statistics_cover_every_night_overlapping_the_range) {
+    useUtc();
+    ManualClock clock(day0());
+    SleepDetector detector(UserPreferences{}, clock);
+
+    // Six days up 07:00-23:00: nights 0-4 seal, night 5 is still open
+    for (int day = 0; day < 6; ++day) {
+        auto morning = day0() + hours(24 * day + 7);
+        addAwake(detector, morning, morning + hours(16));
+    }
+    clock.set(day0() + hours(24 * 5 + 23));
+    detector.detectSleepPeriods(day0(), clock.now());
+    EXPECT_EQ(detector.getStatistics().finalized_nights, static_cast<size_t>(5));
+
+    auto& time_zone = TimeZoneContext::shared();
+    auto windowStart = [&time_zone](int night) { return time_zone.nightWindowStartOf(DAY0 + night); };
+    auto sessions = [&detector](system_clock::time_point from, system_clock::time_point to) {
+        return detector.getSleepStatistics(from, to).range.sessions;
+    };
+
+    // Ranges on window boundaries hold exactly their nights
+    EXPECT_EQ(sessions(windowStart(1), windowStart(4)), 3u);
+    EXPECT_EQ(sessions(windowStart(0), windowStart(7)), 5u);
+
+    // A range ending inside a night includes that night
+    EXPECT_EQ(sessions(windowStart(1), windowStart(3) + milliseconds(1)), 3u);
+    EXPECT_EQ(sessions(windowStart(1), windowStart(3) + hours(14)), 3u);
+    EXPECT_EQ(sessions(windowStart(1) + hours(23), windowStart(4)), 3u);
+
+    // "The last seven days" at 01:00 counts the five sealed nights, not the open one
+    EXPECT_EQ(sessions(clock.now() + hours(2) - hours(24 * 7), clock.now() + hours(2)), 5u);
+
+    SleepDetector::SleepStatistics empty = detector.getSleepStatistics(windowStart(2), windowStart(2));
+    EXPECT_EQ(empty.range.sessions, 0u);
+    EXPECT_EQ(empty.target_sleep_hours, UserPreferences{}.target_sleep_hours.count());
+}
+
+PUUYAPU_TEST_MAIN()
@@ -0,0 +1,88 @@
+/**
+ * @file test_harness.h
+ * @brief Minimal dependency-free test runner for host builds
+ *
+ * Each test file is its own executable (one ctest entry), so process-wide
+ * state such as TimeZoneContext starts fresh. Tests register themselves
+ * with PUUYAPU_TEST; failed expectations are reported with file and line
+ * and fail the test without aborting it.
+ */
+
+#pragma once
+
+#include <cstdio>
+#include <cstring>
+#include <vector>
+
+namespace puuyapu {
+namespace test {
+
+    struct TestCase {
+        const char* name;
+        void (*body)();
+    };
+
+    inline std::vector<TestCase>& registry() {
+        static std::vector<TestCase> tests;
+        return tests;
+    }
+
+    /// Failed expectations of the running test
+    inline size_t& failures() {
+        static size_t count = 0;
+        return count;
+    }
+
+    inline bool registerTest(const char* name, void (*body)()) {
+        registry().push_back(TestCase{name, body});
+        return true;
+    }
+
+    inline void reportFailure(const char* file, int line, const char* expression) {
+        std::fprintf(stderr, "  %s:%d: expected %s\n", file, line, expression);
+        failures()++;
+    }
+
+    /**
+     * @brief Run every registered test, or those whose name contains argv[1]
+     * @return Process exit code (0 if all passed)
+     */
+    inline int runAll(int argc, char** argv) {
+        const char* filter = argc > 1 ? argv[1] : nullptr;
+        size_t failed = 0;
+        size_t run = 0;
+        for (const TestCase& test : registry()) {
+            if (filter && !std::strstr(test.name, filter)) {
+                continue;
+            }
+            failures() = 0;
+            test.body();
+            run++;
+            if (failures() > 0) {
+                failed++;
+            }
+            std::fprintf(stderr, "[%s] %s\n", failures() > 0 ? "FAIL" : " OK ", test.name);
+        }
+        std::fprintf(stderr, "%zu/%zu tests passed\n", run - failed, run);
+        return failed > 0 ? 1 : 0;
+    }
+
+} // namespace test
+} // namespace puuyapu
+
+#define PUUYAPU_TEST(name)                                                              \
+    static void name();                                                                 \
+    static const bool name##_registered = ::puuyapu::test::registerTest(#name, name);   \
+    static void name()
+
+#define EXPECT_TRUE(condition)                                                          \
+    do {                                                                                \
+        if (!(condition)) {                                                             \
+            ::puuyapu::test::reportFailure(__FILE__, __LINE__, #condition);             \
+        }                                                                               \
+    } while (0)
+
+#define EXPECT_EQ(actual, expected) EXPECT_TRUE((actual) == (expected))
+
+#define PUUYAPU_TEST_MAIN()                                                             \
+    int main(int argc, char** argv) { return ::puuyapu::test::runAll(argc, argv); }
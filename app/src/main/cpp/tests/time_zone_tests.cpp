@@ -0,0 +1,115 @@
+/**
+ * @file time_zone_tests.cpp
+ * @brief TimeZoneContext span cache across DST transitions
+ *
+ * Runs in a POSIX US Eastern zone (no tzdata needed): EST (-5h) until
+ * 2026-03-08 07:00 UTC, EDT (-4h) until 2026-11-01 06:00 UTC.
+ */
+
+#include "test_harness.h"
+#include "time_utils.h"
+#include <cstdlib>
+#include <ctime>
+
+using namespace puuyapu;
+
+namespace {
+    constexpr int64_t HOUR = 3600;
+    constexpr int64_t DAY = 24 * HOUR;
+    constexpr int64_t SPRING_FORWARD = 1772953200;     ///< 2026-03-08 07:00 UTC
+    constexpr int64_t FALL_BACK = 1793512800;          ///< 2026-11-01 06:00 UTC
+    constexpr int64_t NIGHT_OF_MARCH_7 = 20519;        ///< Local day of the evening before spring forward
+    constexpr int32_t EST = -5 * HOUR;
+    constexpr int32_t EDT = -4 * HOUR;
+
+    std::chrono::system_clock::time_point at(int64_t epoch_seconds) {
+        return std::chrono::system_clock::time_point(std::chrono::seconds(epoch_seconds));
+    }
+
+    int32_t libcOffsetAt(int64_t epoch_seconds) {
+        auto time_t = static_cast<std::time_t>(epoch_seconds);
+        std::tm tm{};
+        localtime_r(&time_t, &tm);
+        return static_cast<int32_t>(tm.tm_gmtoff);
+    }
+
+    TimeZoneContext& easternZone() {
+        setenv("TZ", "EST5EDT,M3.2.0,M11.1.0", 1);
+        TimeZoneContext& zone = TimeZoneContext::shared();
+        zone.invalidate();
+        return zone;
+    }
+}
+
+PUUYAPU_TEST(offsets_match_libc_around_transitions) {
+    TimeZoneContext& zone = easternZone();
+    for (int64_t transition : {SPRING_FORWARD, FALL_BACK}) {
+        for (int64_t t = transition - 2 * DAY; t <= transition + 2 * DAY; t += 599) {
+            EXPECT_EQ(zone.utcOffsetAt(at(t)), libcOffsetAt(t));
+        }
+        EXPECT_EQ(zone.utcOffsetAt(at(transition - 1)), libcOffsetAt(transition - 1));
+        EXPECT_EQ(zone.utcOffsetAt(at(transition)), libcOffsetAt(transition));
+    }
+}
+
+PUUYAPU_TEST(back_and_forth_across_a_transition_stays_cached) {
+    TimeZoneContext& zone = easternZone();
+    int64_t before = SPRING_FORWARD - DAY;
+    int64_t after = SPRING_FORWARD + DAY;
+
+    EXPECT_EQ(zone.utcOffsetAt(at(after)), EDT);
+    EXPECT_EQ(zone.utcOffsetAt(at(before)), EST);
+    uint64_t lookups = TimeZoneContext::systemLookupCount();
+
+    for (int i = 0; i < 100; ++i) {
+        EXPECT_EQ(zone.utcOffsetAt(at(before + i * 60)), EST);
+        EXPECT_EQ(zone.utcOffsetAt(at(after - i * 60)), EDT);
+    }
+    EXPECT_EQ(TimeZoneContext::systemLookupCount(), lookups);
+}
+
+PUUYAPU_TEST(future_lookup_keeps_the_current_span) {
+    TimeZoneContext& zone = easternZone();
+    int64_t now = SPRING_FORWARD - 2 * HOUR;
+
+    EXPECT_EQ(zone.utcOffsetAt(at(now)), EST);
+
+    // Night windows after the transition resolve the next span once
+    uint64_t refreshes = zone.refreshCount();
+    auto night = zone.toCivil(at(now)).night_index;
+    EXPECT_EQ(zone.nightWindowStartOf(night + 2), at((night + 2) * DAY + 12 * HOUR - EDT));
+    EXPECT_EQ(zone.refreshCount(), refreshes + 1);
+    uint64_t after_future = TimeZoneContext::systemLookupCount();
+
+    for (int i = 0; i < 100; ++i) {
+        EXPECT_EQ(zone.utcOffsetAt(at(now + i)), EST);
+        zone.nightWindowStartOf(night + 1 + i % 3);
+    }
+    EXPECT_EQ(TimeZoneContext::systemLookupCount(), after_future);
+}
+
+PUUYAPU_TEST(history_before_the_span_is_cached_after_the_first_lookup) {
+    TimeZoneContext& zone = easternZone();
+    EXPECT_EQ(zone.utcOffsetAt(at(SPRING_FORWARD + DAY)), EDT);
+
+    int64_t last_winter = SPRING_FORWARD - 100 * DAY;
+    EXPECT_EQ(zone.utcOffsetAt(at(last_winter)), EST);
+    uint64_t lookups = TimeZoneContext::systemLookupCount();
+
+    for (int i = 0; i < 100; ++i) {
+        EXPECT_EQ(zone.utcOffsetAt(at(last_winter + i * HOUR)), EST);
+        EXPECT_EQ(zone.utcOffsetAt(at(SPRING_FORWARD + DAY + i)), EDT);
+    }
+    EXPECT_EQ(TimeZoneContext::systemLookupCount(), lookups);
+}
+
+PUUYAPU_TEST(night_windows_start_at_local_noon_on_both_sides) {
+    TimeZoneContext& zone = easternZone();
+    EXPECT_EQ(zone.nightWindowStartOf(NIGHT_OF_MARCH_7),
+              at(NIGHT_OF_MARCH_7 * DAY + 12 * HOUR - EST));
+    EXPECT_EQ(zone.nightWindowStartOf(NIGHT_OF_MARCH_7 + 1),
+              at((NIGHT_OF_MARCH_7 + 1) * DAY + 12 * HOUR - EDT));
+    EXPECT_EQ(zone.toCivil(at(SPRING_FORWARD)).night_index, NIGHT_OF_MARCH_7);
+}
+
+PUUYAPU_TEST_MAIN()
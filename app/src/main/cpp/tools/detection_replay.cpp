@@ -0,0 +1,267 @@
+/**
+ * @file detection_replay.cpp
+ * @brief Deterministic, faster-than-real-time replay of recorded interaction streams
+ *
+ * Streams events through SleepDetector ingestion in order while a
+ * ManualClock follows the recording, running a detection pass every
+ * --detect-every-ms of simulated time (what the app's periodic check
+ * would have done). Reports ingestion throughput, the wall-clock latency
+ * distribution of those passes and every night detected at the end, as
+ * JSON on stdout. The same input and timezone always produce the same
+ * sessions and digest, so runs can be diffed across builds.
+ *
+ * Inputs:
+ *   --events <file>     InteractionEvent::serialize records, back to back
+ *                       (the addInteractionEventsPacked format)
+ *   --event-log <dir>   EventLog directory (use a copy: the log owns it)
+ *   --synthetic <events>:<days>  Seeded benchmark stream
+ *
+ * Usage: puuyapu_replay (--events <file> | --event-log <dir> | --synthetic <n>:<days>)
+ *                       [--detect-every-ms <ms>] [--tz <zone>] [--write-events <file>]
+ */
+
+#include "sleep_detector.h"
+#include "data_processor.h"
+#include "checksum.h"
+#include "synthetic_events.h"
+#include <algorithm>
+#include <cstdio>
+#include <cstdlib>
+#include <ctime>
+#include <memory>
+#include <string>
+#include <vector>
+
+using namespace puuyapu;
+
+namespace {
+
+    using std::chrono::milliseconds;
+    using std::chrono::system_clock;
+
+    bool readEventFile(const std::string& path, InteractionEventList& events) {
+        FILE* file = std::fopen(path.c_str(), "rb");
+        if (!file) {
+            std::fprintf(stderr, "cannot open %s\n", path.c_str());
+            return false;
+        }
+
+        uint8_t record[InteractionEvent::SERIALIZED_SIZE];
+        while (std::fread(record, sizeof(record), 1, file) == 1) {
+            events.push_back(InteractionEvent::deserialize(record));
+        }
+        bool truncated = !std::feof(file) || std::ftell(file) % InteractionEvent::SERIALIZED_SIZE != 0;
+        std::fclose(file);
+
+        if (truncated) {
+            std::fprintf(stderr, "%s: trailing partial record ignored\n", path.c_str());
+        }
+        return true;
+    }
+
+    bool readEventLog(const std::string& directory, InteractionEventList& events) {
+        EventLog log;
+        if (!log.open(directory, EventLog::Durability::NONE)) {
+            std::fprintf(stderr, "cannot open event log %s\n", directory.c_str());
+            return false;
+        }
+        log.forEach([&](const InteractionEvent& event) { events.push_back(event); });
+        return true;
+    }
+
+    bool writeEventFile(const std::string& path, const InteractionEventList& events) {
+        FILE* file = std::fopen(path.c_str(), "wb");
+        if (!file) {
+            std::fprintf(stderr, "cannot create %s\n", path.c_str());
+            return false;
+        }
+
+        uint8_t record[InteractionEvent::SERIALIZED_SIZE];
+        bool ok = true;
+        for (const auto& event : events) {
+            event.serialize(record);
+            ok = ok && std::fwrite(record, sizeof(record), 1, file) == 1;
+        }
+        return std::fclose(file) == 0 && ok;
+    }
+
+    int64_t epochMs(system_clock::time_point time_point) {
+        return std::chrono::duration_cast<milliseconds>(time_point.time_since_epoch()).count();
+    }
+
+    struct PassLatency {
+        size_t count{0};
+        double mean_us{0};
+        double p50_us{0};
+        double p90_us{0};
+        double p99_us{0};
+        double max_us{0};
+    };
+
+    PassLatency summarize(std::vector<double>& samples_us) {
+        PassLatency summary;
+        summary.count = samples_us.size();
+        if (samples_us.empty()) {
+            return summary;
+        }
+
+        std::sort(samples_us.begin(), samples_us.end());
+        auto at = [&](double quantile) {
+            return samples_us[static_cast<size_t>(quantile * static_cast<double>(samples_us.size() - 1))];
+        };
+        for (double value : samples_us) {
+            summary.mean_us += value / static_cast<double>(samples_us.size());
+        }
+        summary.p50_us = at(0.50);
+        summary.p90_us = at(0.90);
+        summary.p99_us = at(0.99);
+        summary.max_us = samples_us.back();
+        return summary;
+    }
+
+    int usage(const char* program) {
+        std::fprintf(stderr,
+                     "Usage: %s (--events <file> | --event-log <dir> | --synthetic <events>:<days>)\n"
+                     "          [--detect-every-ms <ms>] [--tz <zone>] [--write-events <file>]\n",
+                     program);
+        return 2;
+    }
+
+} // namespace
+
+int main(int argc, char** argv) {
+    std::string events_path;
+    std::string event_log_dir;
+    std::string write_path;
+    size_t synthetic_events = 0;
+    size_t synthetic_days = 0;
+    long detect_every_ms = 5 * 60 * 1000;
+
+    for (int i = 1; i < argc; ++i) {
+        std::string arg = argv[i];
+        if (arg == "--events" && i + 1 < argc) {
+            events_path = argv[++i];
+        } else if (arg == "--event-log" && i + 1 < argc) {
+            event_log_dir = argv[++i];
+        } else if (arg == "--synthetic" && i + 1 < argc) {
+            char* end = nullptr;
+            synthetic_events = std::strtoul(argv[++i], &end, 10);
+            synthetic_days = (end && *end == ':') ? std::strtoul(end + 1, nullptr, 10) : 0;
+            if (synthetic_events == 0 || synthetic_days == 0) {
+                return usage(argv[0]);
+            }
+        } else if (arg == "--detect-every-ms" && i + 1 < argc) {
+            detect_every_ms = std::max(1L, std::strtol(argv[++i], nullptr, 10));
+        } else if (arg == "--tz" && i + 1 < argc) {
+            // Before the first local-time conversion caches a span
+            setenv("TZ", argv[++i], 1);
+            tzset();
+        } else if (arg == "--write-events" && i + 1 < argc) {
+            write_path = argv[++i];
+        } else {
+            return usage(argv[0]);
+        }
+    }
+
+    InteractionEventList events;
+    bool loaded;
+    if (!events_path.empty()) {
+        loaded = readEventFile(events_path, events);
+    } else if (!event_log_dir.empty()) {
+        loaded = readEventLog(event_log_dir, events);
+    } else if (synthetic_events > 0) {
+        events = bench::SyntheticEventGenerator().generate(synthetic_events, synthetic_days).events;
+        loaded = true;
+    } else {
+        return usage(argv[0]);
+    }
+    if (!loaded) {
+        return 1;
+    }
+    if (events.empty()) {
+        std::fprintf(stderr, "no events to replay\n");
+        return 1;
+    }
+    if (!write_path.empty() && !writeEventFile(write_path, events)) {
+        return 1;
+    }
+
+    // Recorded order is ingestion order; simulated time only moves forward
+    const system_clock::time_point first = events.front().timestamp;
+    system_clock::time_point last = first;
+    for (const auto& event : events) {
+        last = std::max(last, event.timestamp + std::chrono::duration_cast<system_clock::duration>(event.duration));
+    }
+
+    ManualClock clock(first);
+    SleepDetector detector(UserPreferences{}, clock);
+
+    const milliseconds interval(detect_every_ms);
+    system_clock::time_point next_detection = first + interval;
+    std::vector<double> latencies_us;
+    size_t detected = 0;
+    latencies_us.reserve(static_cast<size_t>((last - first) / interval) + 2);
+
+    auto detectAt = [&](system_clock::time_point at) {
+        clock.set(at);
+        auto start = std::chrono::steady_clock::now();
+        SleepDetectionResult result = detector.detectSleepPeriod(clock.now());
+        auto elapsed = std::chrono::steady_clock::now() - start;
+        latencies_us.push_back(std::chrono::duration<double, std::micro>(elapsed).count());
+        detected += result.isValid() ? 1 : 0;
+    };
+
+    auto replay_start = std::chrono::steady_clock::now();
+    for (const auto& event : events) {
+        while (event.timestamp >= next_detection) {
+            detectAt(next_detection);
+            next_detection += interval;
+        }
+        clock.advanceTo(event.timestamp);
+        detector.addInteractionEvent(event);
+    }
+    detectAt(std::max(clock.now(), last));
+    auto replay_wall = std::chrono::steady_clock::now() - replay_start;
+
+    // Final sessions, one per night, in the packed layout for a stable digest
+    std::vector<SleepDetectionResult> sessions =
+            detector.detectSleepPeriods(first, last + std::chrono::hours(24));
+
+    uint32_t digest = 0;
+    std::vector<uint8_t> packed;
+    for (const auto& session : sessions) {
+        packed.resize(DataProcessor::packedResultSize(session));
+        DataProcessor::serializePacked(session, packed.data(), packed.size());
+        digest = crc32(packed.data(), packed.size()) ^ (digest * 31u);
+    }
+
+    double wall_seconds = std::chrono::duration<double>(replay_wall).count();
+    double simulated_seconds = std::chrono::duration<double>(last - first).count();
+    PassLatency latency = summarize(latencies_us);
+    SleepDetector::Statistics stats = detector.getStatistics();
+
+    std::printf("{\n  \"input\": {\"events\": %zu, \"first_ms\": %lld, \"last_ms\": %lld, \"detect_every_ms\": %ld},\n",
+                events.size(), static_cast<long long>(epochMs(first)), static_cast<long long>(epochMs(last)),
+                detect_every_ms);
+    std::printf("  \"throughput\": {\"wall_seconds\": %.4f, \"events_per_second\": %.0f, \"speedup\": %.0f, "
+                "\"dropped_events\": %zu},\n",
+                wall_seconds,
+                wall_seconds > 0 ? static_cast<double>(events.size()) / wall_seconds : 0.0,
+                wall_seconds > 0 ? simulated_seconds / wall_seconds : 0.0,
+                stats.ingress_dropped_events);
+    std::printf("  \"detection_latency_us\": {\"count\": %zu, \"mean\": %.1f, \"p50\": %.1f, \"p90\": %.1f, "
+                "\"p99\": %.1f, \"max\": %.1f, \"valid_results\": %zu},\n",
+                latency.count, latency.mean_us, latency.p50_us, latency.p90_us, latency.p99_us, latency.max_us, detected);
+    std::printf("  \"sessions\": [\n");
+    for (size_t i = 0; i < sessions.size(); ++i) {
+        const SleepDetectionResult& session = sessions[i];
+        std::printf("    {\"bedtime_ms\": %lld, \"wake_ms\": %lld, \"hours\": %.3f, \"confidence\": \"%s\", "
+                    "\"quality\": %.3f, \"interruptions\": %zu}%s\n",
+                    static_cast<long long>(session.bedtime ? epochMs(*session.bedtime) : 0),
+                    static_cast<long long>(session.wake_time ? epochMs(*session.wake_time) : 0),
+                    session.duration.count(), session.getConfidenceString(), session.quality_score,
+                    session.interruptions.size(), i + 1 < sessions.size() ? "," : "");
+    }
+    std::printf("  ],\n  \"digest\": \"%08x\"\n}\n", digest);
+    return 0;
+}